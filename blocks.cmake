@@ -69,4 +69,15 @@ add_custom_command(
     VERBATIM
 )
 
+add_custom_command(
+    OUTPUT ${Blocks_SOURCE_DIR}/items.hpp
+    COMMAND ${Python3_EXECUTABLE} protocol_item_ids.py -i ${CMAKE_BINARY_DIR}/registries-1.19.3.json -o ${Blocks_SOURCE_DIR}/
+    WORKING_DIRECTORY ${CMAKE_BINARY_DIR}/../generators
+    DEPENDS ${CMAKE_BINARY_DIR}/../generators/protocol_item_ids.py
+    MAIN_DEPENDENCY ${CMAKE_BINARY_DIR}/registries-1.19.3.json
+    VERBATIM
+)
+
+list(APPEND BLOCKS_SRC ${Blocks_SOURCE_DIR}/items.hpp)
+
 add_library(Blocks STATIC ${BLOCKS_SRC})
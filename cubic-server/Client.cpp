@@ -29,18 +29,23 @@
 #include "protocol/ServerPackets.hpp"
 #include "protocol/serialization/popPrimaryType.hpp"
 #include "types.hpp"
+#include "world_storage/Persistence.hpp"
 
 using boost::asio::ip::tcp;
 
 Client::Client(tcp::socket &&socket, size_t clientID):
     _isRunning(true),
+    _pendingPackets(0),
+    _stats(),
     _status(protocol::ClientStatus::Initial),
     _recvBuffer(0),
     _sendBuffer(2048 * 128 * 100 * 64),
     _player(nullptr),
+    _batchPackets(0),
     _socket(std::move(socket)),
     _clientID(clientID),
-    _isEncrypted(false)
+    _isEncrypted(false),
+    _playerDataUuid {0, 0}
 {
     LDEBUG("Creating client");
 }
@@ -53,6 +58,7 @@ Client::~Client()
 
     if (!_player)
         return;
+    Server::getInstance()->getStatusCache().onPlayerLeave();
     // Everything that is done here is because we can't use share_from_this from the player destructor
     this->_player->_dim->removeEntity(_player->_id);
     this->_player->_dim->removePlayer(_player->_id);
@@ -79,6 +85,7 @@ void Client::doRead()
             // Server::getInstance()->triggerClientCleanup(_clientID);
             return;
         }
+        _stats.onRead(length);
         if (_isEncrypted)
             _encryption.decrypt((uint8_t *) _readBuffer, length);
         _recvBuffer.insert(_recvBuffer.end(), _readBuffer, _readBuffer + length);
@@ -88,10 +95,55 @@ void Client::doRead()
 }
 
 void Client::doWrite(std::unique_ptr<std::vector<uint8_t>> &&data)
+{
+    {
+        // Every packet is prefixed by its length then its id
+        uint8_t *at = data->data();
+        uint8_t *eof = at + data->size();
+        protocol::popVarInt(at, eof);
+        _stats.onPacketOut(_status, protocol::popVarInt(at, eof), data->size());
+    }
+
+    std::lock_guard _(_batchMutex);
+    // Nothing is ticking for the client before the play state, there is no point in waiting
+    if (_status != protocol::ClientStatus::Play) {
+        this->_write(std::move(data), 1);
+        return;
+    }
+
+    if (_batch.empty() && data->size() >= MAX_BATCH_SIZE) {
+        this->_write(std::move(data), 1);
+        return;
+    }
+    _batch.insert(_batch.end(), data->begin(), data->end());
+    _batchPackets++;
+    if (_batch.size() >= MAX_BATCH_SIZE)
+        this->_writeBatch();
+}
+
+void Client::flush()
+{
+    std::lock_guard _(_batchMutex);
+    this->_writeBatch();
+}
+
+void Client::_writeBatch()
+{
+    if (_batch.empty())
+        return;
+    auto data = std::make_unique<std::vector<uint8_t>>(std::move(_batch));
+    _batch = std::vector<uint8_t>();
+    _batch.reserve(data->capacity());
+    this->_write(std::move(data), _batchPackets);
+    _batchPackets = 0;
+}
+
+void Client::_write(std::unique_ptr<std::vector<uint8_t>> &&data, size_t packets)
 {
     if (_isEncrypted)
         _encryption.encrypt(*data);
-    Server::getInstance()->sendData(_clientID, std::move(data));
+    _pendingPackets += packets;
+    Server::getInstance()->sendData(_clientID, std::move(data), packets);
 }
 
 bool Client::isDisconnected() const { return !_isRunning; }
@@ -99,6 +151,7 @@ bool Client::isDisconnected() const { return !_isRunning; }
 void Client::switchToPlayState(u128 playerUuid, const std::string &username)
 {
     this->setStatus(protocol::ClientStatus::Play);
+    Server::getInstance()->getStatusCache().onPlayerJoin();
     LDEBUG("Switched to play state");
     // TODO: get the player dimension from the world by his uuid
     this->_player =
@@ -226,6 +279,7 @@ void Client::_handlePacket()
         bool error = false;
         // Handle the packet if the length is there
         const auto packetId = static_cast<protocol::ServerPacketsID>(protocol::popVarInt(at, eof));
+        _stats.onPacketIn(_status, static_cast<int32_t>(packetId), (startPayload - data.data()) + length);
         std::function<std::unique_ptr<protocol::BaseServerPacket>(std::vector<uint8_t> &)> parser;
         PARSER_IT_DECLARE(Initial);
         PARSER_IT_DECLARE(Login);
@@ -273,45 +327,33 @@ void Client::_onStatusRequest(UNUSED protocol::StatusRequest &pck)
 {
     N_LDEBUG("Got a status request");
 
-    auto srv = Server::getInstance();
-    auto conf = srv->getConfig();
-    auto &cli = srv->getClients();
-    auto worldGroup = srv->getWorldGroup("default");
-
-    // TODO: Fix this
-    nlohmann::json json;
-
-    json["previewsChat"] = false;
-    json["favicon"] = DEFAULT_FAVICON; // TODO: Understand how this works, cause right now it is witchcraft
-    json["description"]["text"] = conf["motd"].value();
-    json["enforcesSecureChat"] = false;
-
-    // Old
-    if (!worldGroup->isInitialized()) {
-        sendStatusResponse(json.dump());
+    if (!this->_allowStatusRequest())
         return;
-    }
-
-    json["version"]["name"] = MC_VERSION;
-    json["version"]["protocol"] = MC_PROTOCOL;
-    json["players"]["max"] = conf["max-players"].as<int32_t>();
-    {
-        std::lock_guard _(srv->clientsMutex);
-        json["players"]["online"] = std::count_if(cli.begin(), cli.end(), [](std::pair<size_t, std::shared_ptr<Client>> each) {
-            return each.second->getStatus() == protocol::ClientStatus::Play;
-        });
-    }
-
-    sendStatusResponse(json.dump());
+    doWrite(std::make_unique<std::vector<uint8_t>>(*Server::getInstance()->getStatusCache().get()));
 }
 
 void Client::_onPingRequest(protocol::PingRequest &pck)
 {
     N_LDEBUG("Got a ping request");
 
+    if (!this->_allowStatusRequest())
+        return;
     sendPingResponse(pck.payload);
 }
 
+bool Client::_allowStatusRequest()
+{
+    boost::system::error_code ec;
+    auto endpoint = _socket.remote_endpoint(ec);
+    if (!ec && Server::getInstance()->getStatusLimiter().allow(endpoint.address()))
+        return true;
+
+    // Server list floods are dropped without an answer
+    N_LDEBUG("Too many status requests, closing the connection");
+    _isRunning = false;
+    return false;
+}
+
 void Client::_onLoginStart(protocol::LoginStart &pck)
 {
     N_LDEBUG("Got a Login Start");
@@ -328,6 +370,8 @@ void Client::_onLoginStart(protocol::LoginStart &pck)
         this->disconnect("You are not whitelisted on this server.");
         return;
     }
+    // Read from disk while the client goes through the encryption and the authentication
+    this->_loadPlayerData(resPck.uuid);
     if (CONFIG["online-mode"].as<bool>()) {
         _resPck = resPck;
         sendEncryptionRequest();
@@ -463,6 +507,8 @@ void Client::sendLoginSuccess(const protocol::LoginSuccess &packet)
 
 void Client::sendLoginPlay()
 {
+    // Kept alive until the packet is serialized
+    auto loginPayloads = Server::getInstance()->getLoginCache().get();
     protocol::LoginPlay resPck = {
         .entityID = _player->getId(), // TODO: figure out what is this
         .isHardcore = false, // TODO: something like this this->_player->_dim->getWorld()->getDifficulty(); Thats not difficulty tho (peaceful, easy, normal, hard)
@@ -470,104 +516,7 @@ void Client::sendLoginPlay()
         .previousGamemode =
             player_attributes::Gamemode::Survival, // TODO: something like this this->_player->getPreviousGamemode().has_value() ? this->_player->getPreviousGamemode() : -1;
         .dimensionNames = std::vector<std::string>({"minecraft:overworld"}), // TODO: something like this this->_player->_dim->getWorld()->getDimensions();
-        // clang-format off
-        .registryCodec = std::shared_ptr<nbt::Compound>(new nbt::Compound("", {
-            NBT_MAKE(nbt::Compound, "minecraft:dimension_type", {
-                NBT_MAKE(nbt::String, "type", "minecraft:dimension_type"),
-                NBT_MAKE(nbt::List, "value", {
-                    NBT_MAKE(nbt::Compound, "", {
-                        NBT_MAKE(nbt::String, "name", "minecraft:overworld"),
-                        NBT_MAKE(nbt::Int, "id", 0),
-                        NBT_MAKE(nbt::Compound, "element", {
-                            NBT_MAKE(nbt::Byte, "ultrawarm", 0),
-                            NBT_MAKE(nbt::Int, "logical_height", 256),
-                            NBT_MAKE(nbt::String, "infiniburn", "#minecraft:infiniburn_overworld"),
-                            NBT_MAKE(nbt::Byte, "piglin_safe", 0),
-                            NBT_MAKE(nbt::Float, "ambient_light", 0.0),
-                            NBT_MAKE(nbt::Byte, "has_skylight", 1),
-                            NBT_MAKE(nbt::String, "effects", "minecraft:overworld"),
-                            NBT_MAKE(nbt::Byte, "has_raids", 1),
-                            NBT_MAKE(nbt::Int, "monster_spawn_block_light_limit", 0),
-                            NBT_MAKE(nbt::Byte, "respawn_anchor_works", 0),
-                            NBT_MAKE(nbt::Int, "height", 384),
-                            NBT_MAKE(nbt::Byte, "has_ceiling", 0),
-                            NBT_MAKE(nbt::Compound, "monster_spawn_light_level", {
-                                NBT_MAKE(nbt::String, "type", "minecraft:uniform"),
-                                NBT_MAKE(nbt::Compound, "value", {
-                                    NBT_MAKE(nbt::Int, "max_inclusive", 7),
-                                    NBT_MAKE(nbt::Int, "min_inclusive", 0)
-                                })
-                            }),
-                            NBT_MAKE(nbt::Byte, "natural", 1),
-                            NBT_MAKE(nbt::Int, "min_y", -64),
-                            NBT_MAKE(nbt::Float, "coordinate_scale", 1.0),
-                            NBT_MAKE(nbt::Byte, "bed_works", 1)
-                        })
-                    })
-                })
-            }),
-            NBT_MAKE(nbt::Compound, "minecraft:worldgen/biome", {
-                NBT_MAKE(nbt::String, "type", "minecraft:worldgen/biome"),
-                NBT_MAKE(nbt::List, "value", {
-                    NBT_MAKE(nbt::Compound, "", {
-                        NBT_MAKE(nbt::String, "name", "minecraft:plains"),
-                        NBT_MAKE(nbt::Int, "id", 0),
-                        NBT_MAKE(nbt::Compound, "element", {
-                            NBT_MAKE(nbt::String, "precipitation", "none"),
-                            NBT_MAKE(nbt::Float, "temperature", 0.8),
-                            NBT_MAKE(nbt::Float, "downfall", 0.4),
-                            NBT_MAKE(nbt::Compound, "effects", {
-                                NBT_MAKE(nbt::Int, "sky_color", 7907327),
-                                NBT_MAKE(nbt::Int, "water_fog_color", 329011),
-                                NBT_MAKE(nbt::Int, "fog_color", 12638463),
-                                NBT_MAKE(nbt::Int, "water_color", 4159204),
-                            })
-                        }),
-                    }),
-                    NBT_MAKE(nbt::Compound, "", {
-                        NBT_MAKE(nbt::String, "name", "minecraft:my_super_cool_biome_lol_haha"),
-                        NBT_MAKE(nbt::Int, "id", 1),
-                        NBT_MAKE(nbt::Compound, "element", {
-                            NBT_MAKE(nbt::String, "precipitation", "none"),
-                            NBT_MAKE(nbt::Float, "temperature", 0.8),
-                            NBT_MAKE(nbt::Float, "downfall", 0.4),
-                            NBT_MAKE(nbt::Compound, "effects", {
-                                NBT_MAKE(nbt::Int, "sky_color", 7907327),
-                                NBT_MAKE(nbt::Int, "water_fog_color", 329011),
-                                NBT_MAKE(nbt::Int, "fog_color", 12638463),
-                                NBT_MAKE(nbt::Int, "water_color", 4159204),
-                            })
-                        }),
-                    })
-                })
-            }),
-            NBT_MAKE(nbt::Compound, "minecraft:chat_type", {
-                NBT_MAKE(nbt::String, "type", "minecraft:chat_type"),
-                NBT_MAKE(nbt::List, "value", {
-                    NBT_MAKE(nbt::Compound, "", {
-                        NBT_MAKE(nbt::String, "name", "minecraft:chat"),
-                        NBT_MAKE(nbt::Int, "id", 0),
-                        NBT_MAKE(nbt::Compound, "element", {
-                            NBT_MAKE(nbt::Compound, "chat", {
-                                NBT_MAKE(nbt::List, "parameters", {
-                                    NBT_MAKE(nbt::String, "", "sender"),
-                                    NBT_MAKE(nbt::String, "", "content")
-                                }),
-                                NBT_MAKE(nbt::String, "translation_key", "chat.type.text"),
-                            }),
-                            NBT_MAKE(nbt::Compound, "narration", {
-                                NBT_MAKE(nbt::List, "parameters", {
-                                    NBT_MAKE(nbt::String, "", "sender"),
-                                    NBT_MAKE(nbt::String, "", "content")
-                                }),
-                                NBT_MAKE(nbt::String, "translation_key", "chat.type.text.narrate"),
-                            })
-                        })
-                    })
-                })
-            })
-        })),
-        // clang-format on
+        .registryCodec = loginPayloads->registryCodec,
         .dimensionType = "minecraft:overworld", // TODO: something like this this->_player->_dim->getDimensionType();
         .dimensionName = "overworld", // TODO: something like this this->_player->getDimension()->name;
         .hashedSeed = 0, // TODO: something like this this->_player->_dim->getWorld()->getHashedSeed();
@@ -583,7 +532,6 @@ void Client::sendLoginPlay()
         .deathLocation = {0, 0, 0},
     };
     _player->sendLoginPlay(resPck);
-    // resPck.registryCodec.destroy();
 }
 
 void Client::disconnect(const chat::Message &reason)
@@ -604,11 +552,24 @@ void Client::_loginSequence(const protocol::LoginSuccess &pck)
     // Encryption request
     // Set Compression
     this->sendLoginSuccess(pck);
+    // The session server knows the real uuid of the player, not the client
+    if (pck.uuid.most != _playerDataUuid.most || pck.uuid.least != _playerDataUuid.least)
+        this->_loadPlayerData(pck.uuid);
     this->switchToPlayState(pck.uuid, pck.username);
+    this->_player->_loadData(std::move(_playerData));
     this->sendLoginPlay();
     this->_player->_continueLoginSequence();
 }
 
+void Client::_loadPlayerData(u128 uuid)
+{
+    auto *persistence = Server::getInstance()->getWorldGroup("default")->getWorld("default")->getPersistence();
+
+    _playerDataUuid = uuid;
+    if (persistence)
+        _playerData = persistence->loadPlayerDataAsync(uuid);
+}
+
 std::shared_ptr<Player> Client::getPlayer() { return _player; }
 
 const std::shared_ptr<Player> Client::getPlayer() const { return _player; }
@@ -3,17 +3,21 @@
 
 #include <arpa/inet.h>
 #include <boost/asio.hpp>
+#include <future>
 #include <memory>
 #include <netinet/in.h>
+#include <optional>
 #include <thread>
 #include <vector>
 
 #include "EASEncryptionHandler.hpp"
 #include "chat/Message.hpp"
+#include "metrics/ClientStats.hpp"
 #include "options.hpp"
 #include "protocol/ClientPackets.hpp"
 #include "protocol/ServerPackets.hpp"
 #include "protocol/common.hpp"
+#include "world_storage/PlayerData.hpp"
 #include <boost/circular_buffer.hpp>
 #include <boost/container/deque.hpp>
 
@@ -49,6 +53,8 @@ constexpr const char DEFAULT_FAVICON[] =
     "sdLO1W1lblzNWmFlbl7uiDcvd1r516TjPwaZkJJGXel5AAAAAElFTkSuQmCC";
 
 constexpr auto _readBufferSize = 2048;
+// Packets of a playing client are written once per tick, or as soon as they add up to this many bytes
+constexpr size_t MAX_BATCH_SIZE = 64 * 1024;
 
 class Player;
 
@@ -61,11 +67,33 @@ public:
 
     void run();
     void doRead();
+    /**
+     * @brief Send a packet, it is batched until the end of the tick once the client is playing
+     *
+     * @note This function is thread-safe
+     */
     void doWrite(std::unique_ptr<std::vector<uint8_t>> &&data);
+    /**
+     * @brief Hand the batched packets over to the write thread as a single write
+     *
+     * @note This function is thread-safe
+     */
+    void flush();
     NODISCARD inline std::thread &getThread() { return _thread; };
 
     NODISCARD bool isDisconnected() const;
     NODISCARD protocol::ClientStatus getStatus() const { return _status; }
+    /**
+     * @brief Number of packets handed to the write thread and not on the socket yet, a batch counts for all of its packets
+     */
+    NODISCARD size_t pendingPackets() const { return _pendingPackets; }
+    void onDataWritten(size_t bytes, size_t packets, std::chrono::steady_clock::duration latency)
+    {
+        _pendingPackets -= packets;
+        _stats.onWritten(bytes, latency);
+    }
+    NODISCARD metrics::ClientStats &getStats() { return _stats; }
+    NODISCARD const metrics::ClientStats &getStats() const { return _stats; }
 
     void setStatus(protocol::ClientStatus status) { _status = status; }
     void switchToPlayState(u128 playerUuid, const std::string &username);
@@ -90,18 +118,30 @@ private:
     void _handlePacket();
     void _flushSendData();
     void _tryFlushAllSendData();
+    void _writeBatch();
+    void _write(std::unique_ptr<std::vector<uint8_t>> &&data, size_t packets);
     // void _sendData(std::vector<uint8_t> &data);
     void _onHandshake(protocol::Handshake &pck);
     void _onStatusRequest(protocol::StatusRequest &pck);
     void _onLoginStart(protocol::LoginStart &pck);
     void _onPingRequest(protocol::PingRequest &pck);
+    /**
+     * @brief Take a token from the status rate limiter, closing the connection if there is none left
+     */
+    bool _allowStatusRequest();
     void _onEncryptionResponse(protocol::EncryptionResponse &pck);
     void _loginSequence(const protocol::LoginSuccess &packet);
     bool _handleOnline(const std::array<uint8_t, 16> &key);
+    /**
+     * @brief Start reading the player data from disk, it is handed to the player when the login is done
+     */
+    void _loadPlayerData(u128 uuid);
     NODISCARD inline const std::vector<protocol::PlayerProperty> &getProperties() const { return _resPck.properties; }
 
 private:
     std::atomic<bool> _isRunning;
+    std::atomic<size_t> _pendingPackets;
+    metrics::ClientStats _stats;
     protocol::ClientStatus _status;
     std::vector<uint8_t> _recvBuffer;
     char _readBuffer[_readBufferSize];
@@ -109,6 +149,10 @@ private:
     boost::circular_buffer<uint8_t> _sendBuffer;
     std::shared_ptr<Player> _player;
     std::mutex _writeMutex;
+    // Also keeps the encryption in the same order as the writes
+    std::mutex _batchMutex;
+    std::vector<uint8_t> _batch;
+    size_t _batchPackets;
     boost::asio::ip::tcp::socket _socket;
     // boost::lockfree::queue<uint8_t> _toSend;
     boost::container::deque<std::unique_ptr<uint8_t>> _toSend;
@@ -117,6 +161,8 @@ private:
     bool _isEncrypted;
     EASEncryptionHandler _encryption;
     protocol::LoginSuccess _resPck;
+    std::future<std::optional<world_storage::PlayerData>> _playerData;
+    u128 _playerDataUuid;
 };
 
 #endif // CUBICSERVER_CLIENT_HPP
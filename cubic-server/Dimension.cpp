@@ -6,47 +6,117 @@
 #include "World.hpp"
 #include "logging/logging.hpp"
 #include "math/Vector3.hpp"
+#include "profiling/Profiler.hpp"
 #include "protocol/ClientPackets.hpp"
 #include "types.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <latch>
 #include <memory>
 #include <mutex>
-#include <thread>
+#include <unordered_map>
 
 Dimension::Dimension(std::shared_ptr<World> world, world_storage::DimensionType dimensionType):
-    _dimensionLock(std::counting_semaphore<1000>(0)),
     _world(world),
     _isInitialized(false),
     _isRunning(false),
+    _tickDuration(0),
     _dimensionType(dimensionType)
 {
 }
 
-void Dimension::tick()
+static int32_t getEntityRegion(double pos) { return transformBlockPosToChunkPos(static_cast<int64_t>(std::floor(pos))) >> ENTITY_REGION_SHIFT; }
+
+void Dimension::tick() { this->_tickEntities(); }
+
+void Dimension::_tickEntities()
 {
-    std::lock_guard _(_entitiesMutex);
-    for (auto ent : _entities) {
-        ent->tick();
+    PROFILE_ZONE("Entity tick");
+
+    // Entities added or removed while ticking are taken into account on the next tick
+    std::vector<std::shared_ptr<Entity>> entities;
+    {
+        std::lock_guard _(_entitiesMutex);
+        entities = _entities;
     }
+
+    auto &pool = _world->getEntityTickPool();
+    if (entities.size() < MIN_ENTITIES_FOR_PARALLEL_TICK || pool.getWorkerNb() == 0) {
+        for (auto &ent : entities)
+            ent->tick();
+    } else {
+        std::unordered_map<Position2D, std::vector<Entity *>> regionMap;
+        for (auto &ent : entities) {
+            const auto &pos = ent->getPosition();
+            regionMap[{getEntityRegion(pos.x), getEntityRegion(pos.z)}].push_back(ent.get());
+        }
+        std::vector<const std::vector<Entity *> *> regions;
+        regions.reserve(regionMap.size());
+        for (const auto &[_, region] : regionMap)
+            regions.push_back(&region);
+
+        // Workers pull regions until there are none left, this thread works too so a busy pool never stalls the tick
+        std::atomic<size_t> nextRegion = 0;
+        auto tickRegions = [&regions, &nextRegion] {
+            for (size_t i = nextRegion++; i < regions.size(); i = nextRegion++) {
+                PROFILE_ZONE("Entity region tick");
+                for (auto ent : *regions[i]) {
+                    try {
+                        ent->tick();
+                    } catch (const std::exception &e) {
+                        LERROR("Entity {} tick failed: {}", ent->getId(), e.what());
+                    }
+                }
+            }
+        };
+        auto helpers = std::min<size_t>(regions.size() - 1, pool.getWorkerNb());
+        std::latch done(helpers);
+        for (size_t i = 0; i < helpers; i++) {
+            pool.addJob([&tickRegions, &done] {
+                tickRegions();
+                done.count_down();
+            });
+        }
+        tickRegions();
+        done.wait();
+    }
+
+    PROFILE_ZONE("Deferred entity actions");
+    std::vector<std::function<void()>> deferred;
+    {
+        std::lock_guard _(_deferredMutex);
+        deferred.swap(_deferred);
+    }
+    for (auto &action : deferred)
+        action();
+}
+
+void Dimension::defer(std::function<void()> action)
+{
+    std::lock_guard _(_deferredMutex);
+    _deferred.emplace_back(std::move(action));
+}
+
+void Dimension::timedTick()
+{
+    PROFILE_ZONE("Dimension tick");
+    auto start = std::chrono::steady_clock::now();
+    this->tick();
+    _tickDuration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 void Dimension::stop()
 {
+    // The world group joins its tick before stopping the worlds, no tick is running here
     this->_isRunning = false;
-    this->_dimensionLock.release(_dimensionLock.max());
-
-    if (_processingThread.joinable())
-        _processingThread.join();
-    // TODO: Save the dimension
+    // The world saves the modified chunks before stopping its dimensions
 
     _level.clear();
 }
 
-void Dimension::initialize()
-{
-    this->_isRunning = true;
-    this->_processingThread = std::thread(&Dimension::_run, this);
-}
+void Dimension::initialize() { this->_isRunning = true; }
 
 bool Dimension::isInitialized() const { return _isInitialized; }
 
@@ -54,7 +124,9 @@ std::shared_ptr<World> Dimension::getWorld() { return _world; }
 
 const std::shared_ptr<World> Dimension::getWorld() const { return _world; }
 
-std::counting_semaphore<1000> &Dimension::getDimensionLock() { return _dimensionLock; }
+bool Dimension::isRunning() const { return _isRunning; }
+
+double Dimension::getTickDuration() const { return _tickDuration; }
 
 std::vector<std::shared_ptr<Entity>> &Dimension::getEntities() { return _entities; }
 
@@ -178,22 +250,16 @@ void Dimension::loadOrGenerateChunk(int x, int z, std::shared_ptr<Player> player
     return;
 }
 
-void Dimension::_run()
-{
-    // TODO(huntears): Remove this busy loop
-    while (this->_isRunning && !this->_isInitialized)
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-    while (this->_isRunning) {
-        this->_dimensionLock.acquire();
-        this->tick();
-    }
-}
-
 std::vector<std::shared_ptr<Player>> &Dimension::getPlayers() { return _players; }
 
 const std::vector<std::shared_ptr<Player>> &Dimension::getPlayers() const { return _players; }
 
+std::vector<std::shared_ptr<Player>> Dimension::copyPlayers() const
+{
+    std::lock_guard _(_playersMutex);
+    return _players;
+}
+
 bool Dimension::hasChunkLoaded(int x, int z) const { return this->_level.hasChunkColumn(x, z); }
 
 void Dimension::removePlayerFromLoadingChunk(const Position2D &pos, std::shared_ptr<Player> player)
@@ -232,18 +298,18 @@ void Dimension::spawnPlayer(Player &current)
     auto current_id = current.getId();
     std::lock_guard _(_playersMutex);
     for (auto player : _players) {
-        LDEBUG("player is: {}", player->getUsername());
-        LDEBUG("current is: {}", current.getUsername());
+        LTRACE("player is: {}", player->getUsername());
+        LTRACE("current is: {}", current.getUsername());
         // if (current->getPos().distance(player->getPos()) <= 12) {
         if (player->getId() != current_id) {
             player->sendSpawnPlayer(
                 {current_id, current.getUuid(), current.getPosition().x, current.getPosition().y, current.getPosition().z, current.getRotation().x, current.getRotation().z}
             );
-            LDEBUG("send spawn player to {}", player->getUsername());
+            LTRACE("send spawn player to {}", player->getUsername());
             current.sendSpawnPlayer(
                 {player->getId(), player->getUuid(), player->getPosition().x, player->getPosition().y, player->getPosition().z, player->getRotation().x, player->getRotation().z}
             );
-            LDEBUG("send spawn player to {}", current.getUsername());
+            LTRACE("send spawn player to {}", current.getUsername());
             //}
         }
         player->sendSkinLayers(current_id);
@@ -287,13 +353,102 @@ void Dimension::updateBlock(Position position, int32_t id)
     if (z < 0)
         z += 16;
 
-    chunk.updateBlock({x, position.y, z}, id);
+    {
+        std::lock_guard _(_dirtyChunksMutex);
+        chunk.updateBlock({x, position.y, z}, id);
+        this->_markDirty(chunk);
+    }
     std::lock_guard _(_playersMutex);
     for (auto player : _players) {
         player->sendBlockUpdate({position, id});
     }
 }
 
+void Dimension::markChunkDirty(const Position2D &pos)
+{
+    std::lock_guard _(_dirtyChunksMutex);
+    if (_level.hasChunkColumn(pos))
+        this->_markDirty(_level.getChunkColumn(pos));
+}
+
+void Dimension::_markDirty(world_storage::ChunkColumn &chunk)
+{
+    if (chunk.isDirty())
+        return;
+    chunk.setDirty(true);
+    _dirtyChunks.emplace_back(chunk.getChunkPos(), std::chrono::steady_clock::now());
+}
+
+std::optional<world_storage::ChunkSnapshot> Dimension::takeDirtyChunk(std::chrono::steady_clock::time_point modifiedBefore)
+{
+    std::lock_guard _(_dirtyChunksMutex);
+    while (!_dirtyChunks.empty() && _dirtyChunks.front().second <= modifiedBefore) {
+        const auto pos = _dirtyChunks.front().first;
+        _dirtyChunks.pop_front();
+        // Chunks saved by snapshotChunk meanwhile are skipped
+        if (!_level.hasChunkColumn(pos) || !_level.getChunkColumn(pos).isDirty())
+            continue;
+        auto &chunk = _level.getChunkColumn(pos);
+        // The generation writes its sections without the lock, the chunk waits for it to end
+        if (!chunk.isReady()) {
+            _dirtyChunks.emplace_back(pos, std::chrono::steady_clock::now());
+            continue;
+        }
+        chunk.setDirty(false);
+        _savingChunks[pos]++;
+        return chunk.snapshot();
+    }
+    return std::nullopt;
+}
+
+std::optional<world_storage::ChunkSnapshot> Dimension::snapshotChunk(const Position2D &pos)
+{
+    std::lock_guard _(_dirtyChunksMutex);
+    if (!_level.hasChunkColumn(pos) || !_level.getChunkColumn(pos).isReady())
+        return std::nullopt;
+    auto &chunk = _level.getChunkColumn(pos);
+    chunk.setDirty(false);
+    _savingChunks[pos]++;
+    return chunk.snapshot();
+}
+
+void Dimension::onChunkSaved(const Position2D &pos, bool saved)
+{
+    std::lock_guard _(_dirtyChunksMutex);
+    if (--_savingChunks[pos] == 0)
+        _savingChunks.erase(pos);
+    if (saved || !_level.hasChunkColumn(pos))
+        return;
+    this->_markDirty(_level.getChunkColumn(pos));
+}
+
+bool Dimension::unloadChunk(const Position2D &pos)
+{
+    {
+        // Generating a chunk touches its neighbours, and a player may walk a chunk further before we are done
+        const int32_t distance = _world->getRenderDistance() + 2;
+        std::lock_guard _(_playersMutex);
+        for (const auto &player : _players) {
+            const auto &playerPos = player->getPosition();
+            const int32_t x = transformBlockPosToChunkPos(static_cast<int64_t>(std::floor(playerPos.x)));
+            const int32_t z = transformBlockPosToChunkPos(static_cast<int64_t>(std::floor(playerPos.z)));
+            if (std::abs(x - pos.x) <= distance && std::abs(z - pos.z) <= distance)
+                return false;
+        }
+    }
+    {
+        std::lock_guard _(_loadingChunksMutex);
+        if (_loadingChunks.contains(pos))
+            return false;
+    }
+
+    std::lock_guard _(_dirtyChunksMutex);
+    if (_savingChunks.contains(pos) || !_level.hasChunkColumn(pos) || _level.getChunkColumn(pos).isDirty())
+        return false;
+    _level.removeChunkColumn(pos);
+    return true;
+}
+
 void Dimension::updateEntityAttributes(const protocol::UpdateAttributes &attributes)
 {
     std::lock_guard _(_entitiesMutex);
@@ -314,9 +469,10 @@ void Dimension::sendChunkToPlayers(int x, int z)
 {
     // This send the chunk to the players that are loading it
     std::lock_guard<std::mutex> _(_loadingChunksMutex);
+    auto chunk = this->_level.findChunkColumn({x, z});
     for (auto weak_player : this->_loadingChunks[{x, z}].players) {
-        if (auto player = weak_player.lock()) {
-            player->sendChunkAndLightUpdate(this->_level.getChunkColumn(x, z));
+        if (auto player = weak_player.lock(); player && chunk) {
+            player->sendChunkAndLightUpdate(*chunk);
         }
     }
     this->_loadingChunks.erase({x, z});
@@ -2,10 +2,13 @@
 #define CUBICSERVER_DIMENSION_HPP
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
-#include <semaphore>
-#include <thread>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "options.hpp"
@@ -13,8 +16,10 @@
 #include "world_storage/ChunkColumn.hpp"
 #include "world_storage/Level.hpp"
 
-// TODO(huntears): Fix whatever this is
-constexpr int SEMAPHORE_MAX = 1000;
+// Entities are ticked in parallel by regions of 8x8 chunks
+constexpr int ENTITY_REGION_SHIFT = 3;
+// Below this many entities, splitting the tick costs more than it saves
+constexpr size_t MIN_ENTITIES_FOR_PARALLEL_TICK = 256;
 
 class World;
 class Player;
@@ -34,13 +39,39 @@ public:
     virtual void tick();
     virtual void stop();
 
+    /**
+     * @brief Tick the dimension and measure how long it took, called by the world group tick workers
+     */
+    void timedTick();
+
+    /**
+     * @brief Queue an action touching entities outside of the ticking one
+     * Entities are ticked in parallel by region, the queued actions are run in order once every region is done.
+     * A tick may only touch its own entity and the locked state of the dimension, anything reaching another entity goes through here
+     *
+     * @note This function is thread-safe
+     *
+     * @param action std::function<void()>
+     */
+    virtual void defer(std::function<void()> action);
+
     NODISCARD virtual bool isInitialized() const;
     NODISCARD virtual std::shared_ptr<World> getWorld();
     NODISCARD virtual const std::shared_ptr<World> getWorld() const;
-    NODISCARD virtual std::counting_semaphore<SEMAPHORE_MAX> &getDimensionLock();
+    NODISCARD virtual bool isRunning() const;
+    /**
+     * @brief Duration of the last tick in milliseconds
+     */
+    NODISCARD virtual double getTickDuration() const;
     NODISCARD virtual std::vector<std::shared_ptr<Player>> &getPlayers();
     NODISCARD virtual std::vector<std::shared_ptr<Entity>> &getEntities();
     NODISCARD virtual const std::vector<std::shared_ptr<Player>> &getPlayers() const;
+    /**
+     * @brief Copy of the players, taken with _playersMutex locked
+     *
+     * @note This function is thread-safe
+     */
+    NODISCARD std::vector<std::shared_ptr<Player>> copyPlayers() const;
     NODISCARD virtual const std::vector<std::shared_ptr<Entity>> &getEntities() const;
     NODISCARD virtual std::shared_ptr<Entity> getEntityByID(int32_t id);
     NODISCARD virtual const std::shared_ptr<Entity> getEntityByID(int32_t id) const;
@@ -55,6 +86,57 @@ public:
     virtual void generateChunk(Position2D pos, world_storage::GenerationState goalState = world_storage::GenerationState::READY);
     virtual void generateChunk(int x, int z, world_storage::GenerationState goalState = world_storage::GenerationState::READY);
     virtual void updateBlock(Position position, int32_t id);
+
+    /**
+     * @brief Mark a chunk as modified, it is saved by the autosave
+     *
+     * @note This function is thread-safe
+     */
+    void markChunkDirty(const Position2D &pos);
+
+    /**
+     * @brief Copy the chunk modified the longest ago and mark it as saved
+     *
+     * The chunk is kept in memory until onChunkSaved is called for it.
+     *
+     * @note This function is thread-safe
+     *
+     * @param modifiedBefore Chunks modified after this time are left for later
+     * @return std::nullopt if no chunk was modified before modifiedBefore
+     */
+    NODISCARD std::optional<world_storage::ChunkSnapshot> takeDirtyChunk(std::chrono::steady_clock::time_point modifiedBefore);
+
+    /**
+     * @brief Copy a chunk to save it and mark it as saved, whether it was modified or not
+     *
+     * The chunk is kept in memory until onChunkSaved is called for it.
+     *
+     * @note This function is thread-safe
+     *
+     * @return std::nullopt if the chunk is not loaded or is still being generated
+     */
+    NODISCARD std::optional<world_storage::ChunkSnapshot> snapshotChunk(const Position2D &pos);
+
+    /**
+     * @brief Called once a snapshot of the chunk was written, or failed to be
+     *
+     * @note This function is thread-safe
+     *
+     * @param saved false if the snapshot could not be written, the chunk is then saved again later
+     */
+    void onChunkSaved(const Position2D &pos, bool saved);
+
+    /**
+     * @brief Remove a chunk from memory, it must be on disk already
+     *
+     * Chunks that are modified, waiting to be written, being loaded or close enough to a player to be seen are kept.
+     * A column still held by a chunk send or a generation is freed once they are done, see world_storage::Level.
+     *
+     * @note This function is thread-safe
+     *
+     * @return true if the chunk was removed
+     */
+    bool unloadChunk(const Position2D &pos);
     void addEntityMetadata(const protocol::SetEntityMetadata &metadata);
     void updateEntityAttributes(const protocol::UpdateAttributes &attributes);
     virtual void spawnPlayer(Player &player);
@@ -134,7 +216,11 @@ public:
     virtual void unlockLoadingChunksMutex() { _loadingChunksMutex.unlock(); };
 
 protected:
-    virtual void _run();
+    virtual void _tickEntities();
+    /**
+     * @brief Queue a chunk to the autosave if it is not already, with _dirtyChunksMutex locked
+     */
+    void _markDirty(world_storage::ChunkColumn &chunk);
 
 public:
     mutable std::mutex _playersMutex;
@@ -142,7 +228,6 @@ public:
     mutable std::mutex _loadingChunksMutex;
 
 protected:
-    std::counting_semaphore<SEMAPHORE_MAX> _dimensionLock;
     std::vector<std::shared_ptr<Entity>> _entities;
     std::vector<std::shared_ptr<Player>> _players;
     std::shared_ptr<World> _world;
@@ -151,8 +236,14 @@ protected:
     std::atomic<bool> _isRunning;
     world_storage::Level _level;
     std::unordered_map<Position2D, ChunkRequest> _loadingChunks;
-    std::thread _processingThread;
+    std::atomic<double> _tickDuration;
+    std::mutex _deferredMutex;
+    std::vector<std::function<void()>> _deferred;
     world_storage::DimensionType _dimensionType;
+    // Taken by the block updates and the snapshots of the modified chunks
+    std::mutex _dirtyChunksMutex;
+    std::deque<std::pair<Position2D, std::chrono::steady_clock::time_point>> _dirtyChunks; // Oldest modification first
+    std::unordered_map<Position2D, uint16_t> _savingChunks; // Snapshots waiting for the region writer
 };
 
 template<isBaseOf<Entity> T, typename... Args>
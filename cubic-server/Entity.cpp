@@ -105,9 +105,15 @@ void Entity::teleport(const Vector3<double> &pos)
 {
     this->forceSetPosition(pos);
 
-    for (auto i : this->getDimension()->getPlayers()) {
-        if (i->getId() == this->getId())
-            continue;
-        i->sendTeleportEntity(this->getId(), pos);
-    }
+    // Teleports happen during the parallel tick, the other players are only told once every region is done
+    _dim->defer([weak = weak_from_this(), id = this->getId(), pos] {
+        auto self = weak.lock();
+        if (!self)
+            return;
+        for (auto i : self->getDimension()->copyPlayers()) {
+            if (i->getId() == id)
+                continue;
+            i->sendTeleportEntity(id, pos);
+        }
+    });
 }
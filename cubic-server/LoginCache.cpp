@@ -0,0 +1,125 @@
+#include "LoginCache.hpp"
+
+#include "logging/logging.hpp"
+#include "nbt_writer.hpp"
+#include "protocol/ClientPackets.hpp"
+
+void LoginCache::rebuild()
+{
+    auto payloads = std::make_shared<Payloads>();
+
+    _buildRegistryCodec(payloads->registryCodec);
+    // TODO: send the recipes, the tags and the commands available in the server
+    payloads->updateRecipes = std::move(*protocol::createUpdateRecipes({}));
+    payloads->updateTags = std::move(*protocol::createUpdateTags({}));
+    payloads->commands = std::move(*protocol::createCommands({{}, 0}));
+
+    auto size = payloads->registryCodec.size() + payloads->updateRecipes.size() + payloads->updateTags.size() + payloads->commands.size();
+    std::atomic_store(&_payloads, std::shared_ptr<const Payloads>(std::move(payloads)));
+    LDEBUG("Login payloads built ({} bytes)", size);
+}
+
+std::shared_ptr<const LoginCache::Payloads> LoginCache::get() const { return std::atomic_load(&_payloads); }
+
+void LoginCache::_buildRegistryCodec(std::vector<uint8_t> &out)
+{
+    nbt::Writer writer(out);
+    // clang-format off
+    writer.beginCompound("")
+        .beginCompound("minecraft:dimension_type")
+            .writeString("type", "minecraft:dimension_type")
+            .beginList("value", nbt::TagType::Compound)
+                .beginCompound("")
+                    .writeString("name", "minecraft:overworld")
+                    .writeInt("id", 0)
+                    .beginCompound("element")
+                        .writeByte("ultrawarm", 0)
+                        .writeInt("logical_height", 256)
+                        .writeString("infiniburn", "#minecraft:infiniburn_overworld")
+                        .writeByte("piglin_safe", 0)
+                        .writeFloat("ambient_light", 0.0)
+                        .writeByte("has_skylight", 1)
+                        .writeString("effects", "minecraft:overworld")
+                        .writeByte("has_raids", 1)
+                        .writeInt("monster_spawn_block_light_limit", 0)
+                        .writeByte("respawn_anchor_works", 0)
+                        .writeInt("height", 384)
+                        .writeByte("has_ceiling", 0)
+                        .beginCompound("monster_spawn_light_level")
+                            .writeString("type", "minecraft:uniform")
+                            .beginCompound("value")
+                                .writeInt("max_inclusive", 7)
+                                .writeInt("min_inclusive", 0)
+                            .endCompound()
+                        .endCompound()
+                        .writeByte("natural", 1)
+                        .writeInt("min_y", -64)
+                        .writeFloat("coordinate_scale", 1.0)
+                        .writeByte("bed_works", 1)
+                    .endCompound()
+                .endCompound()
+            .endList()
+        .endCompound()
+        .beginCompound("minecraft:worldgen/biome")
+            .writeString("type", "minecraft:worldgen/biome")
+            .beginList("value", nbt::TagType::Compound)
+                .beginCompound("")
+                    .writeString("name", "minecraft:plains")
+                    .writeInt("id", 0)
+                    .beginCompound("element")
+                        .writeString("precipitation", "none")
+                        .writeFloat("temperature", 0.8)
+                        .writeFloat("downfall", 0.4)
+                        .beginCompound("effects")
+                            .writeInt("sky_color", 7907327)
+                            .writeInt("water_fog_color", 329011)
+                            .writeInt("fog_color", 12638463)
+                            .writeInt("water_color", 4159204)
+                        .endCompound()
+                    .endCompound()
+                .endCompound()
+                .beginCompound("")
+                    .writeString("name", "minecraft:my_super_cool_biome_lol_haha")
+                    .writeInt("id", 1)
+                    .beginCompound("element")
+                        .writeString("precipitation", "none")
+                        .writeFloat("temperature", 0.8)
+                        .writeFloat("downfall", 0.4)
+                        .beginCompound("effects")
+                            .writeInt("sky_color", 7907327)
+                            .writeInt("water_fog_color", 329011)
+                            .writeInt("fog_color", 12638463)
+                            .writeInt("water_color", 4159204)
+                        .endCompound()
+                    .endCompound()
+                .endCompound()
+            .endList()
+        .endCompound()
+        .beginCompound("minecraft:chat_type")
+            .writeString("type", "minecraft:chat_type")
+            .beginList("value", nbt::TagType::Compound)
+                .beginCompound("")
+                    .writeString("name", "minecraft:chat")
+                    .writeInt("id", 0)
+                    .beginCompound("element")
+                        .beginCompound("chat")
+                            .beginList("parameters", nbt::TagType::String)
+                                .writeString("", "sender")
+                                .writeString("", "content")
+                            .endList()
+                            .writeString("translation_key", "chat.type.text")
+                        .endCompound()
+                        .beginCompound("narration")
+                            .beginList("parameters", nbt::TagType::String)
+                                .writeString("", "sender")
+                                .writeString("", "content")
+                            .endList()
+                            .writeString("translation_key", "chat.type.text.narrate")
+                        .endCompound()
+                    .endCompound()
+                .endCompound()
+            .endList()
+        .endCompound()
+    .endCompound();
+    // clang-format on
+}
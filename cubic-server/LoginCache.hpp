@@ -0,0 +1,45 @@
+#ifndef CUBICSERVER_LOGINCACHE_HPP
+#define CUBICSERVER_LOGINCACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "options.hpp"
+
+/**
+ * @brief Parts of the login sequence that are the same for every player
+ *
+ * They only depend on the server configuration, so they are encoded once at startup and again on /reload.
+ * A login keeps the snapshot it got even if a reload swaps it in the meantime.
+ */
+class LoginCache {
+public:
+    struct Payloads {
+        // Serialized NBT compound spliced into the Login (play) packet
+        std::vector<uint8_t> registryCodec;
+        // Complete packets, ready to be written
+        std::vector<uint8_t> updateRecipes;
+        std::vector<uint8_t> updateTags;
+        std::vector<uint8_t> commands;
+    };
+
+public:
+    /**
+     * @brief Encode the payloads again, the previous snapshot stays valid for its current users
+     */
+    void rebuild();
+
+    /**
+     * @note This function is thread-safe
+     */
+    NODISCARD std::shared_ptr<const Payloads> get() const;
+
+private:
+    static void _buildRegistryCodec(std::vector<uint8_t> &out);
+
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<const Payloads> _payloads;
+};
+
+#endif // CUBICSERVER_LOGINCACHE_HPP
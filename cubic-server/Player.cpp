@@ -15,6 +15,7 @@
 #include "PluginManager.hpp"
 #include "events/CancelEvents.hpp"
 #include "logging/logging.hpp"
+#include "profiling/Profiler.hpp"
 #include "protocol/ClientPackets.hpp"
 #include "protocol/PacketUtils.hpp"
 #include "protocol/ServerPackets.hpp"
@@ -22,7 +23,10 @@
 #include "protocol/container/Container.hpp"
 #include "protocol/container/Inventory.hpp"
 #include "protocol/serialization/addPrimaryType.hpp"
+#include "world_storage/Persistence.hpp"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -42,17 +46,26 @@ Player::Player(std::weak_ptr<Client> cli, std::shared_ptr<Dimension> dim, u128 u
     _keepAliveIgnored(0),
     _gamemode(player_attributes::Gamemode::Survival),
     _keepAliveClock(200, std::bind(&Player::_processKeepAlive, this)), // 5 seconds for keep-alives
+    _pendingChunksNeedSort(false),
+    _lookYaw(0.0f),
+    _chunksPerTick(CONFIG["chunks-per-tick"].as<uint16_t>()),
+    _maxPendingPackets(CONFIG["max-pending-packets"].as<uint32_t>()),
+    _chunkLookBias(CONFIG["chunk-look-bias"].as<float>()),
     _inventory(std::make_shared<protocol::container::Inventory>()),
-    _foodLevel(player_attributes::MAX_FOOD_LEVEL - 4), // TODO: Take this from the saved data
-    _foodSaturationLevel(player_attributes::DEFAULT_FOOD_SATURATION_LEVEL), // TODO: Take this from the saved data
-    _foodTickTimer(0), // TODO: Take this from the saved data
-    _foodExhaustionLevel(0.0f), // TODO: Take this from the saved data
+    _foodLevel(player_attributes::MAX_FOOD_LEVEL - 4),
+    _foodSaturationLevel(player_attributes::DEFAULT_FOOD_SATURATION_LEVEL),
+    _foodTickTimer(0),
+    _foodExhaustionLevel(0.0f),
+    _data {},
+    _dataLoaded(false),
+    _saveClock(CONFIG["player-save-interval"].as<uint16_t>(), std::bind(&Player::_saveData, this)),
     _chatVisibility(protocol::ClientInformation::ChatVisibility::Enabled),
     _isFlying(true), // TODO: Take this from the saved data
     _isSprinting(false),
     _isJumping(false)
 {
     _keepAliveClock.start();
+    _saveClock.start();
     _heldItem = 0;
 
     this->_uuidString = this->getUuid().toString();
@@ -67,6 +80,8 @@ Player::Player(std::weak_ptr<Client> cli, std::shared_ptr<Dimension> dim, u128 u
 
 Player::~Player()
 {
+    this->_saveData();
+
     chat::Message disconnectMsg = chat::Message::fromTranslationKey<chat::message::TranslationKey::MultiplayerPlayerLeft>(*this);
 
     this->_dim->getWorld()->sendPlayerInfoRemovePlayer(this);
@@ -79,8 +94,20 @@ Player::~Player()
 void Player::tick()
 {
     _keepAliveClock.tick();
+    // The data was slower to load than the login, the player is moved once it is there
+    if (_pendingData.valid() && _pendingData.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        this->_applyData(_pendingData.get());
+        const Vector3<double> pos(_data.pos.x, _data.pos.y, _data.pos.z);
+        this->setPosition(pos, _data.onGround);
+        this->teleport(pos);
+        this->sendHealth();
+        this->sendSetHeldItem({static_cast<uint8_t>(_heldItem)});
+        this->sendGameEvent({protocol::GameEvent::Event::ChangeGamemode, static_cast<float>(_gamemode)});
+    }
+    _saveClock.tick();
 
     _tickPosition();
+    _sendPendingChunks();
     _foodTick();
 }
 
@@ -103,26 +130,26 @@ void Player::_tickPosition()
         updateRot = true;
         _lastRot = _rot;
     }
-    if (updatePos && updateRot) {
-        for (auto i : this->getDimension()->getPlayers()) {
-            if (i->getId() == this->getId())
-                continue;
-            i->sendUpdateEntityPositionAndRotation({this->getId(), deltaX, deltaY, deltaZ, this->_rot.x, this->_rot.z, true});
-            i->sendHeadRotation({this->getId(), _rot.x});
-        }
-    } else if (updatePos && !updateRot) {
-        for (auto i : this->getDimension()->getPlayers()) {
-            if (i->getId() == this->getId())
-                continue;
-            i->sendUpdateEntityPosition({this->getId(), deltaX, deltaY, deltaZ, true});
-        }
-    } else if (!updatePos && updateRot) {
-        for (auto i : this->getDimension()->getPlayers()) {
-            if (i->getId() == this->getId())
-                continue;
-            i->sendUpdateEntityRotation({this->getId(), this->_rot.x, this->_rot.z, true});
-            i->sendHeadRotation({this->getId(), _rot.x});
-        }
+    if (updatePos || updateRot) {
+        // The other players may be ticked by another region, they are only touched once every region is done
+        this->_dim->defer([weak = dynamicWeakFromThis<Player>(), updatePos, updateRot, deltaX, deltaY, deltaZ, rot = _rot] {
+            auto self = weak.lock();
+            if (!self)
+                return;
+            for (auto i : self->getDimension()->copyPlayers()) {
+                if (i->getId() == self->getId())
+                    continue;
+                if (updatePos && updateRot) {
+                    i->sendUpdateEntityPositionAndRotation({self->getId(), deltaX, deltaY, deltaZ, rot.x, rot.z, true});
+                    i->sendHeadRotation({self->getId(), rot.x});
+                } else if (updatePos) {
+                    i->sendUpdateEntityPosition({self->getId(), deltaX, deltaY, deltaZ, true});
+                } else {
+                    i->sendUpdateEntityRotation({self->getId(), rot.x, rot.z, true});
+                    i->sendHeadRotation({self->getId(), rot.x});
+                }
+            }
+        });
     }
 
     if (_pos.y < -100) // TODO: Change that
@@ -180,6 +207,7 @@ void Player::disconnect(const chat::Message &reason)
     GET_CLIENT();
     auto pck = protocol::createPlayDisconnect({reason.serialize()});
     client->doWrite(std::move(pck));
+    client->flush();
     client->_isRunning = false;
     N_LDEBUG("Sent a disconnect play packet");
     onEvent(Server::getInstance()->getPluginManager(), onPlayerLeave, this);
@@ -493,14 +521,16 @@ void Player::sendChunkAndLightUpdate(const Position2D &pos) { this->sendChunkAnd
 
 void Player::sendChunkAndLightUpdate(int32_t x, int32_t z)
 {
-    if (!this->_dim->hasChunkLoaded(x, z)) {
+    // Held during the send, the chunk may be unloaded meanwhile
+    auto chunk = this->_dim->getLevel().findChunkColumn({x, z});
+    if (chunk == nullptr) {
         this->_dim->loadOrGenerateChunk(x, z, dynamic_pointer_cast<Player>(shared_from_this()));
         this->_chunks[{x, z}] = ChunkState::Loading;
         return;
     }
 
     std::lock_guard<std::mutex> _(this->getDimension()->_loadingChunksMutex);
-    this->sendChunkAndLightUpdate(this->_dim->getChunk(x, z));
+    this->sendChunkAndLightUpdate(*chunk);
 }
 
 void Player::sendChunkAndLightUpdate(const world_storage::ChunkColumn &chunk)
@@ -587,7 +617,7 @@ void Player::sendGameEvent(const protocol::GameEvent &packet)
     GET_CLIENT();
     auto pck = protocol::createGameEvent(packet);
     client->doWrite(std::move(pck));
-    LDEBUG("Sent a Game Event packet");
+    N_LDEBUG("Sent a Game Event packet");
 }
 
 void Player::sendCloseContainer(uint8_t containerId)
@@ -691,7 +721,7 @@ void Player::sendSetEntityMetadata(const protocol::SetEntityMetadata &packet)
     GET_CLIENT();
     auto pck = protocol::createSetEntityMetadata(packet);
     client->doWrite(std::move(pck));
-    LDEBUG("Sent set entity metadata packet");
+    N_LDEBUG("Sent set entity metadata packet");
 }
 
 void Player::sendUpdateAttributes(const protocol::UpdateAttributes &packet)
@@ -875,12 +905,14 @@ void Player::_onSetPlayerPositionAndRotation(protocol::SetPlayerPositionAndRotat
     onEvent(Server::getInstance()->getPluginManager(), onEntityRotate, this, {_rot.x, _rot.z, 0}, {(uint8_t)pck.yaw, (uint8_t)pck.pitch, 0});
     this->setPosition(pck.x, pck.feetY, pck.z, pck.onGround);
     this->setRotation(pck.yaw, pck.pitch);
+    _lookYaw = pck.yaw;
 }
 
 void Player::_onSetPlayerRotation(protocol::SetPlayerRotation &pck)
 {
     N_LDEBUG("Got a Set Player Rotation");
     this->setRotation(pck.yaw, pck.pitch);
+    _lookYaw = pck.yaw;
     onEvent(Server::getInstance()->getPluginManager(), onEntityRotate, this, {_rot.x, _rot.z, 0}, {(uint8_t)pck.yaw, (uint8_t)pck.pitch, 0});
 }
 
@@ -1047,7 +1079,7 @@ void Player::_onUseItemOn(protocol::UseItemOn &pck)
         break;
     }
     if (_inventory->hotbar().at(this->_heldItem).present)
-        this->getDimension()->updateBlock(pck.location, GLOBAL_PALETTE.fromBlockToProtocolId(ITEM_CONVERTER.fromProtocolIdToItem(_inventory->hotbar().at(this->_heldItem).itemID)));
+        this->getDimension()->updateBlock(pck.location, GLOBAL_PALETTE.fromBlockToProtocolId(std::string(ITEM_CONVERTER.fromProtocolIdToItem(_inventory->hotbar().at(this->_heldItem).itemID))));
     if (_gamemode == player_attributes::Gamemode::Creative)
         return;
     this->_inventory->hotbar().at(this->_heldItem).itemCount--;
@@ -1104,27 +1136,106 @@ void Player::_updateRenderedChunks(const Position2D &oldChunkPos, const Position
     }
 
     //* New chunks
-    // Positive changes
-    for (int32_t x = newChunkPos.x + renderDistance; x >= std::max(oldChunkPos.x + renderDistance + 1, newChunkPos.x - renderDistance); x--) {
-        for (int32_t z = newChunkPos.z - renderDistance; z < newChunkPos.z + renderDistance + 1; z++)
-            this->sendChunkAndLightUpdate(x, z);
-    }
-    for (int32_t z = newChunkPos.z + renderDistance; z >= std::max(oldChunkPos.z + renderDistance + 1, newChunkPos.z - renderDistance); z--) {
-        for (int32_t x = newChunkPos.x - renderDistance; x < newChunkPos.x + renderDistance + 1 - (newChunkPos.x - oldChunkPos.x); x++)
-            this->sendChunkAndLightUpdate(x, z);
+    this->_queueChunksAround(newChunkPos);
+}
+
+void Player::_queueChunksAround(const Position2D &center)
+{
+    auto renderDistance = this->getDimension()->getWorld()->getRenderDistance();
+    std::vector<Position2D> toSend;
+
+    toSend.reserve((2 * renderDistance + 1) * (2 * renderDistance + 1));
+    {
+        std::lock_guard _(_chunksMutex);
+        for (int32_t x = center.x - renderDistance; x < center.x + renderDistance + 1; x++) {
+            for (int32_t z = center.z - renderDistance; z < center.z + renderDistance + 1; z++) {
+                if (!this->_chunks.contains({x, z}))
+                    toSend.emplace_back(x, z);
+            }
+        }
     }
 
-    // Negative changes
-    for (int32_t x = newChunkPos.x - renderDistance; x < std::min(oldChunkPos.x - renderDistance, newChunkPos.x + renderDistance + 1); x++) {
-        for (int32_t z = newChunkPos.z - renderDistance; z < newChunkPos.z + renderDistance + 1; z++)
-            this->sendChunkAndLightUpdate(x, z);
+    std::lock_guard _(_pendingChunksMutex);
+    _pendingChunks = std::move(toSend);
+    _pendingChunksNeedSort = true;
+}
+
+void Player::_sendPendingChunks()
+{
+    PROFILE_ZONE("Chunk sends");
+    std::vector<Position2D> toSend;
+    {
+        std::lock_guard _(_pendingChunksMutex);
+        if (_pendingChunks.empty())
+            return;
+
+        auto client = this->_cli.lock();
+        if (client == nullptr)
+            return;
+        const size_t pendingPackets = client->pendingPackets();
+        const size_t budget = std::min<size_t>(_chunksPerTick, _maxPendingPackets > pendingPackets ? _maxPendingPackets - pendingPackets : 0);
+        if (budget == 0)
+            return;
+
+        // The look direction changes constantly, so we only need to sort again when it matters
+        if (_pendingChunksNeedSort || _chunkLookBias > 0) {
+            auto center = Position2D(transformBlockPosToChunkPos(_pos.x), transformBlockPosToChunkPos(_pos.z));
+            // Minecraft yaw: 0 is south (+z) and 90 is west (-x)
+            const float lookYaw = _lookYaw.load(std::memory_order_relaxed);
+            auto lookX = -std::sin(lookYaw * M_PI / 180.0);
+            auto lookZ = std::cos(lookYaw * M_PI / 180.0);
+            auto priority = [&](const Position2D &pos) {
+                double dx = pos.x - center.x;
+                double dz = pos.z - center.z;
+                double distance = std::sqrt(dx * dx + dz * dz);
+                if (distance == 0)
+                    return 0.0;
+                // Chunks behind the player are pushed back by up to (1 + bias) times their distance
+                double alignment = (dx * lookX + dz * lookZ) / distance;
+                return distance * (1.0 + _chunkLookBias * (1.0 - alignment) / 2.0);
+            };
+
+            // The priorities are computed once per chunk instead of in every comparison
+            std::vector<std::pair<double, Position2D>> keyed;
+            keyed.reserve(_pendingChunks.size());
+            for (const auto &pos : _pendingChunks)
+                keyed.emplace_back(priority(pos), pos);
+            auto farthestFirst = [](const auto &a, const auto &b) { return a.first > b.first; };
+            if (_chunkLookBias > 0 && budget < keyed.size()) {
+                // Everything is sorted again next tick, only the chunks sent by this one need to be in order at the back
+                auto sent = keyed.end() - budget;
+                std::nth_element(keyed.begin(), sent, keyed.end(), farthestFirst);
+                std::sort(sent, keyed.end(), farthestFirst);
+            } else {
+                std::sort(keyed.begin(), keyed.end(), farthestFirst);
+            }
+            for (size_t i = 0; i < keyed.size(); i++)
+                _pendingChunks[i] = keyed[i].second;
+            _pendingChunksNeedSort = false;
+        }
+
+        while (!_pendingChunks.empty() && toSend.size() < budget) {
+            toSend.push_back(_pendingChunks.back());
+            _pendingChunks.pop_back();
+        }
     }
-    for (int32_t z = newChunkPos.z - renderDistance; z < std::min(oldChunkPos.z - renderDistance, newChunkPos.z + renderDistance + 1); z++) {
-        for (int32_t x = newChunkPos.x - renderDistance - (newChunkPos.x - oldChunkPos.x); x < newChunkPos.x + renderDistance + 1; x++)
-            this->sendChunkAndLightUpdate(x, z);
+
+    for (const auto &pos : toSend) {
+        {
+            std::lock_guard _(_chunksMutex);
+            if (this->_chunks.contains(pos))
+                continue;
+        }
+        this->sendChunkAndLightUpdate(pos);
     }
 }
 
+void Player::_sendCachedPacket(const std::vector<uint8_t> &packet)
+{
+    GET_CLIENT();
+    client->doWrite(std::make_unique<std::vector<uint8_t>>(packet));
+}
+
 void Player::_continueLoginSequence()
 {
     this->sendFeatureFlags({{"minecraft:vanilla"}});
@@ -1137,25 +1248,25 @@ void Player::_continueLoginSequence()
              (uint8_t) protocol::PlayerAbilitiesClient::Flags::AllowFlying | (uint8_t) protocol::PlayerAbilitiesClient::Flags::CreativeMode,
          0.05, 0.1}
     );
-    // TODO: send the value stored in the player data
-    this->sendSetHeldItem({4});
+    this->sendSetHeldItem({static_cast<uint8_t>(_heldItem)});
 
-    // TODO: send the recipes
-    this->sendUpdateRecipes({});
-
-    // TODO: send the tags
-    this->sendUpdateTags({});
+    // The recipes, the tags and the commands are the same for everyone, see LoginCache
+    auto loginPayloads = Server::getInstance()->getLoginCache().get();
+    this->_sendCachedPacket(loginPayloads->updateRecipes);
+    this->_sendCachedPacket(loginPayloads->updateTags);
 
     // TODO: implement the event Statues correctly // 24 (set op permission level)
     this->sendEntityEvent({this->_id, 24});
 
-    // TODO: send all the commands avaliable in the server
-    this->sendCommands({{}, 0});
+    this->_sendCachedPacket(loginPayloads->commands);
 
     // TODO: send the player recipies book
     this->sendUpdateRecipiesBook({});
 
-    this->teleport({8.5, 100, 8.5}); // TODO: change that to player_attributes::DEFAULT_SPAWN_POINT
+    // TODO: change the default to player_attributes::DEFAULT_SPAWN_POINT
+    const Vector3<double> spawn = _dataLoaded ? Vector3<double>(_data.pos.x, _data.pos.y, _data.pos.z) : Vector3<double>(8.5, 100, 8.5);
+    const Position2D spawnChunk(transformBlockPosToChunkPos(spawn.x), transformBlockPosToChunkPos(spawn.z));
+    this->teleport(spawn);
 
     this->sendServerData({false, "", false, "", false});
 
@@ -1164,19 +1275,11 @@ void Player::_continueLoginSequence()
     LDEBUG("Added entity player to dimension");
     getDimension()->getWorld()->sendPlayerInfoAddPlayer(this);
 
-    this->sendSetCenterChunk({0, 0});
+    this->sendSetCenterChunk(spawnChunk);
 
-    auto renderDistance = this->getDimension()->getWorld()->getRenderDistance();
-    // Send all chunks around the player
-    // TODO: send chunk closer to the player first
-    sendChunkAndLightUpdate(0, 0);
-    for (int32_t x = -renderDistance; x < renderDistance + 1; x++) {
-        for (int32_t z = -renderDistance; z < renderDistance + 1; z++) {
-            if (x == 0 && z == 0)
-                continue;
-            sendChunkAndLightUpdate(x, z);
-        }
-    }
+    // Chunks are sent closest first from the tick, the first batch goes out right away
+    this->_queueChunksAround(spawnChunk);
+    this->_sendPendingChunks();
 
     // TODO: Initialize world border
     this->sendInitializeWorldBorder({0, 0, 0, 10000, 0, 29999984, 10, 10});
@@ -1205,7 +1308,7 @@ void Player::_continueLoginSequence()
     //     player->_synchronizePostion({0, -58, 0});
     // this->_player->sendChunkAndLightUpdate(0, 0);
     getDimension()->spawnPlayer(*this);
-    this->teleport({8.5, 100, 8.5}); // TODO: change that to player_attributes::DEFAULT_SPAWN_POINT
+    this->teleport(spawn);
 
     // Send login message
     chat::Message connectionMsg = chat::Message::fromTranslationKey<chat::message::TranslationKey::MultiplayerPlayerJoined>(*this);
@@ -1311,3 +1414,81 @@ void Player::teleport(const Vector3<double> &pos)
     LDEBUG("Synchronize player position");
     Entity::teleport(pos);
 }
+
+void Player::_loadData(std::future<std::optional<world_storage::PlayerData>> &&pendingData)
+{
+    if (!pendingData.valid())
+        this->_applyData(std::nullopt);
+    else if (pendingData.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        this->_applyData(pendingData.get());
+    else
+        _pendingData = std::move(pendingData);
+}
+
+void Player::_applyData(std::optional<world_storage::PlayerData> &&data)
+{
+    _dataLoaded = true;
+    if (!data) {
+        // First time on this world
+        _data = this->_toData();
+        _data.air = 300;
+        _data.dimension = "minecraft:overworld";
+        _data.pos = {8.5, 100, 8.5}; // TODO: change that to player_attributes::DEFAULT_SPAWN_POINT
+        return;
+    }
+    _data = std::move(*data);
+
+    this->setHealth(_data.health);
+    _foodLevel = _data.foodLevel;
+    _foodSaturationLevel = _data.foodSaturationLevel;
+    _foodTickTimer = _data.foodTickTimer;
+    _foodExhaustionLevel = _data.foodExhaustionLevel;
+    if (_data.playerGameType >= 0 && _data.playerGameType <= static_cast<int32_t>(player_attributes::Gamemode::Spectator))
+        _gamemode = static_cast<player_attributes::Gamemode>(_data.playerGameType);
+    if (_data.selectedItemSlot >= 0 && _data.selectedItemSlot < 9)
+        _heldItem = _data.selectedItemSlot;
+    _lookYaw = _data.rotation.yaw;
+}
+
+world_storage::PlayerData Player::_toData() const
+{
+    world_storage::PlayerData data = _data;
+
+    data.dataVersion = MC_DATA_VERSION;
+    data.uuid = _uuid;
+    data.health = _health;
+    data.pos = {_pos.x, _pos.y, _pos.z};
+    data.rotation.yaw = _lookYaw;
+    data.selectedItemSlot = _heldItem;
+    data.foodLevel = _foodLevel;
+    data.foodSaturationLevel = _foodSaturationLevel;
+    data.foodTickTimer = _foodTickTimer;
+    data.foodExhaustionLevel = _foodExhaustionLevel;
+    data.playerGameType = static_cast<int32_t>(_gamemode);
+    return data;
+}
+
+/**
+ * @brief Compare the fields written by Player::_toData, the others are copied from the last save
+ */
+static bool hasChanged(const world_storage::PlayerData &data, const world_storage::PlayerData &saved)
+{
+    return data.pos.x != saved.pos.x || data.pos.y != saved.pos.y || data.pos.z != saved.pos.z || data.rotation.yaw != saved.rotation.yaw || data.health != saved.health ||
+        data.selectedItemSlot != saved.selectedItemSlot || data.foodLevel != saved.foodLevel || data.foodSaturationLevel != saved.foodSaturationLevel ||
+        data.foodTickTimer != saved.foodTickTimer || data.foodExhaustionLevel != saved.foodExhaustionLevel || data.playerGameType != saved.playerGameType ||
+        data.dataVersion != saved.dataVersion;
+}
+
+void Player::_saveData()
+{
+    auto *persistence = this->getWorld()->getPersistence();
+    // Saving before the data is loaded would overwrite it with the defaults
+    if (!persistence || !_dataLoaded)
+        return;
+
+    auto data = this->_toData();
+    if (!hasChanged(data, _data))
+        return;
+    _data = data;
+    persistence->savePlayerDataAsync(_uuid, std::move(data));
+}
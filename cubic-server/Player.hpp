@@ -17,9 +17,13 @@
 #include "protocol/container/Inventory.hpp"
 #include "types.hpp"
 #include "world_storage/ChunkColumn.hpp"
+#include "world_storage/PlayerData.hpp"
+#include <atomic>
 #include <compare>
 #include <cstdint>
+#include <future>
 #include <memory>
+#include <optional>
 #include <sys/types.h>
 #include <type_traits>
 
@@ -181,11 +185,34 @@ private:
     void _processKeepAlive();
     void _tickPosition();
     void _updateRenderedChunks(const Position2D &oldChunkPos, const Position2D &newChunkPos);
+    /**
+     * @brief Replace the chunk send queue with every chunk in render distance of center that is not already known by the client
+     */
+    void _queueChunksAround(const Position2D &center);
+    /**
+     * @brief Send the closest queued chunks, up to the per-tick budget and as long as the client's outbound queue is not saturated
+     */
+    void _sendPendingChunks();
     void _continueLoginSequence();
+    /**
+     * @brief Write a copy of a packet that was encoded once for every player
+     */
+    void _sendCachedPacket(const std::vector<uint8_t> &packet);
     void _unloadChunk(int32_t x, int32_t z);
     void _foodTick();
     void _eat();
 
+    /**
+     * @brief Take the data being loaded from disk, it is applied right away if it is already there or from the tick once it is
+     */
+    void _loadData(std::future<std::optional<world_storage::PlayerData>> &&pendingData);
+    void _applyData(std::optional<world_storage::PlayerData> &&data);
+    NODISCARD world_storage::PlayerData _toData() const;
+    /**
+     * @brief Queue a save of the player data if it changed since it was loaded or last saved
+     */
+    void _saveData();
+
     std::weak_ptr<Client> _cli;
     std::string _username;
     std::string _uuidString;
@@ -198,6 +225,15 @@ private:
     std::unordered_map<Position2D, ChunkState> _chunks;
     mutable std::mutex _chunksMutex;
 
+    // Chunk sending
+    std::vector<Position2D> _pendingChunks; // Sorted from the farthest to the closest chunk, only the next ones to send with a look bias
+    std::mutex _pendingChunksMutex;
+    bool _pendingChunksNeedSort;
+    std::atomic<float> _lookYaw; // Written by the network thread, read by the tick
+    uint16_t _chunksPerTick;
+    size_t _maxPendingPackets;
+    float _chunkLookBias;
+
     // Inventory
     std::shared_ptr<protocol::container::Inventory> _inventory;
     std::vector<std::shared_ptr<protocol::container::Container>> _containers;
@@ -208,6 +244,12 @@ private:
     int _foodTickTimer;
     float _foodExhaustionLevel;
 
+    // Saved data
+    std::future<std::optional<world_storage::PlayerData>> _pendingData;
+    world_storage::PlayerData _data; // Keeps the fields of the file the player does not use
+    bool _dataLoaded;
+    TickClock _saveClock;
+
     // player status
     protocol::ClientInformation::ChatVisibility _chatVisibility;
     bool _isFlying;
@@ -0,0 +1,323 @@
+#include "Pregenerator.hpp"
+
+#include "Dimension.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "logging/logging.hpp"
+#include "nlohmann/json.hpp"
+#include "world_storage/Persistence.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+using namespace std::chrono_literals;
+
+constexpr auto PREGEN_REPORT_INTERVAL = 10s;
+// Chunks generated before they are written to their region
+constexpr size_t PREGEN_SAVE_BATCH = 256;
+
+// Position of the nth chunk of a square spiral starting at 0, 0
+static Position2D spiralPosition(uint64_t index)
+{
+    if (index == 0)
+        return {0, 0};
+
+    auto ring = static_cast<uint64_t>(std::sqrt(static_cast<double>(index)));
+    while (ring * ring > index)
+        ring--;
+    while ((ring + 1) * (ring + 1) <= index)
+        ring++;
+    auto k = static_cast<int32_t>((ring + 1) / 2);
+    auto offset = static_cast<int32_t>(index - (2 * k - 1) * (2 * k - 1));
+    auto side = offset / (2 * k);
+    auto step = offset % (2 * k);
+
+    switch (side) {
+    case 0:
+        return {k, -k + 1 + step};
+    case 1:
+        return {k - 1 - step, k};
+    case 2:
+        return {-k, k - 1 - step};
+    default:
+        return {-k + 1 + step, -k};
+    }
+}
+
+Pregenerator::Pregenerator(World &world, const std::string &folder):
+    _world(world),
+    _progressFile(folder + "/pregen.json"),
+    _radius(0),
+    _total(0),
+    _next(0),
+    _savedCheckpoint(0),
+    _generated(0),
+    _concurrency(CONFIG["pregen-concurrency"].as<uint16_t>()),
+    _isRunning(false)
+{
+}
+
+Pregenerator::~Pregenerator() { this->stop(); }
+
+void Pregenerator::start(const std::string &dimension, int32_t radius)
+{
+    this->_interrupt();
+
+    std::lock_guard _(_mutex);
+    _dimension = dimension;
+    _radius = radius;
+    _total = static_cast<uint64_t>(2 * radius + 1) * static_cast<uint64_t>(2 * radius + 1);
+    _next = 0;
+    _savedCheckpoint = 0;
+    this->_saveProgress(false);
+
+    _isRunning = true;
+    _generated = 0;
+    _startTime = std::chrono::steady_clock::now();
+    _thread = std::thread(&Pregenerator::_run, this);
+}
+
+bool Pregenerator::resume()
+{
+    if (_isRunning)
+        return true;
+    this->_interrupt();
+
+    std::lock_guard _(_mutex);
+    bool paused = false;
+    if (_total == 0 && !this->_loadProgress(paused))
+        return false;
+    if (_next >= _total)
+        return false;
+    this->_saveProgress(false);
+
+    _isRunning = true;
+    _generated = 0;
+    _startTime = std::chrono::steady_clock::now();
+    _thread = std::thread(&Pregenerator::_run, this);
+    return true;
+}
+
+void Pregenerator::pause()
+{
+    this->_interrupt();
+
+    std::lock_guard _(_mutex);
+    if (_total != 0 && _next < _total)
+        this->_saveProgress(true);
+}
+
+void Pregenerator::stop()
+{
+    this->_interrupt();
+
+    std::lock_guard _(_mutex);
+    if (_total != 0 && _next < _total)
+        this->_saveProgress(false);
+}
+
+void Pregenerator::load()
+{
+    std::lock_guard _(_mutex);
+    bool paused = false;
+    if (!this->_loadProgress(paused))
+        return;
+    if (paused) {
+        LINFO("Found a paused pregeneration of {} ({}/{} chunks), use /pregen resume to continue it", _dimension, _next, _total);
+        return;
+    }
+
+    LINFO("Resuming the pregeneration of {} ({}/{} chunks)", _dimension, _next, _total);
+    _isRunning = true;
+    _generated = 0;
+    _startTime = std::chrono::steady_clock::now();
+    _thread = std::thread(&Pregenerator::_run, this);
+}
+
+std::string Pregenerator::status() const
+{
+    std::lock_guard _(_mutex);
+    if (_total == 0)
+        return "No pregeneration in progress";
+
+    auto done = this->_checkpoint();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+    double rate = elapsed > 0 ? _generated / elapsed : 0;
+    std::string eta = "unknown";
+    if (rate > 0) {
+        auto seconds = static_cast<uint64_t>((_total - done) / rate);
+        eta = fmt::format("{}h{:02}m{:02}s", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    }
+    return fmt::format(
+        "Pregeneration of {} (radius {}): {}/{} chunks ({:.1f}%), {:.1f} chunks/s, ETA {}{}", _dimension, _radius, done, _total, done * 100.0 / _total, rate, eta,
+        _isRunning ? "" : " [paused]"
+    );
+}
+
+void Pregenerator::_run()
+{
+    auto dim = _world.getDimension(_dimension);
+    auto *persistence = _world.getPersistence();
+    if (persistence == nullptr)
+        LWARN("The world of {} is not saved, the pregenerated chunks are kept in memory", _dimension);
+
+    // Let the dimension generate its spawn first
+    while (_isRunning && !dim->isInitialized())
+        std::this_thread::sleep_for(100ms);
+
+    auto lastReport = std::chrono::steady_clock::now();
+    std::unique_lock lock(_mutex);
+    while (_isRunning && _next < _total) {
+        _jobDone.wait(lock, [this] {
+            return !_isRunning || _inFlight.size() < _concurrency;
+        });
+        if (!_isRunning)
+            break;
+
+        auto index = _next++;
+        auto pos = spiralPosition(index);
+        _inFlight.insert(index);
+        _world.getGenerationPool().addJob(std::numeric_limits<int>::max(), [this, dim, persistence, index, pos] {
+            // Chunks already on disk are only loaded to be unloaded again
+            bool save = true;
+            if (!dim->hasChunkLoaded(pos.x, pos.z)) {
+                if (persistence != nullptr && persistence->isChunkLoaded(*dim, pos.x, pos.z))
+                    save = false;
+                else
+                    dim->generateChunk(pos);
+            }
+
+            std::lock_guard _(_mutex);
+            _inFlight.erase(index);
+            _generatedChunks.push_back({pos, save});
+            _generated++;
+            _jobDone.notify_all();
+        });
+
+        const bool report = std::chrono::steady_clock::now() - lastReport >= PREGEN_REPORT_INTERVAL;
+        if (report || _generatedChunks.size() >= PREGEN_SAVE_BATCH)
+            this->_saveChunks(*dim, persistence, lock);
+        if (report) {
+            lastReport = std::chrono::steady_clock::now();
+            this->_saveProgress(false);
+            lock.unlock();
+            LINFO(this->status());
+            lock.lock();
+        }
+    }
+
+    // Every job captures this, they must be done before we return
+    _jobDone.wait(lock, [this] {
+        return _inFlight.empty();
+    });
+    this->_saveChunks(*dim, persistence, lock);
+
+    if (_next >= _total) {
+        LINFO("Pregeneration of {} done ({} chunks)", _dimension, _total);
+        std::filesystem::remove(_progressFile);
+        _total = 0;
+        _next = 0;
+        _isRunning = false;
+    }
+}
+
+void Pregenerator::_saveChunks(Dimension &dim, world_storage::Persistence *persistence, std::unique_lock<std::mutex> &lock)
+{
+    // Every chunk before the checkpoint is in this batch or in a previous one
+    const uint64_t checkpoint = this->_checkpoint();
+    const uint64_t total = _total;
+    auto chunks = std::move(_generatedChunks);
+    _generatedChunks.clear();
+    if (persistence == nullptr) {
+        _savedCheckpoint = checkpoint;
+        return;
+    }
+    lock.unlock();
+
+    std::vector<Position2D> toSave;
+    for (const auto &chunk : chunks) {
+        if (chunk.save)
+            toSave.push_back(chunk.pos);
+        _savedChunks.push_back(chunk.pos);
+    }
+    persistence->saveChunks(dim, toSave);
+    persistence->flushChunks();
+
+    // Generating a chunk touches its neighbours, a chunk is unloaded once the ring around its own is done
+    std::erase_if(_savedChunks, [&](const Position2D &pos) {
+        const uint64_t ring = std::max(std::abs(pos.x), std::abs(pos.z));
+        if (checkpoint < total && checkpoint < (2 * ring + 3) * (2 * ring + 3))
+            return false;
+        // Chunks a player can see stay loaded
+        persistence->unloadChunk(dim, pos);
+        return true;
+    });
+
+    lock.lock();
+    _savedCheckpoint = checkpoint;
+}
+
+void Pregenerator::_interrupt()
+{
+    {
+        std::lock_guard _(_mutex);
+        _isRunning = false;
+    }
+    _jobDone.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+}
+
+bool Pregenerator::_loadProgress(bool &paused)
+{
+    if (!std::filesystem::exists(_progressFile))
+        return false;
+
+    std::ifstream file(_progressFile);
+    try {
+        auto progress = nlohmann::json::parse(file);
+        _dimension = progress["dimension"].get<std::string>();
+        _radius = progress["radius"].get<int32_t>();
+        _next = progress["progress"].get<uint64_t>();
+        _savedCheckpoint = _next;
+        paused = progress["paused"].get<bool>();
+    } catch (const std::exception &e) {
+        LERROR("Failed to parse {}: {}", _progressFile, e.what());
+        return false;
+    }
+    if (!_world.getDimensions().contains(_dimension)) {
+        LERROR("Unknown dimension {} in {}", _dimension, _progressFile);
+        return false;
+    }
+    _total = static_cast<uint64_t>(2 * _radius + 1) * static_cast<uint64_t>(2 * _radius + 1);
+    return true;
+}
+
+void Pregenerator::_saveProgress(bool paused) const
+{
+    nlohmann::json progress = {
+        {"dimension", _dimension},
+        {"radius", _radius},
+        {"progress", _savedCheckpoint},
+        {"paused", paused},
+    };
+
+    // Write then rename so a crash never leaves a truncated file behind
+    auto tmpFile = _progressFile + ".tmp";
+    std::filesystem::create_directories(std::filesystem::path(_progressFile).parent_path());
+    std::ofstream file(tmpFile);
+    file << std::setw(4) << progress << std::endl;
+    file.close();
+    std::filesystem::rename(tmpFile, _progressFile);
+}
+
+uint64_t Pregenerator::_checkpoint() const
+{
+    // Chunks are not done in order, everything before the oldest chunk still in flight is
+    if (_inFlight.empty())
+        return _next;
+    return *_inFlight.begin();
+}
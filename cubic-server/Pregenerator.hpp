@@ -0,0 +1,103 @@
+#ifndef CUBICSERVER_PREGENERATOR_HPP
+#define CUBICSERVER_PREGENERATOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "options.hpp"
+#include "types.hpp"
+
+class World;
+class Dimension;
+namespace world_storage {
+class Persistence;
+}
+
+/**
+ * @brief Generates every chunk in a square around the spawn of a dimension, closest first
+ *
+ * Chunks are pushed on the world generation pool with the lowest priority, so players are always served first.
+ * They are written to their region by batches, then unloaded unless a player can see them.
+ * The progress is saved in the world folder, which allows a pregeneration to be resumed after a restart.
+ */
+class Pregenerator {
+public:
+    explicit Pregenerator(World &world, const std::string &folder);
+    ~Pregenerator();
+
+    /**
+     * @brief Start a new pregeneration, replacing the saved one if any
+     *
+     * @param dimension Name of the dimension in the world
+     * @param radius Radius in chunks around 0, 0
+     */
+    void start(const std::string &dimension, int32_t radius);
+
+    /**
+     * @brief Resume the current or saved pregeneration
+     *
+     * @return false if there is nothing to resume
+     */
+    bool resume();
+
+    /**
+     * @brief Pause the pregeneration, it will not be resumed automatically on the next start
+     */
+    void pause();
+
+    /**
+     * @brief Stop the pregeneration because the server is stopping, it will be resumed on the next start
+     */
+    void stop();
+
+    /**
+     * @brief Resume the saved pregeneration if it was not paused
+     */
+    void load();
+
+    NODISCARD bool isRunning() const { return _isRunning; }
+    NODISCARD std::string status() const;
+
+private:
+    struct GeneratedChunk {
+        Position2D pos;
+        bool save; // false if it was loaded from its region
+    };
+
+    void _run();
+    /**
+     * @brief Write the chunks generated since the last call and unload the ones whose neighbours are done, with _mutex locked
+     */
+    void _saveChunks(Dimension &dim, world_storage::Persistence *persistence, std::unique_lock<std::mutex> &lock);
+    void _interrupt();
+    bool _loadProgress(bool &paused);
+    void _saveProgress(bool paused) const;
+    NODISCARD uint64_t _checkpoint() const;
+
+    World &_world;
+    std::string _progressFile;
+    std::string _dimension;
+    int32_t _radius;
+    uint64_t _total;
+    uint64_t _next;
+    std::set<uint64_t> _inFlight;
+    std::vector<GeneratedChunk> _generatedChunks; // Waiting to be saved
+    std::vector<Position2D> _savedChunks; // Waiting for their neighbours to be done to be unloaded, only used by _run
+    uint64_t _savedCheckpoint; // Every chunk before it is on disk
+    std::atomic<uint64_t> _generated;
+    std::chrono::steady_clock::time_point _startTime;
+    uint16_t _concurrency;
+    std::atomic<bool> _isRunning;
+    mutable std::mutex _mutex;
+    std::condition_variable _jobDone;
+    std::thread _thread;
+};
+
+#endif // CUBICSERVER_PREGENERATOR_HPP
@@ -0,0 +1,51 @@
+#include "RateLimiter.hpp"
+
+#include <algorithm>
+
+RateLimiter::RateLimiter():
+    _rate(0),
+    _burst(0),
+    _nextPrune()
+{
+}
+
+void RateLimiter::configure(double rate, double burst)
+{
+    std::lock_guard _(_mutex);
+    _rate = rate;
+    _burst = std::max(burst, 1.0);
+    _nextPrune = {};
+    _buckets.clear();
+}
+
+bool RateLimiter::allow(const boost::asio::ip::address &address)
+{
+    auto now = Clock::now();
+    std::lock_guard _(_mutex);
+    if (_rate <= 0)
+        return true;
+
+    auto it = _buckets.find(address);
+    if (it == _buckets.end()) {
+        if (_buckets.size() >= MAX_TRACKED_ADDRESSES && now >= _nextPrune)
+            this->_prune(now);
+        it = _buckets.emplace(address, Bucket {_burst, now}).first;
+    }
+
+    auto &bucket = it->second;
+    bucket.tokens = std::min(_burst, bucket.tokens + std::chrono::duration<double>(now - bucket.lastRefill).count() * _rate);
+    bucket.lastRefill = now;
+    if (bucket.tokens < 1)
+        return false;
+    bucket.tokens--;
+    return true;
+}
+
+void RateLimiter::_prune(Clock::time_point now)
+{
+    // Every bucket left idle until then is full again by the next prune
+    _nextPrune = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_burst / _rate));
+    std::erase_if(_buckets, [this, now](const auto &entry) {
+        return entry.second.tokens + std::chrono::duration<double>(now - entry.second.lastRefill).count() * _rate >= _burst;
+    });
+}
@@ -0,0 +1,54 @@
+#ifndef CUBICSERVER_RATELIMITER_HPP
+#define CUBICSERVER_RATELIMITER_HPP
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include "options.hpp"
+
+/**
+ * @brief Token bucket per remote address
+ *
+ * Every address can make rate requests per second on average, with bursts of up to burst requests.
+ * Addresses whose bucket is full again are forgotten once too many are tracked, so a scan cannot grow it forever.
+ * They are pruned at most once per time a bucket takes to refill, which bounds the work done per request.
+ */
+class RateLimiter {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr size_t MAX_TRACKED_ADDRESSES = 4096;
+
+public:
+    RateLimiter();
+
+    /**
+     * @brief Change the limits, a rate of 0 disables the limiter
+     */
+    void configure(double rate, double burst);
+
+    /**
+     * @brief Take a token from the bucket of this address
+     *
+     * @return false if the address is over its limit
+     */
+    NODISCARD bool allow(const boost::asio::ip::address &address);
+
+private:
+    struct Bucket {
+        double tokens;
+        Clock::time_point lastRefill;
+    };
+
+    void _prune(Clock::time_point now);
+
+    double _rate;
+    double _burst;
+    Clock::time_point _nextPrune;
+    std::unordered_map<boost::asio::ip::address, Bucket> _buckets;
+    std::mutex _mutex;
+};
+
+#endif // CUBICSERVER_RATELIMITER_HPP
@@ -0,0 +1,204 @@
+#include "RegistrySnapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Checksum.hpp"
+#include "logging/logging.hpp"
+#include "nbt_writer.hpp"
+
+static void hashFile(Checksum &checksum, const std::filesystem::path &file)
+{
+    const auto name = file.string();
+    checksum.update(reinterpret_cast<const uint8_t *>(name.c_str()), name.size() + 1);
+
+    std::ifstream stream(file, std::ios::binary);
+    char buffer[0x10000];
+    while (stream) {
+        stream.read(buffer, sizeof(buffer));
+        checksum.update(reinterpret_cast<const uint8_t *>(buffer), stream.gcount());
+    }
+}
+
+static std::vector<std::filesystem::path> listFiles(const std::vector<std::filesystem::path> &sources)
+{
+    std::vector<std::filesystem::path> files;
+    for (const auto &source : sources) {
+        if (!std::filesystem::is_directory(source)) {
+            files.push_back(source);
+            continue;
+        }
+        // The order of a directory iteration is unspecified
+        auto first = files.size();
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(source)) {
+            if (entry.is_regular_file())
+                files.push_back(entry.path());
+        }
+        std::sort(files.begin() + first, files.end());
+    }
+    return files;
+}
+
+static RegistrySnapshot::Digest stampFiles(const std::vector<std::filesystem::path> &files)
+{
+    Checksum checksum;
+    for (const auto &file : files) {
+        const auto name = file.string();
+        checksum.update(reinterpret_cast<const uint8_t *>(name.c_str()), name.size() + 1);
+        // A missing file is stamped with zeros, it is hashed as an empty file
+        int64_t stamp[2] = {0, 0};
+        struct stat stat_buf;
+        if (stat(file.c_str(), &stat_buf) == 0) {
+            stamp[0] = stat_buf.st_size;
+            stamp[1] = static_cast<int64_t>(stat_buf.st_mtim.tv_sec) * 1000000000 + stat_buf.st_mtim.tv_nsec;
+        }
+        checksum.update(reinterpret_cast<const uint8_t *>(stamp), sizeof(stamp));
+    }
+    RegistrySnapshot::Digest digest;
+    checksum.finalize(digest.data());
+    return digest;
+}
+
+static bool equals(const nbt::TagView &tag, const RegistrySnapshot::Digest &digest)
+{
+    auto bytes = tag.getByteArray();
+    return bytes.size() == digest.size() && std::memcmp(bytes.data(), digest.data(), digest.size()) == 0;
+}
+
+RegistrySnapshot::RegistrySnapshot(std::filesystem::path path, std::vector<std::filesystem::path> sources):
+    _path(std::move(path)),
+    _sourceFiles(listFiles(sources)),
+    _sourceStamp(stampFiles(_sourceFiles)),
+    _sourceContentHash(),
+    _mapping(nullptr),
+    _mappingSize(0)
+{
+}
+
+RegistrySnapshot::~RegistrySnapshot() { this->_close(); }
+
+bool RegistrySnapshot::open()
+{
+    this->_close();
+
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) == -1 || stat_buf.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    _mappingSize = stat_buf.st_size;
+    _mapping = mmap(nullptr, _mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (_mapping == MAP_FAILED) {
+        _mapping = nullptr;
+        LWARN("Could not map the registry snapshot {}: {}", _path.string(), strerror(errno));
+        return false;
+    }
+
+    try {
+        _root = nbt::TagView::root({static_cast<const uint8_t *>(_mapping), _mappingSize});
+        auto version = _root.find("Version", nbt::TagType::Int);
+        auto stamp = _root.find("SourceStamp", nbt::TagType::ByteArray);
+        auto hash = _root.find("SourceHash", nbt::TagType::ByteArray);
+        if (version && version->getInt() == FORMAT_VERSION && stamp && hash) {
+            if (equals(*stamp, _sourceStamp))
+                return true;
+            // The sources were touched or copied, only their content tells if they changed
+            if (equals(*hash, this->_sourceHash())) {
+                this->_restamp(*stamp);
+                return true;
+            }
+        }
+        LINFO("Registry snapshot {} is outdated", _path.string());
+    } catch (const std::exception &e) {
+        LWARN("Registry snapshot {} is corrupted: {}", _path.string(), e.what());
+    }
+    this->_close();
+    return false;
+}
+
+std::optional<nbt::TagView> RegistrySnapshot::get(std::string_view name) const
+{
+    if (!_mapping)
+        return std::nullopt;
+    return _root.find(name);
+}
+
+bool RegistrySnapshot::save(const std::vector<uint8_t> &content)
+{
+    std::vector<uint8_t> data;
+    data.reserve(content.size() + 96);
+    nbt::Writer writer(data);
+    const auto &sourceHash = this->_sourceHash();
+    writer.beginCompound("")
+        .writeInt("Version", FORMAT_VERSION)
+        .writeByteArray("SourceStamp", {reinterpret_cast<const int8_t *>(_sourceStamp.data()), _sourceStamp.size()})
+        .writeByteArray("SourceHash", {reinterpret_cast<const int8_t *>(sourceHash.data()), sourceHash.size()});
+    data.insert(data.end(), content.begin(), content.end());
+    writer.endCompound();
+    if (!this->_write(data))
+        return false;
+    LDEBUG("Registry snapshot {} written ({} bytes)", _path.string(), data.size());
+    return true;
+}
+
+const RegistrySnapshot::Digest &RegistrySnapshot::_sourceHash()
+{
+    if (_sourceContentHash)
+        return *_sourceContentHash;
+    Checksum checksum;
+    for (const auto &file : _sourceFiles)
+        hashFile(checksum, file);
+    _sourceContentHash.emplace();
+    checksum.finalize(_sourceContentHash->data());
+    return *_sourceContentHash;
+}
+
+void RegistrySnapshot::_restamp(const nbt::TagView &stamp)
+{
+    const auto *begin = static_cast<const uint8_t *>(_mapping);
+    std::vector<uint8_t> data(begin, begin + _mappingSize);
+    auto offset = reinterpret_cast<const uint8_t *>(stamp.getByteArray().data()) - begin;
+    std::copy(_sourceStamp.begin(), _sourceStamp.end(), data.begin() + offset);
+    // The mapping keeps the previous file alive once it is replaced
+    if (this->_write(data))
+        LDEBUG("Registry snapshot {} stamped again", _path.string());
+}
+
+bool RegistrySnapshot::_write(const std::vector<uint8_t> &data) const
+{
+    // Write then rename so a running server never maps a truncated file
+    auto tmpFile = _path;
+    tmpFile += ".tmp";
+    std::ofstream file(tmpFile, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    file.close();
+    if (!file) {
+        LWARN("Could not write the registry snapshot {}", tmpFile.string());
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tmpFile, _path, error);
+    if (error) {
+        LWARN("Could not write the registry snapshot {}: {}", _path.string(), error.message());
+        return false;
+    }
+    return true;
+}
+
+void RegistrySnapshot::_close()
+{
+    if (_mapping)
+        munmap(_mapping, _mappingSize);
+    _mapping = nullptr;
+    _mappingSize = 0;
+    _root = nbt::TagView();
+}
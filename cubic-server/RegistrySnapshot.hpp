@@ -0,0 +1,80 @@
+#ifndef CUBICSERVER_REGISTRYSNAPSHOT_HPP
+#define CUBICSERVER_REGISTRYSNAPSHOT_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "nbt_reader.hpp"
+#include "options.hpp"
+
+/**
+ * @brief Binary copy of the registries read from JSON at startup (blocks, items and loot tables)
+ *
+ * The snapshot is an uncompressed NBT compound mapped in memory and read in place with nbt::TagView.
+ * It stores a SHA-1 of the JSON sources it was built from, a snapshot built from other sources is ignored.
+ * The sources are only hashed when their paths, sizes or modification times changed since the snapshot was written.
+ */
+class RegistrySnapshot {
+public:
+    typedef std::array<uint8_t, 20> Digest;
+
+    // Bumped whenever the content written by the registries changes
+    static constexpr int32_t FORMAT_VERSION = 2;
+
+public:
+    /**
+     * @param path The snapshot file
+     * @param sources The JSON files the snapshot is built from, the directories are walked recursively
+     */
+    RegistrySnapshot(std::filesystem::path path, std::vector<std::filesystem::path> sources);
+    ~RegistrySnapshot();
+    RegistrySnapshot(const RegistrySnapshot &) = delete;
+    RegistrySnapshot &operator=(const RegistrySnapshot &) = delete;
+
+    /**
+     * @brief Map the snapshot in memory
+     *
+     * @return false if it is missing, corrupted or was built from other sources
+     */
+    bool open();
+
+    /**
+     * @brief Tag written at the root of the snapshot, only valid while the snapshot is open
+     */
+    NODISCARD std::optional<nbt::TagView> get(std::string_view name) const;
+
+    /**
+     * @brief Write a new snapshot, replacing the previous one atomically
+     *
+     * @param content The named tags to put at the root, written with an nbt::Writer outside of any compound
+     */
+    bool save(const std::vector<uint8_t> &content);
+
+private:
+    void _close();
+    /**
+     * @brief Hash the content of the sources, computed once
+     */
+    const Digest &_sourceHash();
+    /**
+     * @brief Rewrite the snapshot with the current stamp of the sources, its content is unchanged
+     */
+    void _restamp(const nbt::TagView &stamp);
+    bool _write(const std::vector<uint8_t> &data) const;
+
+    std::filesystem::path _path;
+    std::vector<std::filesystem::path> _sourceFiles;
+    // Paths, sizes and modification times of the sources
+    Digest _sourceStamp;
+    std::optional<Digest> _sourceContentHash;
+    void *_mapping;
+    size_t _mappingSize;
+    nbt::TagView _root;
+};
+
+#endif // CUBICSERVER_REGISTRYSNAPSHOT_HPP
@@ -26,6 +26,8 @@
 #include "command_parser/commands/InventoryDump.hpp"
 #include "default/DefaultWorldGroup.hpp"
 #include "logging/logging.hpp"
+#include "nbt_writer.hpp"
+#include "profiling/Profiler.hpp"
 
 using boost::asio::ip::tcp;
 
@@ -34,6 +36,7 @@ Server::Server():
     // _sockfd(-1),
     _config(),
     _toSend(1024),
+    _flushes(0),
     _pluginManager(this)
 {
     // _config.load("./config.yml");
@@ -59,6 +62,11 @@ Server::Server():
     _commands.emplace_back(std::make_unique<command_parser::Loot>());
     _commands.emplace_back(std::make_unique<command_parser::Gamemode>());
     _commands.emplace_back(std::make_unique<command_parser::InventoryDump>());
+    _commands.emplace_back(std::make_unique<command_parser::Pregen>());
+    _commands.emplace_back(std::make_unique<command_parser::Tps>());
+    _commands.emplace_back(std::make_unique<command_parser::Profile>());
+    _commands.emplace_back(std::make_unique<command_parser::NetStats>());
+    _commands.emplace_back(std::make_unique<command_parser::SaveAll>());
 }
 
 Server::~Server() { }
@@ -66,19 +74,14 @@ Server::~Server() { }
 void Server::launch(const configuration::ConfigHandler &config)
 {
     this->_config = config;
+    _statusLimiter.configure(_config["status-rate-limit"].as<double>(), _config["status-rate-burst"].as<double>());
+    _statusCache.configure(_config["motd"].as<std::string>(), _config["max-players"].as<int32_t>());
 
     _rsaKey.generate();
 
-    // Initialize the global palette
-    _globalPalette.initialize(std::string("blocks-") + MC_VERSION + ".json");
-    LINFO("GlobalPalette initialized");
-
-    // Initialize the item converter
-    _itemConverter.initialize(std::string("registries-") + MC_VERSION + ".json");
-    LINFO("ItemConverter initialized");
+    _loadRegistries();
 
-    // Initialize loot tables
-    _lootTables.initialize();
+    _loginCache.rebuild();
 
     // Initialize default world group
     auto defaultChat = std::make_shared<Chat>();
@@ -111,6 +114,17 @@ void Server::launch(const configuration::ConfigHandler &config)
     auto opt = boost::asio::ip::v6_only();
     _acceptor->get_option(opt);
 
+    if (_config["metrics-enabled"].as<bool>()) {
+        auto metricsEndpoint = tcp::endpoint(boost::asio::ip::make_address(_config["metrics-ip"].as<std::string>()), _config["metrics-port"].as<uint16_t>());
+        try {
+            _metricsServer = std::make_unique<metrics::MetricsServer>(_io_context, metricsEndpoint);
+            _metricsServer->start();
+        } catch (const boost::system::system_error &e) {
+            LERROR("Could not serve metrics on port {}: {}", metricsEndpoint.port(), e.what());
+            _metricsServer.reset();
+        }
+    }
+
     _writeThread = std::thread(&Server::_writeLoop, this);
 
     _doAccept();
@@ -141,7 +155,44 @@ void Server::launch(const configuration::ConfigHandler &config)
     // }
 }
 
-void Server::sendData(size_t clientID, std::unique_ptr<std::vector<uint8_t>> &&data) { _toSend.push({clientID, data.release()}); }
+void Server::sendData(size_t clientID, std::unique_ptr<std::vector<uint8_t>> &&data, size_t packets)
+{
+    _toSend.push({clientID, data.release(), packets, std::chrono::steady_clock::now()});
+}
+
+void Server::flushClients()
+{
+    PROFILE_ZONE("Flush clients");
+    bool sampleBacklogs = ++_flushes % metrics::BACKLOG_SAMPLE_TICKS == 0;
+    // Flushed outside of the clients mutex, a tick must never wait for the write thread
+    std::vector<std::shared_ptr<Client>> clients;
+    {
+        std::unique_lock _(clientsMutex);
+        clients.reserve(_clients.size());
+        for (auto &[_, client] : _clients)
+            clients.push_back(client);
+    }
+    for (auto &client : clients) {
+        client->flush();
+        if (sampleBacklogs && client->getStats().sampleBacklog(client->pendingPackets())) {
+            if (client->getStats().isSlow())
+                LWARN("Client {} can't keep up, {} packets are waiting to be sent", client->getID(), client->pendingPackets());
+            else
+                LINFO("Client {} caught up", client->getID());
+        }
+    }
+}
+
+std::vector<std::shared_ptr<Client>> Server::getSlowClients()
+{
+    std::vector<std::shared_ptr<Client>> slowClients;
+    std::unique_lock _(clientsMutex);
+    for (auto &[_, client] : _clients) {
+        if (client->getStats().isSlow())
+            slowClients.push_back(client);
+    }
+    return slowClients;
+}
 
 void Server::_writeLoop()
 {
@@ -155,9 +206,10 @@ void Server::_writeLoop()
                 return;
         }
 
-        OutboundClientData data = {0, nullptr};
+        OutboundClientData data = {0, nullptr, 0, {}};
         if (!_toSend.pop(data))
             continue;
+        std::shared_ptr<Client> client;
         {
             std::unique_lock _(clientsMutex);
             triggerClientCleanup();
@@ -165,21 +217,21 @@ void Server::_writeLoop()
                 delete data.data;
                 continue;
             }
-            auto client = _clients.at(data.clientID);
+            client = _clients.at(data.clientID);
             if (client->isDisconnected()) {
                 triggerClientCleanup(client->getID());
                 delete data.data;
                 continue;
             }
-            boost::system::error_code ec;
-            boost::asio::write(client->getSocket(), boost::asio::buffer(data.data->data(), data.data->size()), ec);
-            // TODO(huntears): Handle errors properly xd
-            if (ec) {
-                LERROR(ec.what());
-                continue;
-            }
         }
+        // The write blocks while the client's socket buffer is full, the clients mutex must not be held during it
+        boost::system::error_code ec;
+        boost::asio::write(client->getSocket(), boost::asio::buffer(data.data->data(), data.data->size()), ec);
+        client->onDataWritten(ec ? 0 : data.data->size(), data.packets, std::chrono::steady_clock::now() - data.enqueuedAt);
         delete data.data;
+        // TODO(huntears): Handle errors properly xd
+        if (ec)
+            LERROR(ec.what());
     }
 }
 
@@ -255,6 +307,8 @@ void Server::stop()
     this->_running = false;
     if (this->_acceptor)
         this->_acceptor->cancel();
+    if (this->_metricsServer)
+        this->_metricsServer->stop();
     if (num++ >= 5) {
         exit(1); // Mash that Ctrl-C xd
     }
@@ -287,7 +341,7 @@ void Server::_stop()
         this->_writeThread.join();
 
     while (!_toSend.empty()) {
-        OutboundClientData data = {0, nullptr};
+        OutboundClientData data = {0, nullptr, 0, {}};
         _toSend.pop(data);
         if (data.data)
             delete data.data;
@@ -304,6 +358,51 @@ void Server::_stop()
     LINFO("Server stopped");
 }
 
+/*
+**  Loads the global palette, the item converter and the loot tables.
+**  They are read from the registry snapshot when it was built from the same JSON files,
+**  otherwise from the JSON files, and the snapshot is rebuilt for the next launch.
+*/
+void Server::_loadRegistries()
+{
+    const std::string blocksPath = std::string("blocks-") + MC_VERSION + ".json";
+    const std::string registriesPath = std::string("registries-") + MC_VERSION + ".json";
+    const std::string lootTablesPath = "assets/loot_tables";
+
+    RegistrySnapshot snapshot(std::string("registries-") + MC_VERSION + ".snapshot", {blocksPath, registriesPath, lootTablesPath});
+    if (snapshot.open()) {
+        try {
+            _globalPalette.load(snapshot.get("blocks").value());
+            _itemConverter.load(snapshot.get("items").value());
+            _lootTables.initialize(snapshot.get("loot_tables").value());
+            LINFO("Registries loaded from the snapshot");
+            return;
+        } catch (const std::exception &e) {
+            LWARN("Could not load the registry snapshot, falling back to JSON: {}", e.what());
+        }
+    }
+
+    std::vector<uint8_t> content;
+    nbt::Writer writer(content);
+
+    // Initialize the global palette
+    _globalPalette.initialize(blocksPath);
+    _globalPalette.save(writer);
+    LINFO("GlobalPalette initialized");
+
+    // Initialize the item converter
+    _itemConverter.initialize(registriesPath);
+    _itemConverter.save(writer);
+    LINFO("ItemConverter initialized");
+
+    // Initialize loot tables
+    writer.beginCompound("loot_tables");
+    _lootTables.initialize(lootTablesPath, &writer);
+    writer.endCompound();
+
+    snapshot.save(content);
+}
+
 /*
 **  Reloads the config if no error within the new file
 */
@@ -315,6 +414,8 @@ void Server::_reloadConfig()
         LERROR(e.what());
         return;
     }
+    _statusLimiter.configure(_config["status-rate-limit"].as<double>(), _config["status-rate-burst"].as<double>());
+    _statusCache.configure(_config["motd"].as<std::string>(), _config["max-players"].as<int32_t>());
 }
 
 /*
@@ -341,6 +442,7 @@ void Server::reload()
     _reloadConfig();
     _reloadWhitelist();
     _enforceWhitelistOnReload();
+    _loginCache.rebuild();
     /* Reload datapacks + plugins */
 }
 
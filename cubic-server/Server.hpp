@@ -14,13 +14,18 @@
 #include <vector>
 
 #include "Client.hpp"
+#include "LoginCache.hpp"
 #include "RSAEncryptionHandler.hpp"
+#include "RateLimiter.hpp"
+#include "RegistrySnapshot.hpp"
+#include "StatusCache.hpp"
 #include "command_parser/commands/Gamemode.hpp"
 #include "command_parser/commands/Help.hpp"
 #include "protocol/ServerPackets.hpp"
 
 #include "WorldGroup.hpp"
 #include "configuration/ConfigHandler.hpp"
+#include "metrics/MetricsServer.hpp"
 #include "whitelist/Whitelist.hpp"
 
 #include "allCommands.hpp"
@@ -39,6 +44,7 @@
 
 constexpr char MC_VERSION[] = "1.19.3";
 constexpr uint16_t MC_PROTOCOL = 761;
+constexpr int32_t MC_DATA_VERSION = 3218;
 constexpr uint16_t MS_PER_TICK = 50;
 
 #define GLOBAL_PALETTE Server::getInstance()->getGlobalPalette()
@@ -51,6 +57,8 @@ class WorldGroup;
 struct OutboundClientData {
     size_t clientID;
     std::vector<uint8_t> *data;
+    size_t packets; // Number of packets batched in the data
+    std::chrono::steady_clock::time_point enqueuedAt;
 };
 
 class Server {
@@ -65,6 +73,10 @@ public:
     void reload();
 
     const configuration::ConfigHandler &getConfig() const { return _config; }
+    /**
+     * @brief Set the configuration without launching the server, for tools that only need the world code
+     */
+    void setConfig(const configuration::ConfigHandler &config) { _config = config; }
     const WhitelistHandling::Whitelist &getWhitelist() const { return _whitelist; }
     bool isWhitelistEnabled() const { return _config["whitelist-enabled"]; }
     bool isWhitelistEnforce() const { return _config["enforce-whitelist"]; }
@@ -87,11 +99,22 @@ public:
     std::unordered_map<std::string_view, std::shared_ptr<WorldGroup>> &getWorldGroups();
     const std::unordered_map<std::string_view, std::shared_ptr<WorldGroup>> &getWorldGroups() const;
     PluginManager &getPluginManager() noexcept { return _pluginManager; }
+    StatusCache &getStatusCache() noexcept { return _statusCache; }
+    LoginCache &getLoginCache() noexcept { return _loginCache; }
+    RateLimiter &getStatusLimiter() noexcept { return _statusLimiter; }
     Recipes &getRecipeSystem(void) noexcept;
 
     LootTables &getLootTableSystem(void) noexcept;
 
-    void sendData(size_t clientID, std::unique_ptr<std::vector<uint8_t>> &&data);
+    void sendData(size_t clientID, std::unique_ptr<std::vector<uint8_t>> &&data, size_t packets = 1);
+    /**
+     * @brief Write the packets batched by every client during the tick
+     */
+    void flushClients();
+    /**
+     * @brief Clients whose send backlog kept growing over the last samples
+     */
+    NODISCARD std::vector<std::shared_ptr<Client>> getSlowClients();
     void triggerClientCleanup(size_t clientID = -1);
 
     void addCommand(std::unique_ptr<CommandBase> command);
@@ -103,6 +126,7 @@ public:
 private:
     Server();
     void _stop();
+    void _loadRegistries();
     void _reloadWhitelist();
     void _reloadConfig();
     void _enforceWhitelistOnReload();
@@ -129,6 +153,9 @@ private:
     Recipes _recipes;
     PluginManager _pluginManager;
     LootTables _lootTables;
+    StatusCache _statusCache;
+    LoginCache _loginCache;
+    RateLimiter _statusLimiter;
 
     // new boost stuff
 
@@ -136,8 +163,10 @@ private:
 
     boost::asio::io_context _io_context;
     std::unique_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
+    std::unique_ptr<metrics::MetricsServer> _metricsServer;
 
     boost::lockfree::queue<OutboundClientData> _toSend;
+    uint64_t _flushes;
     void _writeLoop();
     std::thread _writeThread;
 
@@ -4,6 +4,7 @@
 #include "Player.hpp"
 #include "World.hpp"
 #include "WorldGroup.hpp"
+#include "profiling/Profiler.hpp"
 
 SoundSystem::SoundSystem(const WorldGroup &group):
     _group(group)
@@ -12,6 +13,7 @@ SoundSystem::SoundSystem(const WorldGroup &group):
 
 void SoundSystem::tick()
 {
+    PROFILE_ZONE("Sound tick");
     _sinceLastSE++;
     // 20t = 1s -> SE every 20 seconds
     if (_sinceLastSE <= 20 * 20)
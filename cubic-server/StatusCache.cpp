@@ -0,0 +1,91 @@
+#include "StatusCache.hpp"
+
+#include "Server.hpp"
+#include "nlohmann/json.hpp"
+#include "protocol/ClientPackets.hpp"
+
+StatusCache::StatusCache():
+    _builtAt(0),
+    _dirty(true),
+    _onlinePlayers(0),
+    _maxPlayers(0)
+{
+}
+
+std::shared_ptr<const std::vector<uint8_t>> StatusCache::get()
+{
+    auto now = Clock::now().time_since_epoch().count();
+    auto packet = std::atomic_load(&_packet);
+    if (packet && !_dirty && Clock::duration(now - _builtAt) < REFRESH_INTERVAL)
+        return packet;
+
+    // Only one client rebuilds it, the others keep serving the previous one
+    std::unique_lock lock(_buildMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        if (packet)
+            return packet;
+        lock.lock();
+        if ((packet = std::atomic_load(&_packet)))
+            return packet;
+    }
+
+    // Cleared first so an invalidation during the build is not lost
+    _dirty = false;
+    packet = this->_build();
+    std::atomic_store(&_packet, packet);
+    _builtAt = now;
+    return packet;
+}
+
+void StatusCache::configure(std::string motd, int32_t maxPlayers)
+{
+    {
+        std::lock_guard _(_configMutex);
+        _motd = std::move(motd);
+        _maxPlayers = maxPlayers;
+    }
+    _dirty = true;
+}
+
+void StatusCache::invalidate() { _dirty = true; }
+
+void StatusCache::onPlayerJoin()
+{
+    _onlinePlayers++;
+    _dirty = true;
+}
+
+void StatusCache::onPlayerLeave()
+{
+    _onlinePlayers--;
+    _dirty = true;
+}
+
+int32_t StatusCache::getOnlinePlayers() const { return _onlinePlayers; }
+
+std::shared_ptr<const std::vector<uint8_t>> StatusCache::_build() const
+{
+    std::string motd;
+    int32_t maxPlayers;
+    {
+        std::lock_guard _(_configMutex);
+        motd = _motd;
+        maxPlayers = _maxPlayers;
+    }
+    nlohmann::json json;
+
+    json["previewsChat"] = false;
+    json["favicon"] = DEFAULT_FAVICON;
+    json["description"]["text"] = motd;
+    json["enforcesSecureChat"] = false;
+
+    // The version and the players are only sent once the worlds are loaded
+    if (Server::getInstance()->getWorldGroup("default")->isInitialized()) {
+        json["version"]["name"] = MC_VERSION;
+        json["version"]["protocol"] = MC_PROTOCOL;
+        json["players"]["max"] = maxPlayers;
+        json["players"]["online"] = _onlinePlayers.load();
+    }
+
+    return protocol::createStatusResponse({json.dump()});
+}
@@ -0,0 +1,67 @@
+#ifndef CUBICSERVER_STATUSCACHE_HPP
+#define CUBICSERVER_STATUSCACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+
+/**
+ * @brief Serialized status response served to the server list pings
+ *
+ * The packet is rebuilt at most once per REFRESH_INTERVAL, or on the next ping after an invalidation.
+ * Pings served while it is being rebuilt get the previous packet instead of waiting.
+ * It is built from its own copy of the configuration, the pings never read the configuration while it is reloaded.
+ */
+class StatusCache {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr auto REFRESH_INTERVAL = std::chrono::seconds(1);
+
+public:
+    StatusCache();
+
+    /**
+     * @brief The complete Status Response packet, ready to be written
+     *
+     * @note This function is thread-safe
+     */
+    NODISCARD std::shared_ptr<const std::vector<uint8_t>> get();
+
+    /**
+     * @brief Set the values taken from the configuration, the packet is rebuilt on the next ping
+     *
+     * @note This function is thread-safe
+     */
+    void configure(std::string motd, int32_t maxPlayers);
+
+    /**
+     * @brief Rebuild the packet on the next ping
+     */
+    void invalidate();
+
+    void onPlayerJoin();
+    void onPlayerLeave();
+    NODISCARD int32_t getOnlinePlayers() const;
+
+private:
+    NODISCARD std::shared_ptr<const std::vector<uint8_t>> _build() const;
+
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<const std::vector<uint8_t>> _packet;
+    std::atomic<Clock::rep> _builtAt;
+    std::atomic<bool> _dirty;
+    std::atomic<int32_t> _onlinePlayers;
+    std::mutex _buildMutex;
+    mutable std::mutex _configMutex;
+    std::string _motd;
+    int32_t _maxPlayers;
+};
+
+#endif // CUBICSERVER_STATUSCACHE_HPP
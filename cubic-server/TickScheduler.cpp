@@ -0,0 +1,153 @@
+#include "TickScheduler.hpp"
+
+#include "logging/logging.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+constexpr auto TPS_SAMPLE_INTERVAL = 5s;
+constexpr auto BEHIND_WARNING_INTERVAL = 15s;
+constexpr std::array<double, 3> TPS_WINDOWS = {60.0, 300.0, 900.0};
+
+TickScheduler::TickScheduler(std::chrono::milliseconds tickDuration):
+    _tickDuration(tickDuration),
+    _tpsWindowTicks(0),
+    _mspt(),
+    _msptIndex(0),
+    _msptCount(0),
+    _overruns(0),
+    _msptBuckets(),
+    _msptSumUs(0)
+{
+    this->start();
+}
+
+void TickScheduler::start()
+{
+    auto now = Clock::now();
+    double tickRate = std::chrono::duration<double>(1s) / _tickDuration;
+
+    std::lock_guard _(_metricsMutex);
+    _nextTick = now;
+    _tickStart = now;
+    _lastBehindWarning = now - BEHIND_WARNING_INTERVAL;
+    _tpsWindowStart = now;
+    _tpsWindowTicks = 0;
+    _tps.fill(tickRate);
+    _msptIndex = 0;
+    _msptCount = 0;
+    _overruns = 0;
+    for (auto &bucket : _msptBuckets)
+        bucket = 0;
+    _msptSumUs = 0;
+}
+
+void TickScheduler::waitNextTick()
+{
+    auto now = Clock::now();
+
+    if (now < _nextTick) {
+        std::this_thread::sleep_until(_nextTick);
+        now = Clock::now();
+    } else if (now - _nextTick > _tickDuration * MAX_CATCH_UP_TICKS) {
+        auto behind = now - _nextTick;
+        if (now - _lastBehindWarning >= BEHIND_WARNING_INTERVAL) {
+            _lastBehindWarning = now;
+            LWARN(
+                "Can't keep up! Is the server overloaded? Running {}ms or {} ticks behind", std::chrono::duration_cast<std::chrono::milliseconds>(behind).count(),
+                behind / _tickDuration
+            );
+        }
+        // Drop the missed ticks rather than running them all back to back
+        _nextTick = now;
+    }
+
+    _nextTick += _tickDuration;
+    _tickStart = now;
+    this->_updateTps(now);
+}
+
+void TickScheduler::endTick()
+{
+    auto duration = Clock::now() - _tickStart;
+    double mspt = std::chrono::duration<double, std::milli>(duration).count();
+
+    auto bucket = std::lower_bound(MSPT_BUCKETS.begin(), MSPT_BUCKETS.end(), mspt) - MSPT_BUCKETS.begin();
+    _msptBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _msptSumUs.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), std::memory_order_relaxed);
+
+    std::lock_guard _(_metricsMutex);
+    _mspt[_msptIndex] = mspt;
+    _msptIndex = (_msptIndex + 1) % MSPT_SAMPLES;
+    _msptCount = std::min(_msptCount + 1, MSPT_SAMPLES);
+    if (duration > _tickDuration)
+        _overruns++;
+}
+
+std::array<double, 3> TickScheduler::getTps() const
+{
+    std::lock_guard _(_metricsMutex);
+    return _tps;
+}
+
+TickScheduler::MsptStats TickScheduler::getMspt() const
+{
+    std::vector<double> samples;
+    {
+        std::lock_guard _(_metricsMutex);
+        samples.assign(_mspt.begin(), _mspt.begin() + _msptCount);
+    }
+    if (samples.empty())
+        return {0, 0, 0, 0, 0};
+
+    std::sort(samples.begin(), samples.end());
+    return {
+        samples.front(),
+        std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size(),
+        samples[samples.size() / 2],
+        samples[std::min(samples.size() - 1, samples.size() * 95 / 100)],
+        samples.back(),
+    };
+}
+
+uint64_t TickScheduler::getOverruns() const
+{
+    std::lock_guard _(_metricsMutex);
+    return _overruns;
+}
+
+TickScheduler::MsptHistogram TickScheduler::getMsptHistogram() const
+{
+    MsptHistogram histogram;
+    uint64_t total = 0;
+    for (size_t i = 0; i < _msptBuckets.size(); i++) {
+        total += _msptBuckets[i].load(std::memory_order_relaxed);
+        histogram.buckets[i] = total;
+    }
+    histogram.sum = _msptSumUs.load(std::memory_order_relaxed) / 1000.0;
+    return histogram;
+}
+
+void TickScheduler::_updateTps(Clock::time_point now)
+{
+    _tpsWindowTicks++;
+    auto elapsed = now - _tpsWindowStart;
+    if (elapsed < TPS_SAMPLE_INTERVAL)
+        return;
+
+    // Exponentially weighted like the unix load average
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double current = _tpsWindowTicks / seconds;
+
+    std::lock_guard _(_metricsMutex);
+    for (size_t i = 0; i < _tps.size(); i++) {
+        double decay = std::exp(-seconds / TPS_WINDOWS[i]);
+        _tps[i] = _tps[i] * decay + current * (1 - decay);
+    }
+    _tpsWindowStart = now;
+    _tpsWindowTicks = 0;
+}
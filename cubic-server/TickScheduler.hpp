@@ -0,0 +1,105 @@
+#ifndef CUBICSERVER_TICKSCHEDULER_HPP
+#define CUBICSERVER_TICKSCHEDULER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "options.hpp"
+
+/**
+ * @brief Paces a fixed timestep loop on the monotonic clock and measures its TPS and MSPT
+ *
+ * Late ticks are run back to back until the loop has caught up with its deadlines.
+ * When it is more than MAX_CATCH_UP_TICKS behind, the missed ticks are dropped instead.
+ */
+class TickScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct MsptStats {
+        double min;
+        double average;
+        double median;
+        double p95;
+        double max;
+    };
+
+    // Upper bounds in milliseconds of the MSPT histogram buckets, the last bucket is unbounded
+    static constexpr std::array<double, 8> MSPT_BUCKETS = {5, 10, 25, 50, 100, 250, 500, 1000};
+
+    struct MsptHistogram {
+        // Cumulative like a Prometheus histogram, the last one is the total number of ticks
+        std::array<uint64_t, MSPT_BUCKETS.size() + 1> buckets;
+        double sum;
+    };
+
+    // Number of late ticks run without sleeping before giving up on them
+    static constexpr uint16_t MAX_CATCH_UP_TICKS = 10;
+    // 30 seconds at 20 TPS
+    static constexpr size_t MSPT_SAMPLES = 600;
+
+public:
+    explicit TickScheduler(std::chrono::milliseconds tickDuration);
+
+    /**
+     * @brief Reset the deadlines and the metrics, the first tick is due immediately
+     */
+    void start();
+
+    /**
+     * @brief Sleep until the next tick is due, catching up or dropping ticks if the loop is late
+     */
+    void waitNextTick();
+
+    /**
+     * @brief Record the duration of the tick started by the last waitNextTick
+     */
+    void endTick();
+
+    /**
+     * @brief Ticks per second averaged over the last 1, 5 and 15 minutes
+     */
+    NODISCARD std::array<double, 3> getTps() const;
+
+    /**
+     * @brief Milliseconds per tick over the last MSPT_SAMPLES ticks
+     */
+    NODISCARD MsptStats getMspt() const;
+
+    /**
+     * @brief Number of ticks that took longer than their time slot
+     */
+    NODISCARD uint64_t getOverruns() const;
+
+    /**
+     * @brief Distribution of the MSPT since the start, lock free so it can be scraped at any time
+     */
+    NODISCARD MsptHistogram getMsptHistogram() const;
+
+private:
+    void _updateTps(Clock::time_point now);
+
+    Clock::duration _tickDuration;
+    Clock::time_point _nextTick;
+    Clock::time_point _tickStart;
+    Clock::time_point _lastBehindWarning;
+
+    Clock::time_point _tpsWindowStart;
+    uint64_t _tpsWindowTicks;
+    std::array<double, 3> _tps;
+
+    std::array<double, MSPT_SAMPLES> _mspt;
+    size_t _msptIndex;
+    size_t _msptCount;
+    uint64_t _overruns;
+
+    std::array<std::atomic<uint64_t>, MSPT_BUCKETS.size() + 1> _msptBuckets;
+    std::atomic<uint64_t> _msptSumUs;
+
+    mutable std::mutex _metricsMutex;
+};
+
+#endif // CUBICSERVER_TICKSCHEDULER_HPP
@@ -5,6 +5,7 @@
 #include "Server.hpp"
 #include "WorldGroup.hpp"
 #include "logging/logging.hpp"
+#include "profiling/Profiler.hpp"
 #include <cstdint>
 
 World::World(std::shared_ptr<WorldGroup> worldGroup, world_storage::WorldType worldType, std::string folder):
@@ -14,8 +15,10 @@ World::World(std::shared_ptr<WorldGroup> worldGroup, world_storage::WorldType wo
     _renderDistance(CONFIG["render-distance"].as<uint8_t>()),
     _timeUpdateClock(20, std::bind(&World::updateTime, this)), // 1 second for time updates
     _generationPool(CONFIG["num-gen-thread"].as<uint16_t>(), "WorldGen"),
+    _entityTickPool(CONFIG["num-entity-thread"].as<uint16_t>(), "EntityTick"),
     _worldType(worldType),
-    _folder(folder)
+    _folder(folder),
+    _pregenerator(*this, folder)
 {
     _timeUpdateClock.start();
     _seed = CONFIG["seed"].as<int64_t>();
@@ -24,22 +27,27 @@ World::World(std::shared_ptr<WorldGroup> worldGroup, world_storage::WorldType wo
 
 void World::tick()
 {
-    onEvent(Server::getInstance()->getPluginManager(), tick);
+    PROFILE_ZONE("World tick");
+    {
+        PROFILE_ZONE("Plugin tick event");
+        onEvent(Server::getInstance()->getPluginManager(), tick);
+    }
 
     // TODO: I don't think this should tick if there are no players / chunks loaded
     _timeUpdateClock.tick();
-    for (auto &[_, dim] : this->_dimensions)
-        dim->getDimensionLock().release();
 }
 
 void World::initialize()
 {
     for (auto &[_, dim] : this->_dimensions)
         dim->initialize();
+
+    _pregenerator.load();
 }
 
 void World::stop()
 {
+    _pregenerator.stop();
     _generationPool.cancelAll();
     _generationPool.waitUntilJobsDone();
 
@@ -189,6 +197,23 @@ void World::sendPlayerInfoRemovePlayer(const Player *current)
 
 thread_pool::PriorityThreadPool &World::getGenerationPool() { return _generationPool; }
 
+thread_pool::ThreadPool &World::getEntityTickPool() { return _entityTickPool; }
+
+Pregenerator &World::getPregenerator() { return _pregenerator; }
+
+world_storage::Persistence *World::getPersistence() { return nullptr; }
+
+void World::save(UNUSED bool flush) { }
+
+const world_storage::ChunkColumn &World::getFlatTemplate(std::shared_ptr<Dimension> dimension)
+{
+    std::call_once(_flatTemplateFlag, [this, dimension] {
+        _flatTemplate = std::make_unique<world_storage::ChunkColumn>(Position2D(0, 0), dimension);
+        _flatTemplate->generateFlatTemplate();
+    });
+    return *_flatTemplate;
+}
+
 Seed World::getSeed() const { return _seed; }
 
 uint8_t World::getRenderDistance() const { return _renderDistance; }
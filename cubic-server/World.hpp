@@ -3,12 +3,15 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "Pregenerator.hpp"
 #include "TickClock.hpp"
 #include "options.hpp"
 #include "thread_pool/PriorityThreadPool.hpp"
+#include "thread_pool/ThreadPool.hpp"
 #include "types.hpp"
 #include "world_storage/ChunkColumn.hpp"
 #include "world_storage/LevelData.hpp"
@@ -19,6 +22,10 @@ class Entity;
 class Player;
 class WorldGroup;
 
+namespace world_storage {
+class Persistence;
+}
+
 constexpr int NB_SPAWN_CHUNKS = 19;
 
 class World : public std::enable_shared_from_this<World> {
@@ -47,6 +54,27 @@ public:
     virtual void sendPlayerInfoRemovePlayer(const Player *current);
 
     NODISCARD virtual thread_pool::PriorityThreadPool &getGenerationPool();
+    NODISCARD virtual thread_pool::ThreadPool &getEntityTickPool();
+    NODISCARD virtual Pregenerator &getPregenerator();
+
+    /**
+     * @brief Storage of the world on disk, nullptr if the world is not persisted
+     */
+    NODISCARD virtual world_storage::Persistence *getPersistence();
+
+    /**
+     * @brief Queue every modified chunk to be saved, nothing is saved if the world is not persisted
+     *
+     * @param flush Wait for the chunks and the player data to be written
+     */
+    virtual void save(bool flush);
+
+    /**
+     * @brief Chunk every flat chunk of the world is copied from, built on first use
+     *
+     * @param dimension Dimension used to build the template the first time
+     */
+    NODISCARD virtual const world_storage::ChunkColumn &getFlatTemplate(std::shared_ptr<Dimension> dimension);
 
     NODISCARD virtual Seed getSeed() const;
     NODISCARD virtual uint8_t getRenderDistance() const;
@@ -78,8 +106,12 @@ protected:
     TickClock _timeUpdateClock;
     Seed _seed;
     thread_pool::PriorityThreadPool _generationPool;
+    thread_pool::ThreadPool _entityTickPool;
     world_storage::WorldType _worldType;
     std::string _folder;
+    Pregenerator _pregenerator;
+    std::unique_ptr<world_storage::ChunkColumn> _flatTemplate;
+    std::once_flag _flatTemplateFlag;
 };
 
 #endif // CUBICSERVER_WORLD_HPP
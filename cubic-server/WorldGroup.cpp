@@ -1,15 +1,20 @@
 #include "WorldGroup.hpp"
 
 #include "Chat.hpp"
+#include "Dimension.hpp"
 #include "Server.hpp"
 #include "SoundSystem.hpp"
 #include "World.hpp"
 #include "logging/logging.hpp"
+#include "profiling/Profiler.hpp"
+#include <latch>
 
 WorldGroup::WorldGroup(std::shared_ptr<Chat> chat):
     _chat(std::move(chat)),
     _soundSystem(new SoundSystem(*this)),
-    _running(false)
+    _running(false),
+    _tickScheduler(std::chrono::milliseconds(MS_PER_TICK)),
+    _tickPool(CONFIG["num-tick-thread"].as<uint16_t>(), "Tick")
 {
 }
 
@@ -22,23 +27,53 @@ WorldGroup::~WorldGroup()
 void WorldGroup::initialize()
 {
     this->_running = true;
+    this->_tickScheduler.start();
     this->_thread = std::thread(&WorldGroup::_run, this);
 }
 
 void WorldGroup::_run()
 {
     while (_running) {
-        auto startTime = std::chrono::system_clock::now();
-        for (auto &[_, world] : _worlds) {
-            world->tick();
+        _tickScheduler.waitNextTick();
+        {
+            PROFILE_ZONE("Tick");
+            for (auto &[_, world] : _worlds) {
+                world->tick();
+            }
+            this->_tickDimensions();
+            _soundSystem->tick();
+            Server::getInstance()->flushClients();
         }
-        _soundSystem->tick();
-        auto endTime = std::chrono::system_clock::now();
-        auto compute_time = endTime - startTime;
-        std::this_thread::sleep_for(std::chrono::milliseconds(MS_PER_TICK) - compute_time);
+        _tickScheduler.endTick();
     }
 }
 
+void WorldGroup::_tickDimensions()
+{
+    std::vector<std::shared_ptr<Dimension>> dimensions;
+    for (auto &[_, world] : _worlds) {
+        for (auto &dim : world->getDimensions()) {
+            if (dim.second->isRunning() && dim.second->isInitialized())
+                dimensions.push_back(dim.second);
+        }
+    }
+    if (dimensions.empty())
+        return;
+
+    std::latch done(dimensions.size());
+    for (auto &dim : dimensions) {
+        _tickPool.addJob([&done, dim] {
+            try {
+                dim->timedTick();
+            } catch (const std::exception &e) {
+                LERROR("Dimension tick failed: {}", e.what());
+            }
+            done.count_down();
+        });
+    }
+    done.wait();
+}
+
 void WorldGroup::stop()
 {
     _running = false;
@@ -59,6 +94,8 @@ std::unordered_map<std::string_view, std::shared_ptr<World>> &WorldGroup::getWor
 
 const std::unordered_map<std::string_view, std::shared_ptr<World>> &WorldGroup::getWorlds() const { return this->_worlds; }
 
+const TickScheduler &WorldGroup::getTickScheduler() const { return this->_tickScheduler; }
+
 // void WorldGroup::initialize()
 //{
 //     LWARN("Initialized empty world group");
@@ -7,6 +7,9 @@
 #include <thread>
 #include <unordered_map>
 
+#include "TickScheduler.hpp"
+#include "thread_pool/ThreadPool.hpp"
+
 class World;
 class Chat;
 class SoundSystem;
@@ -25,13 +28,21 @@ public:
 
     virtual bool isInitialized() const;
 
+    virtual const TickScheduler &getTickScheduler() const;
+
 protected:
     virtual void _run();
+    /**
+     * @brief Tick every running dimension of every world on the tick pool and wait for all of them
+     */
+    virtual void _tickDimensions();
 
     std::shared_ptr<Chat> _chat;
     std::unordered_map<std::string_view, std::shared_ptr<World>> _worlds;
     SoundSystem *_soundSystem;
     std::atomic<bool> _running;
+    TickScheduler _tickScheduler;
+    thread_pool::ThreadPool _tickPool;
     std::thread _thread;
 };
 
@@ -3,10 +3,15 @@
 #include "command_parser/commands/Gamemode.hpp"
 #include "command_parser/commands/Help.hpp"
 #include "command_parser/commands/Log.hpp"
+#include "command_parser/commands/NetStats.hpp"
 #include "command_parser/commands/Op.hpp"
+#include "command_parser/commands/Pregen.hpp"
+#include "command_parser/commands/Profile.hpp"
 #include "command_parser/commands/QuestionMark.hpp"
 #include "command_parser/commands/Reload.hpp"
+#include "command_parser/commands/SaveAll.hpp"
 #include "command_parser/commands/Seed.hpp"
 #include "command_parser/commands/Stop.hpp"
 #include "command_parser/commands/Time.hpp"
+#include "command_parser/commands/Tps.hpp"
 #include "command_parser/commands/Loot.hpp"
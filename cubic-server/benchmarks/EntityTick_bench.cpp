@@ -0,0 +1,65 @@
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Entity.hpp"
+#include "World.hpp"
+#include "WorldGroup.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <random>
+
+namespace EntityTick {
+
+constexpr size_t NB_ENTITIES = 20000;
+// Entities are spread over a square of this many blocks, about a thousand regions
+constexpr double SPAWN_AREA = 4096;
+
+/**
+ * @brief Wanders around and does a bit of math every tick, roughly what a simple mob AI costs
+ */
+class WanderingEntity : public Entity {
+public:
+    WanderingEntity(std::shared_ptr<Dimension> dim, const Vector3<double> &pos):
+        Entity(dim, protocol::SpawnEntity::EntityType::Zombie),
+        _angle(0)
+    {
+        this->forceSetPosition(pos);
+    }
+
+    void tick() override
+    {
+        for (int i = 0; i < 64; i++)
+            _angle = std::fmod(_angle + std::sin(_angle + _pos.x) * std::cos(_angle + _pos.z) + 0.1, 2 * M_PI);
+        _pos.x += std::cos(_angle) * 0.1;
+        _pos.z += std::sin(_angle) * 0.1;
+    }
+
+private:
+    double _angle;
+};
+
+static std::shared_ptr<Dimension> makeDimension()
+{
+    auto worldGroup = std::make_shared<WorldGroup>(std::make_shared<Chat>());
+    auto world = std::make_shared<World>(worldGroup, world_storage::WorldType::SUPERFLAT, "bench-world");
+    auto dimension = std::make_shared<Dimension>(world, world_storage::DimensionType::OVERWORLD);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> distribution(-SPAWN_AREA / 2, SPAWN_AREA / 2);
+    for (size_t i = 0; i < NB_ENTITIES; i++)
+        dimension->makeEntity<WanderingEntity>(Vector3<double> {distribution(random), -60, distribution(random)});
+    return dimension;
+}
+
+static void tick(benchmark::State &state)
+{
+    static auto dimension = makeDimension();
+
+    for (auto _ : state)
+        dimension->tick();
+
+    state.counters["entities/s"] = benchmark::Counter(state.iterations() * NB_ENTITIES, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(tick)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace EntityTick
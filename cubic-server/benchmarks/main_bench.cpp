@@ -0,0 +1,31 @@
+#include "Server.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <thread>
+
+// The server configuration is read by the worlds, it must exist before any benchmark runs
+static void initConfig()
+{
+    auto config = configuration::ConfigHandler("cubic-bench", PROGRAM_VERSION);
+
+    config.add("render-distance").defaultValue(10);
+    config.add("num-gen-thread").defaultValue(1);
+    config.add("num-tick-thread").defaultValue(1);
+    config.add("num-entity-thread").defaultValue(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    config.add("pregen-concurrency").defaultValue(1);
+    config.add("seed").defaultValue(-721274728);
+    config.parse();
+    Server::getInstance()->setConfig(config);
+}
+
+int main(int argc, char **argv)
+{
+    initConfig();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
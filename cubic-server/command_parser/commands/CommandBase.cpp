@@ -0,0 +1,15 @@
+#include "CommandBase.hpp"
+
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Player.hpp"
+#include "World.hpp"
+#include "logging/logging.hpp"
+
+void CommandBase::reply(const std::string &message, Player *invoker)
+{
+    if (invoker)
+        invoker->getDimension()->getWorld()->getChat()->sendSystemMessage(message, *invoker);
+    else
+        LINFO(message);
+}
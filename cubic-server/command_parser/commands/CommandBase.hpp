@@ -20,6 +20,11 @@ struct CommandBase {
     virtual void execute(std::vector<std::string> &args, Player *invoker) const = 0;
     virtual void help(std::vector<std::string> &args, Player *invoker) const = 0;
 
+    /**
+     * @brief Send a message to the player running the command, or log it when it comes from the console
+     */
+    static void reply(const std::string &message, Player *invoker);
+
     const std::string _name;
     const std::string _help;
     const uint8_t _needOp;
@@ -0,0 +1,98 @@
+#include "NetStats.hpp"
+
+#include "Chat.hpp"
+#include "Client.hpp"
+#include "Dimension.hpp"
+#include "Player.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "logging/logging.hpp"
+#include "metrics/ClientStats.hpp"
+
+// Packet types listed for each direction
+constexpr size_t TOP_PACKETS = 8;
+
+static std::string formatBytes(uint64_t bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return fmt::format("{:.1f}MiB", bytes / (1024.0 * 1024.0));
+    if (bytes >= 1024)
+        return fmt::format("{:.1f}KiB", bytes / 1024.0);
+    return fmt::format("{}B", bytes);
+}
+
+static void replyPackets(const std::string &title, const std::vector<metrics::ClientStats::PacketStat> &packets, Player *invoker)
+{
+    CommandBase::reply(title, invoker);
+    for (size_t i = 0; i < packets.size() && i < TOP_PACKETS; i++)
+        CommandBase::reply(fmt::format("  0x{:02x} (state {}): {} packets, {}", packets[i].id, packets[i].status, packets[i].packets, formatBytes(packets[i].bytes)), invoker);
+}
+
+void command_parser::NetStats::autocomplete(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker)
+        return;
+    else
+        LINFO("autocomplete netstats");
+}
+
+void command_parser::NetStats::execute(std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker && !invoker->isOperator())
+        return;
+    if (args.size() > 1) {
+        reply("Usage : " + _help, invoker);
+        return;
+    }
+
+    auto server = Server::getInstance();
+    std::vector<std::string> lines;
+    std::shared_ptr<Client> target;
+    {
+        std::lock_guard _(server->clientsMutex);
+        for (const auto &[id, client] : server->getClients()) {
+            auto player = client->getPlayer();
+            if (args.size() == 1) {
+                if (player && player->getUsername() == args[0])
+                    target = client;
+                continue;
+            }
+            const auto &stats = client->getStats();
+            lines.push_back(fmt::format(
+                "Client {}{}: in {}, out {}, {} pending packets, write latency {:.1f}ms (max {:.1f}ms){}", id, player ? " (" + player->getUsername() + ")" : "",
+                formatBytes(stats.getBytesIn()), formatBytes(stats.getBytesOut()), client->pendingPackets(), stats.getWriteLatency(), stats.getMaxWriteLatency(),
+                stats.isSlow() ? " [slow]" : ""
+            ));
+        }
+    }
+
+    if (args.size() == 1) {
+        if (!target) {
+            reply(fmt::format("Unknown player {}", args[0]), invoker);
+            return;
+        }
+        replyPackets(fmt::format("Packets sent to {}:", args[0]), target->getStats().getPacketsOut(), invoker);
+        replyPackets(fmt::format("Packets received from {}:", args[0]), target->getStats().getPacketsIn(), invoker);
+        return;
+    }
+
+    reply(
+        fmt::format(
+            "{} clients, {} slow, in {}, out {}", lines.size(), metrics::network.slowClients.load(), formatBytes(metrics::network.bytesIn.load()),
+            formatBytes(metrics::network.bytesOut.load())
+        ),
+        invoker
+    );
+    for (const auto &line : lines)
+        reply(line, invoker);
+    replyPackets("Heaviest packets sent:", metrics::ClientStats::sortPackets(metrics::network.packetsOut), invoker);
+}
+
+void command_parser::NetStats::help(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker) {
+        if (invoker->isOperator())
+            invoker->getDimension()->getWorld()->getChat()->sendSystemMessage(_help, *invoker);
+    } else
+        LINFO(_help);
+}
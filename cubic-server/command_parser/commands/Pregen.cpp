@@ -0,0 +1,66 @@
+#include "Pregen.hpp"
+
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Player.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "WorldGroup.hpp"
+#include "logging/logging.hpp"
+
+void command_parser::Pregen::autocomplete(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker)
+        return;
+    else
+        LINFO("autocomplete pregen");
+}
+
+void command_parser::Pregen::execute(std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker && !invoker->isOperator())
+        return;
+    if (args.empty() || args.size() > 2) {
+        reply("Usage : " + _help, invoker);
+        return;
+    }
+
+    auto world = Server::getInstance()->getWorldGroup("default")->getWorld("default");
+    auto &pregenerator = world->getPregenerator();
+
+    if (args[0] == "status") {
+        reply(pregenerator.status(), invoker);
+    } else if (args[0] == "pause") {
+        pregenerator.pause();
+        reply(pregenerator.status(), invoker);
+    } else if (args[0] == "resume") {
+        if (!pregenerator.resume())
+            reply("No pregeneration to resume", invoker);
+        else
+            reply(pregenerator.status(), invoker);
+    } else {
+        int32_t radius = 0;
+        try {
+            radius = std::stoi(args[0]);
+        } catch (const std::exception &) {
+            reply("Usage : " + _help, invoker);
+            return;
+        }
+        auto dimension = args.size() == 2 ? args[1] : "overworld";
+        if (radius < 0 || !world->getDimensions().contains(dimension)) {
+            reply("Usage : " + _help, invoker);
+            return;
+        }
+        pregenerator.start(dimension, radius);
+        reply(pregenerator.status(), invoker);
+    }
+}
+
+void command_parser::Pregen::help(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker) {
+        if (invoker->isOperator())
+            invoker->getDimension()->getWorld()->getChat()->sendSystemMessage(_help, *invoker);
+    } else
+        LINFO(_help);
+}
@@ -0,0 +1,21 @@
+#ifndef CUBICSERVER_COMMANDPARSER_COMMANDS_PREGEN_HPP
+#define CUBICSERVER_COMMANDPARSER_COMMANDS_PREGEN_HPP
+
+#include "CommandBase.hpp"
+
+namespace command_parser {
+struct Pregen : public CommandBase {
+    Pregen():
+        CommandBase("pregen", "/pregen <radius> [dimension] | pause | resume | status", true)
+    {
+    }
+
+    ~Pregen() override = default;
+
+    void autocomplete(std::vector<std::string> &args, Player *invoker) const override;
+    void execute(std::vector<std::string> &args, Player *invoker) const override;
+    void help(std::vector<std::string> &args, Player *invoker) const override;
+};
+}
+
+#endif // CUBICSERVER_COMMANDPARSER_COMMANDS_PREGEN_HPP
@@ -0,0 +1,56 @@
+#include "Profile.hpp"
+
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Player.hpp"
+#include "World.hpp"
+#include "logging/logging.hpp"
+#include "profiling/Profiler.hpp"
+#include <chrono>
+
+void command_parser::Profile::autocomplete(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker)
+        return;
+    else
+        LINFO("autocomplete profile");
+}
+
+void command_parser::Profile::execute(std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker && !invoker->isOperator())
+        return;
+    if (args.empty() || args.size() > 2 || (args[0] != "start" && args[0] != "stop") || (args[0] == "start" && args.size() != 1)) {
+        reply("Usage : " + _help, invoker);
+        return;
+    }
+
+    auto &profiler = profiling::Profiler::getInstance();
+    if (args[0] == "start") {
+        if (profiler.isRunning()) {
+            reply("The profiler is already running", invoker);
+            return;
+        }
+        profiler.start();
+        reply("Profiler started, use /profile stop to write the trace", invoker);
+        return;
+    }
+
+    if (!profiler.isRunning()) {
+        reply("The profiler is not running", invoker);
+        return;
+    }
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    auto file = args.size() == 2 ? args[1] : fmt::format("profiles/profile-{}.json", seconds);
+    auto events = profiler.stop(file);
+    reply(fmt::format("Wrote {} events to {}, open it with chrome://tracing or https://ui.perfetto.dev", events, file), invoker);
+}
+
+void command_parser::Profile::help(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker) {
+        if (invoker->isOperator())
+            invoker->getDimension()->getWorld()->getChat()->sendSystemMessage(_help, *invoker);
+    } else
+        LINFO(_help);
+}
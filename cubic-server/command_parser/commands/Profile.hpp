@@ -0,0 +1,21 @@
+#ifndef CUBICSERVER_COMMANDPARSER_COMMANDS_PROFILE_HPP
+#define CUBICSERVER_COMMANDPARSER_COMMANDS_PROFILE_HPP
+
+#include "CommandBase.hpp"
+
+namespace command_parser {
+struct Profile : public CommandBase {
+    Profile():
+        CommandBase("profile", "/profile <start|stop> [file]", true)
+    {
+    }
+
+    ~Profile() override = default;
+
+    void autocomplete(std::vector<std::string> &args, Player *invoker) const override;
+    void execute(std::vector<std::string> &args, Player *invoker) const override;
+    void help(std::vector<std::string> &args, Player *invoker) const override;
+};
+}
+
+#endif // CUBICSERVER_COMMANDPARSER_COMMANDS_PROFILE_HPP
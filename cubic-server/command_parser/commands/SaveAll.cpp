@@ -0,0 +1,45 @@
+#include "SaveAll.hpp"
+
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Player.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "WorldGroup.hpp"
+#include "logging/logging.hpp"
+
+void command_parser::SaveAll::autocomplete(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker)
+        return;
+    else
+        LINFO("autocomplete save-all");
+}
+
+void command_parser::SaveAll::execute(std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker && !invoker->isOperator())
+        return;
+    if (args.size() > 1 || (args.size() == 1 && args[0] != "flush")) {
+        reply("Usage : " + _help, invoker);
+        return;
+    }
+
+    // The chunks are written by the region writer, flush waits for it to be done
+    const bool flush = !args.empty();
+    reply("Saving the game (this may take a moment!)", invoker);
+    for (auto &[_, worldGroup] : Server::getInstance()->getWorldGroups()) {
+        for (auto &[_, world] : worldGroup->getWorlds())
+            world->save(flush);
+    }
+    reply(flush ? "Saved the game" : "Queued the game to be saved", invoker);
+}
+
+void command_parser::SaveAll::help(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker) {
+        if (invoker->isOperator())
+            invoker->getDimension()->getWorld()->getChat()->sendSystemMessage(_help, *invoker);
+    } else
+        LINFO(_help);
+}
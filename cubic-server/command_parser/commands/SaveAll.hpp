@@ -0,0 +1,21 @@
+#ifndef CUBICSERVER_COMMANDPARSER_COMMANDS_SAVEALL_HPP
+#define CUBICSERVER_COMMANDPARSER_COMMANDS_SAVEALL_HPP
+
+#include "CommandBase.hpp"
+
+namespace command_parser {
+struct SaveAll : public CommandBase {
+    SaveAll():
+        CommandBase("save-all", "/save-all [flush]", true)
+    {
+    }
+
+    ~SaveAll() override = default;
+
+    void autocomplete(std::vector<std::string> &args, Player *invoker) const override;
+    void execute(std::vector<std::string> &args, Player *invoker) const override;
+    void help(std::vector<std::string> &args, Player *invoker) const override;
+};
+}
+
+#endif // CUBICSERVER_COMMANDPARSER_COMMANDS_SAVEALL_HPP
@@ -0,0 +1,50 @@
+#include "Tps.hpp"
+
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Player.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "WorldGroup.hpp"
+#include "logging/logging.hpp"
+
+void command_parser::Tps::autocomplete(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker)
+        return;
+    else
+        LINFO("autocomplete tps");
+}
+
+void command_parser::Tps::execute(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker && !invoker->isOperator())
+        return;
+
+    const auto &scheduler = Server::getInstance()->getWorldGroup("default")->getTickScheduler();
+    auto tps = scheduler.getTps();
+    auto mspt = scheduler.getMspt();
+
+    reply(fmt::format("TPS from last 1m, 5m, 15m: {:.2f}, {:.2f}, {:.2f}", tps[0], tps[1], tps[2]), invoker);
+    reply(
+        fmt::format(
+            "MSPT over the last {}s: min {:.2f}, avg {:.2f}, median {:.2f}, 95th {:.2f}, max {:.2f}", TickScheduler::MSPT_SAMPLES * MS_PER_TICK / 1000, mspt.min,
+            mspt.average, mspt.median, mspt.p95, mspt.max
+        ),
+        invoker
+    );
+    reply(fmt::format("Ticks over their {}ms budget: {}", MS_PER_TICK, scheduler.getOverruns()), invoker);
+    for (const auto &[worldName, world] : Server::getInstance()->getWorldGroup("default")->getWorlds()) {
+        for (const auto &[dimensionName, dimension] : world->getDimensions())
+            reply(fmt::format("Last tick of {}/{}: {:.2f}ms", worldName, dimensionName, dimension->getTickDuration()), invoker);
+    }
+}
+
+void command_parser::Tps::help(UNUSED std::vector<std::string> &args, Player *invoker) const
+{
+    if (invoker) {
+        if (invoker->isOperator())
+            invoker->getDimension()->getWorld()->getChat()->sendSystemMessage(_help, *invoker);
+    } else
+        LINFO(_help);
+}
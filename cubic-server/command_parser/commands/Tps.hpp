@@ -0,0 +1,21 @@
+#ifndef CUBICSERVER_COMMANDPARSER_COMMANDS_TPS_HPP
+#define CUBICSERVER_COMMANDPARSER_COMMANDS_TPS_HPP
+
+#include "CommandBase.hpp"
+
+namespace command_parser {
+struct Tps : public CommandBase {
+    Tps():
+        CommandBase("tps", "/tps", true)
+    {
+    }
+
+    ~Tps() override = default;
+
+    void autocomplete(std::vector<std::string> &args, Player *invoker) const override;
+    void execute(std::vector<std::string> &args, Player *invoker) const override;
+    void help(std::vector<std::string> &args, Player *invoker) const override;
+};
+}
+
+#endif // CUBICSERVER_COMMANDPARSER_COMMANDS_TPS_HPP
@@ -1,18 +1,33 @@
 #include "DefaultWorld.hpp"
 
 #include "Overworld.hpp"
+#include "Server.hpp"
 #include "TheEnd.hpp"
 #include "TheNether.hpp"
 #include "world_storage/Persistence.hpp"
+#include <limits>
 #include <memory>
 
 DefaultWorld::DefaultWorld(std::shared_ptr<WorldGroup> worldGroup, world_storage::WorldType worldType, std::string folder):
     World(worldGroup, worldType, folder),
-    persistence(folder)
+    persistence(folder, world_storage::parseStorageFormat(CONFIG["storage-format"].as<std::string>())),
+    _autosaveInterval(CONFIG["autosave-interval"].as<uint32_t>()),
+    _autosaveTimeBudget(CONFIG["autosave-time-budget"].as<uint32_t>()),
+    _autosaveMaxPending(CONFIG["autosave-max-pending"].as<uint64_t>())
 {
 }
 
-void DefaultWorld::tick() { World::tick(); }
+void DefaultWorld::tick()
+{
+    World::tick();
+
+    if (_autosaveInterval.count() == 0)
+        return;
+    // Only the chunks left unsaved for a whole interval are written, a few at a time
+    const auto now = std::chrono::steady_clock::now();
+    for (auto &[_, dim] : _dimensions)
+        persistence.saveDirtyChunks(*dim, now - _autosaveInterval, now + _autosaveTimeBudget, _autosaveMaxPending);
+}
 
 void DefaultWorld::initialize()
 {
@@ -23,4 +38,23 @@ void DefaultWorld::initialize()
     World::initialize();
 }
 
-void DefaultWorld::stop() { World::stop(); }
+void DefaultWorld::stop()
+{
+    this->save(true);
+    World::stop();
+    persistence.flushPlayerData();
+}
+
+world_storage::Persistence *DefaultWorld::getPersistence() { return &persistence; }
+
+void DefaultWorld::save(bool flush)
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto &[_, dim] : _dimensions)
+        persistence.saveDirtyChunks(*dim, now, std::chrono::steady_clock::time_point::max(), std::numeric_limits<size_t>::max());
+
+    if (flush) {
+        persistence.flushChunks();
+        persistence.flushPlayerData();
+    }
+}
@@ -4,6 +4,7 @@
 #include "../World.hpp"
 #include "world_storage/ChunkColumn.hpp"
 #include "world_storage/Persistence.hpp"
+#include <chrono>
 #include <memory>
 
 class DefaultWorld : public World {
@@ -13,8 +14,17 @@ public:
     void tick() override;
     void initialize() override;
     void stop() override;
+    NODISCARD world_storage::Persistence *getPersistence() override;
+    void save(bool flush) override;
 
     world_storage::Persistence persistence;
+
+private:
+    // Chunks are saved once they have not been saved for this long, 0 disables the autosave
+    std::chrono::seconds _autosaveInterval;
+    // Time spent queueing chunks to the region writer each tick
+    std::chrono::microseconds _autosaveTimeBudget;
+    size_t _autosaveMaxPending;
 };
 
 #endif // CUBICSERVER_DEFAULT_DEFAULTWORLD_HPP
@@ -75,8 +75,11 @@ void Overworld::generateChunk(int x, int z, world_storage::GenerationState goalS
     LDEBUG("Generate - Overworld ({}, {})", x, z);
     Position2D pos {x, z};
     // TODO(huntears): tmp to deactivate generation
-    if (CONFIG["enable-generation"].as<bool>())
-        _level.addChunkColumn(pos, shared_from_this()).generate(goalState);
-    else
+    if (CONFIG["enable-generation"].as<bool>()) {
+        _level.addChunkColumn(pos, shared_from_this())->generate(goalState);
+        // Otherwise only the chunks modified by players are saved
+        if (goalState == world_storage::GenerationState::READY && CONFIG["autosave-generated"].as<bool>())
+            this->markChunkDirty(pos);
+    } else
         _level.addChunkColumn(pos, shared_from_this());
 }
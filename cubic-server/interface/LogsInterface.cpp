@@ -105,30 +105,15 @@ bool LogsInterface::on_key_press_event(GdkEventKey *event)
 
 bool LogsInterface::_onLogToDisplay()
 {
-    logging::Registry::LogLevel logLevel;
     std::string temp = "";
     std::stringstream ss;
-    auto q_copy = logging::instance().getMessages();
-
-    if (_selectedLogLevel == logging::Registry::LogLevel::off) {
-        while (!q_copy.empty()) {
-            auto front = q_copy.front();
-            logLevel = front.level;
-            ss << front.message << std::endl;
-            temp = ss.str();
-            q_copy.pop();
-        }
-    } else {
-        while (!q_copy.empty()) {
-            auto front = q_copy.front();
-            logLevel = front.level;
-            if (logLevel == _selectedLogLevel) {
-                ss << front.message << std::endl;
-                temp = ss.str();
-            }
-            q_copy.pop();
-        }
+    auto messages = logging::instance().getMessages();
+
+    for (const auto &message : messages) {
+        if (_selectedLogLevel == logging::Registry::LogLevel::off || message.level == _selectedLogLevel)
+            ss << message.message << std::endl;
     }
+    temp = ss.str();
 
     if (_logs->get_text().raw() != temp) {
         _logs->set_text(temp.c_str());
@@ -5,6 +5,7 @@
 #include <unistd.h>
 
 #include "Server.hpp"
+#include "WorldGroup.hpp"
 
 ManagementInterface::ManagementInterface()
 {
@@ -13,6 +14,8 @@ ManagementInterface::ManagementInterface()
     set_border_width(5);
     this->_playersTitle.set_xalign(0);
     this->_playersTitle.set_yalign(0);
+    this->_tickInfo.set_xalign(1);
+    this->_tickInfo.set_yalign(0);
 
     add(this->_content);
 
@@ -22,7 +25,11 @@ ManagementInterface::ManagementInterface()
     this->_sections.set_position(280);
 
     this->_content.set_orientation(Gtk::ORIENTATION_VERTICAL);
-    this->_content.add1(this->_playersTitle);
+    this->_header.set_orientation(Gtk::ORIENTATION_HORIZONTAL);
+    this->_header.pack_start(this->_playersTitle);
+    this->_header.pack_end(this->_tickInfo);
+
+    this->_content.add1(this->_header);
     this->_content.add2(this->_sections);
     this->_content.set_position(25);
 
@@ -58,6 +65,14 @@ bool ManagementInterface::onTimeout()
 
     this->_playersTitle.set_text(title.c_str());
 
+    const auto &worldGroups = Server::getInstance()->getWorldGroups();
+    if (worldGroups.contains("default")) {
+        const auto &scheduler = worldGroups.at("default")->getTickScheduler();
+        auto tps = scheduler.getTps();
+        auto mspt = scheduler.getMspt();
+        this->_tickInfo.set_text(fmt::format("TPS: {:.1f} {:.1f} {:.1f} - MSPT: {:.1f} avg, {:.1f} max", tps[0], tps[1], tps[2], mspt.average, mspt.max));
+    }
+
     return true;
 }
 
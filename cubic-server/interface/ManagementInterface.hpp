@@ -20,7 +20,9 @@ protected:
 protected:
     Gtk::Paned _content;
     Gtk::Paned _sections;
+    Gtk::Box _header;
     Gtk::Label _playersTitle;
+    Gtk::Label _tickInfo;
     PlayersInterface _playersSection;
     LogsInterface _logsSection;
 };
@@ -0,0 +1,417 @@
+#include "Bot.hpp"
+
+#include "Server.hpp"
+#include "logging/logging.hpp"
+#include "protocol/serialization/addPrimaryType.hpp"
+#include "protocol/serialization/popPrimaryType.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <numbers>
+#include <string_view>
+
+using namespace loadtest;
+
+namespace {
+// Ids of the clientbound packets the bots look at
+constexpr int32_t LOGIN_DISCONNECT = 0x00;
+constexpr int32_t LOGIN_ENCRYPTION_REQUEST = 0x01;
+constexpr int32_t LOGIN_SUCCESS = 0x02;
+constexpr int32_t LOGIN_SET_COMPRESSION = 0x03;
+constexpr int32_t PLAY_BLOCK_UPDATE = 0x09;
+constexpr int32_t PLAY_DISCONNECT = 0x17;
+constexpr int32_t PLAY_KEEP_ALIVE = 0x1F;
+constexpr int32_t PLAY_CHUNK_DATA = 0x20;
+constexpr int32_t PLAY_PLAYER_CHAT = 0x31;
+constexpr int32_t PLAY_SYNCHRONIZE_POSITION = 0x38;
+constexpr int32_t PLAY_SYSTEM_CHAT = 0x60;
+
+// Hotbar slot the bots fill with stone so they can place blocks in any gamemode
+constexpr int16_t HOTBAR_SLOT = 36;
+constexpr int32_t STONE_ITEM = 1;
+constexpr uint8_t FACE_TOP = 1;
+constexpr size_t READ_SIZE = 64 * 1024;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+}
+
+Bot::Bot(uint32_t id, const BotConfig &config, Stats &stats):
+    _id(id),
+    _name(fmt::format("cubic_bot_{}", id)),
+    _config(config),
+    _stats(stats),
+    _socket(_io),
+    _state(State::Connecting),
+    _chunks(0),
+    _spawned(false),
+    _heading(0),
+    _moveBudget(0),
+    _chatBudget(0),
+    _blockBudget(0),
+    _chatSequence(0),
+    _blockSequence(0)
+{
+}
+
+Bot::~Bot()
+{
+    this->close();
+    if (_reader.joinable())
+        _reader.join();
+}
+
+bool Bot::connect()
+{
+    _connectedAt = Clock::now();
+    try {
+        boost::asio::ip::tcp::resolver resolver(_io);
+        boost::asio::connect(_socket, resolver.resolve(_config.host, std::to_string(_config.port)));
+        _socket.set_option(boost::asio::ip::tcp::no_delay(true));
+    } catch (const boost::system::system_error &e) {
+        this->_fail(fmt::format("failed to connect to {}:{}: {}", _config.host, _config.port, e.what()));
+        return false;
+    }
+
+    std::vector<uint8_t> handshake;
+    protocol::addVarInt(handshake, MC_PROTOCOL);
+    protocol::addString(handshake, _config.host);
+    protocol::addUShort(handshake, _config.port);
+    protocol::addVarInt(handshake, 2);
+    this->_send(protocol::ServerPacketsID::Handshake, handshake);
+
+    std::vector<uint8_t> loginStart;
+    protocol::addString(loginStart, _name);
+    protocol::addBoolean(loginStart, false);
+    this->_send(protocol::ServerPacketsID::LoginStart, loginStart);
+
+    _state = State::Login;
+    _reader = std::thread(&Bot::_read, this);
+    return true;
+}
+
+void Bot::act(std::mt19937 &rng, double seconds)
+{
+    if (_state != State::Play || !_spawned)
+        return;
+
+    _moveBudget += _config.moveRate * seconds;
+    _chatBudget += _config.chatRate * seconds;
+    _blockBudget += _config.blockRate * seconds;
+    for (; _moveBudget >= 1; _moveBudget--)
+        this->_move(rng);
+    for (; _chatBudget >= 1; _chatBudget--)
+        this->_chat();
+    for (; _blockBudget >= 1; _blockBudget--)
+        this->_changeBlock();
+}
+
+void Bot::close()
+{
+    if (_state.exchange(State::Closed) == State::Closed)
+        return;
+    boost::system::error_code ec;
+    _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
+
+void Bot::_read()
+{
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> chunk(READ_SIZE);
+    boost::system::error_code ec;
+
+    while (_state != State::Closed) {
+        auto read = _socket.read_some(boost::asio::buffer(chunk), ec);
+        if (ec) {
+            if (_state != State::Closed) {
+                _stats.disconnected++;
+                this->_fail(fmt::format("connection lost: {}", ec.message()));
+            }
+            return;
+        }
+        _stats.bytesIn += read;
+        buffer.insert(buffer.end(), chunk.begin(), chunk.begin() + read);
+
+        size_t offset = 0;
+        while (true) {
+            // The length prefix itself may not have been fully received yet
+            int32_t length = 0;
+            size_t at = offset;
+            bool complete = false;
+            for (int shift = 0; at < buffer.size() && shift < 35; shift += 7) {
+                uint8_t byte = buffer[at++];
+                length |= (byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete || buffer.size() - at < static_cast<size_t>(length))
+                break;
+            offset = at + length;
+            if (length == 0)
+                continue;
+
+            _stats.packetsIn++;
+            uint8_t *data = buffer.data() + at;
+            uint8_t *eof = data + length - 1;
+            try {
+                auto id = protocol::popVarInt(data, eof);
+                this->_handlePacket(id, data, eof);
+            } catch (const std::exception &e) {
+                LWARN("{}: failed to parse a packet: {}", _name, e.what());
+            }
+            if (_state == State::Closed)
+                return;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+    }
+}
+
+void Bot::_handlePacket(int32_t id, uint8_t *at, uint8_t *eof)
+{
+    if (_state == State::Play)
+        return this->_handlePlayPacket(id, at, eof);
+
+    switch (id) {
+    case LOGIN_DISCONNECT:
+        this->_fail(fmt::format("kicked during the login: {}", protocol::popChat(at, eof)));
+        break;
+    case LOGIN_ENCRYPTION_REQUEST:
+        this->_fail("the server is in online mode, start it with --online-mode false");
+        break;
+    case LOGIN_SUCCESS: {
+        _loggedInAt = Clock::now();
+        // The load test may have closed the bot in the meantime
+        auto expected = State::Login;
+        if (_state.compare_exchange_strong(expected, State::Play))
+            _stats.playing++;
+        break;
+    }
+    case LOGIN_SET_COMPRESSION:
+        this->_fail("the server enabled compression, which the bots do not support");
+        break;
+    default:
+        break;
+    }
+}
+
+void Bot::_handlePlayPacket(int32_t id, uint8_t *at, uint8_t *eof)
+{
+    switch (id) {
+    case PLAY_KEEP_ALIVE: {
+        // The server uses its clock as the id, which is only comparable to ours on the same host
+        auto keepAliveId = protocol::popLong(at, eof);
+        auto delay = std::chrono::system_clock::now().time_since_epoch().count() - keepAliveId;
+        if (delay >= 0 && std::chrono::system_clock::duration(delay) < std::chrono::minutes(1))
+            _stats.addSample(Stats::KeepAlive, std::chrono::duration<double, std::milli>(std::chrono::system_clock::duration(delay)).count());
+
+        std::vector<uint8_t> response;
+        protocol::addLong(response, keepAliveId);
+        this->_send(protocol::ServerPacketsID::KeepAliveResponse, response);
+        break;
+    }
+    case PLAY_CHUNK_DATA:
+        _stats.chunks++;
+        _chunks++;
+        if (_chunks == 1)
+            _stats.addSample(Stats::FirstChunk, millisecondsSince(_loggedInAt));
+        if (_chunks == _config.viewChunks)
+            _stats.addSample(Stats::ViewChunks, millisecondsSince(_loggedInAt));
+        break;
+    case PLAY_SYNCHRONIZE_POSITION: {
+        Vector3<double> position;
+        position.x = protocol::popDouble(at, eof);
+        position.y = protocol::popDouble(at, eof);
+        position.z = protocol::popDouble(at, eof);
+        protocol::popFloat(at, eof);
+        protocol::popFloat(at, eof);
+        auto flags = protocol::popByte(at, eof);
+        auto teleportId = protocol::popVarInt(at, eof);
+
+        std::vector<uint8_t> confirm;
+        protocol::addVarInt(confirm, teleportId);
+        this->_send(protocol::ServerPacketsID::ConfirmTeleportation, confirm);
+
+        std::lock_guard _(_mutex);
+        // The lowest three bits make the coordinates relative
+        _position.x = (flags & 0x01 ? _position.x : 0) + position.x;
+        _position.y = (flags & 0x02 ? _position.y : 0) + position.y;
+        _position.z = (flags & 0x04 ? _position.z : 0) + position.z;
+        if (_spawned)
+            break;
+
+        _spawn = _position;
+        _spawned = true;
+        _stats.addSample(Stats::Join, millisecondsSince(_connectedAt));
+
+        std::vector<uint8_t> slot;
+        protocol::addShort(slot, HOTBAR_SLOT);
+        protocol::addSlot(slot, {true, STONE_ITEM, 64});
+        this->_send(protocol::ServerPacketsID::SetCreativeModeSlot, slot);
+        break;
+    }
+    case PLAY_BLOCK_UPDATE: {
+        auto position = protocol::popPosition(at, eof);
+        std::lock_guard _(_mutex);
+        auto it = std::find_if(_pendingBlocks.begin(), _pendingBlocks.end(), [&position](const PendingBlock &pending) {
+            return pending.position == position;
+        });
+        if (it != _pendingBlocks.end()) {
+            _stats.addSample(Stats::Block, millisecondsSince(it->sentAt));
+            _pendingBlocks.erase(it);
+        }
+        break;
+    }
+    case PLAY_PLAYER_CHAT:
+    case PLAY_SYSTEM_CHAT: {
+        // Every bot sees the messages of the others, only look for our own tag
+        std::string_view payload(reinterpret_cast<const char *>(at), eof - at + 1);
+        auto tag = "[" + _name + ":";
+        auto found = payload.find(tag);
+        if (found == std::string_view::npos)
+            break;
+
+        uint64_t sequence = 0;
+        for (auto i = found + tag.size(); i < payload.size() && std::isdigit(static_cast<unsigned char>(payload[i])); i++)
+            sequence = sequence * 10 + (payload[i] - '0');
+        std::lock_guard _(_mutex);
+        auto it = std::find_if(_pendingChats.begin(), _pendingChats.end(), [sequence](const auto &pending) {
+            return pending.first == sequence;
+        });
+        if (it != _pendingChats.end()) {
+            _stats.addSample(Stats::Chat, millisecondsSince(it->second));
+            _pendingChats.erase(it);
+        }
+        break;
+    }
+    case PLAY_DISCONNECT:
+        _stats.disconnected++;
+        this->_fail(fmt::format("kicked: {}", protocol::popChat(at, eof)));
+        break;
+    default:
+        break;
+    }
+}
+
+void Bot::_send(protocol::ServerPacketsID id, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> body;
+    protocol::addVarInt(body, static_cast<int32_t>(id));
+    body.insert(body.end(), payload.begin(), payload.end());
+    std::vector<uint8_t> packet;
+    protocol::addVarInt(packet, static_cast<int32_t>(body.size()));
+    packet.insert(packet.end(), body.begin(), body.end());
+
+    boost::system::error_code ec;
+    {
+        std::lock_guard _(_writeMutex);
+        boost::asio::write(_socket, boost::asio::buffer(packet), ec);
+    }
+    if (ec) {
+        if (_state != State::Closed)
+            this->_fail(fmt::format("failed to send a packet: {}", ec.message()));
+        return;
+    }
+    _stats.bytesOut += packet.size();
+    _stats.packetsOut++;
+}
+
+void Bot::_fail(const std::string &reason)
+{
+    auto state = _state.load();
+    if (state == State::Closed)
+        return;
+    if (state != State::Play)
+        _stats.failed++;
+    else
+        _stats.playing--;
+    LERROR("{}: {}", _name, reason);
+    this->close();
+}
+
+void Bot::_move(std::mt19937 &rng)
+{
+    std::normal_distribution<double> turn(0, 0.3);
+    std::vector<uint8_t> payload;
+    {
+        std::lock_guard _(_mutex);
+        auto dx = _position.x - _spawn.x;
+        auto dz = _position.z - _spawn.z;
+        if (dx * dx + dz * dz > _config.walkRadius * _config.walkRadius)
+            _heading = std::atan2(-dz, -dx);
+        else
+            _heading = std::fmod(_heading + turn(rng), 2 * std::numbers::pi);
+
+        // Move at walking speed whatever the packet rate is
+        auto step = WALK_SPEED / _config.moveRate;
+        _position.x += std::cos(_heading) * step;
+        _position.z += std::sin(_heading) * step;
+        protocol::addDouble(payload, _position.x);
+        protocol::addDouble(payload, _position.y);
+        protocol::addDouble(payload, _position.z);
+        protocol::addBoolean(payload, true);
+    }
+    this->_send(protocol::ServerPacketsID::SetPlayerPosition, payload);
+}
+
+void Bot::_chat()
+{
+    std::vector<uint8_t> payload;
+    {
+        std::lock_guard _(_mutex);
+        auto sequence = _chatSequence++;
+        if (_pendingChats.size() >= MAX_PENDING)
+            _pendingChats.pop_front();
+        _pendingChats.emplace_back(sequence, Clock::now());
+        protocol::addString(payload, fmt::format("[{}:{}] load test message", _name, sequence));
+    }
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    protocol::addLong(payload, now);
+    protocol::addLong(payload, 0);
+    protocol::addBoolean(payload, false);
+    // Empty acknowledged messages bitset
+    for (int i = 0; i < 3; i++)
+        protocol::addByte(payload, 0);
+    this->_send(protocol::ServerPacketsID::ChatMessage, payload);
+}
+
+void Bot::_changeBlock()
+{
+    std::vector<uint8_t> payload;
+    auto id = protocol::ServerPacketsID::UseItemOn;
+    {
+        std::lock_guard _(_mutex);
+        Position target;
+        if (_placedBlock) {
+            // Break the block placed by the previous call
+            id = protocol::ServerPacketsID::PlayerAction;
+            target = *_placedBlock;
+            _placedBlock.reset();
+            protocol::addVarInt(payload, static_cast<int32_t>(protocol::PlayerAction::Status::FinishedDigging));
+            protocol::addPosition(payload, target);
+            protocol::addByte(payload, FACE_TOP);
+            protocol::addVarInt(payload, _blockSequence++);
+        } else {
+            // Place a block on top of the ground next to the bot
+            Position ground {
+                static_cast<Position::valueType>(std::floor(_position.x)) + 1,
+                static_cast<Position::valueType>(std::floor(_position.y)) - 1,
+                static_cast<Position::valueType>(std::floor(_position.z)),
+            };
+            target = {ground.x, ground.y + 1, ground.z};
+            _placedBlock = target;
+            protocol::addVarInt(payload, 0);
+            protocol::addPosition(payload, ground);
+            protocol::addVarInt(payload, FACE_TOP);
+            protocol::addFloat(payload, 0.5);
+            protocol::addFloat(payload, 1);
+            protocol::addFloat(payload, 0.5);
+            protocol::addBoolean(payload, false);
+            protocol::addVarInt(payload, _blockSequence++);
+        }
+        if (_pendingBlocks.size() >= MAX_PENDING)
+            _pendingBlocks.pop_front();
+        _pendingBlocks.push_back({target, Clock::now()});
+    }
+    this->_send(id, payload);
+}
@@ -0,0 +1,131 @@
+#ifndef CUBICSERVER_LOADTEST_BOT_HPP
+#define CUBICSERVER_LOADTEST_BOT_HPP
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Stats.hpp"
+#include "math/Vector3.hpp"
+#include "options.hpp"
+#include "protocol/ServerPackets.hpp"
+#include "types.hpp"
+
+namespace loadtest {
+
+struct BotConfig {
+    std::string host;
+    uint16_t port;
+    // Number of chunks a bot waits for before reporting its view as loaded
+    uint32_t viewChunks;
+    // Actions per second of every bot
+    double moveRate;
+    double chatRate;
+    double blockRate;
+    // Distance in blocks the bots can wander from their spawn
+    double walkRadius;
+};
+
+/**
+ * @brief Headless offline mode client playing like a very simple player
+ *
+ * Packets are read on a thread of the bot, the actions are driven by the load test through act.
+ * The bot only parses the packets it needs to measure the server, everything else is skipped.
+ */
+class Bot {
+public:
+    enum class State {
+        Connecting,
+        Login,
+        Play,
+        Closed,
+    };
+
+    // Speed of a walking player in blocks per second
+    static constexpr double WALK_SPEED = 4.317;
+    // Maximum number of unanswered chat messages or block changes tracked at once
+    static constexpr size_t MAX_PENDING = 32;
+
+public:
+    Bot(uint32_t id, const BotConfig &config, Stats &stats);
+    ~Bot();
+
+    /**
+     * @brief Connect to the server and start the offline login, the reader thread takes it from there
+     *
+     * @return false if the connection failed
+     */
+    bool connect();
+
+    /**
+     * @brief Move, chat and change blocks according to the configured rates
+     *
+     * @param seconds Time since the previous call
+     */
+    void act(std::mt19937 &rng, double seconds);
+
+    void close();
+
+    NODISCARD State getState() const { return _state; }
+    NODISCARD const std::string &getName() const { return _name; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct PendingBlock {
+        Position position;
+        Clock::time_point sentAt;
+    };
+
+    void _read();
+    void _handlePacket(int32_t id, uint8_t *at, uint8_t *eof);
+    void _handlePlayPacket(int32_t id, uint8_t *at, uint8_t *eof);
+    void _send(protocol::ServerPacketsID id, const std::vector<uint8_t> &payload);
+    void _fail(const std::string &reason);
+
+    void _move(std::mt19937 &rng);
+    void _chat();
+    void _changeBlock();
+
+    uint32_t _id;
+    std::string _name;
+    const BotConfig &_config;
+    Stats &_stats;
+
+    boost::asio::io_context _io;
+    boost::asio::ip::tcp::socket _socket;
+    std::mutex _writeMutex;
+    std::thread _reader;
+    std::atomic<State> _state;
+
+    Clock::time_point _connectedAt;
+    Clock::time_point _loggedInAt;
+    uint32_t _chunks;
+
+    // Protects the position, which the server can change with a teleport, and the pending actions
+    std::mutex _mutex;
+    std::atomic<bool> _spawned;
+    Vector3<double> _spawn;
+    Vector3<double> _position;
+    double _heading;
+    double _moveBudget;
+    double _chatBudget;
+    double _blockBudget;
+    uint64_t _chatSequence;
+    std::deque<std::pair<uint64_t, Clock::time_point>> _pendingChats;
+    std::deque<PendingBlock> _pendingBlocks;
+    std::optional<Position> _placedBlock;
+    int32_t _blockSequence;
+};
+
+} // namespace loadtest
+
+#endif // CUBICSERVER_LOADTEST_BOT_HPP
@@ -0,0 +1,66 @@
+#include "Stats.hpp"
+
+#include "logging/logging.hpp"
+#include <algorithm>
+
+using namespace loadtest;
+
+void Stats::addSample(Sample sample, double ms)
+{
+    std::lock_guard _(_mutex);
+    _samples[sample].push_back(ms);
+}
+
+Stats::Summary Stats::summarize(Sample sample, bool interval)
+{
+    std::vector<double> samples;
+    {
+        std::lock_guard _(_mutex);
+        auto &all = _samples[sample];
+        samples.assign(all.begin() + (interval ? _reported[sample] : 0), all.end());
+    }
+    if (samples.empty())
+        return {0, 0, 0, 0, 0};
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](size_t p) {
+        return samples[std::min(samples.size() - 1, samples.size() * p / 100)];
+    };
+    return {samples.size(), percentile(50), percentile(95), percentile(99), samples.back()};
+}
+
+std::string Stats::report(double seconds, bool interval)
+{
+    std::string report;
+    for (size_t i = 0; i < SampleCount; i++) {
+        auto summary = this->summarize(static_cast<Sample>(i), interval);
+        if (summary.count == 0)
+            continue;
+        report += fmt::format(
+            "  {:<12} n={:<7} p50={:>8.2f}ms p95={:>8.2f}ms p99={:>8.2f}ms max={:>8.2f}ms\n", SAMPLE_NAMES[i], summary.count, summary.p50, summary.p95, summary.p99,
+            summary.max
+        );
+    }
+
+    Counters counters = {bytesIn, bytesOut, packetsIn, packetsOut, chunks};
+    Counters since = counters;
+    std::lock_guard _(_mutex);
+    if (interval) {
+        since.bytesIn -= _lastCounters.bytesIn;
+        since.bytesOut -= _lastCounters.bytesOut;
+        since.packetsIn -= _lastCounters.packetsIn;
+        since.packetsOut -= _lastCounters.packetsOut;
+        since.chunks -= _lastCounters.chunks;
+        _lastCounters = counters;
+        for (size_t i = 0; i < SampleCount; i++)
+            _reported[i] = _samples[i].size();
+    }
+
+    seconds = std::max(seconds, 0.001);
+    report += fmt::format(
+        "  in {:.1f} KiB/s ({:.0f} packets/s), out {:.1f} KiB/s ({:.0f} packets/s), {:.0f} chunks/s, {} playing, {} failed, {} disconnected",
+        since.bytesIn / 1024.0 / seconds, since.packetsIn / seconds, since.bytesOut / 1024.0 / seconds, since.packetsOut / seconds, since.chunks / seconds,
+        playing.load(), failed.load(), disconnected.load()
+    );
+    return report;
+}
@@ -0,0 +1,92 @@
+#ifndef CUBICSERVER_LOADTEST_STATS_HPP
+#define CUBICSERVER_LOADTEST_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+
+namespace loadtest {
+
+/**
+ * @brief Counters and latency samples shared by every bot of a load test
+ *
+ * Samples are kept for the whole run so the final report can give exact percentiles,
+ * the periodic reports only look at the samples added since the previous one.
+ */
+class Stats {
+public:
+    enum Sample : size_t {
+        // Delay between the server sending a keep alive and the bot reading it
+        KeepAlive,
+        // Round trip of a chat message until the server broadcasts it back
+        Chat,
+        // Round trip of a block placed or broken until the server sends the block update
+        Block,
+        // Delay between the login success and the first chunk
+        FirstChunk,
+        // Delay between the login success and the view-chunks th chunk
+        ViewChunks,
+        // Delay between the connection and the first position synchronization
+        Join,
+        SampleCount,
+    };
+
+    static constexpr std::array<const char *, SampleCount> SAMPLE_NAMES = {"keep alive", "chat rtt", "block rtt", "first chunk", "view chunks", "join"};
+
+    struct Summary {
+        size_t count;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    /**
+     * @brief Record a latency in milliseconds
+     */
+    void addSample(Sample sample, double ms);
+
+    /**
+     * @brief Percentiles of every sample since the start, or since the previous interval summary
+     */
+    NODISCARD Summary summarize(Sample sample, bool interval);
+
+    /**
+     * @brief One line per sample kind followed by the counters
+     *
+     * @param seconds Duration covered by the report, used for the rates
+     */
+    NODISCARD std::string report(double seconds, bool interval);
+
+    std::atomic<uint64_t> bytesIn = 0;
+    std::atomic<uint64_t> bytesOut = 0;
+    std::atomic<uint64_t> packetsIn = 0;
+    std::atomic<uint64_t> packetsOut = 0;
+    std::atomic<uint64_t> chunks = 0;
+    std::atomic<uint32_t> playing = 0;
+    std::atomic<uint32_t> failed = 0;
+    std::atomic<uint32_t> disconnected = 0;
+
+private:
+    struct Counters {
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+        uint64_t packetsIn;
+        uint64_t packetsOut;
+        uint64_t chunks;
+    };
+
+    std::mutex _mutex;
+    std::array<std::vector<double>, SampleCount> _samples;
+    std::array<size_t, SampleCount> _reported = {};
+    Counters _lastCounters = {};
+};
+
+} // namespace loadtest
+
+#endif // CUBICSERVER_LOADTEST_STATS_HPP
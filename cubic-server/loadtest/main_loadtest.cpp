@@ -0,0 +1,182 @@
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Bot.hpp"
+#include "Stats.hpp"
+#include "configuration/ConfigHandler.hpp"
+#include "logging/logging.hpp"
+
+using namespace std::chrono_literals;
+
+// Interval between two rounds of bot actions, one server tick
+constexpr auto ACTION_INTERVAL = 50ms;
+
+static std::atomic<bool> running = true;
+
+static void signalHandler(UNUSED int sig) { running = false; }
+
+static auto initArgs(int argc, const char *const argv[])
+{
+    auto program = configuration::ConfigHandler("cubic-loadtest", PROGRAM_VERSION);
+
+    // clang-format off
+    program.add("host")
+        .help("address of the server to test, it must be in offline mode")
+        .valueFromArgument("--host")
+        .defaultValue("127.0.0.1");
+
+    program.add("port")
+        .help("port of the server to test")
+        .valueFromArgument("--port")
+        .defaultValue(25565);
+
+    program.add("bots")
+        .help("number of bots to connect")
+        .valueFromArgument("--bots")
+        .defaultValue(100);
+
+    program.add("duration")
+        .help("seconds to run the test for once every bot is connected")
+        .valueFromArgument("--duration")
+        .defaultValue(60);
+
+    program.add("connect-rate")
+        .help("bots connected per second")
+        .valueFromArgument("--connect-rate")
+        .defaultValue(10.0);
+
+    program.add("move-rate")
+        .help("position updates per second of every bot, a moving vanilla client sends 20")
+        .valueFromArgument("--move-rate")
+        .defaultValue(20.0);
+
+    program.add("chat-rate")
+        .help("chat messages per second of every bot")
+        .valueFromArgument("--chat-rate")
+        .defaultValue(0.1);
+
+    program.add("block-rate")
+        .help("blocks placed or broken per second by every bot")
+        .valueFromArgument("--block-rate")
+        .defaultValue(0.5);
+
+    program.add("walk-radius")
+        .help("distance in blocks the bots can wander from their spawn")
+        .valueFromArgument("--walk-radius")
+        .defaultValue(32.0);
+
+    program.add("view-chunks")
+        .help("number of chunks of a fully loaded view, 441 for a render distance of 10")
+        .valueFromArgument("--view-chunks")
+        .defaultValue(441);
+
+    program.add("report-interval")
+        .help("seconds between two reports")
+        .valueFromArgument("--report-interval")
+        .defaultValue(10);
+
+    program.add("max-p95")
+        .help("fail if the p95 of the keep alive, chat or block latency is above this many milliseconds, 0 to disable")
+        .valueFromArgument("--max-p95")
+        .defaultValue(0.0);
+    // clang-format on
+
+    try {
+        program.parse(argc, argv);
+    } catch (const std::runtime_error &err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << program;
+        std::exit(1);
+    }
+
+    return program;
+}
+
+int main(int argc, char *argv[])
+{
+    auto program = initArgs(argc, argv);
+
+    std::signal(SIGTERM, signalHandler);
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    loadtest::BotConfig config {
+        program["host"].as<std::string>(),
+        program["port"].as<uint16_t>(),
+        program["view-chunks"].as<uint32_t>(),
+        program["move-rate"].as<double>(),
+        program["chat-rate"].as<double>(),
+        program["block-rate"].as<double>(),
+        program["walk-radius"].as<double>(),
+    };
+    auto botCount = program["bots"].as<uint32_t>();
+    auto duration = std::chrono::seconds(program["duration"].as<uint32_t>());
+    auto connectRate = program["connect-rate"].as<double>();
+    auto reportInterval = std::chrono::seconds(program["report-interval"].as<uint32_t>());
+    auto maxP95 = program["max-p95"].as<double>();
+
+    loadtest::Stats stats;
+    std::vector<std::unique_ptr<loadtest::Bot>> bots;
+    bots.reserve(botCount);
+    std::mt19937 rng(std::random_device {}());
+
+    LINFO("Connecting {} bots to {}:{}", botCount, config.host, config.port);
+    auto start = std::chrono::steady_clock::now();
+    auto lastAction = start;
+    auto lastReport = start;
+    std::optional<std::chrono::steady_clock::time_point> end;
+    double connectBudget = 1;
+
+    while (running && (!end || std::chrono::steady_clock::now() < *end)) {
+        std::this_thread::sleep_for(ACTION_INTERVAL);
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastAction).count();
+        lastAction = now;
+
+        for (connectBudget += connectRate * seconds; connectBudget >= 1 && bots.size() < botCount; connectBudget--) {
+            bots.push_back(std::make_unique<loadtest::Bot>(bots.size(), config, stats));
+            bots.back()->connect();
+        }
+        if (!end && bots.size() == botCount) {
+            LINFO("Every bot is connected, running for {}s", duration.count());
+            end = now + duration;
+        }
+
+        for (auto &bot : bots)
+            bot->act(rng, seconds);
+
+        if (now - lastReport >= reportInterval) {
+            double interval = std::chrono::duration<double>(now - lastReport).count();
+            LINFO("Last {:.0f}s:\n{}", interval, stats.report(interval, true));
+            lastReport = now;
+        }
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LINFO("Total over {:.0f}s:\n{}", elapsed, stats.report(elapsed, false));
+
+    // A non zero exit code lets a release pipeline gate on the test
+    int status = 0;
+    if (stats.failed != 0 || stats.disconnected != 0) {
+        LERROR("{} bots failed to log in and {} were disconnected", stats.failed.load(), stats.disconnected.load());
+        status = 1;
+    }
+    if (maxP95 > 0) {
+        for (auto sample : {loadtest::Stats::KeepAlive, loadtest::Stats::Chat, loadtest::Stats::Block}) {
+            auto summary = stats.summarize(sample, false);
+            if (summary.p95 > maxP95) {
+                LERROR("The p95 {} latency is {:.2f}ms, above the limit of {:.2f}ms", loadtest::Stats::SAMPLE_NAMES[sample], summary.p95, maxP95);
+                status = 1;
+            }
+        }
+    }
+
+    bots.clear();
+    return status;
+}
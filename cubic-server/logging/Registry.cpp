@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <iostream>
 
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
@@ -20,7 +21,9 @@
 
 namespace logging {
 
-Registry::Registry()
+Registry::Registry():
+    _generation(1),
+    _threadPool(std::make_shared<spdlog::details::thread_pool>(ASYNC_QUEUE_SIZE, 1))
 {
     spdlog::file_event_handlers handlers;
     handlers.before_close = [](UNUSED const spdlog::filename_t &filename, UNUSED std::FILE *file_stream) {
@@ -53,9 +56,9 @@ Registry &Registry::instance()
     return instance;
 }
 
-const std::queue<Registry::Message> &Registry::getMessages()
+std::vector<Registry::Message> Registry::getMessages()
 {
-    if (auto sink = dynamic_pointer_cast<StoreLogMessage>(defaultLogger()->sinks().at(0)))
+    if (auto sink = dynamic_pointer_cast<StoreLogMessage>(_sinks.at(0)))
         return sink->messages();
     throw std::runtime_error("Logger not initialized");
 }
@@ -73,6 +76,7 @@ std::shared_ptr<Registry::Logger> Registry::registerLogger(std::shared_ptr<Logge
     });
 
     spdlog::details::registry::instance().initialize_logger(logger);
+    _generation++;
     return logger;
 }
 
@@ -94,11 +98,44 @@ void Registry::unregisterLogger(const std::string_view &name)
         return pair.second == name;
     });
     spdlog::details::registry::instance().drop(std::string(name));
+    _generation++;
 }
 
 std::shared_ptr<Registry::Logger> Registry::defaultLogger() { return spdlog::default_logger(); }
 
-std::shared_ptr<Registry::Logger> Registry::threadDefaultLogger()
+std::shared_ptr<Registry::Logger> Registry::threadDefaultLogger() { return _cachedThreadDefaultLogger(); }
+
+Registry::Logger *Registry::threadLogger() { return _cachedThreadDefaultLogger().get(); }
+
+Registry::Logger *Registry::networkLogger()
+{
+    thread_local uint64_t cachedGeneration = 0;
+    thread_local std::shared_ptr<Logger> cachedLogger;
+
+    auto generation = _generation.load(std::memory_order_acquire);
+    if (cachedGeneration != generation) {
+        cachedLogger = get("network");
+        if (!cachedLogger)
+            cachedLogger = defaultLogger();
+        cachedGeneration = generation;
+    }
+    return cachedLogger.get();
+}
+
+const std::shared_ptr<Registry::Logger> &Registry::_cachedThreadDefaultLogger()
+{
+    thread_local uint64_t cachedGeneration = 0;
+    thread_local std::shared_ptr<Logger> cachedLogger;
+
+    auto generation = _generation.load(std::memory_order_acquire);
+    if (cachedGeneration != generation) {
+        cachedLogger = _findThreadDefaultLogger();
+        cachedGeneration = generation;
+    }
+    return cachedLogger;
+}
+
+std::shared_ptr<Registry::Logger> Registry::_findThreadDefaultLogger()
 {
     std::shared_lock _(_threadsMutex);
     if (!_threadLoggers.contains(std::this_thread::get_id()))
@@ -121,6 +158,7 @@ void Registry::setThreadDefaultLogger(const std::string_view &name)
     if (_threadLoggers.contains(std::this_thread::get_id()))
         _threadLoggers.erase(std::this_thread::get_id());
     _threadLoggers.emplace(std::this_thread::get_id(), name);
+    _generation++;
 }
 
 void Registry::removeThreadDefaultLogger()
@@ -128,8 +166,26 @@ void Registry::removeThreadDefaultLogger()
     std::unique_lock lock(_threadsMutex);
     if (_threadLoggers.contains(std::this_thread::get_id()))
         _threadLoggers.erase(std::this_thread::get_id());
+    _generation++;
 }
 
 void Registry::setLevel(LogLevel level) { spdlog::set_level(static_cast<spdlog::level::level_enum>(level)); }
 
+void Registry::flush()
+{
+    {
+        std::shared_lock lock(_loggersMutex);
+        for (auto &[name, logger] : _loggers)
+            logger->flush();
+    }
+
+    // The flush requests of the async loggers are queued behind their messages
+    const auto deadline = std::chrono::steady_clock::now() + FLUSH_TIMEOUT;
+    while (_threadPool->queue_size() > 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // The sinks are thread-safe, this waits for the message the logging thread may still be writing
+    for (auto &sink : _sinks)
+        sink->flush();
+}
+
 } // namespace logging
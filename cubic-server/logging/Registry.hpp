@@ -3,13 +3,23 @@
 
 #include "concept.hpp"
 #include "options.hpp"
-#include <queue>
+#include <atomic>
+#include <chrono>
 #include <shared_mutex>
+#include <spdlog/async_logger.h>
 #include <spdlog/common.h>
+#include <spdlog/details/thread_pool.h>
 #include <spdlog/logger.h>
 #include <thread>
+#include <vector>
 
 namespace logging {
+
+// Messages waiting to be written by the logging thread, the oldest are dropped when it can't keep up
+constexpr size_t ASYNC_QUEUE_SIZE = 8192;
+// Longest time flush waits for the logging thread
+constexpr std::chrono::milliseconds FLUSH_TIMEOUT(1000);
+
 class Registry {
 public:
     using LogLevel = spdlog::level::level_enum;
@@ -26,11 +36,11 @@ public:
     Registry();
 
     /**
-     * @brief Get the all messages object
+     * @brief Get a copy of the last messages kept for the GUI
      *
-     * @return NODISCARD const&
+     * @return std::vector<Message>
      */
-    NODISCARD const std::queue<Message> &getMessages();
+    NODISCARD std::vector<Message> getMessages();
 
     /**
      * @brief Get the default logger
@@ -46,6 +56,20 @@ public:
      */
     std::shared_ptr<Logger> threadDefaultLogger();
 
+    /**
+     * @brief Same as threadDefaultLogger, but cached per thread so the logging macros never lock
+     *
+     * @return Logger*
+     */
+    Logger *threadLogger();
+
+    /**
+     * @brief The "network" logger, or the default logger without DEBUG_NETWORK, cached per thread like threadLogger
+     *
+     * @return Logger*
+     */
+    Logger *networkLogger();
+
     /**
      * @brief Get the logger with the given name
      *
@@ -98,10 +122,21 @@ public:
      */
     void setLevel(LogLevel level);
 
+    /**
+     * @brief Wait for the logging thread to write the queued messages, at most FLUSH_TIMEOUT, then flush the sinks
+     */
+    void flush();
+
 private:
+    const std::shared_ptr<Logger> &_cachedThreadDefaultLogger();
+    std::shared_ptr<Logger> _findThreadDefaultLogger();
+
     std::shared_mutex _loggersMutex;
     std::shared_mutex _threadsMutex;
+    // Bumped whenever a logger or a thread default logger changes, to invalidate the per thread caches
+    std::atomic<uint64_t> _generation;
 
+    std::shared_ptr<spdlog::details::thread_pool> _threadPool;
     std::vector<std::shared_ptr<spdlog::sinks::sink>> _sinks;
 
     std::unordered_map<std::string, std::shared_ptr<Logger>> _loggers;
@@ -111,7 +146,11 @@ private:
 template<isBaseOf<Registry::Logger> L>
 std::shared_ptr<Registry::Logger> Registry::registerLogger(const std::string_view &name)
 {
-    return registerLogger(std::make_shared<L>(std::string(name), _sinks.begin(), _sinks.end()));
+    // Plain loggers are made asynchronous, the sinks are only ever written by the logging thread
+    if constexpr (std::is_same_v<L, Logger>)
+        return registerLogger(std::make_shared<spdlog::async_logger>(std::string(name), _sinks.begin(), _sinks.end(), _threadPool, spdlog::async_overflow_policy::overrun_oldest));
+    else
+        return registerLogger(std::make_shared<L>(std::string(name), _sinks.begin(), _sinks.end()));
 }
 
 } // namespace logging
@@ -1,10 +1,18 @@
 #include "Sinks.hpp"
 
+std::vector<logging::Registry::Message> logging::StoreLogMessage::messages()
+{
+    std::lock_guard _(spdlog::sinks::base_sink<std::mutex>::mutex_);
+    return std::vector<Registry::Message>(_messages.begin(), _messages.end());
+}
+
 void logging::StoreLogMessage::sink_it_(const spdlog::details::log_msg &msg)
 {
     spdlog::memory_buf_t formatted;
     spdlog::sinks::base_sink<std::mutex>::formatter_->format(msg, formatted);
-    _messages.emplace(Registry::Message {msg.level, fmt::to_string(formatted)});
+    if (_messages.size() >= MAX_STORED_MESSAGES)
+        _messages.pop_front();
+    _messages.emplace_back(Registry::Message {msg.level, fmt::to_string(formatted)});
 }
 
 void logging::StoreLogMessage::flush_() { }
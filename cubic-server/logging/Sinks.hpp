@@ -1,7 +1,8 @@
 #ifndef LOGGER_SINKS_HPP
 #define LOGGER_SINKS_HPP
 
-#include <queue>
+#include <deque>
+#include <vector>
 
 #include "Registry.hpp"
 #include "formating.hpp"
@@ -12,19 +13,27 @@
 
 namespace logging {
 
+// Only the last messages are shown by the GUI, older ones are still in the log files
+constexpr size_t MAX_STORED_MESSAGES = 2000;
+
 class StoreLogMessage : public spdlog::sinks::base_sink<std::mutex> {
 public:
     using level_enum = Registry::LogLevel;
 
 public:
-    NODISCARD constexpr inline const std::queue<Registry::Message> &messages() const noexcept { return _messages; }
+    /**
+     * @brief Copy of the last MAX_STORED_MESSAGES messages
+     *
+     * @note This function is thread-safe
+     */
+    NODISCARD std::vector<Registry::Message> messages();
 
 protected:
     void sink_it_(const spdlog::details::log_msg &msg) override;
     void flush_() override;
 
 private:
-    std::queue<Registry::Message> _messages;
+    std::deque<Registry::Message> _messages;
 };
 
 } // namespace logging
@@ -8,29 +8,84 @@ namespace logging {
 
 constexpr spdlog::string_view_t LEVEL_NAMES[] = SPDLOG_LEVEL_NAMES;
 
-#define LTRACE(...) logging::instance().threadDefaultLogger()->log(spdlog::level::trace, __VA_ARGS__)
-#define LDEBUG(...) logging::instance().threadDefaultLogger()->log(spdlog::level::debug, __VA_ARGS__)
-#define LINFO(...) logging::instance().threadDefaultLogger()->log(spdlog::level::info, __VA_ARGS__)
-#define LWARN(...) logging::instance().threadDefaultLogger()->log(spdlog::level::warn, __VA_ARGS__)
-#define LERROR(...) logging::instance().threadDefaultLogger()->log(spdlog::level::err, __VA_ARGS__)
-#define LFATAL(...) logging::instance().threadDefaultLogger()->log(spdlog::level::critical, __VA_ARGS__)
+// Levels below this one are removed at compile time, their arguments are not even evaluated
+#ifndef LOG_ACTIVE_LEVEL
+#define LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+#define LOG_WITH(logger, level, ...)               \
+    do {                                           \
+        auto *cubicLogger_ = (logger);             \
+        if (cubicLogger_->should_log(level))       \
+            cubicLogger_->log(level, __VA_ARGS__); \
+    } while (0)
+
+#define LOG_AT(level, ...) LOG_WITH(logging::instance().threadLogger(), level, __VA_ARGS__)
+#define N_LOG_AT(level, ...) LOG_WITH(logging::instance().networkLogger(), level, __VA_ARGS__)
+
+// Removed messages still name their arguments, in an unevaluated operand, so the variables only logged are not unused
+#define LOG_DISCARD(...)                              \
+    do {                                              \
+        (void) sizeof(logging::discard(__VA_ARGS__)); \
+    } while (0)
+
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define LTRACE(...) LOG_AT(spdlog::level::trace, __VA_ARGS__)
+#else
+#define LTRACE(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define LDEBUG(...) LOG_AT(spdlog::level::debug, __VA_ARGS__)
+#else
+#define LDEBUG(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#define LINFO(...) LOG_AT(spdlog::level::info, __VA_ARGS__)
+#else
+#define LINFO(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define LWARN(...) LOG_AT(spdlog::level::warn, __VA_ARGS__)
+#else
+#define LWARN(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+#define LERROR(...) LOG_AT(spdlog::level::err, __VA_ARGS__)
+#else
+#define LERROR(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+// Fatal messages are written before returning, the server is usually about to exit
+#define LFATAL(...)                                   \
+    do {                                              \
+        LOG_AT(spdlog::level::critical, __VA_ARGS__); \
+        logging::instance().flush();                  \
+    } while (0)
 
 #ifdef DEBUG_NETWORK
-#define N_LTRACE(...) logging::instance().get("network")->log(spdlog::level::trace, __VA_ARGS__)
-#define N_LDEBUG(...) logging::instance().get("network")->log(spdlog::level::debug, __VA_ARGS__)
-#define N_LINFO(...) logging::instance().get("network")->log(spdlog::level::info, __VA_ARGS__)
-#define N_LWARN(...) logging::instance().get("network")->log(spdlog::level::warn, __VA_ARGS__)
-#define N_LERROR(...) logging::instance().get("network")->log(spdlog::level::err, __VA_ARGS__)
-#define N_LFATAL(...) logging::instance().get("network")->log(spdlog::level::critical, __VA_ARGS__)
+#define N_LTRACE(...) N_LOG_AT(spdlog::level::trace, __VA_ARGS__)
+#define N_LDEBUG(...) N_LOG_AT(spdlog::level::debug, __VA_ARGS__)
+#define N_LINFO(...) N_LOG_AT(spdlog::level::info, __VA_ARGS__)
+#define N_LWARN(...) N_LOG_AT(spdlog::level::warn, __VA_ARGS__)
+#define N_LERROR(...) N_LOG_AT(spdlog::level::err, __VA_ARGS__)
+#define N_LFATAL(...) N_LOG_AT(spdlog::level::critical, __VA_ARGS__)
 #else
-#define N_LTRACE(...)
-#define N_LDEBUG(...)
-#define N_LINFO(...)
-#define N_LWARN(...)
-#define N_LERROR(...)
-#define N_LFATAL(...)
+#define N_LTRACE(...) LOG_DISCARD(__VA_ARGS__)
+#define N_LDEBUG(...) LOG_DISCARD(__VA_ARGS__)
+#define N_LINFO(...) LOG_DISCARD(__VA_ARGS__)
+#define N_LWARN(...) LOG_DISCARD(__VA_ARGS__)
+#define N_LERROR(...) LOG_DISCARD(__VA_ARGS__)
+#define N_LFATAL(...) LOG_DISCARD(__VA_ARGS__)
 #endif
 
+/**
+ * @brief Stand-in for the removed messages, only ever named in an unevaluated operand
+ */
+template<typename... Args>
+constexpr int discard(const Args &...) noexcept
+{
+    return 0;
+}
+
 inline Registry &instance() noexcept { return Registry::instance(); }
 
 /**
@@ -78,6 +133,11 @@ inline std::shared_ptr<Registry::Logger> get(const std::string &name) { return i
  */
 inline void unregisterLogger(const std::string &name) { instance().unregisterLogger(name); }
 
+/**
+ * @brief Write the messages waiting in the queue of the logging thread and flush the sinks
+ */
+inline void flush() { instance().flush(); }
+
 /**
  * @brief Set all loggers to the given level
  *
@@ -2,19 +2,49 @@
 
 #include <filesystem>
 #include <fstream>
+#include <tuple>
 
 #include "logging/logging.hpp"
+#include "nbt_reader.hpp"
+#include "nbt_writer.hpp"
 
-void LootTables::initialize(const std::string &defaultFolder)
+void LootTables::initialize(const std::string &defaultFolder, nbt::Writer *snapshot)
 {
+    this->_addDefaultCreators();
+
+    // import default's minecraft tables
+    this->importTableFolder("minecraft", defaultFolder, snapshot);
+}
+
+void LootTables::initialize(const nbt::TagView &snapshot)
+{
+    // the tables are decoded first so that nothing is imported from a corrupted snapshot
+    std::vector<std::tuple<std::string, std::string, nlohmann::json>> tables;
+    for (const auto &_namespace : snapshot) {
+        for (const auto &table : _namespace) {
+            auto data = table.getByteArray();
+            const auto *begin = reinterpret_cast<const uint8_t *>(data.data());
+            tables.emplace_back(_namespace.getName(), table.getName(), nlohmann::json::from_msgpack(begin, begin + data.size()));
+        }
+    }
+
+    this->_addDefaultCreators();
+    for (const auto &[_namespace, name, table] : tables)
+        this->_importTable(_namespace, name, table);
+    LINFO("Loaded {} loot tables from the registry snapshot", tables.size());
+}
+
+void LootTables::_addDefaultCreators(void)
+{
+    // already added by a previous initialization
+    if (!this->_rollCreator.empty())
+        return;
+
     // initialize default minecraft's creators
     addDefaultRollCreators();
     addDefaultEntryCreators();
     addDefaultFunctionCreators();
     addDefaultConditionCreators();
-
-    // import default's minecraft tables
-    this->importTableFolder("minecraft", defaultFolder);
 }
 
 void LootTables::addRollCreator(LootTable::Roll::Creator creator, LootTable::Roll::IsOfType check) { this->_rollCreator.push_back({creator, check}); }
@@ -87,31 +117,47 @@ std::unique_ptr<LootTable::Condition::Condition> LootTables::createCondition(con
     return (nullptr);
 }
 
-void LootTables::importTableFolder(const std::string &_namespace, const std::string &path)
+void LootTables::importTableFolder(const std::string &_namespace, const std::string &path, nbt::Writer *snapshot)
 {
     size_t path_length = path.size();
 
     if (!std::filesystem::is_directory(path))
         return;
+    if (snapshot)
+        snapshot->beginCompound(_namespace);
     // recursively loops through every file in the given folder
     for (const auto &filepath : std::filesystem::recursive_directory_iterator(path)) {
         if (filepath.is_regular_file() && filepath.path().string().ends_with(".json")) {
             std::ifstream filestream(filepath.path().string());
-
-            // create new table from json
-            std::unique_ptr<LootTable::LootTable> newTable = std::make_unique<LootTable::LootTable>(nlohmann::json::parse(filestream));
-
-            // keep table if valid, drop if not
-            if (newTable->isValid()) {
-                this->_lootTables[_namespace][filepath.path().string().substr(path_length + 1, filepath.path().string().length() - (path_length + 1) - 5)].swap(newTable);
-                LDEBUG("loaded {} :{}", _namespace, filepath.path().string().substr(path_length + 1, filepath.path().string().length() - (path_length + 1) - 5));
-            } else
-                LDEBUG("invalid table " + filepath.path().string());
+            const std::string name = filepath.path().string().substr(path_length + 1, filepath.path().string().length() - (path_length + 1) - 5);
+            nlohmann::json table = nlohmann::json::parse(filestream);
+
+            // stored as msgpack, which is decoded a lot faster than the text
+            if (snapshot) {
+                auto data = nlohmann::json::to_msgpack(table);
+                snapshot->writeByteArray(name, {reinterpret_cast<const int8_t *>(data.data()), data.size()});
+            }
+            this->_importTable(_namespace, name, table);
         }
     }
+    if (snapshot)
+        snapshot->endCompound();
     LINFO("Loaded {} loot tables from path {} into namespace \"{}\"", std::to_string(this->_lootTables[_namespace].size()), path, _namespace);
 }
 
+void LootTables::_importTable(const std::string &_namespace, const std::string &name, const nlohmann::json &table)
+{
+    // create new table from json
+    std::unique_ptr<LootTable::LootTable> newTable = std::make_unique<LootTable::LootTable>(table);
+
+    // keep table if valid, drop if not
+    if (newTable->isValid()) {
+        this->_lootTables[_namespace][name].swap(newTable);
+        LDEBUG("loaded {} :{}", _namespace, name);
+    } else
+        LDEBUG("invalid table {} :{}", _namespace, name);
+}
+
 bool LootTables::exists(const std::string &_namespace, const std::string &table)
 {
     return (this->_lootTables.contains(_namespace) && this->_lootTables[_namespace].contains(table));
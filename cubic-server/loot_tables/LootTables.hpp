@@ -18,6 +18,11 @@
 #include "functions/Function.hpp"
 #include "rolls/Roll.hpp"
 
+namespace nbt {
+class TagView;
+class Writer;
+}
+
 void addDefaultRollCreators(void);
 void addDefaultEntryCreators(void);
 void addDefaultFunctionCreators(void);
@@ -34,7 +39,10 @@ public:
     LootTables() = default;
     ~LootTables() = default;
 
-    void initialize(const std::string &defaultFolder = "assets/loot_tables");
+    // snapshot, when given, receives every table imported in the "loot_tables" compound of a registry snapshot
+    void initialize(const std::string &defaultFolder = "assets/loot_tables", nbt::Writer *snapshot = nullptr);
+    // imports the tables from the "loot_tables" compound of a registry snapshot, throws if it is corrupted
+    void initialize(const nbt::TagView &snapshot);
 
     // creators handle specific loot table components
     void addRollCreator(LootTable::Roll::Creator creator, LootTable::Roll::IsOfType check);
@@ -49,7 +57,7 @@ public:
     std::unique_ptr<LootTable::Condition::Condition> createCondition(const nlohmann::json &condition);
 
     // import all tables within folder and subfolders; does not keed invalid tables
-    void importTableFolder(const std::string &_namespace, const std::string &path);
+    void importTableFolder(const std::string &_namespace, const std::string &path, nbt::Writer *snapshot = nullptr);
 
     // table getters have no checks, please make sure your table exists by calling exists("namespace", "table")
     bool exists(const std::string &_namespace, const std::string &table);
@@ -61,6 +69,10 @@ public:
     std::unordered_map<std::string, std::unique_ptr<LootTable::LootTable>> &operator[](const std::string &_namespace);
 
 private:
+    void _addDefaultCreators(void);
+    // keeps the table only if it is valid
+    void _importTable(const std::string &_namespace, const std::string &name, const nlohmann::json &table);
+
     // loot table map, default loot tables will be imported under the namespace "minecraft"
     std::unordered_map<std::string, std::unordered_map<std::string, std::unique_ptr<LootTable::LootTable>>> _lootTables;
 
@@ -99,8 +99,74 @@ auto initArgs(int argc, const char *const argv[])
         .valueFromArgument("--num-gen-thread")
         .defaultValue(4);
 
+    program.add("num-tick-thread")
+        .help("Number of threads ticking the dimensions in parallel")
+        .valueFromConfig("general", "num-tick-thread")
+        .valueFromEnvironmentVariable("CBSRV_NUM_TICK_THREAD")
+        .valueFromArgument("--num-tick-thread")
+        .defaultValue(3);
+
+    program.add("num-entity-thread")
+        .help("Number of threads helping each dimension tick its entities by region")
+        .valueFromConfig("general", "num-entity-thread")
+        .valueFromEnvironmentVariable("CBSRV_NUM_ENTITY_THREAD")
+        .valueFromArgument("--num-entity-thread")
+        .defaultValue(3);
+
+    program.add("player-save-interval")
+        .help("Number of ticks between two saves of the data of a player that changed")
+        .valueFromConfig("general", "player-save-interval")
+        .valueFromEnvironmentVariable("CBSRV_PLAYER_SAVE_INTERVAL")
+        .valueFromArgument("--player-save-interval")
+        .defaultValue(1200);
+
+    program.add("storage-format")
+        .help("Format of the regions of the world, anvil like vanilla or native, faster and smaller (see cubic-region-tool)")
+        .valueFromConfig("general", "storage-format")
+        .valueFromEnvironmentVariable("CBSRV_STORAGE_FORMAT")
+        .valueFromArgument("--storage-format")
+        .possibleValues("anvil", "native")
+        .defaultValue("anvil");
+
+    program.add("autosave-interval")
+        .help("Number of seconds a modified chunk waits before being saved, 0 disables the autosave")
+        .valueFromConfig("autosave", "interval")
+        .valueFromEnvironmentVariable("CBSRV_AUTOSAVE_INTERVAL")
+        .valueFromArgument("--autosave-interval")
+        .defaultValue(300);
+
+    program.add("autosave-time-budget")
+        .help("Number of microseconds spent each tick queueing modified chunks to be saved")
+        .valueFromConfig("autosave", "time-budget")
+        .valueFromEnvironmentVariable("CBSRV_AUTOSAVE_TIME_BUDGET")
+        .valueFromArgument("--autosave-time-budget")
+        .defaultValue(1000);
+
+    program.add("autosave-generated")
+        .help("Also save the chunks that were only generated, by default only the chunks modified by players and the ones of /pregen are saved, "
+              "the others are generated again from the seed and change with the generator")
+        .valueFromConfig("autosave", "generated")
+        .valueFromEnvironmentVariable("CBSRV_AUTOSAVE_GENERATED")
+        .valueFromArgument("--autosave-generated")
+        .possibleValues(true, false)
+        .defaultValue(false);
+
+    program.add("autosave-max-pending")
+        .help("Maximum number of bytes of chunks waiting to be written before the autosave stops queueing")
+        .valueFromConfig("autosave", "max-pending")
+        .valueFromEnvironmentVariable("CBSRV_AUTOSAVE_MAX_PENDING")
+        .valueFromArgument("--autosave-max-pending")
+        .defaultValue(33554432);
+
+    program.add("pregen-concurrency")
+        .help("Maximum number of chunks queued at once by /pregen")
+        .valueFromConfig("generation", "pregen-concurrency")
+        .valueFromEnvironmentVariable("CBSRV_PREGEN_CONCURRENCY")
+        .valueFromArgument("--pregen-concurrency")
+        .defaultValue(16);
+
     program.add("world-type")
-        .help("World type to generate")
+        .help("World type to generate, the superflat worlds use built-in layers as a custom list of layers is not supported")
         .valueFromConfig("generation", "world-type")
         .valueFromEnvironmentVariable("CBSRV_LEVEL_TYPE")
         .valueFromArgument("--world-type")
@@ -120,6 +186,55 @@ auto initArgs(int argc, const char *const argv[])
         .valueFromEnvironmentVariable("CBSRV_RENDER_DISTANCE")
         .valueFromArgument("--render-distance")
         .defaultValue(10);
+    program.add("chunks-per-tick")
+        .help("Maximum number of chunks sent to a player each tick")
+        .valueFromConfig("network", "chunks-per-tick")
+        .valueFromEnvironmentVariable("CBSRV_CHUNKS_PER_TICK")
+        .valueFromArgument("--chunks-per-tick")
+        .defaultValue(16);
+    program.add("max-pending-packets")
+        .help("Number of packets waiting to be written to a client above which chunk sending is delayed")
+        .valueFromConfig("network", "max-pending-packets")
+        .valueFromEnvironmentVariable("CBSRV_MAX_PENDING_PACKETS")
+        .valueFromArgument("--max-pending-packets")
+        .defaultValue(512);
+    program.add("chunk-look-bias")
+        .help("How much chunks in front of the player are sent before the ones behind (0 to disable)")
+        .valueFromConfig("network", "chunk-look-bias")
+        .valueFromEnvironmentVariable("CBSRV_CHUNK_LOOK_BIAS")
+        .valueFromArgument("--chunk-look-bias")
+        .defaultValue(0.5);
+    program.add("status-rate-limit")
+        .help("Status and ping requests per second allowed from a single ip (0 to disable)")
+        .valueFromConfig("network", "status-rate-limit")
+        .valueFromEnvironmentVariable("CBSRV_STATUS_RATE_LIMIT")
+        .valueFromArgument("--status-rate-limit")
+        .defaultValue(5.0);
+    program.add("status-rate-burst")
+        .help("Status and ping requests a single ip can make at once before being limited")
+        .valueFromConfig("network", "status-rate-burst")
+        .valueFromEnvironmentVariable("CBSRV_STATUS_RATE_BURST")
+        .valueFromArgument("--status-rate-burst")
+        .defaultValue(20.0);
+    program.add("metrics-enabled")
+        .help("Serve the server metrics in the Prometheus format over HTTP")
+        .valueFromConfig("metrics", "enabled")
+        .valueFromEnvironmentVariable("CBSRV_METRICS_ENABLED")
+        .valueFromArgument("--metrics-enabled")
+        .possibleValues(false, true)
+        .defaultValue(false);
+    program.add("metrics-ip")
+        .help("Ip on which the metrics are served")
+        .valueFromConfig("metrics", "ip")
+        .valueFromEnvironmentVariable("CBSRV_METRICS_IP")
+        .valueFromArgument("--metrics-ip")
+        .defaultValue("127.0.0.1");
+    program.add("metrics-port")
+        .help("Port on which the metrics are served")
+        .valueFromConfig("metrics", "port")
+        .valueFromEnvironmentVariable("CBSRV_METRICS_PORT")
+        .valueFromArgument("--metrics-port")
+        .defaultValue(9225);
     program.add("online-mode")
         .help("Enable client/server encryption and only accepts legitimate accounts")
         .valueFromConfig("general", "online-mode")
@@ -134,6 +249,7 @@ auto initArgs(int argc, const char *const argv[])
     } catch (const configuration::BadFile &) {
         if (std::filesystem::exists("./config.yml")) {
             LERROR("Failed to open config file, check permissions");
+            logging::flush();
             std::exit(1);
         }
         LWARN("No config file found, creating one");
@@ -0,0 +1,133 @@
+#include "ClientStats.hpp"
+
+#include <algorithm>
+
+// Weight of the newest sample in the write latency average
+constexpr uint64_t LATENCY_SMOOTHING = 16;
+
+metrics::ClientPacketCounters::ClientPacketCounters(const std::array<size_t, CLIENT_STATUS_COUNT> &sizes):
+    _offsets {}
+{
+    for (size_t state = 0; state < CLIENT_STATUS_COUNT; state++)
+        _offsets[state + 1] = _offsets[state] + sizes[state];
+    _counters = std::make_unique<PacketCounter[]>(_offsets.back());
+}
+
+void metrics::ClientPacketCounters::count(protocol::ClientStatus status, int32_t id, size_t bytes)
+{
+    auto state = static_cast<size_t>(status);
+    if (state >= CLIENT_STATUS_COUNT || id < 0 || static_cast<size_t>(id) >= _offsets[state + 1] - _offsets[state])
+        return;
+    auto &counter = _counters[_offsets[state] + id];
+    counter.packets.fetch_add(1, std::memory_order_relaxed);
+    counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+metrics::ClientStats::ClientStats():
+    _packetsIn(PACKET_IDS_IN),
+    _packetsOut(PACKET_IDS_OUT),
+    _bytesIn(0),
+    _bytesOut(0),
+    _writeLatencyUs(0),
+    _maxWriteLatencyUs(0),
+    _lastBacklog(0),
+    _growingSamples(0),
+    _slow(false)
+{
+}
+
+metrics::ClientStats::~ClientStats()
+{
+    if (_slow)
+        network.slowClients--;
+}
+
+void metrics::ClientStats::onRead(size_t bytes)
+{
+    _bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+    addBytesIn(bytes);
+}
+
+void metrics::ClientStats::onPacketIn(protocol::ClientStatus status, int32_t id, size_t bytes)
+{
+    _packetsIn.count(status, id, bytes);
+    countPacket(network.packetsIn, status, id, bytes);
+}
+
+void metrics::ClientStats::onPacketOut(protocol::ClientStatus status, int32_t id, size_t bytes)
+{
+    _packetsOut.count(status, id, bytes);
+    countPacket(network.packetsOut, status, id, bytes);
+}
+
+void metrics::ClientStats::onWritten(size_t bytes, std::chrono::steady_clock::duration latency)
+{
+    _bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+    addBytesOut(bytes);
+    addWriteLatency(latency);
+
+    // Only the write thread writes these, the loads and stores don't need to be a single operation
+    uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    uint64_t average = _writeLatencyUs.load(std::memory_order_relaxed);
+    _writeLatencyUs.store(average == 0 ? latencyUs : (average * (LATENCY_SMOOTHING - 1) + latencyUs) / LATENCY_SMOOTHING, std::memory_order_relaxed);
+    if (latencyUs > _maxWriteLatencyUs.load(std::memory_order_relaxed))
+        _maxWriteLatencyUs.store(latencyUs, std::memory_order_relaxed);
+}
+
+bool metrics::ClientStats::sampleBacklog(size_t pendingPackets)
+{
+    if (pendingPackets > _lastBacklog)
+        _growingSamples++;
+    else
+        _growingSamples = 0;
+    _lastBacklog = pendingPackets;
+
+    if (!_slow && _growingSamples >= SLOW_CLIENT_SAMPLES && pendingPackets >= SLOW_CLIENT_MIN_BACKLOG) {
+        _slow = true;
+        network.slowClients++;
+        return true;
+    }
+    if (_slow && pendingPackets < SLOW_CLIENT_MIN_BACKLOG / 2) {
+        _slow = false;
+        network.slowClients--;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Add the packet types of a state with at least one packet to stats
+ */
+static void collectPackets(std::vector<metrics::ClientStats::PacketStat> &stats, size_t state, std::span<const metrics::PacketCounter> counters)
+{
+    for (size_t id = 0; id < counters.size(); id++) {
+        auto packets = counters[id].packets.load(std::memory_order_relaxed);
+        if (packets != 0)
+            stats.push_back({static_cast<protocol::ClientStatus>(state), static_cast<int32_t>(id), packets, counters[id].bytes.load(std::memory_order_relaxed)});
+    }
+}
+
+static void sortByBytes(std::vector<metrics::ClientStats::PacketStat> &stats)
+{
+    std::sort(stats.begin(), stats.end(), [](const metrics::ClientStats::PacketStat &a, const metrics::ClientStats::PacketStat &b) {
+        return a.bytes > b.bytes;
+    });
+}
+
+std::vector<metrics::ClientStats::PacketStat> metrics::ClientStats::sortPackets(const PacketCounters &counters)
+{
+    std::vector<PacketStat> stats;
+    for (size_t state = 0; state < CLIENT_STATUS_COUNT; state++)
+        collectPackets(stats, state, counters[state]);
+    sortByBytes(stats);
+    return stats;
+}
+
+std::vector<metrics::ClientStats::PacketStat> metrics::ClientStats::sortPackets(const ClientPacketCounters &counters)
+{
+    std::vector<PacketStat> stats;
+    for (size_t state = 0; state < CLIENT_STATUS_COUNT; state++)
+        collectPackets(stats, state, counters.get(state));
+    sortByBytes(stats);
+    return stats;
+}
@@ -0,0 +1,110 @@
+#ifndef CUBICSERVER_METRICS_CLIENTSTATS_HPP
+#define CUBICSERVER_METRICS_CLIENTSTATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Metrics.hpp"
+#include "options.hpp"
+
+namespace metrics {
+
+// Ticks between two samples of the backlog of a client
+constexpr uint16_t BACKLOG_SAMPLE_TICKS = 20;
+// A client is slow once its backlog grew this many samples in a row
+constexpr size_t SLOW_CLIENT_SAMPLES = 5;
+// Backlogs smaller than this many packets are never considered slow, a client is back to normal under half of it
+constexpr size_t SLOW_CLIENT_MIN_BACKLOG = 256;
+
+/**
+ * @brief Packet counters of a single client, only sized for the packet ids of each state (see PACKET_IDS_IN)
+ *
+ * The ids out of the protocol are only counted by the global network counters.
+ */
+class ClientPacketCounters {
+public:
+    explicit ClientPacketCounters(const std::array<size_t, CLIENT_STATUS_COUNT> &sizes);
+
+    void count(protocol::ClientStatus status, int32_t id, size_t bytes);
+    NODISCARD std::span<const PacketCounter> get(size_t state) const { return {_counters.get() + _offsets[state], _offsets[state + 1] - _offsets[state]}; }
+
+private:
+    std::array<size_t, CLIENT_STATUS_COUNT + 1> _offsets;
+    std::unique_ptr<PacketCounter[]> _counters;
+};
+
+/**
+ * @brief Traffic of a single client, also added to the global network counters
+ */
+class ClientStats {
+public:
+    struct PacketStat {
+        protocol::ClientStatus status;
+        int32_t id;
+        uint64_t packets;
+        uint64_t bytes;
+    };
+
+public:
+    ClientStats();
+    ~ClientStats();
+
+    void onRead(size_t bytes);
+    void onPacketIn(protocol::ClientStatus status, int32_t id, size_t bytes);
+    void onPacketOut(protocol::ClientStatus status, int32_t id, size_t bytes);
+    /**
+     * @brief Record a write that reached the socket
+     *
+     * @param latency Time between its enqueueing and the end of the write
+     */
+    void onWritten(size_t bytes, std::chrono::steady_clock::duration latency);
+
+    /**
+     * @brief Feed the backlog of the client to the slow client detector, from the tick thread only
+     *
+     * @return true if the client just became slow or just recovered
+     */
+    bool sampleBacklog(size_t pendingPackets);
+
+    NODISCARD uint64_t getBytesIn() const { return _bytesIn.load(std::memory_order_relaxed); }
+    NODISCARD uint64_t getBytesOut() const { return _bytesOut.load(std::memory_order_relaxed); }
+    NODISCARD bool isSlow() const { return _slow.load(std::memory_order_relaxed); }
+    /**
+     * @brief Exponential moving average of the write latency in milliseconds
+     */
+    NODISCARD double getWriteLatency() const { return _writeLatencyUs.load(std::memory_order_relaxed) / 1000.0; }
+    NODISCARD double getMaxWriteLatency() const { return _maxWriteLatencyUs.load(std::memory_order_relaxed) / 1000.0; }
+
+    /**
+     * @brief Every packet type seen in one direction, the heaviest first
+     */
+    NODISCARD std::vector<PacketStat> getPacketsIn() const { return sortPackets(_packetsIn); }
+    NODISCARD std::vector<PacketStat> getPacketsOut() const { return sortPackets(_packetsOut); }
+
+    /**
+     * @brief Every packet type with at least one packet, the heaviest first
+     */
+    static std::vector<PacketStat> sortPackets(const PacketCounters &counters);
+    static std::vector<PacketStat> sortPackets(const ClientPacketCounters &counters);
+
+private:
+    ClientPacketCounters _packetsIn;
+    ClientPacketCounters _packetsOut;
+    std::atomic<uint64_t> _bytesIn;
+    std::atomic<uint64_t> _bytesOut;
+    std::atomic<uint64_t> _writeLatencyUs;
+    std::atomic<uint64_t> _maxWriteLatencyUs;
+
+    size_t _lastBacklog;
+    size_t _growingSamples;
+    std::atomic<bool> _slow;
+};
+
+} // namespace metrics
+
+#endif // CUBICSERVER_METRICS_CLIENTSTATS_HPP
@@ -0,0 +1,13 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+
+metrics::Network metrics::network {};
+
+void metrics::addWriteLatency(std::chrono::steady_clock::duration latency)
+{
+    double milliseconds = std::chrono::duration<double, std::milli>(latency).count();
+    auto bucket = std::lower_bound(WRITE_LATENCY_BUCKETS.begin(), WRITE_LATENCY_BUCKETS.end(), milliseconds) - WRITE_LATENCY_BUCKETS.begin();
+    network.writeLatency[bucket].fetch_add(1, std::memory_order_relaxed);
+    network.writeLatencySumUs.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(latency).count(), std::memory_order_relaxed);
+}
@@ -0,0 +1,63 @@
+#ifndef CUBICSERVER_METRICS_METRICS_HPP
+#define CUBICSERVER_METRICS_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "protocol/common.hpp"
+
+namespace metrics {
+
+constexpr size_t CLIENT_STATUS_COUNT = 4;
+// Every packet id of the protocol fits on a single varint byte
+constexpr size_t MAX_PACKET_ID = 0x80;
+// Number of packet ids of each state of the protocol, received then sent, the counters of a client only cover these
+constexpr std::array<size_t, CLIENT_STATUS_COUNT> PACKET_IDS_IN = {0x01, 0x02, 0x03, 0x33};
+constexpr std::array<size_t, CLIENT_STATUS_COUNT> PACKET_IDS_OUT = {0x00, 0x02, 0x05, 0x6B};
+// Upper bounds in milliseconds of the write latency histogram buckets, the last bucket is unbounded
+constexpr std::array<double, 8> WRITE_LATENCY_BUCKETS = {1, 5, 10, 25, 50, 100, 500, 1000};
+
+struct PacketCounter {
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> bytes;
+};
+
+typedef std::array<std::array<PacketCounter, MAX_PACKET_ID>, CLIENT_STATUS_COUNT> PacketCounters;
+
+/**
+ * @brief Traffic of every client since the start, only relaxed atomics so the network threads never wait on each other
+ */
+struct Network {
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    PacketCounters packetsIn;
+    PacketCounters packetsOut;
+    // Time spent by the writes in the queue of the write thread
+    std::array<std::atomic<uint64_t>, WRITE_LATENCY_BUCKETS.size() + 1> writeLatency;
+    std::atomic<uint64_t> writeLatencySumUs;
+    std::atomic<int32_t> slowClients;
+};
+
+extern Network network;
+
+inline void addBytesIn(size_t bytes) { network.bytesIn.fetch_add(bytes, std::memory_order_relaxed); }
+
+inline void addBytesOut(size_t bytes) { network.bytesOut.fetch_add(bytes, std::memory_order_relaxed); }
+
+inline void countPacket(PacketCounters &counters, protocol::ClientStatus status, int32_t id, size_t bytes)
+{
+    auto state = static_cast<size_t>(status);
+    if (state < CLIENT_STATUS_COUNT && id >= 0 && static_cast<size_t>(id) < MAX_PACKET_ID) {
+        counters[state][id].packets.fetch_add(1, std::memory_order_relaxed);
+        counters[state][id].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+void addWriteLatency(std::chrono::steady_clock::duration latency);
+
+} // namespace metrics
+
+#endif // CUBICSERVER_METRICS_METRICS_HPP
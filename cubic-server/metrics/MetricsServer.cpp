@@ -0,0 +1,258 @@
+#include "MetricsServer.hpp"
+
+#include "Client.hpp"
+#include "Dimension.hpp"
+#include "Metrics.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "WorldGroup.hpp"
+#include "logging/logging.hpp"
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+using boost::asio::ip::tcp;
+
+// Scrapes only send a request line and a few headers
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+
+namespace {
+
+struct Connection {
+    explicit Connection(tcp::socket &&socket):
+        socket(std::move(socket)),
+        request(MAX_REQUEST_SIZE)
+    {
+    }
+
+    tcp::socket socket;
+    boost::asio::streambuf request;
+    std::string response;
+};
+
+constexpr const char *CLIENT_STATUS_NAMES[metrics::CLIENT_STATUS_COUNT] = {"initial", "status", "login", "play"};
+
+void writeHeader(std::string &out, const char *name, const char *type, const char *help)
+{
+    out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+void writePackets(std::string &packets, std::string &bytes, const metrics::PacketCounters &counters, const char *direction)
+{
+    for (size_t state = 0; state < metrics::CLIENT_STATUS_COUNT; state++) {
+        for (size_t id = 0; id < metrics::MAX_PACKET_ID; id++) {
+            auto count = counters[state][id].packets.load(std::memory_order_relaxed);
+            if (count == 0)
+                continue;
+            auto labels = fmt::format("direction=\"{}\",state=\"{}\",id=\"0x{:02x}\"", direction, CLIENT_STATUS_NAMES[state], id);
+            packets += fmt::format("cubic_network_packets_total{{{}}} {}\n", labels, count);
+            bytes += fmt::format("cubic_network_packet_bytes_total{{{}}} {}\n", labels, counters[state][id].bytes.load(std::memory_order_relaxed));
+        }
+    }
+}
+
+void writeMemory(UNUSED std::string &out)
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (statm >> size >> resident) {
+        writeHeader(out, "cubic_resident_memory_bytes", "gauge", "Resident set size of the process");
+        out += fmt::format("cubic_resident_memory_bytes {}\n", resident * sysconf(_SC_PAGESIZE));
+    }
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    auto info = mallinfo2();
+    writeHeader(out, "cubic_heap_bytes", "gauge", "Bytes allocated on the heap");
+    out += fmt::format("cubic_heap_bytes {}\n", info.uordblks + info.hblkhd);
+#endif
+#endif
+}
+
+} // namespace
+
+metrics::MetricsServer::MetricsServer(boost::asio::io_context &ioContext, const tcp::endpoint &endpoint):
+    _acceptor(ioContext)
+{
+    _acceptor.open(endpoint.protocol());
+    _acceptor.set_option(tcp::acceptor::reuse_address(true));
+    if (endpoint.protocol() == tcp::v6())
+        _acceptor.set_option(boost::asio::ip::v6_only(false));
+    _acceptor.bind(endpoint);
+    _acceptor.listen();
+}
+
+void metrics::MetricsServer::start()
+{
+    LINFO("Serving metrics on http://{}:{}/metrics", _acceptor.local_endpoint().address().to_string(), _acceptor.local_endpoint().port());
+    this->_doAccept();
+}
+
+void metrics::MetricsServer::stop()
+{
+    boost::asio::post(_acceptor.get_executor(), [this] {
+        boost::system::error_code ec;
+        _acceptor.close(ec);
+    });
+}
+
+void metrics::MetricsServer::_doAccept()
+{
+    _acceptor.async_accept([this](const boost::system::error_code &error, tcp::socket socket) {
+        // Only fails once the acceptor is closed
+        if (error)
+            return;
+
+        auto connection = std::make_shared<Connection>(std::move(socket));
+        boost::asio::async_read_until(connection->socket, connection->request, "\r\n\r\n", [connection](const boost::system::error_code &error, UNUSED size_t length) {
+            if (error)
+                return;
+
+            std::istream stream(&connection->request);
+            std::string method;
+            std::string target;
+            stream >> method >> target;
+
+            std::string status = "200 OK";
+            std::string body;
+            if (method != "GET")
+                status = "405 Method Not Allowed";
+            else if (target != "/metrics" && target != "/")
+                status = "404 Not Found";
+            else
+                body = render();
+
+            connection->response = fmt::format(
+                "HTTP/1.1 {}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", status, body.size(), body
+            );
+            boost::asio::async_write(connection->socket, boost::asio::buffer(connection->response), [connection](UNUSED const boost::system::error_code &error, UNUSED size_t length) {
+                boost::system::error_code ec;
+                connection->socket.shutdown(tcp::socket::shutdown_both, ec);
+            });
+        });
+
+        this->_doAccept();
+    });
+}
+
+std::string metrics::MetricsServer::render()
+{
+    std::string out;
+    out.reserve(16 * 1024);
+    auto server = Server::getInstance();
+
+    writeHeader(out, "cubic_tps", "gauge", "Ticks per second averaged over a window");
+    for (const auto &[groupName, group] : server->getWorldGroups()) {
+        auto tps = group->getTickScheduler().getTps();
+        out += fmt::format("cubic_tps{{group=\"{}\",window=\"1m\"}} {:.3f}\n", groupName, tps[0]);
+        out += fmt::format("cubic_tps{{group=\"{}\",window=\"5m\"}} {:.3f}\n", groupName, tps[1]);
+        out += fmt::format("cubic_tps{{group=\"{}\",window=\"15m\"}} {:.3f}\n", groupName, tps[2]);
+    }
+
+    writeHeader(out, "cubic_mspt_milliseconds", "histogram", "Duration of the ticks");
+    for (const auto &[groupName, group] : server->getWorldGroups()) {
+        auto histogram = group->getTickScheduler().getMsptHistogram();
+        for (size_t i = 0; i < TickScheduler::MSPT_BUCKETS.size(); i++)
+            out += fmt::format("cubic_mspt_milliseconds_bucket{{group=\"{}\",le=\"{}\"}} {}\n", groupName, TickScheduler::MSPT_BUCKETS[i], histogram.buckets[i]);
+        out += fmt::format("cubic_mspt_milliseconds_bucket{{group=\"{}\",le=\"+Inf\"}} {}\n", groupName, histogram.buckets.back());
+        out += fmt::format("cubic_mspt_milliseconds_sum{{group=\"{}\"}} {:.3f}\n", groupName, histogram.sum);
+        out += fmt::format("cubic_mspt_milliseconds_count{{group=\"{}\"}} {}\n", groupName, histogram.buckets.back());
+    }
+
+    writeHeader(out, "cubic_tick_overruns_total", "counter", "Ticks that took longer than their time slot");
+    for (const auto &[groupName, group] : server->getWorldGroups())
+        out += fmt::format("cubic_tick_overruns_total{{group=\"{}\"}} {}\n", groupName, group->getTickScheduler().getOverruns());
+
+    std::string dimensionTicks;
+    std::string loadedChunks;
+    std::string generationQueue;
+    std::string generationBusy;
+    std::string generationWorkers;
+    for (const auto &[_, group] : server->getWorldGroups()) {
+        for (const auto &[worldName, world] : group->getWorlds()) {
+            auto &pool = world->getGenerationPool();
+            generationQueue += fmt::format("cubic_generation_queued_jobs{{world=\"{}\"}} {}\n", worldName, pool.getQueuedJobs());
+            generationBusy += fmt::format("cubic_generation_busy_workers{{world=\"{}\"}} {}\n", worldName, pool.getBusyWorkers());
+            generationWorkers += fmt::format("cubic_generation_workers{{world=\"{}\"}} {}\n", worldName, pool.getWorkerNb());
+            for (const auto &[dimensionName, dimension] : world->getDimensions()) {
+                dimensionTicks += fmt::format("cubic_dimension_tick_milliseconds{{world=\"{}\",dimension=\"{}\"}} {:.3f}\n", worldName, dimensionName, dimension->getTickDuration());
+                loadedChunks += fmt::format("cubic_loaded_chunks{{world=\"{}\",dimension=\"{}\"}} {}\n", worldName, dimensionName, dimension->getLevel().getChunkColumnCount());
+            }
+        }
+    }
+    writeHeader(out, "cubic_dimension_tick_milliseconds", "gauge", "Duration of the last tick of a dimension");
+    out += dimensionTicks;
+    writeHeader(out, "cubic_loaded_chunks", "gauge", "Chunk columns in memory");
+    out += loadedChunks;
+    writeHeader(out, "cubic_generation_queued_jobs", "gauge", "Chunk generation jobs waiting for a worker");
+    out += generationQueue;
+    writeHeader(out, "cubic_generation_busy_workers", "gauge", "Chunk generation workers running a job");
+    out += generationBusy;
+    writeHeader(out, "cubic_generation_workers", "gauge", "Chunk generation workers");
+    out += generationWorkers;
+
+    // The clients mutex is held while disconnected clients are joined, skip them rather than delaying the scrape
+    std::unique_lock lock(server->clientsMutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        const auto &clients = server->getClients();
+        writeHeader(out, "cubic_clients", "gauge", "Connected clients");
+        out += fmt::format("cubic_clients {}\n", clients.size());
+        std::string pendingPackets;
+        std::string bytes;
+        std::string latency;
+        std::string slow;
+        for (const auto &[id, client] : clients) {
+            const auto &stats = client->getStats();
+            pendingPackets += fmt::format("cubic_client_pending_packets{{client=\"{}\"}} {}\n", id, client->pendingPackets());
+            bytes += fmt::format("cubic_client_bytes_total{{client=\"{}\",direction=\"in\"}} {}\n", id, stats.getBytesIn());
+            bytes += fmt::format("cubic_client_bytes_total{{client=\"{}\",direction=\"out\"}} {}\n", id, stats.getBytesOut());
+            latency += fmt::format("cubic_client_write_latency_milliseconds{{client=\"{}\"}} {:.3f}\n", id, stats.getWriteLatency());
+            slow += fmt::format("cubic_client_slow{{client=\"{}\"}} {}\n", id, stats.isSlow() ? 1 : 0);
+        }
+        lock.unlock();
+
+        writeHeader(out, "cubic_client_pending_packets", "gauge", "Packets queued for a client and not on the socket yet");
+        out += pendingPackets;
+        writeHeader(out, "cubic_client_bytes_total", "counter", "Bytes exchanged with a client");
+        out += bytes;
+        writeHeader(out, "cubic_client_write_latency_milliseconds", "gauge", "Moving average of the time between the enqueueing of a write and the socket");
+        out += latency;
+        writeHeader(out, "cubic_client_slow", "gauge", "Whether the send backlog of a client keeps growing");
+        out += slow;
+    }
+
+    writeHeader(out, "cubic_slow_clients", "gauge", "Clients whose send backlog keeps growing");
+    out += fmt::format("cubic_slow_clients {}\n", network.slowClients.load(std::memory_order_relaxed));
+
+    writeHeader(out, "cubic_network_write_latency_milliseconds", "histogram", "Time between the enqueueing of a write and the socket");
+    uint64_t writes = 0;
+    for (size_t i = 0; i < WRITE_LATENCY_BUCKETS.size(); i++) {
+        writes += network.writeLatency[i].load(std::memory_order_relaxed);
+        out += fmt::format("cubic_network_write_latency_milliseconds_bucket{{le=\"{}\"}} {}\n", WRITE_LATENCY_BUCKETS[i], writes);
+    }
+    writes += network.writeLatency.back().load(std::memory_order_relaxed);
+    out += fmt::format("cubic_network_write_latency_milliseconds_bucket{{le=\"+Inf\"}} {}\n", writes);
+    out += fmt::format("cubic_network_write_latency_milliseconds_sum {:.3f}\n", network.writeLatencySumUs.load(std::memory_order_relaxed) / 1000.0);
+    out += fmt::format("cubic_network_write_latency_milliseconds_count {}\n", writes);
+
+    writeHeader(out, "cubic_network_bytes_total", "counter", "Bytes exchanged with the clients");
+    out += fmt::format("cubic_network_bytes_total{{direction=\"in\"}} {}\n", network.bytesIn.load(std::memory_order_relaxed));
+    out += fmt::format("cubic_network_bytes_total{{direction=\"out\"}} {}\n", network.bytesOut.load(std::memory_order_relaxed));
+
+    std::string packets;
+    std::string packetBytes;
+    writePackets(packets, packetBytes, network.packetsIn, "in");
+    writePackets(packets, packetBytes, network.packetsOut, "out");
+    writeHeader(out, "cubic_network_packets_total", "counter", "Packets exchanged with the clients by state and id");
+    out += packets;
+    writeHeader(out, "cubic_network_packet_bytes_total", "counter", "Bytes of the packets exchanged with the clients by state and id");
+    out += packetBytes;
+
+    writeMemory(out);
+    return out;
+}
@@ -0,0 +1,39 @@
+#ifndef CUBICSERVER_METRICS_METRICSSERVER_HPP
+#define CUBICSERVER_METRICS_METRICSSERVER_HPP
+
+#include <boost/asio.hpp>
+#include <string>
+
+namespace metrics {
+
+/**
+ * @brief Serves the server internals in the Prometheus text format on GET /metrics
+ *
+ * It runs on the io_context of the server, everything it reads is either atomic or try-locked so a scrape never stalls the tick or the network.
+ */
+class MetricsServer {
+public:
+    MetricsServer(boost::asio::io_context &ioContext, const boost::asio::ip::tcp::endpoint &endpoint);
+
+    void start();
+    /**
+     * @brief Stop accepting scrapes
+     *
+     * @note This function is thread-safe
+     */
+    void stop();
+
+    /**
+     * @brief Render every metric in the Prometheus text exposition format
+     */
+    static std::string render();
+
+private:
+    void _doAccept();
+
+    boost::asio::ip::tcp::acceptor _acceptor;
+};
+
+} // namespace metrics
+
+#endif // CUBICSERVER_METRICS_METRICSSERVER_HPP
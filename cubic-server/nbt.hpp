@@ -15,6 +15,7 @@ namespace nbt {
 DEFINE_EXCEPTION(TypeMismatch);
 DEFINE_EXCEPTION(BufferEOF);
 DEFINE_EXCEPTION(UnknownType);
+DEFINE_EXCEPTION(NestingTooDeep);
 
 enum class TagType {
     End,
@@ -0,0 +1,551 @@
+#include "nbt_arena.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <new>
+
+using namespace nbt::arena;
+using nbt::TagType;
+
+static constexpr uint32_t NO_NAME = std::numeric_limits<uint32_t>::max();
+
+static uint32_t hashName(uint32_t name, uint32_t capacity) { return (name * 0x9E3779B1u) & (capacity - 1); }
+
+static size_t paddingFor(const std::byte *at, size_t alignment) { return (alignment - reinterpret_cast<uintptr_t>(at) % alignment) % alignment; }
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+    auto padding = paddingFor(_current, alignment);
+    if (_current == nullptr || padding + size > _remaining) {
+        // Big allocations get a block of their own so they do not waste the rest of the current one
+        if (size + alignment > BLOCK_SIZE / 4) {
+            auto &block = _blocks.emplace_back(new std::byte[size + alignment]);
+            _used += size;
+            return block.get() + paddingFor(block.get(), alignment);
+        }
+        _current = _blocks.emplace_back(new std::byte[BLOCK_SIZE]).get();
+        _remaining = BLOCK_SIZE;
+        padding = paddingFor(_current, alignment);
+    }
+
+    auto *result = _current + padding;
+    _current += padding + size;
+    _remaining -= padding + size;
+    _used += size;
+    return result;
+}
+
+std::string_view Tag::getName() const { return _document->_names[_name == NO_NAME ? 0 : _name]; }
+
+std::string_view Tag::getString() const
+{
+    auto &tag = this->_expect(TagType::String);
+    return {static_cast<const char *>(tag._data), tag._size};
+}
+
+std::span<Tag *const> Tag::getChildren() const
+{
+    if (_type != TagType::Compound && _type != TagType::List)
+        throw TypeMismatch("Only compounds and lists have children");
+    return {_children, _size};
+}
+
+Tag &Tag::at(size_t index) const
+{
+    auto children = this->getChildren();
+    if (index >= children.size())
+        throw std::out_of_range("nbt::arena::Tag index out of range");
+    return *children[index];
+}
+
+Tag *Tag::find(std::string_view name) const
+{
+    this->_expect(TagType::Compound);
+    // A name the document never saw cannot be in the compound
+    auto id = _document->_findName(name);
+    if (id == NO_NAME)
+        return nullptr;
+
+    if (_indexCapacity == 0) {
+        for (uint32_t i = 0; i < _size; i++)
+            if (_children[i]->_name == id)
+                return _children[i];
+        return nullptr;
+    }
+    for (auto slot = hashName(id, _indexCapacity); _indexSlots[slot] != 0; slot = (slot + 1) & (_indexCapacity - 1)) {
+        auto *child = _children[_indexSlots[slot] - 1];
+        if (child->_name == id)
+            return child;
+    }
+    return nullptr;
+}
+
+Tag *Tag::find(std::string_view name, TagType type) const
+{
+    auto *child = this->find(name);
+    if (child && child->_type != type)
+        throw TypeMismatch("Provided type does not match the type of the NBT Tag");
+    return child;
+}
+
+Tag &Tag::addByte(std::string_view name, int8_t value)
+{
+    auto &tag = this->_addChild(TagType::Byte, name);
+    tag._integer = value;
+    return tag;
+}
+
+Tag &Tag::addShort(std::string_view name, int16_t value)
+{
+    auto &tag = this->_addChild(TagType::Short, name);
+    tag._integer = value;
+    return tag;
+}
+
+Tag &Tag::addInt(std::string_view name, int32_t value)
+{
+    auto &tag = this->_addChild(TagType::Int, name);
+    tag._integer = value;
+    return tag;
+}
+
+Tag &Tag::addLong(std::string_view name, int64_t value)
+{
+    auto &tag = this->_addChild(TagType::Long, name);
+    tag._integer = value;
+    return tag;
+}
+
+Tag &Tag::addFloat(std::string_view name, float value)
+{
+    auto &tag = this->_addChild(TagType::Float, name);
+    tag._float = value;
+    return tag;
+}
+
+Tag &Tag::addDouble(std::string_view name, double value)
+{
+    auto &tag = this->_addChild(TagType::Double, name);
+    tag._double = value;
+    return tag;
+}
+
+Tag &Tag::addString(std::string_view name, std::string_view value)
+{
+    auto &tag = this->_addChild(TagType::String, name);
+    tag._data = this->_copyArray(value.data(), value.size());
+    tag._size = value.size();
+    return tag;
+}
+
+Tag &Tag::addByteArray(std::string_view name, std::span<const int8_t> values)
+{
+    auto &tag = this->_addChild(TagType::ByteArray, name);
+    tag._data = this->_copyArray(values.data(), values.size_bytes());
+    tag._size = values.size();
+    return tag;
+}
+
+Tag &Tag::addIntArray(std::string_view name, std::span<const int32_t> values)
+{
+    auto &tag = this->_addChild(TagType::IntArray, name);
+    tag._data = this->_copyArray(values.data(), values.size_bytes());
+    tag._size = values.size();
+    return tag;
+}
+
+Tag &Tag::addLongArray(std::string_view name, std::span<const int64_t> values)
+{
+    auto &tag = this->_addChild(TagType::LongArray, name);
+    tag._data = this->_copyArray(values.data(), values.size_bytes());
+    tag._size = values.size();
+    return tag;
+}
+
+Tag &Tag::addIntArray(std::string_view name, size_t size)
+{
+    auto &tag = this->_addChild(TagType::IntArray, name);
+    auto *values = _document->_arena.allocateArray<int32_t>(size);
+    std::fill_n(values, size, 0);
+    tag._data = values;
+    tag._size = size;
+    return tag;
+}
+
+Tag &Tag::addLongArray(std::string_view name, size_t size)
+{
+    auto &tag = this->_addChild(TagType::LongArray, name);
+    auto *values = _document->_arena.allocateArray<int64_t>(size);
+    std::fill_n(values, size, 0);
+    tag._data = values;
+    tag._size = size;
+    return tag;
+}
+
+Tag &Tag::addCompound(std::string_view name) { return this->_addChild(TagType::Compound, name); }
+
+Tag &Tag::addList(std::string_view name, TagType elementType)
+{
+    auto &tag = this->_addChild(TagType::List, name);
+    tag._elementType = elementType;
+    return tag;
+}
+
+bool Tag::remove(std::string_view name)
+{
+    auto *child = this->find(name);
+    if (child == nullptr)
+        return false;
+
+    _size = std::remove(_children, _children + _size, child) - _children;
+    if (_size > INDEX_THRESHOLD)
+        this->_rebuildIndex();
+    else
+        _indexCapacity = 0;
+    return true;
+}
+
+const Tag &Tag::_expect(TagType type) const
+{
+    if (_type != type)
+        throw TypeMismatch("Provided type does not match the type of the NBT Tag");
+    return *this;
+}
+
+Tag &Tag::_addChild(TagType type, std::string_view name)
+{
+    uint32_t id = NO_NAME;
+    if (_type == TagType::Compound) {
+        id = _document->_intern(name);
+    } else if (_type == TagType::List) {
+        if (_size == 0 && _elementType == TagType::End)
+            _elementType = type;
+        else if (_elementType != type)
+            throw TypeMismatch("nbt::arena::Tag list contains a different type");
+    } else {
+        throw TypeMismatch("Only compounds and lists have children");
+    }
+
+    if (_size == _capacity) {
+        _capacity = std::max<uint32_t>(4, _capacity * 2);
+        auto *children = _document->_arena.allocateArray<Tag *>(_capacity);
+        std::copy_n(_children, _size, children);
+        _children = children;
+    }
+    auto *tag = _document->_newTag(type, id);
+    _children[_size++] = tag;
+
+    if (_type == TagType::Compound) {
+        if (_indexCapacity != 0 && _size * 2 <= _indexCapacity)
+            this->_index(_size - 1);
+        else if (_size > INDEX_THRESHOLD)
+            this->_rebuildIndex();
+    }
+    return *tag;
+}
+
+void *Tag::_copyArray(const void *data, size_t bytes)
+{
+    // Every array of the NBT format is made of elements of at most 8 bytes
+    auto *copy = _document->_arena.allocate(bytes, alignof(int64_t));
+    if (bytes != 0)
+        std::memcpy(copy, data, bytes);
+    return copy;
+}
+
+void Tag::_index(uint32_t position)
+{
+    auto slot = hashName(_children[position]->_name, _indexCapacity);
+    while (_indexSlots[slot] != 0)
+        slot = (slot + 1) & (_indexCapacity - 1);
+    _indexSlots[slot] = position + 1;
+}
+
+void Tag::_rebuildIndex()
+{
+    // At most half full so the probes stay short
+    _indexCapacity = std::bit_ceil(_size * 4);
+    _indexSlots = _document->_arena.allocateArray<uint32_t>(_indexCapacity);
+    std::fill_n(_indexSlots, _indexCapacity, 0);
+    for (uint32_t i = 0; i < _size; i++)
+        this->_index(i);
+}
+
+Document::Document(std::string_view rootName)
+{
+    _names.push_back("");
+    _nameIds.emplace("", 0);
+    _root = this->_newTag(TagType::Compound, this->_intern(rootName));
+}
+
+Tag &Document::import(Tag &parent, const nbt::Base &tag)
+{
+    const auto &name = tag.getName();
+    switch (tag.getType()) {
+    case TagType::Byte:
+        return parent.addByte(name, static_cast<const nbt::Byte &>(tag).getValue());
+    case TagType::Short:
+        return parent.addShort(name, static_cast<const nbt::Short &>(tag).getValue());
+    case TagType::Int:
+        return parent.addInt(name, static_cast<const nbt::Int &>(tag).getValue());
+    case TagType::Long:
+        return parent.addLong(name, static_cast<const nbt::Long &>(tag).getValue());
+    case TagType::Float:
+        return parent.addFloat(name, static_cast<const nbt::Float &>(tag).getValue());
+    case TagType::Double:
+        return parent.addDouble(name, static_cast<const nbt::Double &>(tag).getValue());
+    case TagType::String:
+        return parent.addString(name, static_cast<const nbt::String &>(tag).getValue());
+    case TagType::ByteArray:
+        return parent.addByteArray(name, static_cast<const nbt::ByteArray &>(tag).getValues());
+    case TagType::IntArray:
+        return parent.addIntArray(name, static_cast<const nbt::IntArray &>(tag).getValues());
+    case TagType::LongArray:
+        return parent.addLongArray(name, static_cast<const nbt::LongArray &>(tag).getValues());
+    case TagType::List: {
+        const auto &values = static_cast<const nbt::List &>(tag).getValues();
+        auto &list = parent.addList(name, values.empty() ? TagType::End : values.front()->getType());
+        for (const auto &value : values)
+            this->import(list, *value);
+        return list;
+    }
+    case TagType::Compound: {
+        auto &compound = parent.addCompound(name);
+        for (const auto &value : static_cast<const nbt::Compound &>(tag).getValues())
+            this->import(compound, *value);
+        return compound;
+    }
+    default:
+        throw UnknownType("Cannot import a TAG_End");
+    }
+}
+
+Tag &Document::import(Tag &parent, const nbt::TagView &tag) { return this->_import(parent, tag, 0); }
+
+Tag &Document::_import(Tag &parent, const nbt::TagView &tag, size_t depth)
+{
+    if ((tag.getType() == TagType::List || tag.getType() == TagType::Compound) && depth >= nbt::TagView::MAX_DEPTH)
+        throw NestingTooDeep("NBT tags are nested too deeply");
+    const auto name = tag.getName();
+    switch (tag.getType()) {
+    case TagType::Byte:
+        return parent.addByte(name, tag.getByte());
+    case TagType::Short:
+        return parent.addShort(name, tag.getShort());
+    case TagType::Int:
+        return parent.addInt(name, tag.getInt());
+    case TagType::Long:
+        return parent.addLong(name, tag.getLong());
+    case TagType::Float:
+        return parent.addFloat(name, tag.getFloat());
+    case TagType::Double:
+        return parent.addDouble(name, tag.getDouble());
+    case TagType::String:
+        return parent.addString(name, tag.getString());
+    case TagType::ByteArray:
+        return parent.addByteArray(name, tag.getByteArray());
+    case TagType::IntArray: {
+        // Stored big endian in the buffer
+        auto &array = parent.addIntArray(name, tag.size());
+        tag.copyIntArray(array.getIntArray());
+        return array;
+    }
+    case TagType::LongArray: {
+        auto &array = parent.addLongArray(name, tag.size());
+        tag.copyLongArray(array.getLongArray());
+        return array;
+    }
+    case TagType::List: {
+        auto &list = parent.addList(name, tag.getElementType());
+        for (const auto &element : tag)
+            this->_import(list, element, depth + 1);
+        return list;
+    }
+    case TagType::Compound: {
+        auto &compound = parent.addCompound(name);
+        for (const auto &child : tag)
+            this->_import(compound, child, depth + 1);
+        return compound;
+    }
+    default:
+        throw UnknownType("Cannot import a TAG_End");
+    }
+}
+
+static size_t nameSize(const Tag &tag) { return 1 + 2 + tag.getName().size(); }
+
+static size_t payloadSize(const Tag &tag)
+{
+    switch (tag.getType()) {
+    case TagType::Byte:
+        return 1;
+    case TagType::Short:
+        return 2;
+    case TagType::Int:
+    case TagType::Float:
+        return 4;
+    case TagType::Long:
+    case TagType::Double:
+        return 8;
+    case TagType::String:
+        return 2 + tag.size();
+    case TagType::ByteArray:
+        return 4 + tag.size();
+    case TagType::IntArray:
+        return 4 + tag.size() * 4;
+    case TagType::LongArray:
+        return 4 + tag.size() * 8;
+    case TagType::List: {
+        size_t size = 1 + 4;
+        for (const auto *child : tag.getChildren())
+            size += payloadSize(*child);
+        return size;
+    }
+    case TagType::Compound: {
+        size_t size = 1;
+        for (const auto *child : tag.getChildren())
+            size += nameSize(*child) + payloadSize(*child);
+        return size;
+    }
+    default:
+        return 0;
+    }
+}
+
+template<typename T>
+static void writeBigEndian(uint8_t *&at, T value)
+{
+    auto bits = std::bit_cast<std::make_unsigned_t<T>>(value);
+    for (int i = sizeof(T) - 1; i >= 0; i--)
+        *at++ = (bits >> (i * 8)) & 0xFF;
+}
+
+static void writeName(uint8_t *&at, const Tag &tag)
+{
+    auto name = tag.getName();
+    *at++ = static_cast<uint8_t>(tag.getType());
+    writeBigEndian<uint16_t>(at, name.size());
+    std::memcpy(at, name.data(), name.size());
+    at += name.size();
+}
+
+static void writePayload(uint8_t *&at, const Tag &tag)
+{
+    switch (tag.getType()) {
+    case TagType::Byte:
+        *at++ = tag.getByte();
+        break;
+    case TagType::Short:
+        writeBigEndian(at, tag.getShort());
+        break;
+    case TagType::Int:
+        writeBigEndian(at, tag.getInt());
+        break;
+    case TagType::Long:
+        writeBigEndian(at, tag.getLong());
+        break;
+    case TagType::Float:
+        writeBigEndian(at, std::bit_cast<int32_t>(tag.getFloat()));
+        break;
+    case TagType::Double:
+        writeBigEndian(at, std::bit_cast<int64_t>(tag.getDouble()));
+        break;
+    case TagType::String: {
+        auto value = tag.getString();
+        writeBigEndian<uint16_t>(at, value.size());
+        std::memcpy(at, value.data(), value.size());
+        at += value.size();
+        break;
+    }
+    case TagType::ByteArray: {
+        auto values = tag.getByteArray();
+        writeBigEndian<int32_t>(at, values.size());
+        std::memcpy(at, values.data(), values.size());
+        at += values.size();
+        break;
+    }
+    case TagType::IntArray:
+        writeBigEndian<int32_t>(at, tag.size());
+        for (auto value : tag.getIntArray())
+            writeBigEndian(at, value);
+        break;
+    case TagType::LongArray:
+        writeBigEndian<int32_t>(at, tag.size());
+        for (auto value : tag.getLongArray())
+            writeBigEndian(at, value);
+        break;
+    case TagType::List:
+        *at++ = static_cast<uint8_t>(tag.getElementType());
+        writeBigEndian<int32_t>(at, tag.size());
+        for (const auto *child : tag.getChildren())
+            writePayload(at, *child);
+        break;
+    case TagType::Compound:
+        for (const auto *child : tag.getChildren()) {
+            writeName(at, *child);
+            writePayload(at, *child);
+        }
+        *at++ = static_cast<uint8_t>(TagType::End);
+        break;
+    default:
+        break;
+    }
+}
+
+size_t Document::serializedSize(bool includeName) const { return (includeName ? nameSize(*_root) : 0) + payloadSize(*_root); }
+
+void Document::serialize(std::vector<uint8_t> &data, bool includeName) const
+{
+    // Sized once up front so the tree is written without any reallocation
+    auto offset = data.size();
+    data.resize(offset + this->serializedSize(includeName));
+    auto *at = data.data() + offset;
+    if (includeName)
+        writeName(at, *_root);
+    writePayload(at, *_root);
+}
+
+std::vector<uint8_t> Document::serialize() const
+{
+    std::vector<uint8_t> data;
+    this->serialize(data);
+    return data;
+}
+
+Tag *Document::_newTag(TagType type, uint32_t name)
+{
+    auto *tag = new (_arena.allocate(sizeof(Tag), alignof(Tag))) Tag();
+    tag->_document = this;
+    tag->_type = type;
+    tag->_elementType = TagType::End;
+    tag->_name = name;
+    tag->_size = 0;
+    tag->_capacity = 0;
+    tag->_indexCapacity = 0;
+    tag->_integer = 0;
+    tag->_indexSlots = nullptr;
+    return tag;
+}
+
+uint32_t Document::_intern(std::string_view name)
+{
+    if (auto it = _nameIds.find(name); it != _nameIds.end())
+        return it->second;
+
+    // The key must outlive the lookup string, it is copied to the arena
+    auto *copy = _arena.allocateArray<char>(name.size());
+    std::copy(name.begin(), name.end(), copy);
+    std::string_view interned(copy, name.size());
+    auto id = static_cast<uint32_t>(_names.size());
+    _names.push_back(interned);
+    _nameIds.emplace(interned, id);
+    return id;
+}
+
+uint32_t Document::_findName(std::string_view name) const
+{
+    auto it = _nameIds.find(name);
+    return it == _nameIds.end() ? NO_NAME : it->second;
+}
@@ -0,0 +1,245 @@
+#ifndef CUBICSERVER_NBT_ARENA_HPP
+#define CUBICSERVER_NBT_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nbt.hpp"
+#include "nbt_reader.hpp"
+#include "options.hpp"
+
+/**
+ * @brief Flat NBT trees allocated from the arena of their document
+ *
+ * Every tag of a document is a small trivially destructible struct living in the document arena,
+ * compounds and lists keep their children in a contiguous array and the tag names are interned.
+ * Nothing is freed before the document is destroyed, which makes building a tree a series of pointer bumps.
+ *
+ * Compared to nbt::Base, lookups compare interned name ids instead of strings, large compounds have a hash index,
+ * and the typed accessors check the tag type instead of using RTTI.
+ */
+namespace nbt::arena {
+
+/**
+ * @brief Bump allocator handing out memory from fixed size blocks
+ */
+class Arena {
+public:
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    NODISCARD void *allocate(size_t size, size_t alignment);
+
+    /**
+     * @brief Uninitialized array, only for types that never need their destructor called
+     */
+    template<typename T>
+    NODISCARD T *allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T *>(this->allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    NODISCARD size_t getUsedBytes() const { return _used; }
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> _blocks;
+    std::byte *_current = nullptr;
+    size_t _remaining = 0;
+    size_t _used = 0;
+};
+
+class Document;
+
+class Tag {
+public:
+    // Compounds with more children than this get a hash index
+    static constexpr uint32_t INDEX_THRESHOLD = 8;
+
+public:
+    NODISCARD TagType getType() const { return _type; }
+    NODISCARD std::string_view getName() const;
+
+    /**
+     * @brief Scalar values, they throw TypeMismatch if the tag holds another type
+     */
+    NODISCARD int8_t getByte() const { return static_cast<int8_t>(this->_expect(TagType::Byte)._integer); }
+    NODISCARD int16_t getShort() const { return static_cast<int16_t>(this->_expect(TagType::Short)._integer); }
+    NODISCARD int32_t getInt() const { return static_cast<int32_t>(this->_expect(TagType::Int)._integer); }
+    NODISCARD int64_t getLong() const { return this->_expect(TagType::Long)._integer; }
+    NODISCARD float getFloat() const { return this->_expect(TagType::Float)._float; }
+    NODISCARD double getDouble() const { return this->_expect(TagType::Double)._double; }
+    NODISCARD std::string_view getString() const;
+
+    void setByte(int8_t value) { this->_expect(TagType::Byte)._integer = value; }
+    void setShort(int16_t value) { this->_expect(TagType::Short)._integer = value; }
+    void setInt(int32_t value) { this->_expect(TagType::Int)._integer = value; }
+    void setLong(int64_t value) { this->_expect(TagType::Long)._integer = value; }
+    void setFloat(float value) { this->_expect(TagType::Float)._float = value; }
+    void setDouble(double value) { this->_expect(TagType::Double)._double = value; }
+
+    /**
+     * @brief Array values, the elements can be modified in place but not resized
+     */
+    NODISCARD std::span<int8_t> getByteArray() { return this->_array<int8_t>(TagType::ByteArray); }
+    NODISCARD std::span<const int8_t> getByteArray() const { return const_cast<Tag *>(this)->getByteArray(); }
+    NODISCARD std::span<int32_t> getIntArray() { return this->_array<int32_t>(TagType::IntArray); }
+    NODISCARD std::span<const int32_t> getIntArray() const { return const_cast<Tag *>(this)->getIntArray(); }
+    NODISCARD std::span<int64_t> getLongArray() { return this->_array<int64_t>(TagType::LongArray); }
+    NODISCARD std::span<const int64_t> getLongArray() const { return const_cast<Tag *>(this)->getLongArray(); }
+
+    /**
+     * @brief Children of a compound or a list
+     */
+    NODISCARD size_t size() const { return _size; }
+    NODISCARD std::span<Tag *const> getChildren() const;
+    NODISCARD Tag &at(size_t index) const;
+    NODISCARD TagType getElementType() const { return this->_expect(TagType::List)._elementType; }
+
+    /**
+     * @brief Find a child of a compound by name
+     *
+     * @return nullptr if there is no child with this name
+     */
+    NODISCARD Tag *find(std::string_view name) const;
+    NODISCARD bool contains(std::string_view name) const { return this->find(name) != nullptr; }
+
+    /**
+     * @brief Find a child of a compound, checking its type
+     *
+     * @throw TypeMismatch if the child exists with another type
+     */
+    NODISCARD Tag *find(std::string_view name, TagType type) const;
+
+    /**
+     * @brief Add a child to a compound, or append it to a list whose element type must match (the name is then ignored)
+     *
+     * @return The new tag, which stays valid for the lifetime of the document
+     */
+    Tag &addByte(std::string_view name, int8_t value);
+    Tag &addShort(std::string_view name, int16_t value);
+    Tag &addInt(std::string_view name, int32_t value);
+    Tag &addLong(std::string_view name, int64_t value);
+    Tag &addFloat(std::string_view name, float value);
+    Tag &addDouble(std::string_view name, double value);
+    Tag &addString(std::string_view name, std::string_view value);
+    Tag &addByteArray(std::string_view name, std::span<const int8_t> values);
+    Tag &addIntArray(std::string_view name, std::span<const int32_t> values);
+    Tag &addLongArray(std::string_view name, std::span<const int64_t> values);
+    /**
+     * @brief Zero filled int and long arrays, to be filled in place
+     */
+    Tag &addIntArray(std::string_view name, size_t size);
+    Tag &addLongArray(std::string_view name, size_t size);
+    Tag &addCompound(std::string_view name);
+    Tag &addList(std::string_view name, TagType elementType);
+
+    /**
+     * @brief Remove a child of a compound, its memory is only released with the document
+     *
+     * @return false if there is no child with this name
+     */
+    bool remove(std::string_view name);
+
+private:
+    friend class Document;
+
+    Tag() = default;
+
+    const Tag &_expect(TagType type) const;
+    Tag &_expect(TagType type) { return const_cast<Tag &>(std::as_const(*this)._expect(type)); }
+
+    template<typename T>
+    std::span<T> _array(TagType type)
+    {
+        auto &tag = this->_expect(type);
+        return {static_cast<T *>(tag._data), tag._size};
+    }
+
+    Tag &_addChild(TagType type, std::string_view name);
+    void *_copyArray(const void *data, size_t bytes);
+    void _index(uint32_t position);
+    void _rebuildIndex();
+
+    Document *_document;
+    TagType _type;
+    // Type of the elements of a list
+    TagType _elementType;
+    uint32_t _name;
+    // Number of children or elements of an array
+    uint32_t _size;
+    uint32_t _capacity;
+    uint32_t _indexCapacity;
+    union {
+        int64_t _integer;
+        float _float;
+        double _double;
+        void *_data;
+        Tag **_children;
+    };
+    // Open addressing table of child positions + 1 keyed on the name id, 0 for an empty slot
+    uint32_t *_indexSlots;
+};
+
+static_assert(std::is_trivially_destructible_v<Tag>);
+
+/**
+ * @brief Owner of a tree of tags, its root is a compound
+ *
+ * A document cannot be copied nor moved since its tags point back to it, wrap it in a smart pointer to pass it around.
+ */
+class Document {
+public:
+    explicit Document(std::string_view rootName = "");
+    Document(const Document &) = delete;
+    Document &operator=(const Document &) = delete;
+
+    NODISCARD Tag &getRoot() { return *_root; }
+    NODISCARD const Tag &getRoot() const { return *_root; }
+
+    /**
+     * @brief Copy a tree of nbt::Base tags as a child of parent, a compound or a list of this document
+     */
+    Tag &import(Tag &parent, const nbt::Base &tag);
+
+    /**
+     * @brief Copy a tag of a serialized buffer as a child of parent, the buffer can be released afterwards
+     *
+     * @throw NestingTooDeep if the tag nests more than nbt::TagView::MAX_DEPTH lists and compounds
+     */
+    Tag &import(Tag &parent, const nbt::TagView &tag);
+
+    NODISCARD size_t serializedSize(bool includeName = true) const;
+    void serialize(std::vector<uint8_t> &data, bool includeName = true) const;
+    NODISCARD std::vector<uint8_t> serialize() const;
+
+    NODISCARD const Arena &getArena() const { return _arena; }
+
+private:
+    friend class Tag;
+
+    Tag &_import(Tag &parent, const nbt::TagView &tag, size_t depth);
+    NODISCARD Tag *_newTag(TagType type, uint32_t name);
+    NODISCARD uint32_t _intern(std::string_view name);
+    NODISCARD uint32_t _findName(std::string_view name) const;
+
+    Arena _arena;
+    std::vector<std::string_view> _names;
+    std::unordered_map<std::string_view, uint32_t> _nameIds;
+    Tag *_root;
+};
+
+}
+
+#endif // CUBICSERVER_NBT_ARENA_HPP
@@ -0,0 +1,299 @@
+#include "nbt_reader.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+using nbt::TagType;
+using nbt::TagView;
+
+template<typename T>
+static T readBigEndian(const uint8_t *at)
+{
+    std::make_unsigned_t<T> bits;
+    std::memcpy(&bits, at, sizeof(T));
+    if constexpr (std::endian::native == std::endian::little) {
+        if constexpr (sizeof(T) == 2)
+            bits = __builtin_bswap16(bits);
+        else if constexpr (sizeof(T) == 4)
+            bits = __builtin_bswap32(bits);
+        else if constexpr (sizeof(T) == 8)
+            bits = __builtin_bswap64(bits);
+    }
+    return std::bit_cast<T>(bits);
+}
+
+static void need(const uint8_t *at, const uint8_t *end, size_t size)
+{
+    if (static_cast<size_t>(end - at) < size)
+        throw nbt::BufferEOF("NBT buffer ended in the middle of a tag");
+}
+
+static size_t readLength(const uint8_t *at, const uint8_t *end)
+{
+    need(at, end, 4);
+    auto length = readBigEndian<int32_t>(at);
+    if (length < 0)
+        throw nbt::BufferEOF("Negative NBT length");
+    return length;
+}
+
+// Size of the payload for the types that do not have a variable length, 0 for the others
+static size_t fixedSize(TagType type)
+{
+    switch (type) {
+    case TagType::Byte:
+        return 1;
+    case TagType::Short:
+        return 2;
+    case TagType::Int:
+    case TagType::Float:
+        return 4;
+    case TagType::Long:
+    case TagType::Double:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+static const uint8_t *skipPayload(TagType type, const uint8_t *at, const uint8_t *end, size_t depth = 0)
+{
+    if (auto size = fixedSize(type)) {
+        need(at, end, size);
+        return at + size;
+    }
+
+    switch (type) {
+    case TagType::String: {
+        need(at, end, 2);
+        size_t size = 2 + readBigEndian<uint16_t>(at);
+        need(at, end, size);
+        return at + size;
+    }
+    case TagType::ByteArray:
+    case TagType::IntArray:
+    case TagType::LongArray: {
+        auto elementSize = type == TagType::ByteArray ? 1 : (type == TagType::IntArray ? 4 : 8);
+        auto size = 4 + readLength(at, end) * elementSize;
+        need(at, end, size);
+        return at + size;
+    }
+    case TagType::List: {
+        if (depth >= TagView::MAX_DEPTH)
+            throw nbt::NestingTooDeep("NBT tags are nested too deeply");
+        need(at, end, 1);
+        auto elementType = static_cast<TagType>(*at);
+        auto count = readLength(at + 1, end);
+        at += 5;
+        // Lists of scalars are jumped over in one go
+        if (auto size = fixedSize(elementType)) {
+            need(at, end, count * size);
+            return at + count * size;
+        }
+        for (size_t i = 0; i < count; i++)
+            at = skipPayload(elementType, at, end, depth + 1);
+        return at;
+    }
+    case TagType::Compound:
+        if (depth >= TagView::MAX_DEPTH)
+            throw nbt::NestingTooDeep("NBT tags are nested too deeply");
+        while (true) {
+            need(at, end, 1);
+            auto childType = static_cast<TagType>(*at++);
+            if (childType == TagType::End)
+                return at;
+            need(at, end, 2);
+            size_t nameSize = 2 + readBigEndian<uint16_t>(at);
+            need(at, end, nameSize);
+            at = skipPayload(childType, at + nameSize, end, depth + 1);
+        }
+    default:
+        throw nbt::UnknownType("Unknown NBT tag type " + std::to_string(static_cast<int>(type)));
+    }
+}
+
+TagView TagView::root(std::span<const uint8_t> data)
+{
+    TagView view;
+    const auto *at = data.data();
+    view._end = at + data.size();
+    need(at, view._end, 3);
+    view._type = static_cast<TagType>(at[0]);
+    if (view._type == TagType::End)
+        throw TypeMismatch("The root of an NBT buffer cannot be a TAG_End");
+    view._nameSize = readBigEndian<uint16_t>(at + 1);
+    view._name = at + 3;
+    need(view._name, view._end, view._nameSize);
+    view._payload = view._name + view._nameSize;
+    return view;
+}
+
+int8_t TagView::getByte() const { return this->_scalar<int8_t>(TagType::Byte); }
+
+int16_t TagView::getShort() const { return this->_scalar<int16_t>(TagType::Short); }
+
+int32_t TagView::getInt() const { return this->_scalar<int32_t>(TagType::Int); }
+
+int64_t TagView::getLong() const { return this->_scalar<int64_t>(TagType::Long); }
+
+float TagView::getFloat() const { return std::bit_cast<float>(this->_scalar<int32_t>(TagType::Float)); }
+
+double TagView::getDouble() const { return std::bit_cast<double>(this->_scalar<int64_t>(TagType::Double)); }
+
+std::string_view TagView::getString() const
+{
+    this->_expect(TagType::String);
+    need(_payload, _end, 2);
+    auto size = readBigEndian<uint16_t>(_payload);
+    need(_payload + 2, _end, size);
+    return {reinterpret_cast<const char *>(_payload + 2), size};
+}
+
+std::span<const int8_t> TagView::getByteArray() const
+{
+    this->_expect(TagType::ByteArray);
+    auto size = readLength(_payload, _end);
+    need(_payload + 4, _end, size);
+    return {reinterpret_cast<const int8_t *>(_payload + 4), size};
+}
+
+size_t TagView::size() const
+{
+    switch (_type) {
+    case TagType::ByteArray:
+    case TagType::IntArray:
+    case TagType::LongArray:
+        return readLength(_payload, _end);
+    case TagType::List:
+        need(_payload, _end, 1);
+        return readLength(_payload + 1, _end);
+    default:
+        throw TypeMismatch("Only the arrays and the lists have a size");
+    }
+}
+
+TagType TagView::getElementType() const
+{
+    this->_expect(TagType::List);
+    need(_payload, _end, 1);
+    return static_cast<TagType>(*_payload);
+}
+
+size_t TagView::copyIntArray(std::span<int32_t> out) const { return this->_copyArray(TagType::IntArray, out); }
+
+size_t TagView::copyLongArray(std::span<int64_t> out) const { return this->_copyArray(TagType::LongArray, out); }
+
+std::optional<TagView> TagView::find(std::string_view name) const
+{
+    this->_expect(TagType::Compound);
+    for (const auto &child : *this) {
+        if (child.getName() == name)
+            return child;
+    }
+    return std::nullopt;
+}
+
+std::optional<TagView> TagView::find(std::string_view name, TagType type) const
+{
+    auto child = this->find(name);
+    if (child && child->getType() != type)
+        throw TypeMismatch("NBT tag " + std::string(name) + " does not have the expected type");
+    return child;
+}
+
+TagView::Iterator TagView::begin() const
+{
+    if (_type != TagType::Compound && _type != TagType::List)
+        throw TypeMismatch("Only the compounds and the lists have children");
+    return Iterator(*this);
+}
+
+TagView::Iterator TagView::end() const { return {}; }
+
+const TagView &TagView::_expect(TagType type) const
+{
+    if (_type != type)
+        throw TypeMismatch("Provided type does not match the type of the NBT Tag");
+    return *this;
+}
+
+const uint8_t *TagView::_skip() const { return skipPayload(_type, _payload, _end); }
+
+template<typename T>
+T TagView::_scalar(TagType type) const
+{
+    this->_expect(type);
+    need(_payload, _end, sizeof(T));
+    return readBigEndian<T>(_payload);
+}
+
+template<typename T>
+size_t TagView::_copyArray(TagType type, std::span<T> out) const
+{
+    this->_expect(type);
+    auto count = std::min(readLength(_payload, _end), out.size());
+    const auto *at = _payload + 4;
+    need(at, _end, count * sizeof(T));
+    for (size_t i = 0; i < count; i++)
+        out[i] = readBigEndian<T>(at + i * sizeof(T));
+    return count;
+}
+
+TagView::Iterator::Iterator(const TagView &parent):
+    _end(parent._end)
+{
+    if (parent._type == TagType::Compound) {
+        this->_read(parent._payload);
+        return;
+    }
+    _elementType = parent.getElementType();
+    _remaining = parent.size();
+    if (_elementType == TagType::End && _remaining > 0)
+        throw UnknownType("NBT list of TAG_End with elements");
+    if (_remaining > 0)
+        this->_read(parent._payload + 5);
+}
+
+TagView::Iterator &TagView::Iterator::operator++()
+{
+    const auto *next = _current._skip();
+    if (_elementType != TagType::End && --_remaining == 0)
+        _current = TagView();
+    else
+        this->_read(next);
+    return *this;
+}
+
+TagView::Iterator TagView::Iterator::operator++(int)
+{
+    auto previous = *this;
+    ++*this;
+    return previous;
+}
+
+void TagView::Iterator::_read(const uint8_t *at)
+{
+    // Elements of a list have no header
+    if (_elementType != TagType::End) {
+        _current._payload = at;
+        _current._end = _end;
+        _current._type = _elementType;
+        return;
+    }
+
+    need(at, _end, 1);
+    auto type = static_cast<TagType>(*at);
+    if (type == TagType::End) {
+        _current = TagView();
+        return;
+    }
+    need(at, _end, 3);
+    _current._type = type;
+    _current._end = _end;
+    _current._nameSize = readBigEndian<uint16_t>(at + 1);
+    _current._name = at + 3;
+    need(_current._name, _end, _current._nameSize);
+    _current._payload = _current._name + _current._nameSize;
+}
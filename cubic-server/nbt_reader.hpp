@@ -0,0 +1,134 @@
+#ifndef CUBICSERVER_NBT_READER_HPP
+#define CUBICSERVER_NBT_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "nbt.hpp"
+#include "options.hpp"
+
+namespace nbt {
+
+/**
+ * @brief Read-only view of a tag inside a serialized NBT buffer
+ *
+ * Nothing is allocated nor copied: the names, the strings and the byte arrays point into the buffer, which must outlive the views.
+ * The int and long arrays are stored big endian in the buffer, copyIntArray and copyLongArray swap them while copying them out.
+ *
+ * Finding a child or moving to the next one skips over the payloads in between, so a compound is best read in a single pass.
+ *
+ * @throw BufferEOF if the buffer ends in the middle of a tag
+ * @throw TypeMismatch if a tag is read as another type
+ * @throw NestingTooDeep if a skipped tag nests more than MAX_DEPTH lists and compounds
+ */
+class TagView {
+public:
+    class Iterator;
+
+    // Same limit as vanilla, deeper tags are rejected rather than overflowing the stack
+    static constexpr size_t MAX_DEPTH = 512;
+
+public:
+    /**
+     * @brief View of the named root tag of a buffer
+     */
+    NODISCARD static TagView root(std::span<const uint8_t> data);
+
+    TagView() = default;
+
+    NODISCARD TagType getType() const { return _type; }
+    NODISCARD std::string_view getName() const { return {reinterpret_cast<const char *>(_name), _nameSize}; }
+
+    NODISCARD int8_t getByte() const;
+    NODISCARD int16_t getShort() const;
+    NODISCARD int32_t getInt() const;
+    NODISCARD int64_t getLong() const;
+    NODISCARD float getFloat() const;
+    NODISCARD double getDouble() const;
+    NODISCARD std::string_view getString() const;
+    NODISCARD std::span<const int8_t> getByteArray() const;
+
+    /**
+     * @brief Number of elements of an array or a list
+     */
+    NODISCARD size_t size() const;
+    NODISCARD TagType getElementType() const;
+
+    /**
+     * @brief Convert the elements of an int or long array to the host endianness into out
+     *
+     * @return The number of elements copied, at most out.size()
+     */
+    size_t copyIntArray(std::span<int32_t> out) const;
+    size_t copyLongArray(std::span<int64_t> out) const;
+
+    /**
+     * @brief Find a child of a compound by name
+     */
+    NODISCARD std::optional<TagView> find(std::string_view name) const;
+
+    /**
+     * @brief Find a child of a compound, checking its type
+     *
+     * @throw TypeMismatch if the child exists with another type
+     */
+    NODISCARD std::optional<TagView> find(std::string_view name, TagType type) const;
+
+    /**
+     * @brief Children of a compound or elements of a list
+     */
+    NODISCARD Iterator begin() const;
+    NODISCARD Iterator end() const;
+
+private:
+    const TagView &_expect(TagType type) const;
+    NODISCARD const uint8_t *_skip() const;
+    template<typename T>
+    NODISCARD T _scalar(TagType type) const;
+    template<typename T>
+    size_t _copyArray(TagType type, std::span<T> out) const;
+
+    const uint8_t *_payload = nullptr;
+    const uint8_t *_end = nullptr;
+    const uint8_t *_name = nullptr;
+    uint16_t _nameSize = 0;
+    TagType _type = TagType::End;
+};
+
+class TagView::Iterator {
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef TagView value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const TagView *pointer;
+    typedef const TagView &reference;
+
+public:
+    Iterator() = default;
+
+    reference operator*() const { return _current; }
+    pointer operator->() const { return &_current; }
+    Iterator &operator++();
+    Iterator operator++(int);
+    bool operator==(const Iterator &other) const { return _current._payload == other._current._payload; }
+
+private:
+    friend class TagView;
+
+    Iterator(const TagView &parent);
+    void _read(const uint8_t *at);
+
+    TagView _current;
+    const uint8_t *_end = nullptr;
+    // End for the children of a compound
+    TagType _elementType = TagType::End;
+    int32_t _remaining = 0;
+};
+
+}
+
+#endif // CUBICSERVER_NBT_READER_HPP
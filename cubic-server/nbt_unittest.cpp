@@ -1,4 +1,7 @@
 #include "nbt.hpp"
+#include "nbt_arena.hpp"
+#include "nbt_reader.hpp"
+#include "nbt_writer.hpp"
 #include <fstream>
 #include <gtest/gtest.h>
 #include <rapidcheck/gtest.h>
@@ -140,4 +143,239 @@ TEST(NbtTest, bigtest)
     EXPECT_EQ(result.size(), buffer.size());
     EXPECT_EQ(result, buffer);
 }
+
+RC_GTEST_PROP(RapidCheckTest, NbtArenaLongArrayChecker, (const std::vector<int64_t> value))
+{
+    nbt::arena::Document document("test");
+    document.getRoot().addLongArray("values", value);
+    auto expected = nbt::Compound("test", {std::make_shared<nbt::LongArray>("values", value)});
+    RC_ASSERT(expected.serialize() == document.serialize());
+}
+
+TEST(NbtArenaTest, TestNbt)
+{
+    nbt::arena::Document document("hello world");
+    document.getRoot().addString("name", "Bananrama");
+
+    std::vector<uint8_t> toGet({0x0a, 0x00, 0x0b, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x08, 0x00, 0x04,
+                                0x6e, 0x61, 0x6d, 0x65, 0x00, 0x09, 0x42, 0x61, 0x6e, 0x61, 0x6e, 0x72, 0x61, 0x6d, 0x61, 0x00});
+    EXPECT_EQ(document.serializedSize(), toGet.size());
+    EXPECT_EQ(document.serialize(), toGet);
+}
+
+TEST(NbtArenaTest, Lookup)
+{
+    nbt::arena::Document document;
+    auto &root = document.getRoot();
+    // Enough children for the compound to be indexed
+    for (int i = 0; i < 100; i++)
+        root.addInt("int" + std::to_string(i), i);
+    auto &list = root.addList("list", nbt::TagType::Short);
+    list.addShort("", 42);
+
+    for (int i = 0; i < 100; i++) {
+        auto *tag = root.find("int" + std::to_string(i));
+        ASSERT_NE(tag, nullptr);
+        EXPECT_EQ(tag->getInt(), i);
+    }
+    EXPECT_EQ(root.find("missing"), nullptr);
+    EXPECT_EQ(root.find("list", nbt::TagType::List)->at(0).getShort(), 42);
+    EXPECT_THROW((void) root.find("int0", nbt::TagType::Long), nbt::TypeMismatch);
+    EXPECT_THROW((void) root.find("int0")->getLong(), nbt::TypeMismatch);
+    EXPECT_THROW(list.addInt("", 0), nbt::TypeMismatch);
+}
+
+TEST(NbtArenaTest, bigtest)
+{
+    std::ifstream file("bigtest.nbt", std::ios::binary);
+    ASSERT_TRUE(testing::AssertionResult(file.is_open() ? testing::AssertionSuccess() : testing::AssertionFailure()) << "Failed to open file");
+    std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(file), {});
+    auto at = buffer.data();
+    auto content = std::dynamic_pointer_cast<nbt::Compound>(nbt::parse(at, at + buffer.size() - 1));
+    ASSERT_TRUE(testing::AssertionResult(content == nullptr ? testing::AssertionFailure() : testing::AssertionSuccess()) << "Failed to parse file");
+
+    nbt::arena::Document document(content->getName());
+    for (const auto &value : content->getValues())
+        document.import(document.getRoot(), *value);
+    auto result = document.serialize();
+    EXPECT_EQ(result.size(), buffer.size());
+    EXPECT_EQ(result, buffer);
+}
+
+TEST(NbtArenaTest, ImportView)
+{
+    std::ifstream file("bigtest.nbt", std::ios::binary);
+    ASSERT_TRUE(testing::AssertionResult(file.is_open() ? testing::AssertionSuccess() : testing::AssertionFailure()) << "Failed to open file");
+    std::vector<uint8_t> buffer(std::istreambuf_iterator<char>(file), {});
+    const auto root = nbt::TagView::root(buffer);
+
+    nbt::arena::Document document(root.getName());
+    for (const auto &child : root)
+        document.import(document.getRoot(), child);
+    EXPECT_EQ(document.serialize(), buffer);
+}
+
+TEST(NbtArenaTest, Remove)
+{
+    nbt::arena::Document document;
+    auto &root = document.getRoot();
+    for (int i = 0; i < 20; i++)
+        root.addInt("int" + std::to_string(i), i);
+
+    EXPECT_TRUE(root.remove("int3"));
+    EXPECT_FALSE(root.remove("int3"));
+    EXPECT_EQ(root.size(), 19);
+    EXPECT_EQ(root.find("int3"), nullptr);
+    EXPECT_EQ(root.find("int4")->getInt(), 4);
+    root.addString("int3", "replaced");
+    EXPECT_EQ(root.find("int3")->getString(), "replaced");
+}
+
+RC_GTEST_PROP(RapidCheckTest, NbtWriterLongArrayChecker, (const std::vector<int64_t> value))
+{
+    std::vector<uint8_t> data;
+    nbt::Writer writer(data);
+    writer.beginCompound("test").writeLongArray("values", value).endCompound();
+    auto expected = nbt::Compound("test", {std::make_shared<nbt::LongArray>("values", value)});
+    RC_ASSERT(expected.serialize() == data);
+}
+
+TEST(NbtWriterTest, TestNbt)
+{
+    std::vector<uint8_t> data;
+    nbt::Writer writer(data);
+    writer.beginCompound("hello world").writeString("name", "Bananrama").endCompound();
+
+    std::vector<uint8_t> toGet({0x0a, 0x00, 0x0b, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x08, 0x00, 0x04,
+                                0x6e, 0x61, 0x6d, 0x65, 0x00, 0x09, 0x42, 0x61, 0x6e, 0x61, 0x6e, 0x72, 0x61, 0x6d, 0x61, 0x00});
+    EXPECT_TRUE(writer.isComplete());
+    EXPECT_EQ(data, toGet);
+}
+
+TEST(NbtWriterTest, Lists)
+{
+    std::vector<uint8_t> data;
+    nbt::Writer writer(data);
+    writer.beginCompound("").beginList("list", nbt::TagType::Short).writeShort("", 42);
+    EXPECT_THROW(writer.writeInt("", 0), nbt::TypeMismatch);
+    EXPECT_THROW(writer.endCompound(), nbt::TypeMismatch);
+    writer.endList().beginList("empty", nbt::TagType::Int).endList().endCompound();
+    EXPECT_TRUE(writer.isComplete());
+
+    // clang-format off
+    std::vector<uint8_t> toGet({
+        0x0a, 0x00, 0x00,
+        0x09, 0x00, 0x04, 'l', 'i', 's', 't', 0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x2a,
+        0x09, 0x00, 0x05, 'e', 'm', 'p', 't', 'y', 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00
+    });
+    // clang-format on
+    EXPECT_EQ(data, toGet);
+}
+
+RC_GTEST_PROP(RapidCheckTest, NbtReaderLongArrayChecker, (const std::vector<int64_t> value))
+{
+    std::vector<uint8_t> data;
+    nbt::Writer writer(data);
+    writer.beginCompound("test").writeLongArray("values", value).endCompound();
+    auto values = nbt::TagView::root(data).find("values", nbt::TagType::LongArray);
+    RC_ASSERT(values);
+    std::vector<int64_t> result(values->size());
+    RC_ASSERT(values->copyLongArray(result) == value.size());
+    RC_ASSERT(result == value);
+}
+
+static std::vector<uint8_t> makeReaderChunk()
+{
+    std::vector<uint8_t> data;
+    nbt::Writer writer(data);
+    std::vector<int64_t> longs({1, -2, 0x0102030405060708});
+    std::vector<int8_t> bytes({1, 2, 3});
+
+    writer.beginCompound("").writeString("Status", "full").beginList("sections", nbt::TagType::Compound);
+    for (int y = -4; y < 2; y++) {
+        writer.beginCompound("").writeByte("Y", y).beginCompound("block_states");
+        writer.beginList("palette", nbt::TagType::Compound).beginCompound("").writeString("Name", "minecraft:stone").endCompound().endList();
+        writer.writeLongArray("data", longs).endCompound().writeByteArray("SkyLight", bytes).endCompound();
+    }
+    writer.endList().beginList("scalars", nbt::TagType::Double).writeDouble("", 1.5).writeDouble("", 2.5).endList();
+    writer.writeFloat("f", 0.25f).writeShort("s", -3).endCompound();
+    return data;
+}
+
+TEST(NbtReaderTest, Walk)
+{
+    auto data = makeReaderChunk();
+    auto root = nbt::TagView::root(data);
+
+    EXPECT_EQ(root.find("Status", nbt::TagType::String)->getString(), "full");
+    EXPECT_EQ(root.find("f")->getFloat(), 0.25f);
+    EXPECT_EQ(root.find("s")->getShort(), -3);
+    EXPECT_FALSE(root.find("missing"));
+    EXPECT_THROW((void) root.find("Status", nbt::TagType::Int), nbt::TypeMismatch);
+
+    auto sections = root.find("sections", nbt::TagType::List);
+    ASSERT_TRUE(sections);
+    EXPECT_EQ(sections->size(), 6);
+    int y = -4;
+    for (const auto &section : *sections) {
+        EXPECT_EQ(section.find("Y")->getByte(), y++);
+        auto blockStates = section.find("block_states");
+        std::vector<int64_t> values(3);
+        EXPECT_EQ(blockStates->find("data")->copyLongArray(values), 3);
+        EXPECT_EQ(values, std::vector<int64_t>({1, -2, 0x0102030405060708}));
+        auto palette = blockStates->find("palette");
+        for (const auto &block : *palette)
+            EXPECT_EQ(block.find("Name")->getString(), "minecraft:stone");
+        EXPECT_EQ(section.find("SkyLight")->getByteArray().size(), 3);
+    }
+    EXPECT_EQ(y, 2);
+
+    std::vector<double> scalars;
+    auto scalarList = root.find("scalars");
+    for (const auto &value : *scalarList)
+        scalars.push_back(value.getDouble());
+    EXPECT_EQ(scalars, std::vector<double>({1.5, 2.5}));
+}
+
+TEST(NbtReaderTest, Truncated)
+{
+    auto data = makeReaderChunk();
+    for (size_t size = 0; size < data.size() - 1; size++) {
+        std::vector<uint8_t> part(data.begin(), data.begin() + size);
+        EXPECT_ANY_THROW({
+            auto root = nbt::TagView::root(part);
+            (void) root.find("missing");
+        });
+    }
+}
+
+TEST(NbtReaderTest, TruncatedList)
+{
+    // A named list without its element type nor its size
+    std::vector<uint8_t> data = {static_cast<uint8_t>(nbt::TagType::List), 0, 0};
+    auto root = nbt::TagView::root(data);
+    EXPECT_THROW((void) root.size(), nbt::BufferEOF);
+}
+
+// Compounds nested depth times, each holding the next one as "a"
+static std::vector<uint8_t> makeNested(size_t depth)
+{
+    std::vector<uint8_t> data = {static_cast<uint8_t>(nbt::TagType::Compound), 0, 0};
+    for (size_t i = 0; i < depth; i++)
+        data.insert(data.end(), {static_cast<uint8_t>(nbt::TagType::Compound), 0, 1, 'a'});
+    data.insert(data.end(), depth + 1, static_cast<uint8_t>(nbt::TagType::End));
+    return data;
+}
+
+TEST(NbtReaderTest, MaxDepth)
+{
+    auto data = makeNested(nbt::TagView::MAX_DEPTH);
+    EXPECT_FALSE(nbt::TagView::root(data).find("missing"));
+
+    data = makeNested(nbt::TagView::MAX_DEPTH + 2);
+    EXPECT_THROW((void) nbt::TagView::root(data).find("missing"), nbt::NestingTooDeep);
+    nbt::arena::Document document("");
+    EXPECT_THROW(document.import(document.getRoot(), nbt::TagView::root(data)), nbt::NestingTooDeep);
+}
 }
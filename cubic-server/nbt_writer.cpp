@@ -0,0 +1,177 @@
+#include "nbt_writer.hpp"
+
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+using nbt::TagType;
+using nbt::Writer;
+
+template<typename T>
+static void writeBigEndian(uint8_t *at, T value)
+{
+    auto bits = std::bit_cast<std::make_unsigned_t<T>>(value);
+    for (int i = sizeof(T) - 1; i >= 0; i--)
+        *at++ = (bits >> (i * 8)) & 0xFF;
+}
+
+Writer::Writer(std::vector<uint8_t> &out):
+    _out(out)
+{
+}
+
+Writer &Writer::beginCompound(std::string_view name)
+{
+    this->_header(TagType::Compound, name);
+    _frames.push_back({TagType::End, 0, 0});
+    return *this;
+}
+
+Writer &Writer::endCompound()
+{
+    if (_frames.empty() || _frames.back().elementType != TagType::End)
+        throw TypeMismatch("nbt::Writer::endCompound called outside of a compound");
+    _frames.pop_back();
+    _out.push_back(static_cast<uint8_t>(TagType::End));
+    return *this;
+}
+
+Writer &Writer::beginList(std::string_view name, TagType elementType)
+{
+    if (elementType == TagType::End)
+        throw TypeMismatch("nbt::Writer::beginList needs the type of the elements");
+    this->_header(TagType::List, name);
+    _frames.push_back({elementType, _out.size(), 0});
+    _out.push_back(static_cast<uint8_t>(elementType));
+    // Patched by endList
+    _out.resize(_out.size() + 4);
+    return *this;
+}
+
+Writer &Writer::endList()
+{
+    if (_frames.empty() || _frames.back().elementType == TagType::End)
+        throw TypeMismatch("nbt::Writer::endList called outside of a list");
+    auto frame = _frames.back();
+    _frames.pop_back();
+    // Empty lists are written as lists of TAG_End like vanilla does
+    if (frame.count == 0)
+        _out[frame.listOffset] = static_cast<uint8_t>(TagType::End);
+    writeBigEndian(_out.data() + frame.listOffset + 1, frame.count);
+    return *this;
+}
+
+Writer &Writer::writeByte(std::string_view name, int8_t value)
+{
+    this->_header(TagType::Byte, name);
+    _out.push_back(value);
+    return *this;
+}
+
+Writer &Writer::writeShort(std::string_view name, int16_t value)
+{
+    this->_header(TagType::Short, name);
+    this->_bigEndian(value);
+    return *this;
+}
+
+Writer &Writer::writeInt(std::string_view name, int32_t value)
+{
+    this->_header(TagType::Int, name);
+    this->_bigEndian(value);
+    return *this;
+}
+
+Writer &Writer::writeLong(std::string_view name, int64_t value)
+{
+    this->_header(TagType::Long, name);
+    this->_bigEndian(value);
+    return *this;
+}
+
+Writer &Writer::writeFloat(std::string_view name, float value)
+{
+    this->_header(TagType::Float, name);
+    this->_bigEndian(std::bit_cast<int32_t>(value));
+    return *this;
+}
+
+Writer &Writer::writeDouble(std::string_view name, double value)
+{
+    this->_header(TagType::Double, name);
+    this->_bigEndian(std::bit_cast<int64_t>(value));
+    return *this;
+}
+
+Writer &Writer::writeString(std::string_view name, std::string_view value)
+{
+    this->_header(TagType::String, name);
+    this->_string(value);
+    return *this;
+}
+
+Writer &Writer::writeByteArray(std::string_view name, std::span<const int8_t> values)
+{
+    this->_header(TagType::ByteArray, name);
+    this->_array(values);
+    return *this;
+}
+
+Writer &Writer::writeIntArray(std::string_view name, std::span<const int32_t> values)
+{
+    this->_header(TagType::IntArray, name);
+    this->_array(values);
+    return *this;
+}
+
+Writer &Writer::writeLongArray(std::string_view name, std::span<const int64_t> values)
+{
+    this->_header(TagType::LongArray, name);
+    this->_array(values);
+    return *this;
+}
+
+void Writer::_header(TagType type, std::string_view name)
+{
+    if (!_frames.empty() && _frames.back().elementType != TagType::End) {
+        auto &list = _frames.back();
+        if (list.elementType != type)
+            throw TypeMismatch("nbt::Writer cannot add this type to the current list");
+        list.count++;
+        return;
+    }
+    _out.push_back(static_cast<uint8_t>(type));
+    this->_string(name);
+}
+
+void Writer::_string(std::string_view value)
+{
+    this->_bigEndian<uint16_t>(value.size());
+    _out.insert(_out.end(), value.begin(), value.end());
+}
+
+template<typename T>
+void Writer::_bigEndian(T value)
+{
+    auto offset = _out.size();
+    _out.resize(offset + sizeof(T));
+    writeBigEndian(_out.data() + offset, value);
+}
+
+template<typename T>
+void Writer::_array(std::span<const T> values)
+{
+    this->_bigEndian<int32_t>(values.size());
+    // Grown once, then every element is swapped in place
+    auto offset = _out.size();
+    _out.resize(offset + values.size_bytes());
+    auto *at = _out.data() + offset;
+    if constexpr (sizeof(T) == 1)
+        std::memcpy(at, values.data(), values.size());
+    else {
+        for (auto value : values) {
+            writeBigEndian(at, value);
+            at += sizeof(T);
+        }
+    }
+}
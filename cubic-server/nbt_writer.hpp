@@ -0,0 +1,77 @@
+#ifndef CUBICSERVER_NBT_WRITER_HPP
+#define CUBICSERVER_NBT_WRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "nbt.hpp"
+#include "options.hpp"
+
+namespace nbt {
+
+/**
+ * @brief Streaming NBT serializer writing the tags straight at the end of a buffer
+ *
+ * The tree is described by a sequence of calls instead of being built first:
+ * @code
+ * nbt::Writer writer(out);
+ * writer.beginCompound("");
+ * writer.writeLongArray("WORLD_SURFACE", values);
+ * writer.endCompound();
+ * @endcode
+ * Inside a list the names are ignored and every element must have the type given to beginList,
+ * the number of elements is patched in when the list is ended.
+ */
+class Writer {
+public:
+    explicit Writer(std::vector<uint8_t> &out);
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    Writer &beginCompound(std::string_view name);
+    Writer &endCompound();
+    Writer &beginList(std::string_view name, TagType elementType);
+    Writer &endList();
+
+    Writer &writeByte(std::string_view name, int8_t value);
+    Writer &writeShort(std::string_view name, int16_t value);
+    Writer &writeInt(std::string_view name, int32_t value);
+    Writer &writeLong(std::string_view name, int64_t value);
+    Writer &writeFloat(std::string_view name, float value);
+    Writer &writeDouble(std::string_view name, double value);
+    Writer &writeString(std::string_view name, std::string_view value);
+    Writer &writeByteArray(std::string_view name, std::span<const int8_t> values);
+    Writer &writeIntArray(std::string_view name, std::span<const int32_t> values);
+    Writer &writeLongArray(std::string_view name, std::span<const int64_t> values);
+
+    /**
+     * @brief Whether every compound and list that was begun has been ended
+     */
+    NODISCARD bool isComplete() const { return _frames.empty(); }
+
+private:
+    struct Frame {
+        // End for a compound
+        TagType elementType;
+        // Offset of the element type of a list in the buffer
+        size_t listOffset;
+        int32_t count;
+    };
+
+    void _header(TagType type, std::string_view name);
+    void _string(std::string_view value);
+    template<typename T>
+    void _bigEndian(T value);
+    template<typename T>
+    void _array(std::span<const T> values);
+
+    std::vector<uint8_t> &_out;
+    std::vector<Frame> _frames;
+};
+
+}
+
+#endif // CUBICSERVER_NBT_WRITER_HPP
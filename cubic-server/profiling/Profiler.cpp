@@ -0,0 +1,149 @@
+#include "Profiler.hpp"
+
+#include "logging/logging.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char *name;
+    profiling::Clock::time_point start;
+    profiling::Clock::duration duration;
+};
+
+struct ThreadBuffer {
+    size_t id;
+    std::mutex mutex;
+    std::vector<Event> events; // Only allocated during a capture
+    size_t next = 0;
+    bool wrapped = false;
+    bool exited = false;
+};
+
+std::mutex buffersMutex;
+// Kept alive after their thread exits so its events still end up in the trace, then dropped by stop
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+size_t nextBufferId = 0;
+
+// Flags the buffer once its thread exits
+struct ThreadBufferOwner {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ~ThreadBufferOwner()
+    {
+        std::lock_guard _(buffersMutex);
+        buffer->exited = true;
+    }
+};
+
+ThreadBuffer &getThreadBuffer()
+{
+    thread_local ThreadBufferOwner owner = [] {
+        auto newBuffer = std::make_shared<ThreadBuffer>();
+
+        std::lock_guard _(buffersMutex);
+        newBuffer->id = nextBufferId++;
+        buffers.push_back(newBuffer);
+        return ThreadBufferOwner {newBuffer};
+    }();
+    return *owner.buffer;
+}
+
+// Nothing is held between two captures, called with buffersMutex locked
+void releaseBuffers()
+{
+    for (auto &buffer : buffers) {
+        std::lock_guard _(buffer->mutex);
+        buffer->events = std::vector<Event>();
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+    std::erase_if(buffers, [](const auto &buffer) {
+        return buffer->exited;
+    });
+}
+
+} // namespace
+
+profiling::Profiler &profiling::Profiler::getInstance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void profiling::Profiler::start()
+{
+    std::lock_guard _(buffersMutex);
+    for (auto &buffer : buffers) {
+        std::lock_guard bufferLock(buffer->mutex);
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+    _startTime = Clock::now();
+    _running = true;
+}
+
+void profiling::Profiler::record(const char *name, Clock::time_point start, Clock::time_point end)
+{
+    auto &buffer = getThreadBuffer();
+
+    // Only contended while the trace is being written
+    std::lock_guard _(buffer.mutex);
+    if (buffer.events.empty()) {
+        // A zone that ends once the trace is written is dropped rather than allocating again
+        if (!this->isRunning())
+            return;
+        buffer.events.resize(EVENTS_PER_THREAD);
+    }
+    buffer.events[buffer.next] = {name, start, end - start};
+    buffer.next++;
+    if (buffer.next == buffer.events.size()) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+size_t profiling::Profiler::stop(const std::string &path)
+{
+    _running = false;
+
+    auto parent = std::filesystem::path(path).parent_path();
+    std::error_code error;
+    if (!parent.empty())
+        std::filesystem::create_directories(parent, error);
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LERROR("Could not open {} to write the profile", path);
+        std::lock_guard _(buffersMutex);
+        releaseBuffers();
+        return 0;
+    }
+
+    size_t count = 0;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    std::lock_guard _(buffersMutex);
+    for (auto &buffer : buffers) {
+        std::lock_guard bufferLock(buffer->mutex);
+        size_t first = buffer->wrapped ? buffer->next : 0;
+        size_t size = buffer->wrapped ? buffer->events.size() : buffer->next;
+
+        for (size_t i = 0; i < size; i++) {
+            const auto &event = buffer->events[(first + i) % buffer->events.size()];
+            if (event.start < _startTime)
+                continue;
+            file << (count++ == 0 ? "" : ",")
+                 << fmt::format(
+                        "{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}", event.name, buffer->id,
+                        std::chrono::duration<double, std::micro>(event.start - _startTime).count(), std::chrono::duration<double, std::micro>(event.duration).count()
+                    );
+        }
+    }
+    file << "]}" << std::endl;
+    releaseBuffers();
+    return count;
+}
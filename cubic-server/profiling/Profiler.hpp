@@ -0,0 +1,86 @@
+#ifndef CUBICSERVER_PROFILING_PROFILER_HPP
+#define CUBICSERVER_PROFILING_PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "options.hpp"
+
+namespace profiling {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Records the zones entered while it is running and dumps them as a Chrome trace
+ *
+ * Every thread writes in its own ring buffer, only the last EVENTS_PER_THREAD zones of each thread are kept.
+ * The buffers are allocated on the first zone of a thread during a capture and released once the trace is written.
+ * The trace can be opened with chrome://tracing, https://ui.perfetto.dev or https://www.speedscope.app
+ */
+class Profiler {
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    static Profiler &getInstance();
+
+    /**
+     * @brief Drop the events of the previous run and start recording
+     */
+    void start();
+
+    /**
+     * @brief Stop recording and write the trace
+     *
+     * @param path Path of the trace file
+     * @return size_t Number of events written
+     */
+    size_t stop(const std::string &path);
+
+    NODISCARD inline bool isRunning() const { return _running.load(std::memory_order_relaxed); }
+
+    void record(const char *name, Clock::time_point start, Clock::time_point end);
+
+private:
+    Profiler() = default;
+
+    std::atomic<bool> _running = false;
+    Clock::time_point _startTime;
+};
+
+/**
+ * @brief Measures the scope it lives in, costs a single relaxed load when the profiler is not running
+ */
+class Zone {
+public:
+    explicit Zone(const char *name):
+        _name(name),
+        _active(Profiler::getInstance().isRunning())
+    {
+        if (_active)
+            _start = Clock::now();
+    }
+
+    ~Zone()
+    {
+        if (_active)
+            Profiler::getInstance().record(_name, _start, Clock::now());
+    }
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+private:
+    const char *_name;
+    bool _active;
+    Clock::time_point _start;
+};
+
+} // namespace profiling
+
+#define PROFILING_CONCAT_IMPL(a, b) a##b
+#define PROFILING_CONCAT(a, b) PROFILING_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) profiling::Zone PROFILING_CONCAT(_profilingZone, __LINE__)(name)
+
+#endif // CUBICSERVER_PROFILING_PROFILER_HPP
@@ -364,6 +364,21 @@ std::unique_ptr<std::vector<uint8_t>> protocol::createChunkDataAndLightUpdate(co
 {
     std::vector<uint8_t> payload;
 
+    // Untouched flat chunks share the payload encoded once by their template
+    if (const auto encodedData = in.data.getEncodedData()) {
+        payload.reserve(2 * sizeof(int32_t) + encodedData->size());
+        // clang-format off
+        serialize(payload,
+            in.chunkX, addInt,
+            in.chunkZ, addInt
+        );
+        // clang-format on
+        payload.insert(payload.end(), encodedData->begin(), encodedData->end());
+        auto packet = std::make_unique<std::vector<uint8_t>>();
+        finalize(*packet, payload, ClientPacketID::ChunkDataAndLightUpdate);
+        return packet;
+    }
+
     // clang-format off
     serialize(payload,
         in.chunkX, addInt,
@@ -413,7 +428,7 @@ std::unique_ptr<std::vector<uint8_t>> protocol::createLoginPlay(const LoginPlay
         in.gamemode, addByte,
         in.previousGamemode, addByte,
         in.dimensionNames, addArray<std::string, addString>,
-        *in.registryCodec, addNBT<nbt::Compound>,
+        in.registryCodec, addRawBytes,
         in.dimensionType, addString,
         in.dimensionName, addString,
         in.hashedSeed, addLong,
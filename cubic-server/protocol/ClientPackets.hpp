@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -464,7 +465,8 @@ struct LoginPlay {
     player_attributes::Gamemode gamemode;
     player_attributes::Gamemode previousGamemode; // must be a signed byte
     std::vector<std::string> dimensionNames;
-    std::shared_ptr<nbt::Compound> registryCodec;
+    // Serialized NBT compound
+    std::span<const uint8_t> registryCodec;
     std::string dimensionType;
     std::string dimensionName;
     long hashedSeed;
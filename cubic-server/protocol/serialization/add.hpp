@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "addPrimaryType.hpp"
+#include "nbt_writer.hpp"
 #include "protocol/ClientPackets.hpp"
 #include "protocol/container/Container.hpp"
 #include "world_storage/ChunkColumn.hpp"
@@ -116,10 +117,14 @@ constexpr void addLight(std::vector<uint8_t> &out, const world_storage::ChunkCol
 }
 
 // https://wiki.vg/Chunk_Format#Serializing
-constexpr void addChunkColumn(std::vector<uint8_t> &out, const world_storage::ChunkColumn &data)
+inline void addChunkColumn(std::vector<uint8_t> &out, const world_storage::ChunkColumn &data)
 {
     // Heightmap
-    addNBT<nbt::Compound>(out, data.getHeightMap());
+    nbt::Writer heightMaps(out);
+    heightMaps.beginCompound("");
+    for (size_t i = 0; i < world_storage::HEIGHTMAP_ENTRY.size(); i++)
+        heightMaps.writeLongArray(world_storage::HEIGHTMAP_ENTRY[i], data.getHeightMaps()[i]);
+    heightMaps.endCompound();
 
     // Chunk sections
     std::vector<uint8_t> chunkData;
@@ -8,6 +8,7 @@
 #define CUBICSERVER_PROTOCOL_SERIALIZATION_ADDPRIMARYTYPE_HPP
 
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -161,6 +162,9 @@ constexpr void addNBT(std::vector<uint8_t> &out, const T &data)
     data.serialize(out);
 }
 
+// Data that is already serialized, like an NBT tag written with nbt::Writer
+constexpr void addRawBytes(std::vector<uint8_t> &out, const std::span<const uint8_t> &data) { out.insert(out.end(), data.begin(), data.end()); }
+
 constexpr void addIdentifier(std::vector<uint8_t> &out, const std::string &data) { addString(out, data); }
 
 constexpr void addUUID(std::vector<uint8_t> &out, const u128 &data)
@@ -1,13 +1,17 @@
 #include "blockStates.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <mutex>
 #include <type_traits>
 
 #include <nlohmann/json.hpp>
 
 #include "logging/logging.hpp"
+#include "nbt_reader.hpp"
+#include "nbt_writer.hpp"
 #include "types.hpp"
 
 void Blocks::GlobalPalette::initialize(const std::string &path)
@@ -17,6 +21,7 @@ void Blocks::GlobalPalette::initialize(const std::string &path)
         return;
     }
     nlohmann::json file = nlohmann::json::parse(std::ifstream(path));
+    this->_blocks.clear();
     for (auto block : file.items()) {
         Blocks::InternalBlock b;
         b.name = block.key();
@@ -28,6 +33,7 @@ void Blocks::GlobalPalette::initialize(const std::string &path)
                 Blocks::InternalProperty p;
                 p.name = property.key();
                 p.baseWeight = weight;
+                p.defaultValue = 0;
                 for (auto value : property.value())
                     p.values.push_back(value);
                 maxThingy += weight * (p.values.size() - 1);
@@ -44,94 +50,206 @@ void Blocks::GlobalPalette::initialize(const std::string &path)
         });
         if (defaultState == block.value()["states"].end()) {
             LERROR("Default state not found for block {}", block.key());
-            return;
+            break;
         }
+        b.defaultProtocolId = defaultState.value()["id"];
         if (defaultState.value().contains("properties")) {
             for (auto property : defaultState.value()["properties"].items())
                 b.defaultProperties.push_back({property.key(), property.value()});
         }
+        for (auto &p : b.properties) {
+            for (const auto &[name, value] : b.defaultProperties) {
+                if (name == p.name)
+                    p.defaultValue = std::find(p.values.begin(), p.values.end(), value) - p.values.begin();
+            }
+        }
         this->_blocks.push_back(b);
     }
+    this->_buildIndex();
 }
 
-BlockId Blocks::GlobalPalette::fromBlockToProtocolId(const std::string &blockName) const
+void Blocks::GlobalPalette::save(nbt::Writer &writer) const
 {
-    Blocks::Block block = {blockName, {}};
-
-    auto internalBlock = std::find_if(this->_blocks.begin(), this->_blocks.end(), [&block](const Blocks::InternalBlock &b) {
-        return b.name == block.name;
-    });
+    writer.beginList("blocks", nbt::TagType::Compound);
+    for (const auto &b : _blocks) {
+        writer.beginCompound("")
+            .writeString("Name", b.name)
+            .writeShort("DefaultId", b.defaultProtocolId)
+            .writeShort("BaseId", b.baseProtocolId)
+            .writeShort("MaxId", b.maxProtocolId)
+            .beginList("Properties", nbt::TagType::Compound);
+        for (const auto &p : b.properties) {
+            writer.beginCompound("").writeString("Name", p.name).writeShort("Weight", p.baseWeight).writeShort("Default", p.defaultValue);
+            writer.beginList("Values", nbt::TagType::String);
+            for (const auto &value : p.values)
+                writer.writeString("", value);
+            writer.endList().endCompound();
+        }
+        writer.endList().beginCompound("DefaultProperties");
+        for (const auto &[name, value] : b.defaultProperties)
+            writer.writeString(name, value);
+        writer.endCompound().endCompound();
+    }
+    writer.endList();
+}
 
-    if (internalBlock == this->_blocks.end())
-        return 0;
+void Blocks::GlobalPalette::load(const nbt::TagView &blocks)
+{
+    // Nothing is replaced if the snapshot turns out to be corrupted halfway
+    std::vector<InternalBlock> loaded;
+    loaded.reserve(blocks.size());
+    for (const auto &block : blocks) {
+        Blocks::InternalBlock b;
+        for (const auto &tag : block) {
+            if (tag.getName() == "Name")
+                b.name = tag.getString();
+            else if (tag.getName() == "DefaultId")
+                b.defaultProtocolId = tag.getShort();
+            else if (tag.getName() == "BaseId")
+                b.baseProtocolId = tag.getShort();
+            else if (tag.getName() == "MaxId")
+                b.maxProtocolId = tag.getShort();
+            else if (tag.getName() == "Properties") {
+                for (const auto &property : tag) {
+                    Blocks::InternalProperty p;
+                    p.name = property.find("Name", nbt::TagType::String).value().getString();
+                    p.baseWeight = property.find("Weight", nbt::TagType::Short).value().getShort();
+                    p.defaultValue = property.find("Default", nbt::TagType::Short).value().getShort();
+                    auto values = property.find("Values", nbt::TagType::List).value();
+                    for (const auto &value : values)
+                        p.values.emplace_back(value.getString());
+                    b.properties.push_back(std::move(p));
+                }
+            } else if (tag.getName() == "DefaultProperties") {
+                for (const auto &property : tag)
+                    b.defaultProperties.push_back({std::string(property.getName()), std::string(property.getString())});
+            }
+        }
+        loaded.push_back(std::move(b));
+    }
+    this->_blocks = std::move(loaded);
+    this->_buildIndex();
+}
 
-    for (auto property : internalBlock->defaultProperties)
-        block.properties.push_back({property.first, property.second});
+void Blocks::GlobalPalette::_buildIndex()
+{
+    // The keys of _nameIndex point into _blocks, which is not modified anymore
+    _nameIndex.clear();
+    _nameIndex.reserve(_blocks.size());
+    _protocolIdIndex.clear();
+    for (uint16_t i = 0; i < _blocks.size(); i++) {
+        const auto &b = _blocks[i];
+        _nameIndex.emplace(b.name, i);
+        if (_protocolIdIndex.size() <= b.maxProtocolId)
+            _protocolIdIndex.resize(b.maxProtocolId + 1, 0);
+        std::fill(_protocolIdIndex.begin() + b.baseProtocolId, _protocolIdIndex.begin() + b.maxProtocolId + 1, i);
+    }
+    std::unique_lock<std::shared_mutex> lock(_stateCacheMutex);
+    _stateCache.clear();
+}
 
-    return this->fromBlockToProtocolId(block);
+const Blocks::InternalBlock *Blocks::GlobalPalette::_findBlock(std::string_view name) const
+{
+    auto it = _nameIndex.find(name);
+    if (it == _nameIndex.end())
+        return nullptr;
+    return &_blocks[it->second];
 }
 
-BlockId Blocks::GlobalPalette::fromBlockToProtocolId(Blocks::Block &block) const
+BlockId Blocks::GlobalPalette::fromBlockToProtocolId(const std::string &block) const
 {
-    auto internalBlock = std::find_if(this->_blocks.begin(), this->_blocks.end(), [&block](const Blocks::InternalBlock &b) {
-        return b.name == block.name;
-    });
-    if (internalBlock == this->_blocks.end()) {
-        LERROR("Block not found in palette (name: {})", block.name);
+    {
+        std::shared_lock<std::shared_mutex> lock(_stateCacheMutex);
+        auto it = _stateCache.find(block);
+        if (it != _stateCache.end())
+            return it->second;
+    }
+    // The strings come from commands and files too, the invalid ones are not kept
+    auto id = this->_parseBlockState(block);
+    if (!id)
         return 0;
+    std::unique_lock<std::shared_mutex> lock(_stateCacheMutex);
+    if (_stateCache.size() < MAX_CACHED_STATES)
+        _stateCache.emplace(block, *id);
+    return *id;
+}
+
+std::optional<BlockId> Blocks::GlobalPalette::_parseBlockState(std::string_view state) const
+{
+    auto propertiesStart = state.find('[');
+    if (propertiesStart == std::string_view::npos) {
+        const auto *internalBlock = this->_findBlock(state);
+        if (!internalBlock)
+            return std::nullopt;
+        return internalBlock->defaultProtocolId;
     }
-    if (block.properties.size() != internalBlock->properties.size()) {
-        for (auto &[h, hh] : internalBlock->defaultProperties) {
-            bool found = false;
-            for (auto &[c, cc] : block.properties) {
-                if (c == h) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-                block.properties.push_back({h, hh});
+    if (state.back() != ']') {
+        LERROR("Invalid block state (state: {})", state);
+        return std::nullopt;
+    }
+
+    Blocks::Block block = {std::string(state.substr(0, propertiesStart)), {}};
+    auto properties = state.substr(propertiesStart + 1, state.size() - propertiesStart - 2);
+    while (!properties.empty()) {
+        auto property = properties.substr(0, properties.find(','));
+        properties.remove_prefix(std::min(property.size() + 1, properties.size()));
+        auto separator = property.find('=');
+        if (separator == std::string_view::npos) {
+            LERROR("Invalid block state (state: {})", state);
+            return std::nullopt;
         }
+        block.properties.push_back({std::string(property.substr(0, separator)), std::string(property.substr(separator + 1))});
+    }
+    return this->_resolve(block);
+}
+
+BlockId Blocks::GlobalPalette::fromBlockToProtocolId(const Blocks::Block &block) const { return this->_resolve(block).value_or(0); }
+
+std::optional<BlockId> Blocks::GlobalPalette::_resolve(const Blocks::Block &block) const
+{
+    const auto *internalBlock = this->_findBlock(block.name);
+    if (!internalBlock) {
+        LERROR("Block not found in palette (name: {})", block.name);
+        return std::nullopt;
     }
-    if (block.properties.size() == 0 && internalBlock->properties.size() == 0)
-        return internalBlock->baseProtocolId;
 
-    BlockId id = internalBlock->baseProtocolId;
-    for (auto property : block.properties) {
-        auto internalProperty = std::find_if(internalBlock->properties.begin(), internalBlock->properties.end(), [&property](const Blocks::InternalProperty &p) {
-            return p.name == property.first;
+    // The given properties move the id away from the default state
+    BlockId id = internalBlock->defaultProtocolId;
+    for (const auto &[name, value] : block.properties) {
+        auto internalProperty = std::find_if(internalBlock->properties.begin(), internalBlock->properties.end(), [&name](const Blocks::InternalProperty &p) {
+            return p.name == name;
         });
         if (internalProperty == internalBlock->properties.end()) {
-            LERROR("Property not found (name: {})", property.first);
-            return 0;
+            LERROR("Property not found (name: {})", name);
+            return std::nullopt;
         }
-        auto value = std::find(internalProperty->values.begin(), internalProperty->values.end(), property.second);
-        if (value == internalProperty->values.end()) {
-            LERROR("Value not found (name: {})", property.second);
-            return 0;
+        auto valueIt = std::find(internalProperty->values.begin(), internalProperty->values.end(), value);
+        if (valueIt == internalProperty->values.end()) {
+            LERROR("Value not found (name: {})", value);
+            return std::nullopt;
         }
-        id += internalProperty->baseWeight * (value - internalProperty->values.begin());
+        id += internalProperty->baseWeight * ((valueIt - internalProperty->values.begin()) - internalProperty->defaultValue);
     }
     return id;
 }
 
 Blocks::Block Blocks::GlobalPalette::fromProtocolIdToBlock(BlockId id) const
 {
-    for (auto b : this->_blocks) {
-        if (id < b.baseProtocolId || id > b.maxProtocolId)
-            continue;
-        Blocks::Block block;
-        block.name = b.name;
-        if (b.properties.size() == 0)
-            return block;
-        id -= b.baseProtocolId;
-        for (auto it = b.properties.rbegin(); it != b.properties.rend(); ++it) {
-            auto property = *it;
-            block.properties.push_back({property.name, property.values[id / property.baseWeight]});
-            id %= property.baseWeight;
-        }
+    if (id < 0 || static_cast<size_t>(id) >= _protocolIdIndex.size()) {
+        LERROR("Block not found in palette (id: {})", id);
+        return {"minecraft:air", {}};
+    }
+    const auto &b = _blocks[_protocolIdIndex[id]];
+    Blocks::Block block;
+    block.name = b.name;
+    if (b.properties.size() == 0)
         return block;
+    id -= b.baseProtocolId;
+    block.properties.reserve(b.properties.size());
+    for (auto it = b.properties.rbegin(); it != b.properties.rend(); ++it) {
+        const auto &property = *it;
+        block.properties.push_back({property.name, property.values[id / property.baseWeight]});
+        id %= property.baseWeight;
     }
-    LERROR("Block not found in palette (id: {})", id);
-    return {"minecraft:air", {}};
+    return block;
 }
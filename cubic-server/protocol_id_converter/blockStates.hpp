@@ -1,11 +1,20 @@
 #ifndef CUBICSERVER_PROTOCOLIDCONVERTER_BLOCKSTATES_HPP
 #define CUBICSERVER_PROTOCOLIDCONVERTER_BLOCKSTATES_HPP
 
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "types.hpp"
 
+namespace nbt {
+class TagView;
+class Writer;
+}
+
 namespace Blocks {
 /**
  * @brief Internal representation of a block property (only used in the GlobalPalette class)
@@ -13,7 +22,9 @@ namespace Blocks {
 struct InternalProperty {
     std::string name;
     std::vector<std::string> values;
-    uint8_t baseWeight;
+    uint16_t baseWeight;
+    // Index of the value of the default state
+    uint16_t defaultValue;
 };
 
 /**
@@ -23,6 +34,7 @@ struct InternalBlock {
     std::string name;
     std::vector<InternalProperty> properties;
     std::vector<std::pair<std::string, std::string>> defaultProperties;
+    uint16_t defaultProtocolId;
     uint16_t baseProtocolId;
     uint16_t maxProtocolId;
 };
@@ -41,15 +53,25 @@ struct Block {
  * @brief Global palette of blocks used to convert from protocol id to block and vice versa
  */
 class GlobalPalette {
+public:
+    // Block state strings cached at most, more than the number of states so that only strings written in unusual ways are not
+    static constexpr size_t MAX_CACHED_STATES = 65536;
+
 public:
     GlobalPalette() {};
     ~GlobalPalette() {};
     /**
-     * @brief Convert a block to a protocol id
+     * @brief Convert a block to a protocol id, the missing properties take their default value
      * @param block The block to convert
      * @return The protocol id of the block
      */
-    BlockId fromBlockToProtocolId(Block &block) const;
+    BlockId fromBlockToProtocolId(const Block &block) const;
+    /**
+     * @brief Convert a block state string to a protocol id, the valid states are cached
+     * @param block The name of the block, optionally followed by its properties (e.g. minecraft:grass_block[snowy=false])
+     * @return The protocol id of the block
+     * @note This function is thread-safe
+     */
     BlockId fromBlockToProtocolId(const std::string &block) const;
     /**
      * @brief Convert a protocol id to a block
@@ -62,9 +84,28 @@ public:
      * @param path The path to the json file
      */
     void initialize(const std::string &path = "blocks.json");
+    /**
+     * @brief Write the palette as the "blocks" list of a registry snapshot
+     */
+    void save(nbt::Writer &writer) const;
+    /**
+     * @brief Initialize the global palette from the "blocks" list of a registry snapshot
+     * @throw nbt::BufferEOF, nbt::TypeMismatch or std::bad_optional_access if the snapshot is corrupted
+     */
+    void load(const nbt::TagView &blocks);
 
 private:
+    void _buildIndex();
+    const InternalBlock *_findBlock(std::string_view name) const;
+    std::optional<BlockId> _resolve(const Block &block) const;
+    std::optional<BlockId> _parseBlockState(std::string_view state) const;
+
     std::vector<InternalBlock> _blocks; // The internal blocks
+    std::unordered_map<std::string_view, uint16_t> _nameIndex; // Index in _blocks of each name, the keys point into _blocks
+    std::vector<uint16_t> _protocolIdIndex; // Index in _blocks of each protocol id
+
+    mutable std::shared_mutex _stateCacheMutex;
+    mutable std::unordered_map<std::string, BlockId> _stateCache; // Valid block state strings already resolved
 };
 }
 
@@ -5,7 +5,10 @@
 
 #include <nlohmann/json.hpp>
 
+#include "items.hpp"
 #include "logging/logging.hpp"
+#include "nbt_reader.hpp"
+#include "nbt_writer.hpp"
 
 void Items::ItemConverter::initialize(const std::string &path)
 {
@@ -14,34 +17,77 @@ void Items::ItemConverter::initialize(const std::string &path)
         return;
     }
     nlohmann::json file = nlohmann::json::parse(std::ifstream(path));
+    std::vector<Items::InternalItem> items;
     for (auto item : file["minecraft:item"]["entries"].items()) {
         Items::InternalItem i;
         i.name = item.key();
         i.protocolId = item.value()["protocol_id"];
-        this->_items.push_back(i);
+        items.push_back(i);
     }
+    this->_buildIndex(items);
 }
 
-ItemId Items::ItemConverter::fromItemToProtocolId(const std::string &name) const
+void Items::ItemConverter::save(nbt::Writer &writer) const
 {
-    auto item = std::find_if(this->_items.begin(), this->_items.end(), [&name](const Items::InternalItem &i) {
-        return i.name == name;
-    });
-    if (item == this->_items.end()) {
+    writer.beginCompound("items");
+    for (size_t id = 0; id < _idToName.size(); id++) {
+        if (!_idToName[id].empty())
+            writer.writeShort(_idToName[id], id);
+    }
+    writer.endCompound();
+}
+
+void Items::ItemConverter::load(const nbt::TagView &items)
+{
+    std::vector<Items::InternalItem> loaded;
+    for (const auto &item : items)
+        loaded.push_back({std::string(item.getName()), static_cast<uint16_t>(item.getShort())});
+    this->_buildIndex(loaded);
+}
+
+void Items::ItemConverter::_buildIndex(const std::vector<InternalItem> &items)
+{
+    _idToName.clear();
+    _nameToId.clear();
+    _nameToId.reserve(items.size());
+
+    // Reserved first, the views must not be moved by a reallocation
+    size_t arenaSize = 0;
+    for (const auto &item : items)
+        arenaSize += item.name.size();
+    _names.clear();
+    _names.reserve(arenaSize);
+
+    for (const auto &item : items) {
+        std::string_view name;
+        if (item.protocolId < Vanilla::NAMES.size() && Vanilla::NAMES[item.protocolId] == item.name)
+            name = Vanilla::NAMES[item.protocolId];
+        else {
+            name = {_names.data() + _names.size(), item.name.size()};
+            _names.append(item.name);
+        }
+        if (_idToName.size() <= item.protocolId)
+            _idToName.resize(item.protocolId + 1);
+        _idToName[item.protocolId] = name;
+        _nameToId.emplace(name, item.protocolId);
+    }
+}
+
+ItemId Items::ItemConverter::fromItemToProtocolId(std::string_view name) const
+{
+    auto item = _nameToId.find(name);
+    if (item == _nameToId.end()) {
         LERROR("Item not found in palette (name: {})", name);
         return 0;
     }
-    return item->protocolId;
+    return item->second;
 }
 
-std::string Items::ItemConverter::fromProtocolIdToItem(ItemId id) const
+std::string_view Items::ItemConverter::fromProtocolIdToItem(ItemId id) const
 {
-    auto item = std::find_if(this->_items.begin(), this->_items.end(), [&id](const Items::InternalItem &i) {
-        return i.protocolId == id;
-    });
-    if (item == this->_items.end()) {
+    if (id < 0 || static_cast<size_t>(id) >= _idToName.size() || _idToName[id].empty()) {
         LERROR("Item not found in palette (id: {})", id);
         return "minecraft:air";
     }
-    return item->name;
+    return _idToName[id];
 }
@@ -2,10 +2,17 @@
 #define CUBICSERVER_PROTOCOLIDCONVERTER_ITEMCONVERTER_HPP
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "types.hpp"
 
+namespace nbt {
+class TagView;
+class Writer;
+}
+
 namespace Items {
 /**
  * @brief Internal representation of an item (only used in the ItemConverter class)
@@ -26,21 +33,34 @@ public:
      * @param name The name of the item
      * @return ItemId The protocol id of the item
      */
-    ItemId fromItemToProtocolId(const std::string &name) const;
+    ItemId fromItemToProtocolId(std::string_view name) const;
     /**
      * @brief Convert a protocol id to an item name
      * @param id The protocol id to convert
-     * @return std::string The name of the item
+     * @return std::string_view The name of the item, valid until the item converter is initialized again
      */
-    std::string fromProtocolIdToItem(ItemId id) const;
+    std::string_view fromProtocolIdToItem(ItemId id) const;
     /**
      * @brief Initialize the item converter with the items from the given json file
      * @param path The path to the json file
      */
     void initialize(const std::string &path = "registries.json");
+    /**
+     * @brief Write the items as the "items" compound of a registry snapshot
+     */
+    void save(nbt::Writer &writer) const;
+    /**
+     * @brief Initialize the item converter from the "items" compound of a registry snapshot
+     * @throw nbt::BufferEOF or nbt::TypeMismatch if the snapshot is corrupted
+     */
+    void load(const nbt::TagView &items);
 
 private:
-    std::vector<InternalItem> _items; // The internal representation of the items
+    void _buildIndex(const std::vector<InternalItem> &items);
+
+    std::string _names; // Arena holding the names of the items that are not in the generated vanilla table
+    std::vector<std::string_view> _idToName; // Name of each protocol id, empty for the unused ones
+    std::unordered_map<std::string_view, ItemId> _nameToId; // The keys point into the vanilla table or _names
 };
 }
 
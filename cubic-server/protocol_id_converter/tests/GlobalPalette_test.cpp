@@ -0,0 +1,86 @@
+#include "nbt_reader.hpp"
+#include "nbt_writer.hpp"
+#include "protocol_id_converter/blockStates.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+namespace GlobalPalette {
+
+// Redstone wire has 1296 states, the weight of its first property does not fit in 8 bits
+static constexpr BlockId REDSTONE_BASE_ID = 2312;
+static constexpr BlockId REDSTONE_DEFAULT_ID = REDSTONE_BASE_ID + 1160;
+
+static std::filesystem::path writeBlocks()
+{
+    auto path = std::filesystem::temp_directory_path() / "cubic_global_palette_test.json";
+    std::ofstream(path) << R"({
+        "minecraft:air": {"states": [{"default": true, "id": 0}]},
+        "minecraft:redstone_wire": {
+            "properties": {
+                "east": ["up", "side", "none"],
+                "north": ["up", "side", "none"],
+                "power": ["0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15"],
+                "south": ["up", "side", "none"],
+                "west": ["up", "side", "none"]
+            },
+            "states": [
+                {"id": 2312, "properties": {"east": "up", "north": "up", "power": "0", "south": "up", "west": "up"}},
+                {"default": true, "id": 3472, "properties": {"east": "none", "north": "none", "power": "0", "south": "none", "west": "none"}},
+                {"id": 3607, "properties": {"east": "none", "north": "none", "power": "15", "south": "none", "west": "none"}}
+            ]
+        }
+    })";
+    return path;
+}
+
+static void expectRedstoneStates(const Blocks::GlobalPalette &palette)
+{
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire"), REDSTONE_DEFAULT_ID);
+    // east=side is one step of 432 states away from east=up
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[east=side,north=up,power=0,south=up,west=up]"), REDSTONE_BASE_ID + 432);
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[east=up,north=side,power=15,south=none,west=side]"), REDSTONE_BASE_ID + 144 + 15 * 9 + 2 * 3 + 1);
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[power=15]"), REDSTONE_DEFAULT_ID + 15 * 9);
+
+    auto block = palette.fromProtocolIdToBlock(REDSTONE_BASE_ID + 432 + 7 * 9);
+    EXPECT_EQ(block.name, "minecraft:redstone_wire");
+    std::vector<std::pair<std::string, std::string>> expected = {{"east", "side"}, {"north", "up"}, {"power", "7"}, {"south", "up"}, {"west", "up"}};
+    EXPECT_EQ(block.properties, expected);
+}
+
+TEST(GlobalPalette, StatesAboveUint8Weights)
+{
+    auto path = writeBlocks();
+    Blocks::GlobalPalette palette;
+    palette.initialize(path.string());
+    std::filesystem::remove(path);
+    expectRedstoneStates(palette);
+
+    // The weights go through the registry snapshot as shorts
+    std::vector<uint8_t> data;
+    nbt::Writer writer(data);
+    writer.beginCompound("");
+    palette.save(writer);
+    writer.endCompound();
+    Blocks::GlobalPalette loaded;
+    loaded.load(nbt::TagView::root(data).find("blocks", nbt::TagType::List).value());
+    expectRedstoneStates(loaded);
+}
+
+TEST(GlobalPalette, InvalidStates)
+{
+    auto path = writeBlocks();
+    Blocks::GlobalPalette palette;
+    palette.initialize(path.string());
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:unknown"), 0);
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[power=16]"), 0);
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[color=red]"), 0);
+    // Asked again once cached, or not
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[power=16]"), 0);
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[power=1]"), REDSTONE_DEFAULT_ID + 9);
+    EXPECT_EQ(palette.fromBlockToProtocolId("minecraft:redstone_wire[power=1]"), REDSTONE_DEFAULT_ID + 9);
+}
+
+} // namespace GlobalPalette
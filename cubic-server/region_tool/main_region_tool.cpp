@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <zlib.h>
+
+#include "configuration/ConfigHandler.hpp"
+#include "logging/logging.hpp"
+#include "world_storage/ChunkData.hpp"
+#include "world_storage/Compression.hpp"
+#include "world_storage/NativeRegionFile.hpp"
+#include "world_storage/RegionFile.hpp"
+
+using namespace world_storage;
+
+// Region folders of the overworld, the nether and the end, like the server
+static const std::filesystem::path regionFolders[] = {"region", "DIM-1/region", "DIM1/region"};
+
+struct ConversionStats {
+    size_t regions = 0;
+    size_t chunks = 0;
+    size_t skipped = 0; // Chunks not fully generated, the server regenerates them
+    size_t failed = 0;
+    uintmax_t bytesBefore = 0;
+    uintmax_t bytesAfter = 0;
+};
+
+static auto initArgs(int argc, const char *const argv[])
+{
+    auto program = configuration::ConfigHandler("cubic-region-tool", PROGRAM_VERSION);
+
+    // clang-format off
+    program.add("world")
+        .help("folder of the world to convert, the server must not be running")
+        .valueFromArgument("--world")
+        .defaultValue("world");
+
+    program.add("to")
+        .help("format to convert the regions to, the regions of the other format are kept")
+        .valueFromArgument("--to")
+        .possibleValues("anvil", "native")
+        .defaultValue("native");
+    // clang-format on
+
+    try {
+        program.parse(argc, argv);
+    } catch (const std::runtime_error &err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << program;
+        std::exit(1);
+    }
+
+    return program;
+}
+
+/**
+ * @brief Convert a region to the other format, chunk by chunk
+ */
+static void convertRegion(const std::filesystem::path &source, const std::filesystem::path &destination, int x, int z, StorageFormat to, ConversionStats &stats)
+{
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> compressed;
+
+    const auto onChunk = [&](auto &region, uint16_t cx, uint16_t cz, std::span<const uint8_t> data) {
+        const Position2D chunkPos(cx + x * maxXPerRegion, cz + z * maxZPerRegion);
+        if (data.empty()) {
+            LERROR("Could not decompress chunk {} {} of {}", cx, cz, source.string());
+            stats.failed++;
+            return;
+        }
+        try {
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(region)>, NativeRegionFile>) {
+                auto chunk = readAnvilChunk(nbt::TagView::root(data), chunkPos);
+                if (!chunk) {
+                    stats.skipped++;
+                    return;
+                }
+                encodeNativeChunk(*chunk, encoded);
+                region.write(cx, cz, encoded);
+            } else {
+                auto chunk = decodeNativeChunk(data);
+                writeAnvilChunk(chunk, encoded);
+                if (!deflateData(encoded, compressed, MAX_WBITS))
+                    throw std::runtime_error("Could not compress the chunk");
+                region.write(cx, cz, chunkCompressionZlib, compressed);
+            }
+            stats.chunks++;
+        } catch (const std::exception &e) {
+            LERROR("Could not convert chunk {} {} of {}: {}", cx, cz, source.string(), e.what());
+            stats.failed++;
+        }
+    };
+
+    if (to == StorageFormat::NATIVE) {
+        NativeRegionFile region(destination);
+        RegionFile::read(source, buffer, [&](uint16_t cx, uint16_t cz, std::span<const uint8_t> data) { onChunk(region, cx, cz, data); });
+    } else {
+        RegionFile region(destination);
+        NativeRegionFile::read(source, buffer, [&](uint16_t cx, uint16_t cz, std::span<const uint8_t> data) { onChunk(region, cx, cz, data); });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    auto program = initArgs(argc, argv);
+
+    const std::filesystem::path world = program["world"].as<std::string>();
+    const StorageFormat to = parseStorageFormat(program["to"].as<std::string>());
+    const std::string sourceExtension = to == StorageFormat::NATIVE ? ".mca" : nativeRegionExtension;
+    const std::string destinationExtension = to == StorageFormat::NATIVE ? nativeRegionExtension : ".mca";
+
+    if (!std::filesystem::is_directory(world)) {
+        LERROR("{} is not a world folder", world.string());
+        return 1;
+    }
+
+    ConversionStats stats;
+    for (const auto &folder : regionFolders) {
+        if (!std::filesystem::is_directory(world / folder))
+            continue;
+        for (const auto &entry : std::filesystem::directory_iterator(world / folder)) {
+            int x = 0;
+            int z = 0;
+            if (entry.path().extension() != sourceExtension || std::sscanf(entry.path().filename().c_str(), "r.%d.%d.", &x, &z) != 2)
+                continue;
+
+            auto destination = entry.path();
+            destination.replace_extension(destinationExtension);
+            try {
+                convertRegion(entry.path(), destination, x, z, to, stats);
+            } catch (const std::exception &e) {
+                LERROR("Could not convert {}: {}", entry.path().string(), e.what());
+                continue;
+            }
+            stats.regions++;
+            stats.bytesBefore += std::filesystem::file_size(entry.path());
+            stats.bytesAfter += std::filesystem::file_size(destination);
+            LINFO("Converted {}", entry.path().string());
+        }
+    }
+
+    LINFO(
+        "Converted {} chunks of {} regions to {} ({} not fully generated, {} failed), {} bytes to {} bytes", stats.chunks, stats.regions, program["to"].as<std::string>(),
+        stats.skipped, stats.failed, stats.bytesBefore, stats.bytesAfter
+    );
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -47,6 +47,12 @@ public:
         return _toolBox.targetSize;
     }
 
+    // jobs waiting for a worker, read without locking the queue
+    int getQueuedJobs() const { return _toolBox.queuedJobs.load(std::memory_order_relaxed); }
+
+    // workers currently running a job, read without locking the queue
+    int getBusyWorkers() const { return _toolBox.busyWorkers.load(std::memory_order_relaxed); }
+
     // any modifications will only take place AFTER a worker has ended its shift.
     void changeWorkerNb(uint16_t newSize)
     {
@@ -75,6 +81,7 @@ public:
 
         auto size = this->_toolBox.jobQueue.size();
         this->_toolBox.jobQueue.clear();
+        this->_toolBox.queuedJobs -= size;
         this->_toolBox.jobSemaphore.increment(size);
     }
 
@@ -87,6 +94,7 @@ public:
         });
         if (it != this->_toolBox.jobQueue.end()) {
             this->_toolBox.jobQueue.erase(it);
+            --this->_toolBox.queuedJobs;
             this->_toolBox.jobSemaphore.increment();
             return true;
         }
@@ -115,6 +123,7 @@ public:
             const std::lock_guard<std::mutex> _guard(_toolBox.queueProtection);
             jobId = ++_toolBox.totalJobsPushed;
             _toolBox.jobQueue.emplace_back(jobId, priority, std::move(realJobList));
+            ++_toolBox.queuedJobs;
         }
         _toolBox.jobSemaphore.release(sizeof...(job));
         return jobId;
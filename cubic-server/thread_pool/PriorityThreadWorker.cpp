@@ -64,6 +64,7 @@ void PriorityThreadWorker::doJob()
 
         _toolBox.library.increment();
         --_toolBox.inactiveThreads;
+        ++_toolBox.busyWorkers;
 
         auto greater = _toolBox.jobQueue.begin();
         for (auto it = greater; it != _toolBox.jobQueue.end(); ++it)
@@ -73,6 +74,7 @@ void PriorityThreadWorker::doJob()
         if (greater != _toolBox.jobQueue.end()) {
             jobList = *greater;
             _toolBox.jobQueue.erase(greater);
+            --_toolBox.queuedJobs;
         }
     }
     do {
@@ -88,6 +90,7 @@ void PriorityThreadWorker::doJob()
     } while (!jobList.jobs.empty());
     ++_toolBox.totalJobsDone;
     ++_toolBox.inactiveThreads;
+    --_toolBox.busyWorkers;
     _toolBox.library.decrement();
 }
 
@@ -77,6 +77,10 @@ struct PriorityThreadPoolUtility {
     std::atomic<int> totalJobsPushed {};
     std::atomic<int> totalJobsDone {};
 
+    // Kept apart from the queue so they can be read without locking it
+    std::atomic<int> queuedJobs {};
+    std::atomic<int> busyWorkers {};
+
     mutable ReverseSemaphore library;
 };
 }
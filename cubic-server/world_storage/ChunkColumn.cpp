@@ -8,25 +8,28 @@
 #include "generation/overworld.hpp"
 #include "logging/logging.hpp"
 #include "nbt.hpp"
+#include "profiling/Profiler.hpp"
+#include "protocol/serialization/add.hpp"
 #include "types.hpp"
 #include "world_storage/Section.hpp"
 #include <cstdlib>
 #include <memory>
 
-#define APPEND_CHUNK_TO(neighbours, chunkMap, pos2D)                                                                                 \
-    if (chunkMap.contains(_chunkPos + pos2D) && chunkMap.at(_chunkPos + pos2D).getState() >= GenerationState::LOCAL_MODIFICATIONS) { \
-        chunkMap.at(_chunkPos + pos2D)._generationLock.lock();                                                                       \
-        neighbours.push_back(&chunkMap.at(_chunkPos + pos2D));                                                                       \
-    } else {                                                                                                                         \
-        /* _dimension->getLevel().chunkColumnsMutex.unlock();                                                                        \
-        // _dimension->generateChunk(_chunkPos + pos2D, GenerationState::LOCAL_MODIFICATIONS);                                       \
-        // _dimension->getLevel().chunkColumnsMutex.lock();                                                                          \
-        // chunkMap.at(_chunkPos + pos2D)._generationLock.lock();                                                                    \
-        // neighbours.push_back(&chunkMap.at(_chunkPos + pos2D));*/                                                                  \
-    }                                                                                                                                \
-
+#define APPEND_CHUNK_TO(neighbours, chunkMap, pos2D)                                                                                  \
+    if (chunkMap.contains(_chunkPos + pos2D) && chunkMap.at(_chunkPos + pos2D)->getState() >= GenerationState::LOCAL_MODIFICATIONS) { \
+        chunkMap.at(_chunkPos + pos2D)->_generationLock.lock();                                                                       \
+        neighbours.push_back(chunkMap.at(_chunkPos + pos2D));                                                                         \
+    } else {                                                                                                                          \
+        /* _dimension->getLevel().chunkColumnsMutex.unlock();                                                                         \
+        // _dimension->generateChunk(_chunkPos + pos2D, GenerationState::LOCAL_MODIFICATIONS);                                        \
+        // _dimension->getLevel().chunkColumnsMutex.lock();                                                                           \
+        // chunkMap.at(_chunkPos + pos2D)->_generationLock.lock();                                                                    \
+        // neighbours.push_back(chunkMap.at(_chunkPos + pos2D));*/                                                                    \
+    }                                                                                                                                 \
+
+// The neighbours are held, they are not freed if they are unloaded during the generation
 #define GET_NEIGHBOURS()                                           \
-    std::vector<ChunkColumn *> neighbours;                         \
+    std::vector<std::shared_ptr<ChunkColumn>> neighbours;          \
     neighbours.reserve(8);                                         \
     auto &chunkColumns = _dimension->getLevel().getChunkColumns(); \
     APPEND_CHUNK_TO(neighbours, chunkColumns, Position2D(1, 1))    \
@@ -47,30 +50,23 @@ namespace world_storage {
 
 ChunkColumn::ChunkColumn(const Position2D &chunkPos, std::shared_ptr<Dimension> dimension):
     _chunkPos(chunkPos),
-    _heightMap(""),
+    _heightMaps(),
     _currentState(GenerationState::INITIALIZED),
-    _dimension(dimension)
+    _dimension(dimension),
+    _dirty(false)
 {
-    // OOF
-    for (auto idx = 0; HEIGHTMAP_ENTRY[idx] != nullptr; idx++) {
-        auto listBase = NBT_MAKE(nbt::List, HEIGHTMAP_ENTRY[idx]);
-        auto list = std::dynamic_pointer_cast<nbt::List>(listBase);
-
-        for (auto i = 0; i < HEIGHTMAP_ARRAY_SIZE; i++)
-            list->push_back(std::make_shared<nbt::Long>("", 0));
-
-        _heightMap.addValue(listBase);
-    }
 }
 
 ChunkColumn::ChunkColumn(ChunkColumn &&chunk):
     _sections(std::move(chunk._sections)),
     _tickData(chunk._tickData),
     _chunkPos(chunk._chunkPos),
-    _heightMap(chunk._heightMap),
+    _heightMaps(chunk._heightMaps),
     _currentState(chunk._currentState),
     _generationLock(),
-    _dimension(chunk._dimension)
+    _dimension(chunk._dimension),
+    _encodedData(std::atomic_load(&chunk._encodedData)),
+    _dirty(chunk._dirty)
 {
 }
 
@@ -95,6 +91,7 @@ void ChunkColumn::updateBlock(const Position &pos, BlockId id)
     // Block update
     // LINFO("ChunkColumn updateBlock: ", pos, "[", getSectionIndex(pos), "] -> ", id);
     // LINFO("wtf: " << pos << " " << id);
+    this->_dropEncodedData();
     _sections.at(getSectionIndex(pos)).updateBlock(Position {pos.x, pos.y - CHUNK_HEIGHT_MIN, pos.z} % SECTION_WIDTH, id);
     // _blocks.at(calculateBlockIdx(pos)) = id;
 }
@@ -108,11 +105,13 @@ uint8_t ChunkColumn::getSkyLight(const Position &pos) const
 
 void ChunkColumn::updateSkyLight(const Position &pos, uint8_t light)
 {
+    this->_dropEncodedData();
     _sections.at(getSectionIndex(pos)).updateSkyLight(Position {pos.x, pos.y - CHUNK_HEIGHT_MIN, pos.z} % SECTION_WIDTH, light);
 }
 
 void ChunkColumn::updateBlockLight(const Position &pos, uint8_t light)
 {
+    this->_dropEncodedData();
     _sections.at(getSectionIndex(pos)).updateBlockLight(Position {pos.x, pos.y - CHUNK_HEIGHT_MIN, pos.z} % SECTION_WIDTH, light);
 }
 
@@ -123,13 +122,28 @@ uint8_t ChunkColumn::getBlockLight(const Position &pos) const
 
 void ChunkColumn::updateBiome(const Position &pos, uint8_t biome)
 {
+    this->_dropEncodedData();
     _sections.at(getBiomeSectionIndex(pos)).updateBiome(Position {pos.x, pos.y - BIOME_HEIGHT_MIN, pos.z} % BIOME_SECTION_WIDTH, biome);
 }
 
 uint8_t ChunkColumn::getBiome(const Position &pos) const { return _sections.at(getBiomeSectionIndex(pos)).getBiome(pos % BIOME_SECTION_WIDTH); }
 
+Section &ChunkColumn::getSection(uint8_t index)
+{
+    this->_dropEncodedData();
+    return _sections.at(index);
+}
+
+std::array<Section, NB_OF_SECTIONS> &ChunkColumn::getSections()
+{
+    this->_dropEncodedData();
+    return _sections;
+}
+
 // const std::array<uint8_t, BIOME_SECTION_3D_SIZE * NB_OF_PLAYABLE_SECTIONS> &ChunkColumn::getBiomes() const { return _biomes; }
 
+ChunkSnapshot ChunkColumn::snapshot() const { return {_chunkPos, _sections, _heightMaps}; }
+
 int64_t ChunkColumn::getTick() { return _tickData; }
 void ChunkColumn::setTick(int64_t tick) { _tickData = tick; }
 Position2D ChunkColumn::getChunkPos() const { return _chunkPos; }
@@ -171,15 +185,20 @@ GenerationState ChunkColumn::getState() const { return this->_currentState; }
 
 void ChunkColumn::updateHeightMap()
 {
-    for (auto &section : _sections) {
+    this->_dropEncodedData();
+    // Every non air block is considered motion blocking
+    for (auto &heightMap : _heightMaps)
+        heightMap.fill(0);
+    for (int z = 0; z < SECTION_WIDTH; z++) {
         for (int x = 0; x < SECTION_WIDTH; x++) {
-            for (int z = 0; z < SECTION_WIDTH; z++) {
-                for (int y = SECTION_WIDTH - 1; y >= 0; y--) {
-                    if (section.getBlock({x, y, z}) != 0) {
-                        _heightMap.getValueAs<nbt::List>("WORLD_SURFACE")->getValueAs<nbt::Long>(x + z * SECTION_WIDTH)->setValue(y + 1);
-                        break;
-                    }
-                }
+            for (int y = CHUNK_HEIGHT_MAX - 1; y >= CHUNK_HEIGHT_MIN; y--) {
+                if (this->getBlock({x, y, z}) == 0)
+                    continue;
+                auto column = x + z * SECTION_WIDTH;
+                auto shift = (column % HEIGHTMAP_VALUES_PER_LONG) * HEIGHTMAP_BITS;
+                for (auto &heightMap : _heightMaps)
+                    heightMap[column / HEIGHTMAP_VALUES_PER_LONG] |= static_cast<int64_t>(y - CHUNK_HEIGHT_MIN + 1) << shift;
+                break;
             }
         }
     }
@@ -187,6 +206,7 @@ void ChunkColumn::updateHeightMap()
 
 void ChunkColumn::recalculateSkyLight()
 {
+    this->_dropEncodedData();
     for (auto &section : _sections) {
         section.recalculateSkyLight();
     }
@@ -194,6 +214,7 @@ void ChunkColumn::recalculateSkyLight()
 
 void ChunkColumn::recalculateBlockLight()
 {
+    this->_dropEncodedData();
     for (auto &section : _sections) {
         section.recalculateBlockLight();
     }
@@ -201,6 +222,7 @@ void ChunkColumn::recalculateBlockLight()
 
 void ChunkColumn::generate(GenerationState goalState)
 {
+    PROFILE_ZONE("Chunk generation");
     switch (_dimension->getWorld()->getWorldType()) {
     case WorldType::DEFAULT:
         switch (_dimension->getDimensionType()) {
@@ -219,8 +241,9 @@ void ChunkColumn::generate(GenerationState goalState)
         }
         break;
     case WorldType::SUPERFLAT:
+        // Copied from the template, which already has its light
         _generateFlat(goalState);
-        break;
+        return;
     case WorldType::LARGEBIOME:
     case WorldType::AMPLIFIED:
     case WorldType::SINGLEBIOME:
@@ -231,12 +254,37 @@ void ChunkColumn::generate(GenerationState goalState)
         break;
     case WorldType::SUPERFLAT_CUBIC_SERVER:
         _generateFlatCubicServer(goalState);
-        break;
+        return;
     default:
         LERROR("Unknown world type");
         break;
     }
     this->recalculateSkyLight();
+    if (_currentState == GenerationState::READY)
+        this->_compactSections();
+}
+
+void ChunkColumn::generateFlatTemplate()
+{
+    std::lock_guard<std::mutex> _(this->_generationLock);
+    switch (_dimension->getWorld()->getWorldType()) {
+    case WorldType::SUPERFLAT:
+        _buildFlat();
+        break;
+    case WorldType::SUPERFLAT_CUBIC_SERVER:
+        _buildFlatCubicServer();
+        break;
+    default:
+        LERROR("World type has no flat template");
+        return;
+    }
+    this->recalculateSkyLight();
+    this->_compactSections();
+    _currentState = GenerationState::READY;
+
+    auto encodedData = std::make_shared<std::vector<uint8_t>>();
+    protocol::addChunkColumn(*encodedData, *this);
+    std::atomic_store(&_encodedData, std::shared_ptr<const std::vector<uint8_t>>(std::move(encodedData)));
 }
 
 void ChunkColumn::_generateOverworld(GenerationState goalState)
@@ -292,9 +340,37 @@ void ChunkColumn::_generateNether(UNUSED GenerationState goalState) { std::lock_
 
 void ChunkColumn::_generateEnd(UNUSED GenerationState goalState) { std::lock_guard<std::mutex> _(this->_generationLock); }
 
-void ChunkColumn::_generateFlat(UNUSED GenerationState goalState)
+void ChunkColumn::_generateFlat(UNUSED GenerationState goalState) { this->_copyFlatTemplate(); }
+
+void ChunkColumn::_generateFlatCubicServer(UNUSED GenerationState goalState) { this->_copyFlatTemplate(); }
+
+void ChunkColumn::_copyFlatTemplate()
 {
+    const auto &flatTemplate = _dimension->getWorld()->getFlatTemplate(_dimension);
+
     std::lock_guard<std::mutex> _(this->_generationLock);
+    // Sections share the template storages until they are modified, the heightmap is left empty like the template one
+    for (size_t i = 0; i < _sections.size(); i++)
+        _sections[i] = flatTemplate._sections[i];
+    std::atomic_store(&_encodedData, flatTemplate.getEncodedData());
+    _currentState = GenerationState::READY;
+}
+
+void ChunkColumn::_compactSections()
+{
+    for (auto &section : _sections)
+        section.compact();
+}
+
+void ChunkColumn::_dropEncodedData()
+{
+    // Readers may be encoding the chunk on another thread, the pointer is only replaced atomically
+    if (std::atomic_load(&_encodedData))
+        std::atomic_store(&_encodedData, std::shared_ptr<const std::vector<uint8_t>>());
+}
+
+void ChunkColumn::_buildFlat()
+{
     for (int y = 0; y < 11; y++) {
         for (int z = 0; z < SECTION_WIDTH; z++) {
             for (int x = 0; x < SECTION_WIDTH; x++) {
@@ -308,7 +384,6 @@ void ChunkColumn::_generateFlat(UNUSED GenerationState goalState)
             }
         }
     }
-    _currentState = GenerationState::READY;
 }
 
 void ChunkColumn::_generateDebug(UNUSED GenerationState goalState)
@@ -322,7 +397,7 @@ void ChunkColumn::_generateDebug(UNUSED GenerationState goalState)
     _currentState = GenerationState::READY;
 }
 
-void ChunkColumn::_generateFlatCubicServer(UNUSED GenerationState goalState)
+void ChunkColumn::_buildFlatCubicServer()
 {
     for (int y = 0; y < 11; y++) {
         for (int z = 0; z < SECTION_WIDTH; z++) {
@@ -419,7 +494,6 @@ void ChunkColumn::_generateFlatCubicServer(UNUSED GenerationState goalState)
             }
         }
     }
-    _currentState = GenerationState::READY;
 }
 
 void ChunkColumn::_generateRawGeneration(generation::Generator &generator)
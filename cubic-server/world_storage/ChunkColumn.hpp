@@ -23,8 +23,11 @@ namespace world_storage {
 
 // Heightmap
 constexpr int HEIGHTMAP_BITS = bitsNeeded(CHUNK_HEIGHT + 1);
-constexpr int HEIGHTMAP_ARRAY_SIZE = (SECTION_2D_SIZE * HEIGHTMAP_BITS / 64) + ((SECTION_2D_SIZE * HEIGHTMAP_BITS % 64) != 0);
-constexpr const char *const HEIGHTMAP_ENTRY[] = {"MOTION_BLOCKING", "WORLD_SURFACE", nullptr};
+// Like vanilla, a value never spans across two longs
+constexpr int HEIGHTMAP_VALUES_PER_LONG = 64 / HEIGHTMAP_BITS;
+constexpr int HEIGHTMAP_ARRAY_SIZE = (SECTION_2D_SIZE + HEIGHTMAP_VALUES_PER_LONG - 1) / HEIGHTMAP_VALUES_PER_LONG;
+constexpr std::array<const char *, 2> HEIGHTMAP_ENTRY = {"MOTION_BLOCKING", "WORLD_SURFACE"};
+typedef std::array<int64_t, HEIGHTMAP_ARRAY_SIZE> HeightMap;
 
 constexpr uint8_t getSectionIndex(const Position &pos) { return (pos.y - CHUNK_HEIGHT_MIN + SECTION_WIDTH) / SECTION_WIDTH; }
 constexpr uint8_t getBiomeSectionIndex(const Position &pos) { return (pos.y - BIOME_HEIGHT_MIN + BIOME_SECTION_WIDTH) / BIOME_SECTION_WIDTH; }
@@ -79,6 +82,17 @@ enum class GenerationState {
     READY,
 };
 
+/**
+ * @brief Copy of the content of a chunk column, written to disk while the chunk keeps being modified
+ *
+ * The sections share their storages with the chunk, which copies them on its next write instead (see Section).
+ */
+struct ChunkSnapshot {
+    Position2D chunkPos;
+    std::array<Section, NB_OF_SECTIONS> sections;
+    std::array<HeightMap, HEIGHTMAP_ENTRY.size()> heightMaps;
+};
+
 class ChunkColumn {
 public:
     ChunkColumn(const Position2D &chunkPos, std::shared_ptr<Dimension> dimension);
@@ -99,10 +113,11 @@ public:
     void updateBiome(const Position &pos, BiomeId biome);
     BiomeId getBiome(const Position &pos) const;
 
-    constexpr Section &getSection(uint8_t index) { return _sections.at(index); }
+    // Mutable access drops the encoded payload, see getEncodedData
+    Section &getSection(uint8_t index);
     constexpr const Section &getSection(uint8_t index) const { return _sections.at(index); }
 
-    constexpr std::array<Section, NB_OF_SECTIONS> &getSections() { return _sections; }
+    std::array<Section, NB_OF_SECTIONS> &getSections();
     constexpr const std::array<Section, NB_OF_SECTIONS> &getSections() const { return _sections; }
 
     int64_t getTick();
@@ -121,10 +136,33 @@ public:
     // const std::deque<Entity *> &getEntities();
 
     void updateHeightMap();
-    NODISCARD constexpr inline const nbt::Compound &getHeightMap() const { return _heightMap; }
+    /**
+     * @brief Packed heightmaps, in the order of HEIGHTMAP_ENTRY
+     */
+    NODISCARD constexpr inline const std::array<HeightMap, HEIGHTMAP_ENTRY.size()> &getHeightMaps() const { return _heightMaps; }
 
     void generate(GenerationState goalState = GenerationState::READY);
 
+    /**
+     * @brief Build the content shared by every chunk of a flat world and encode it once
+     * The chunks of the world are then copied from it, see World::getFlatTemplate
+     */
+    void generateFlatTemplate();
+
+    /**
+     * @brief Network payload of the chunk column shared with its template, null once the chunk has been modified
+     * Returned by copy as the chunk can be modified by another thread while the payload is sent
+     */
+    NODISCARD inline std::shared_ptr<const std::vector<uint8_t>> getEncodedData() const { return std::atomic_load(&_encodedData); }
+
+    /**
+     * @brief Whether the chunk was modified since it was last saved, the chunks that were only generated are not saved unless autosave-generated is set
+     */
+    NODISCARD inline bool isDirty() const { return _dirty; }
+    inline void setDirty(bool dirty) { _dirty = dirty; }
+
+    NODISCARD ChunkSnapshot snapshot() const;
+
     friend class Persistence;
 
 private:
@@ -135,6 +173,12 @@ private:
     void _generateFlat(GenerationState goalState);
     void _generateDebug(GenerationState goalState);
     void _generateFlatCubicServer(GenerationState goalState);
+    void _copyFlatTemplate();
+    void _dropEncodedData();
+    void _compactSections();
+
+    void _buildFlat();
+    void _buildFlatCubicServer();
 
     void _generateRawGeneration(generation::Generator &generator);
     void _generateLakes(generation::Generator &generator);
@@ -157,10 +201,13 @@ private:
     // LightStorage _blockLights;
     int64_t _tickData;
     Position2D _chunkPos;
-    nbt::Compound _heightMap;
+    std::array<HeightMap, HEIGHTMAP_ENTRY.size()> _heightMaps;
     GenerationState _currentState;
     std::mutex _generationLock;
     std::shared_ptr<Dimension> _dimension;
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<const std::vector<uint8_t>> _encodedData;
+    bool _dirty;
 };
 
 } // namespace world_storage
@@ -0,0 +1,291 @@
+#include "ChunkData.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#include "Server.hpp"
+#include "nbt_writer.hpp"
+#include "world_storage/NativeRegionFile.hpp"
+
+namespace world_storage {
+
+StorageFormat parseStorageFormat(std::string_view name)
+{
+    if (name == "anvil")
+        return StorageFormat::ANVIL;
+    if (name == "native")
+        return StorageFormat::NATIVE;
+    throw std::invalid_argument("Unknown storage format " + std::string(name));
+}
+
+/**
+ * @brief Block state string of an entry of an anvil palette, e.g. minecraft:grass_block[snowy=false]
+ */
+static std::string readBlockState(const nbt::TagView &entry)
+{
+    auto name = entry.find("Name", nbt::TagType::String);
+    if (!name)
+        throw std::runtime_error("Palette entry without a name");
+
+    std::string state(name->getString());
+    auto properties = entry.find("Properties", nbt::TagType::Compound);
+    if (!properties)
+        return state;
+    char separator = '[';
+    for (const auto &property : *properties) {
+        state += separator;
+        state += property.getName();
+        state += '=';
+        state += property.getString();
+        separator = ',';
+    }
+    if (separator == ',')
+        state += ']';
+    return state;
+}
+
+static void readAnvilSection(const nbt::TagView &section, SectionData &dst)
+{
+    auto y = section.find("Y", nbt::TagType::Byte);
+    if (!y)
+        throw std::runtime_error("Section without Y");
+    dst.y = y->getByte();
+
+    auto blockStates = section.find("block_states", nbt::TagType::Compound);
+    if (blockStates) {
+        auto palette = blockStates->find("palette", nbt::TagType::List);
+        if (!palette)
+            throw std::runtime_error("Block states without a palette");
+        dst.palette.reserve(palette->size());
+        for (const auto &entry : *palette)
+            dst.palette.push_back(readBlockState(entry));
+
+        auto data = blockStates->find("data", nbt::TagType::LongArray);
+        if (data) {
+            // Anvil packs the palette indices on at least 4 bits, without spanning two longs
+            const size_t bits = std::max<size_t>(4, bitsNeeded(dst.palette.size()));
+            const size_t perLong = 64 / bits;
+            if (data->size() != (SECTION_3D_SIZE + perLong - 1) / perLong)
+                throw std::runtime_error("Block states of " + std::to_string(data->size()) + " longs for a palette of " + std::to_string(dst.palette.size()) + " states");
+            dst.blocks.resize(data->size());
+            data->copyLongArray({reinterpret_cast<int64_t *>(dst.blocks.data()), dst.blocks.size()});
+        }
+    }
+
+    auto blockLight = section.find("BlockLight", nbt::TagType::ByteArray);
+    if (blockLight) {
+        auto values = blockLight->getByteArray();
+        dst.blockLight.assign(values.begin(), values.end());
+    }
+    auto skyLight = section.find("SkyLight", nbt::TagType::ByteArray);
+    if (skyLight) {
+        auto values = skyLight->getByteArray();
+        dst.skyLight.assign(values.begin(), values.end());
+    }
+}
+
+std::optional<ChunkData> readAnvilChunk(const nbt::TagView &chunk, Position2D chunkPos)
+{
+    // Single pass over the chunk, a find per tag would skip over the sections every time
+    std::string_view status;
+    std::optional<nbt::TagView> sections;
+    std::optional<nbt::TagView> heightmaps;
+    for (const auto &tag : chunk) {
+        if (tag.getName() == "Status")
+            status = tag.getString();
+        else if (tag.getName() == "sections")
+            sections = tag;
+        else if (tag.getName() == "Heightmaps")
+            heightmaps = tag;
+    }
+    if (status != "full")
+        return std::nullopt; // TODO(huntears): Handle non complete chunk later somehow
+    if (!sections || !heightmaps)
+        throw std::runtime_error("Chunk without sections or heightmaps");
+
+    ChunkData data {chunkPos, {}, {}};
+    data.sections.reserve(sections->size());
+    for (const auto &section : *sections)
+        readAnvilSection(section, data.sections.emplace_back());
+
+    for (size_t idx = 0; idx < HEIGHTMAP_ENTRY.size(); idx++) {
+        auto heightmap = heightmaps->find(HEIGHTMAP_ENTRY[idx], nbt::TagType::LongArray);
+        if (!heightmap)
+            throw std::runtime_error(std::string("Chunk without the ") + HEIGHTMAP_ENTRY[idx] + " heightmap");
+        heightmap->copyLongArray(data.heightMaps[idx]);
+    }
+    return data;
+}
+
+/**
+ * @brief Write a block state string as an entry of an anvil palette
+ */
+static void writeBlockState(nbt::Writer &writer, std::string_view state)
+{
+    const auto propertiesStart = state.find('[');
+    writer.beginCompound("").writeString("Name", state.substr(0, propertiesStart));
+    if (propertiesStart != std::string_view::npos && state.back() == ']') {
+        auto properties = state.substr(propertiesStart + 1, state.size() - propertiesStart - 2);
+        writer.beginCompound("Properties");
+        while (!properties.empty()) {
+            auto property = properties.substr(0, properties.find(','));
+            properties.remove_prefix(std::min(property.size() + 1, properties.size()));
+            const auto separator = property.find('=');
+            if (separator != std::string_view::npos)
+                writer.writeString(property.substr(0, separator), property.substr(separator + 1));
+        }
+        writer.endCompound();
+    }
+    writer.endCompound();
+}
+
+void writeAnvilChunk(const ChunkData &chunk, std::vector<uint8_t> &out)
+{
+    out.clear();
+    nbt::Writer writer(out);
+    writer.beginCompound("")
+        .writeInt("DataVersion", MC_DATA_VERSION)
+        .writeInt("xPos", chunk.chunkPos.x)
+        .writeInt("zPos", chunk.chunkPos.z)
+        .writeInt("yPos", CHUNK_HEIGHT_MIN / SECTION_WIDTH)
+        .writeString("Status", "full")
+        .beginList("sections", nbt::TagType::Compound);
+
+    for (const auto &section : chunk.sections) {
+        writer.beginCompound("").writeByte("Y", section.y);
+        if (!section.palette.empty()) {
+            writer.beginCompound("block_states").beginList("palette", nbt::TagType::Compound);
+            for (const auto &state : section.palette)
+                writeBlockState(writer, state);
+            writer.endList();
+            if (!section.blocks.empty())
+                writer.writeLongArray("data", {reinterpret_cast<const int64_t *>(section.blocks.data()), section.blocks.size()});
+            writer.endCompound();
+        }
+        if (!section.blockLight.empty())
+            writer.writeByteArray("BlockLight", {reinterpret_cast<const int8_t *>(section.blockLight.data()), section.blockLight.size()});
+        if (!section.skyLight.empty())
+            writer.writeByteArray("SkyLight", {reinterpret_cast<const int8_t *>(section.skyLight.data()), section.skyLight.size()});
+        writer.endCompound();
+    }
+    writer.endList().beginCompound("Heightmaps");
+    for (size_t idx = 0; idx < HEIGHTMAP_ENTRY.size(); idx++)
+        writer.writeLongArray(HEIGHTMAP_ENTRY[idx], chunk.heightMaps[idx]);
+    writer.endCompound().endCompound();
+}
+
+template<typename T>
+static void put(std::vector<uint8_t> &out, T value)
+{
+    value = littleEndian(value);
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * @brief Write an array prefixed by its number of elements
+ */
+template<typename T>
+static void putArray(std::vector<uint8_t> &out, std::span<const T> values)
+{
+    put<uint16_t>(out, values.size());
+    if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+        const auto *bytes = reinterpret_cast<const uint8_t *>(values.data());
+        out.insert(out.end(), bytes, bytes + values.size_bytes());
+    } else {
+        for (const auto value : values)
+            put<T>(out, value);
+    }
+}
+
+void encodeNativeChunk(const ChunkData &chunk, std::vector<uint8_t> &out)
+{
+    out.clear();
+    put<int32_t>(out, chunk.chunkPos.x);
+    put<int32_t>(out, chunk.chunkPos.z);
+    put<uint16_t>(out, chunk.sections.size());
+    for (const auto &section : chunk.sections) {
+        put<int8_t>(out, section.y);
+        put<uint16_t>(out, section.palette.size());
+        for (const auto &state : section.palette)
+            putArray<char>(out, state);
+        putArray<uint64_t>(out, section.blocks);
+        putArray<uint8_t>(out, section.blockLight);
+        putArray<uint8_t>(out, section.skyLight);
+    }
+    for (const auto &heightMap : chunk.heightMaps)
+        putArray<int64_t>(out, heightMap);
+}
+
+/**
+ * @brief Read the next bytes of a native chunk
+ *
+ * @throw std::runtime_error if the chunk is truncated
+ */
+static const uint8_t *take(std::span<const uint8_t> &data, size_t size)
+{
+    if (data.size() < size)
+        throw std::runtime_error("Truncated chunk");
+    const uint8_t *bytes = data.data();
+    data = data.subspan(size);
+    return bytes;
+}
+
+template<typename T>
+static T get(std::span<const uint8_t> &data)
+{
+    T value;
+    std::memcpy(&value, take(data, sizeof(T)), sizeof(T));
+    return littleEndian(value);
+}
+
+/**
+ * @brief Bytes of the next array, prefixed by its number of elements
+ */
+template<typename T>
+static std::span<const uint8_t> getBytes(std::span<const uint8_t> &data)
+{
+    const size_t size = get<uint16_t>(data) * sizeof(T);
+    return {take(data, size), size};
+}
+
+template<typename Container>
+static void getArray(std::span<const uint8_t> &data, Container &out)
+{
+    const auto bytes = getBytes<typename Container::value_type>(data);
+    out.resize(bytes.size() / sizeof(typename Container::value_type));
+    if (!bytes.empty())
+        std::memcpy(out.data(), bytes.data(), bytes.size());
+    for (auto &value : out)
+        value = littleEndian(value);
+}
+
+ChunkData decodeNativeChunk(std::span<const uint8_t> data)
+{
+    ChunkData chunk {};
+    chunk.chunkPos.x = get<int32_t>(data);
+    chunk.chunkPos.z = get<int32_t>(data);
+    chunk.sections.resize(get<uint16_t>(data));
+    for (auto &section : chunk.sections) {
+        section.y = get<int8_t>(data);
+        section.palette.resize(get<uint16_t>(data));
+        for (auto &state : section.palette)
+            getArray(data, state);
+        getArray(data, section.blocks);
+        getArray(data, section.blockLight);
+        getArray(data, section.skyLight);
+    }
+    for (auto &heightMap : chunk.heightMaps) {
+        const auto bytes = getBytes<int64_t>(data);
+        if (bytes.size() != sizeof(heightMap))
+            throw std::runtime_error("Invalid heightmap");
+        std::memcpy(heightMap.data(), bytes.data(), bytes.size());
+        for (auto &value : heightMap)
+            value = littleEndian(value);
+    }
+    return chunk;
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef CUBICSERVER_WORLDSTORAGE_CHUNKDATA_HPP
+#define CUBICSERVER_WORLDSTORAGE_CHUNKDATA_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "nbt_reader.hpp"
+#include "world_storage/ChunkColumn.hpp"
+
+namespace world_storage {
+
+/**
+ * @brief How the chunks of a world are stored on disk
+ */
+enum class StorageFormat {
+    ANVIL = 0, // Vanilla .mca regions, zlib compressed NBT
+    NATIVE // Append-only .cbr regions, zstd compressed binary sections
+};
+
+/**
+ * @brief Parse the storage-format option, "anvil" or "native"
+ *
+ * @throw std::invalid_argument if the format is unknown
+ */
+StorageFormat parseStorageFormat(std::string_view name);
+
+/**
+ * @brief A section as it is stored, whatever the format
+ */
+struct SectionData {
+    int8_t y; // Section index - 5, like the Y tag of the anvil sections
+    std::vector<std::string> palette; // Block states, e.g. minecraft:grass_block[snowy=false], empty without block states
+    std::vector<uint64_t> blocks; // Palette indexes packed in longs, empty with a single value palette
+    std::vector<uint8_t> blockLight; // Nibbles, empty if they must be recalculated
+    std::vector<uint8_t> skyLight;
+};
+
+/**
+ * @brief A fully generated chunk as it is stored, the intermediate step between a chunk column and a region
+ *
+ * Block states are kept as strings so a chunk can be converted from one format to another without the global palette.
+ */
+struct ChunkData {
+    Position2D chunkPos;
+    std::vector<SectionData> sections;
+    std::array<HeightMap, HEIGHTMAP_ENTRY.size()> heightMaps;
+};
+
+/**
+ * @brief Read a chunk of an anvil region
+ *
+ * @return std::nullopt if the chunk is not fully generated
+ * @throw std::runtime_error, nbt::BufferEOF or nbt::TypeMismatch if the chunk is corrupted
+ */
+std::optional<ChunkData> readAnvilChunk(const nbt::TagView &chunk, Position2D chunkPos);
+
+/**
+ * @brief Write a chunk as the uncompressed NBT of an anvil region
+ */
+void writeAnvilChunk(const ChunkData &chunk, std::vector<uint8_t> &out);
+
+/**
+ * @brief Read a chunk of a native region
+ *
+ * @throw std::runtime_error if the chunk is truncated
+ */
+ChunkData decodeNativeChunk(std::span<const uint8_t> data);
+
+/**
+ * @brief Write a chunk as the uncompressed content of a native region
+ *
+ * Sections are written as is, in little endian byte order: the palette strings, the packed longs and the light nibbles.
+ * On little endian hosts the arrays are copied without conversion.
+ */
+void encodeNativeChunk(const ChunkData &chunk, std::vector<uint8_t> &out);
+
+}
+
+#endif // CUBICSERVER_WORLDSTORAGE_CHUNKDATA_HPP
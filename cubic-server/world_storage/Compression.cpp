@@ -0,0 +1,70 @@
+#include "Compression.hpp"
+
+#include <algorithm>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace world_storage {
+
+std::span<const uint8_t> inflateData(std::span<const uint8_t> data, std::vector<uint8_t> &out)
+{
+    z_stream stream {};
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = data.size();
+    // Detects both the zlib and the gzip headers
+    if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK)
+        return {};
+
+    out.resize(std::max(out.size(), data.size() * 4));
+    int ret;
+    do {
+        if (stream.total_out == out.size())
+            out.resize(out.size() * 2);
+        stream.next_out = out.data() + stream.total_out;
+        stream.avail_out = out.size() - stream.total_out;
+        ret = inflate(&stream, Z_NO_FLUSH);
+    } while (ret == Z_OK);
+    inflateEnd(&stream);
+
+    if (ret != Z_STREAM_END)
+        return {};
+    return {out.data(), stream.total_out};
+}
+
+bool deflateData(std::span<const uint8_t> data, std::vector<uint8_t> &out, int windowBits)
+{
+    z_stream stream {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    out.resize(deflateBound(&stream, data.size()));
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = data.size();
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+    const int ret = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END;
+}
+
+bool zstdCompress(std::span<const uint8_t> data, std::vector<uint8_t> &out)
+{
+    out.resize(ZSTD_compressBound(data.size()));
+    const size_t size = ZSTD_compress(out.data(), out.size(), data.data(), data.size(), ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(size))
+        return false;
+    out.resize(size);
+    return true;
+}
+
+std::span<const uint8_t> zstdDecompress(std::span<const uint8_t> data, size_t rawSize, std::vector<uint8_t> &out)
+{
+    out.resize(std::max(out.size(), rawSize));
+    const size_t size = ZSTD_decompress(out.data(), rawSize, data.data(), data.size());
+    if (ZSTD_isError(size) || size != rawSize)
+        return {};
+    return {out.data(), size};
+}
+
+}
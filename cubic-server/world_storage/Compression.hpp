@@ -0,0 +1,41 @@
+#ifndef CUBICSERVER_WORLDSTORAGE_COMPRESSION_HPP
+#define CUBICSERVER_WORLDSTORAGE_COMPRESSION_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace world_storage {
+
+/**
+ * @brief Decompress a zlib or gzip stream into out, which is kept to be reused by the next call
+ *
+ * @return The decompressed data, empty on error
+ */
+std::span<const uint8_t> inflateData(std::span<const uint8_t> data, std::vector<uint8_t> &out);
+
+/**
+ * @brief Compress data into out, a zlib stream for the regions or a gzip stream for the player data files
+ *
+ * @param windowBits MAX_WBITS for zlib, MAX_WBITS + 16 for gzip
+ * @return false on error
+ */
+bool deflateData(std::span<const uint8_t> data, std::vector<uint8_t> &out, int windowBits);
+
+/**
+ * @brief Compress data into a zstd frame, the codec of the native regions
+ *
+ * @return false on error
+ */
+bool zstdCompress(std::span<const uint8_t> data, std::vector<uint8_t> &out);
+
+/**
+ * @brief Decompress a zstd frame of rawSize bytes into out, which is kept to be reused by the next call
+ *
+ * @return The decompressed data, empty on error or if the size does not match
+ */
+std::span<const uint8_t> zstdDecompress(std::span<const uint8_t> data, size_t rawSize, std::vector<uint8_t> &out);
+
+}
+
+#endif // CUBICSERVER_WORLDSTORAGE_COMPRESSION_HPP
@@ -39,6 +39,7 @@ public:
     constexpr void set(uint64_t idx, StoreType value);
     [[nodiscard]] constexpr StoreType get(uint64_t idx) const;
     [[nodiscard]] constexpr bool canContainData() const { return _valueSize != 0; }
+    [[nodiscard]] constexpr uint8_t getValueSize() const { return _valueSize; }
 
     [[nodiscard]] constexpr Array &data() { return _store; }
     [[nodiscard]] constexpr const Array &data() const { return _store; }
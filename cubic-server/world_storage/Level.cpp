@@ -7,39 +7,54 @@ namespace world_storage {
 
 Level::~Level() { }
 
-ChunkColumn &Level::addChunkColumn(Position2D pos, ChunkColumn &&chunkColumn)
+std::shared_ptr<ChunkColumn> Level::addChunkColumn(Position2D pos, ChunkColumn &&chunkColumn)
 {
     std::lock_guard _(this->_chunkColumnsMutex);
-    _chunkColumns.emplace(pos, std::move(chunkColumn));
+    if (!_chunkColumns.contains(pos)) {
+        _chunkColumns.emplace(pos, std::make_shared<ChunkColumn>(std::move(chunkColumn)));
+        _chunkColumnCount++;
+    }
 
     return _chunkColumns.at(pos);
 }
 
-ChunkColumn &Level::addChunkColumn(Position2D pos, std::shared_ptr<Dimension> dimension)
+std::shared_ptr<ChunkColumn> Level::addChunkColumn(Position2D pos, std::shared_ptr<Dimension> dimension)
 {
     std::lock_guard<std::mutex> _(this->chunkColumnsMutex);
-    _chunkColumns.emplace(pos, ChunkColumn {pos, dimension});
+    if (!_chunkColumns.contains(pos)) {
+        _chunkColumns.emplace(pos, std::make_shared<ChunkColumn>(pos, dimension));
+        _chunkColumnCount++;
+    }
     return _chunkColumns.at(pos);
 }
 
 bool Level::hasChunkColumn(const Position2D &pos) const
 {
     std::shared_lock _(_chunkColumnsMutex);
-    return _chunkColumns.contains(pos) && _chunkColumns.at(pos).isReady();
+    return _chunkColumns.contains(pos) && _chunkColumns.at(pos)->isReady();
 }
 
 bool Level::hasChunkColumn(int x, int z) const { return this->hasChunkColumn({x, z}); }
 
+std::shared_ptr<ChunkColumn> Level::findChunkColumn(const Position2D &pos) const
+{
+    std::shared_lock _(_chunkColumnsMutex);
+    auto chunk = _chunkColumns.find(pos);
+    if (chunk == _chunkColumns.end() || !chunk->second->isReady())
+        return nullptr;
+    return chunk->second;
+}
+
 ChunkColumn &Level::getChunkColumn(Position2D pos)
 {
     std::shared_lock _(_chunkColumnsMutex);
-    return _chunkColumns.at(pos);
+    return *_chunkColumns.at(pos);
 }
 
 const ChunkColumn &Level::getChunkColumn(Position2D pos) const
 {
     std::shared_lock _(_chunkColumnsMutex);
-    return _chunkColumns.at(pos);
+    return *_chunkColumns.at(pos);
 }
 
 ChunkColumn &Level::getChunkColumn(int x, int z) { return this->getChunkColumn({x, z}); }
@@ -58,15 +73,21 @@ const ChunkColumn &Level::getChunkColumnFromBlockPos(Position2D pos) const
     return this->getChunkColumn({transformBlockPosToChunkPos(pos.x), transformBlockPosToChunkPos(pos.z)});
 }
 
-void Level::removeChunkColumn(Position2D pos) { _chunkColumns.erase(pos); }
+void Level::removeChunkColumn(Position2D pos)
+{
+    // Chunks are added under either mutex
+    std::scoped_lock _(this->chunkColumnsMutex, this->_chunkColumnsMutex);
+    if (_chunkColumns.erase(pos))
+        _chunkColumnCount--;
+}
 
-const std::unordered_map<Position2D, ChunkColumn> &Level::getChunkColumns() const
+const std::unordered_map<Position2D, std::shared_ptr<ChunkColumn>> &Level::getChunkColumns() const
 {
     std::lock_guard<std::mutex> _(this->chunkColumnsMutex);
     return _chunkColumns;
 }
 
-std::unordered_map<Position2D, ChunkColumn> &Level::getChunkColumns()
+std::unordered_map<Position2D, std::shared_ptr<ChunkColumn>> &Level::getChunkColumns()
 {
     std::lock_guard<std::mutex> _(this->chunkColumnsMutex);
     return _chunkColumns;
@@ -76,6 +97,7 @@ void Level::clear()
 {
     std::lock_guard<std::mutex> _(this->chunkColumnsMutex);
     _chunkColumns.clear();
+    _chunkColumnCount = 0;
 }
 
 } // namespace world_storage
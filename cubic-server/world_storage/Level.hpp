@@ -1,11 +1,13 @@
 #ifndef CUBICSERVER_WORLDSTORAGE_LEVEL_HPP
 #define CUBICSERVER_WORLDSTORAGE_LEVEL_HPP
 
+#include <atomic>
 #include <memory>
 #include <shared_mutex>
 #include <unordered_map>
 
 #include "ChunkColumn.hpp"
+#include "options.hpp"
 #include "types.hpp"
 
 class Dimension;
@@ -15,19 +17,32 @@ constexpr int transformChunkPosToRegionPos(int64_t x) { return x < 0 ? -1 + int6
 
 namespace world_storage {
 
+/**
+ * @brief The chunk columns of a dimension
+ *
+ * Columns are owned through shared pointers: code that keeps a column while other threads run, like a chunk send or a generation,
+ * holds one from findChunkColumn or addChunkColumn so that the column outlives its removal from the level.
+ */
 class Level {
 public:
     Level() = default;
     ~Level();
 
-    ChunkColumn &addChunkColumn(Position2D pos, ChunkColumn &&chunkColumn);
+    std::shared_ptr<ChunkColumn> addChunkColumn(Position2D pos, ChunkColumn &&chunkColumn);
     // ChunkColumn &addChunkColumn(Position2D pos, ChunkColumn &chunkColumn);
 
-    ChunkColumn &addChunkColumn(Position2D pos, std::shared_ptr<Dimension> dimension);
+    std::shared_ptr<ChunkColumn> addChunkColumn(Position2D pos, std::shared_ptr<Dimension> dimension);
 
     bool hasChunkColumn(const Position2D &pos) const;
     bool hasChunkColumn(int x, int z) const;
 
+    /**
+     * @brief Get a chunk column that is ready, it stays valid if it is removed meanwhile
+     *
+     * @return nullptr if the column is not loaded or is still being generated
+     */
+    NODISCARD std::shared_ptr<ChunkColumn> findChunkColumn(const Position2D &pos) const;
+
     /** Get the chunk from chunk coordinate */
     ChunkColumn &getChunkColumn(Position2D pos);
     ChunkColumn &getChunkColumn(int x, int z);
@@ -42,8 +57,13 @@ public:
 
     void removeChunkColumn(Position2D pos);
 
-    const std::unordered_map<Position2D, ChunkColumn> &getChunkColumns() const;
-    std::unordered_map<Position2D, ChunkColumn> &getChunkColumns();
+    /**
+     * @brief Number of chunk columns in memory, lock free
+     */
+    NODISCARD size_t getChunkColumnCount() const { return _chunkColumnCount.load(std::memory_order_relaxed); }
+
+    const std::unordered_map<Position2D, std::shared_ptr<ChunkColumn>> &getChunkColumns() const;
+    std::unordered_map<Position2D, std::shared_ptr<ChunkColumn>> &getChunkColumns();
 
     void clear();
 
@@ -51,7 +71,8 @@ public:
 
 private:
     mutable std::shared_mutex _chunkColumnsMutex;
-    std::unordered_map<Position2D, ChunkColumn> _chunkColumns;
+    std::unordered_map<Position2D, std::shared_ptr<ChunkColumn>> _chunkColumns;
+    std::atomic<size_t> _chunkColumnCount = 0;
 };
 
 }
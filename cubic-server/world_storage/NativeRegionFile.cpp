@@ -0,0 +1,265 @@
+#include "NativeRegionFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "logging/logging.hpp"
+#include "world_storage/Compression.hpp"
+
+namespace world_storage {
+
+// The file is compacted once it is twice as big as its live chunks, and by at least this much
+constexpr uint64_t minCompactedSize = 1024 * 1024;
+
+/**
+ * @brief Convert a header between the host byte order and the byte order of the file
+ */
+static NativeChunkHeader swapHeader(const NativeChunkHeader &header)
+{
+    return {
+        littleEndian(header.magic),
+        littleEndian(header.index),
+        header.compressionScheme,
+        header.version,
+        littleEndian(header.rawSize),
+        littleEndian(header.size),
+        littleEndian(header.checksum),
+    };
+}
+
+NativeRegionFile::NativeRegionFile(const std::filesystem::path &path):
+    _path(path),
+    _fd(-1),
+    _size(0),
+    _liveSize(0),
+    _records {}
+{
+    std::filesystem::create_directories(path.parent_path());
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd == -1)
+        throw std::runtime_error("Could not open " + path.string() + ": " + strerror(errno));
+
+    const auto file = _readFile(_fd);
+    _size = _scan(file, _records);
+    // Drops the chunk a crash left half written, the next ones are appended right after the valid ones
+    if (_size != file.size() && ftruncate(_fd, _size) == -1)
+        throw std::runtime_error("Could not truncate " + path.string() + ": " + strerror(errno));
+    for (const auto &record : _records)
+        _liveSize += record.size;
+}
+
+NativeRegionFile::~NativeRegionFile()
+{
+    if (_fd != -1)
+        ::close(_fd);
+}
+
+void NativeRegionFile::write(uint16_t x, uint16_t z, std::span<const uint8_t> data)
+{
+    if (!zstdCompress(data, _compressed))
+        throw std::runtime_error("Could not compress chunk " + std::to_string(x) + " " + std::to_string(z) + " of " + _path.string());
+
+    const uint16_t index = x + z * maxXPerRegion;
+    const NativeChunkHeader header = {
+        nativeChunkMagic,
+        index,
+        nativeCompressionZstd,
+        nativeChunkVersion,
+        static_cast<uint32_t>(data.size()),
+        static_cast<uint32_t>(_compressed.size()),
+        static_cast<uint32_t>(crc32(0, _compressed.data(), _compressed.size())),
+    };
+    const NativeChunkHeader fileHeader = swapHeader(header);
+    _pwrite(&fileHeader, sizeof(fileHeader), _size);
+    _pwrite(_compressed.data(), _compressed.size(), _size + sizeof(header));
+    // Synced before the chunk is reported as saved
+    if (fdatasync(_fd) == -1)
+        throw std::runtime_error("Could not sync " + _path.string() + ": " + strerror(errno));
+
+    const uint32_t size = sizeof(header) + _compressed.size();
+    _liveSize = _liveSize - _records[index].size + size;
+    _records[index] = {_size, size};
+    _size += size;
+
+    if (_size > 2 * _liveSize && _size - _liveSize > minCompactedSize) {
+        try {
+            this->_compact();
+        } catch (const std::exception &e) {
+            // The chunk is saved, the region stays as it is until the next write
+            LWARN("Could not compact {}: {}", _path.string(), e.what());
+        }
+    }
+}
+
+std::span<const uint8_t> NativeRegionFile::readChunk(uint16_t x, uint16_t z, std::vector<uint8_t> &buffer)
+{
+    const Record &record = _records[x + z * maxXPerRegion];
+    if (record.size == 0)
+        return {};
+
+    // The chunk was checked when it was written or when the file was opened
+    _compressed.resize(record.size);
+    this->_pread(_compressed.data(), _compressed.size(), record.offset);
+    NativeChunkHeader header;
+    std::memcpy(&header, _compressed.data(), sizeof(header));
+    header = swapHeader(header);
+    if (header.version != nativeChunkVersion || header.compressionScheme != nativeCompressionZstd)
+        return {};
+    return zstdDecompress({_compressed.data() + sizeof(header), header.size}, header.rawSize, buffer);
+}
+
+bool NativeRegionFile::read(
+    const std::filesystem::path &path, std::vector<uint8_t> &buffer, const std::function<void(uint16_t x, uint16_t z, std::span<const uint8_t> data)> &onChunk
+)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT)
+            return false;
+        throw std::runtime_error("Could not open " + path.string() + ": " + strerror(errno));
+    }
+    std::vector<uint8_t> file;
+    try {
+        file = _readFile(fd);
+    } catch (const std::exception &) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    std::array<Record, numChunksPerRegion> records {};
+    _scan(file, records);
+    for (uint16_t index = 0; index < numChunksPerRegion; index++) {
+        if (records[index].size == 0)
+            continue;
+        NativeChunkHeader header;
+        std::memcpy(&header, file.data() + records[index].offset, sizeof(header));
+        header = swapHeader(header);
+        std::span<const uint8_t> data;
+        // Chunks of an unknown version or codec are reported as corrupted
+        if (header.version == nativeChunkVersion && header.compressionScheme == nativeCompressionZstd)
+            data = zstdDecompress({file.data() + records[index].offset + sizeof(header), header.size}, header.rawSize, buffer);
+        onChunk(index % maxXPerRegion, index / maxXPerRegion, data);
+    }
+    return true;
+}
+
+uint64_t NativeRegionFile::_scan(std::span<const uint8_t> file, std::array<Record, numChunksPerRegion> &records)
+{
+    uint64_t offset = 0;
+    while (file.size() - offset >= sizeof(NativeChunkHeader)) {
+        NativeChunkHeader header;
+        std::memcpy(&header, file.data() + offset, sizeof(header));
+        header = swapHeader(header);
+        if (header.magic != nativeChunkMagic || header.index >= numChunksPerRegion || header.size > file.size() - offset - sizeof(header))
+            break;
+        if (crc32(0, file.data() + offset + sizeof(header), header.size) != header.checksum)
+            break;
+        records[header.index] = {offset, static_cast<uint32_t>(sizeof(header) + header.size)};
+        offset += sizeof(header) + header.size;
+    }
+    return offset;
+}
+
+std::vector<uint8_t> NativeRegionFile::_readFile(int fd)
+{
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) == -1)
+        throw std::runtime_error(std::string("Could not stat a region: ") + strerror(errno));
+
+    std::vector<uint8_t> file(stat_buf.st_size);
+    size_t done = 0;
+    while (done < file.size()) {
+        const ssize_t got = ::pread(fd, file.data() + done, file.size() - done, done);
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            throw std::runtime_error(std::string("Could not read a region: ") + strerror(errno));
+        done += got;
+    }
+    return file;
+}
+
+void NativeRegionFile::_compact()
+{
+    const auto file = _readFile(_fd);
+    auto records = _records;
+    std::vector<uint8_t> compacted;
+    compacted.reserve(_liveSize);
+    for (auto &record : records) {
+        if (record.size == 0)
+            continue;
+        const uint64_t offset = compacted.size();
+        compacted.insert(compacted.end(), file.begin() + record.offset, file.begin() + record.offset + record.size);
+        record.offset = offset;
+    }
+
+    auto tmpPath = _path;
+    tmpPath += ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        throw std::runtime_error("Could not open " + tmpPath.string() + ": " + strerror(errno));
+    std::swap(_fd, fd);
+    try {
+        _pwrite(compacted.data(), compacted.size(), 0);
+        // Synced before it replaces the region, a crash must leave either the old or the whole new file
+        if (fsync(_fd) == -1)
+            throw std::runtime_error("Could not sync " + tmpPath.string() + ": " + strerror(errno));
+        // The compacted file replaces the region at once, readers see either of them
+        std::filesystem::rename(tmpPath, _path);
+    } catch (const std::exception &) {
+        std::swap(_fd, fd);
+        ::close(fd);
+        std::filesystem::remove(tmpPath);
+        throw;
+    }
+    ::close(fd);
+    _records = records;
+    _size = compacted.size();
+
+    // Until the directory is synced, a crash may bring back the old file, which still holds every chunk
+    const int dirFd = ::open(_path.parent_path().c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd == -1 || fsync(dirFd) == -1)
+        LWARN("Could not sync the directory of {}: {}", _path.string(), strerror(errno));
+    if (dirFd != -1)
+        ::close(dirFd);
+}
+
+void NativeRegionFile::_pwrite(const void *data, size_t size, uint64_t offset)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t written = ::pwrite(_fd, bytes, size, offset);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Could not write " + _path.string() + ": " + strerror(errno));
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+}
+
+void NativeRegionFile::_pread(void *data, size_t size, uint64_t offset)
+{
+    auto *bytes = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t got = ::pread(_fd, bytes, size, offset);
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            throw std::runtime_error("Could not read " + _path.string() + ": " + (got == 0 ? "unexpected end of file" : strerror(errno)));
+        bytes += got;
+        size -= got;
+        offset += got;
+    }
+}
+
+}
@@ -0,0 +1,133 @@
+#ifndef CUBICSERVER_WORLDSTORAGE_NATIVEREGIONFILE_HPP
+#define CUBICSERVER_WORLDSTORAGE_NATIVEREGIONFILE_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "world_storage/RegionFile.hpp"
+
+namespace world_storage {
+
+constexpr uint32_t nativeChunkMagic = 0x4B434243; // "CBCK" on disk
+constexpr uint8_t nativeChunkVersion = 1;
+constexpr uint8_t nativeCompressionZstd = 1;
+constexpr const char *nativeRegionExtension = ".cbr";
+
+/**
+ * @brief Convert a value between the host byte order and the little endian byte order of the native regions
+ */
+template<typename T>
+constexpr T littleEndian(T value)
+{
+    if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+        return value;
+    } else {
+        auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+        std::reverse(bytes.begin(), bytes.end());
+        return std::bit_cast<T>(bytes);
+    }
+}
+
+/**
+ * @brief Header of every chunk of a native region, in little endian byte order
+ */
+struct __attribute__((__packed__)) NativeChunkHeader {
+    uint32_t magic;
+    uint16_t index; // x + z * maxXPerRegion
+    uint8_t compressionScheme;
+    uint8_t version;
+    uint32_t rawSize; // Size of the chunk once decompressed
+    uint32_t size; // Size of the compressed chunk following the header
+    uint32_t checksum; // CRC32 of the compressed chunk
+};
+
+/**
+ * @brief Region file of the native storage format
+ *
+ * Chunks are appended to the file and the last valid copy of a chunk wins, so a chunk is never overwritten in place.
+ * Every append is synced before write returns, so a crash can only lose the chunk being appended.
+ * The file is compacted once most of it is made of stale copies, the compacted copy is synced before it replaces the region.
+ */
+class NativeRegionFile {
+public:
+    /**
+     * @brief Open the region file, it is created if it does not exist
+     *
+     * A truncated or corrupted end of file, left by a crash during a write, is dropped.
+     *
+     * @throw std::runtime_error if the file cannot be opened
+     */
+    explicit NativeRegionFile(const std::filesystem::path &path);
+    ~NativeRegionFile();
+    NativeRegionFile(const NativeRegionFile &) = delete;
+    NativeRegionFile &operator=(const NativeRegionFile &) = delete;
+
+    /**
+     * @brief Compress and append a chunk, replacing its previous copy
+     *
+     * The chunk is synced to the disk before returning.
+     *
+     * @param x The X coordinate of the chunk in the region
+     * @param z The Z coordinate of the chunk in the region
+     * @param data The uncompressed chunk
+     * @throw std::runtime_error if the chunk cannot be compressed or the file cannot be written
+     */
+    void write(uint16_t x, uint16_t z, std::span<const uint8_t> data);
+
+    /**
+     * @brief Read a chunk of the region
+     *
+     * @param x The X coordinate of the chunk in the region
+     * @param z The Z coordinate of the chunk in the region
+     * @param buffer Holds the decompressed chunk, kept to be reused by the next call
+     * @return The decompressed chunk, empty if it is not stored or of an unknown version or cannot be decompressed
+     * @throw std::runtime_error if the file cannot be read
+     */
+    std::span<const uint8_t> readChunk(uint16_t x, uint16_t z, std::vector<uint8_t> &buffer);
+
+    /**
+     * @brief Read the last valid copy of every chunk of a region file
+     *
+     * @param buffer Holds the decompressed chunks, kept to be reused by the next call
+     * @param onChunk Called with the coordinates of the chunk in the region and the decompressed chunk
+     * @return false if the file does not exist
+     * @throw std::runtime_error if the file cannot be read
+     */
+    static bool read(
+        const std::filesystem::path &path, std::vector<uint8_t> &buffer, const std::function<void(uint16_t x, uint16_t z, std::span<const uint8_t> data)> &onChunk
+    );
+
+private:
+    struct Record {
+        uint64_t offset;
+        uint32_t size; // Header included, 0 if the chunk is not stored
+    };
+
+    /**
+     * @brief Index the last valid copy of every chunk
+     *
+     * @return The size of the valid part of the file
+     */
+    static uint64_t _scan(std::span<const uint8_t> file, std::array<Record, numChunksPerRegion> &records);
+    static std::vector<uint8_t> _readFile(int fd);
+    void _compact();
+    void _pwrite(const void *data, size_t size, uint64_t offset);
+    void _pread(void *data, size_t size, uint64_t offset);
+
+    std::filesystem::path _path;
+    int _fd;
+    uint64_t _size;
+    uint64_t _liveSize; // Size of the last copies of the chunks, the rest of the file is stale
+    std::array<Record, numChunksPerRegion> _records;
+    std::vector<uint8_t> _compressed; // Chunk being written or read
+};
+
+}
+
+#endif // CUBICSERVER_WORLDSTORAGE_NATIVEREGIONFILE_HPP
@@ -15,12 +15,28 @@ world_storage::BiomePalette::BiomePalette()
     // _idCount.emplace(0, world_storage::BIOME_SECTION_3D_SIZE);
 }
 
+world_storage::Palette::Palette(const world_storage::Palette &palette):
+    _lock()
+{
+    std::lock_guard _(palette._lock);
+    _nameToId = palette._nameToId;
+}
+
 world_storage::Palette::Palette(world_storage::Palette &&palette):
     _lock(),
     _nameToId(palette._nameToId)
 {
 }
 
+world_storage::Palette &world_storage::Palette::operator=(const world_storage::Palette &palette)
+{
+    if (this == &palette)
+        return *this;
+    std::scoped_lock _(_lock, palette._lock);
+    _nameToId = palette._nameToId;
+    return *this;
+}
+
 void world_storage::Palette::add(int32_t globalId)
 {
     // auto it = std::find_if(_idCount.begin(), _idCount.end(), [globalId](const auto &p) {
@@ -16,7 +16,9 @@ constexpr uint8_t bitsNeeded(int32_t n) { return n <= 1 ? 0 : 1 + bitsNeeded((n
 class Palette {
 public:
     Palette() = default;
+    Palette(const Palette &palette);
     Palette(Palette &&palette);
+    Palette &operator=(const Palette &palette);
     virtual ~Palette() = default;
 
     constexpr uint64_t getId(int32_t globalId) const
@@ -55,7 +57,9 @@ protected:
 class BlockPalette : public Palette {
 public:
     BlockPalette();
+    BlockPalette(const BlockPalette &palette) = default;
     BlockPalette(BlockPalette &&palette) = default;
+    BlockPalette &operator=(const BlockPalette &palette) = default;
     ~BlockPalette() = default;
 
     constexpr uint8_t getBits() const override
@@ -79,7 +83,9 @@ public:
 class BiomePalette : public Palette {
 public:
     BiomePalette();
+    BiomePalette(const BiomePalette &palette) = default;
     BiomePalette(BiomePalette &&palette) = default;
+    BiomePalette &operator=(const BiomePalette &palette) = default;
     ~BiomePalette() = default;
 
     constexpr uint8_t getBits() const override
@@ -5,8 +5,10 @@
 #include "logging/logging.hpp"
 #include "nbt.h"
 #include "nbt.hpp"
+#include "nbt_arena.hpp"
 #include "types.hpp"
 #include "world_storage/ChunkColumn.hpp"
+#include "world_storage/Compression.hpp"
 #include "world_storage/Level.hpp"
 #include "world_storage/LevelData.hpp"
 #include "world_storage/PlayerData.hpp"
@@ -17,13 +19,18 @@
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <netinet/in.h>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/stat.h>
+#include <type_traits>
 #include <vector>
 #include <zlib.h>
 
@@ -83,11 +90,21 @@ static inline const std::shared_ptr<T> getConstElement(const std::shared_ptr<nbt
 
 namespace world_storage {
 
-Persistence::Persistence(const std::string &folder):
-    _folder(folder)
+Persistence::Persistence(const std::string &folder, StorageFormat format):
+    _folder(folder),
+    _format(format),
+    _pendingChunkBytes(0),
+    _playerDataPool(1, "PlayerData"),
+    _regionWritePool(1, "RegionWriter")
 {
 }
 
+Persistence::~Persistence()
+{
+    this->flushChunks();
+    this->flushPlayerData();
+}
+
 struct _userData {
     char *start;
     char *end;
@@ -105,6 +122,95 @@ static size_t _readMem(void *ud, uint8_t *d, size_t s)
     return toCopy;
 }
 
+template<typename T>
+static T tagValue(const nbt::TagView &tag)
+{
+    if constexpr (std::is_same_v<T, int8_t>)
+        return tag.getByte();
+    else if constexpr (std::is_same_v<T, int16_t>)
+        return tag.getShort();
+    else if constexpr (std::is_same_v<T, int32_t>)
+        return tag.getInt();
+    else if constexpr (std::is_same_v<T, float>)
+        return tag.getFloat();
+    else if constexpr (std::is_same_v<T, double>)
+        return tag.getDouble();
+    else
+        return T(tag.getString());
+}
+
+/**
+ * @brief Read a tag of a compound into dst, which is left untouched if the tag is missing
+ *
+ * @throw nbt::TypeMismatch if the tag has another type
+ */
+template<typename T>
+static void readTag(const nbt::TagView &compound, std::string_view name, T &dst)
+{
+    auto tag = compound.find(name);
+    if (tag)
+        dst = tagValue<T>(*tag);
+}
+
+template<typename T, size_t N>
+static void readList(const nbt::TagView &compound, std::string_view name, std::array<T, N> &dst)
+{
+    auto tag = compound.find(name, nbt::TagType::List);
+    if (!tag || tag->size() != N)
+        return;
+    size_t i = 0;
+    for (const auto &element : *tag)
+        dst[i++] = tagValue<T>(element);
+}
+
+/**
+ * @brief Set a tag of a compound, replacing the tag of the same name if it has another type
+ */
+template<typename T>
+static void writeTag(nbt::arena::Tag &compound, std::string_view name, const T &value)
+{
+    if constexpr (std::is_same_v<T, int8_t>) {
+        if (auto *tag = compound.find(name); tag && tag->getType() == nbt::TagType::Byte)
+            return tag->setByte(value);
+        compound.remove(name);
+        compound.addByte(name, value);
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+        if (auto *tag = compound.find(name); tag && tag->getType() == nbt::TagType::Short)
+            return tag->setShort(value);
+        compound.remove(name);
+        compound.addShort(name, value);
+    } else if constexpr (std::is_same_v<T, int32_t>) {
+        if (auto *tag = compound.find(name); tag && tag->getType() == nbt::TagType::Int)
+            return tag->setInt(value);
+        compound.remove(name);
+        compound.addInt(name, value);
+    } else if constexpr (std::is_same_v<T, float>) {
+        if (auto *tag = compound.find(name); tag && tag->getType() == nbt::TagType::Float)
+            return tag->setFloat(value);
+        compound.remove(name);
+        compound.addFloat(name, value);
+    } else {
+        // Strings cannot be resized in place
+        compound.remove(name);
+        compound.addString(name, value);
+    }
+}
+
+template<typename T, size_t N>
+static void writeList(nbt::arena::Tag &compound, std::string_view name, const std::array<T, N> &values)
+{
+    compound.remove(name);
+    if constexpr (std::is_same_v<T, float>) {
+        auto &list = compound.addList(name, nbt::TagType::Float);
+        for (const auto value : values)
+            list.addFloat("", value);
+    } else {
+        auto &list = compound.addList(name, nbt::TagType::Double);
+        for (const auto value : values)
+            list.addDouble("", value);
+    }
+}
+
 static int64_t getFileSize(const std::string &filename)
 {
     struct stat stat_buf;
@@ -124,8 +230,13 @@ static char *loadFile(const std::string &file, size_t *size)
     char *fileContents = (char *) malloc(fileSize);
 
     FILE *openedFile = fopen(file.c_str(), "r");
+    if (!openedFile) {
+        free(fileContents);
+        return nullptr;
+    }
 
     *size = fread(fileContents, 1, fileSize, openedFile);
+    fclose(openedFile);
 
     if (*size != (size_t) fileSize) {
         LFATAL("Could not read everything from {}", file);
@@ -233,98 +344,67 @@ LevelData Persistence::loadLevelData()
     return data;
 }
 
+std::filesystem::path Persistence::_playerDataFile(u128 uuid) const { return std::filesystem::path(_folder) / "playerdata" / (uuid.toString() + ".dat"); }
+
 void Persistence::loadPlayerData(u128 uuid, PlayerData &dest)
 {
-    std::unique_lock<std::mutex> lock(_accessMutex);
-
-    // TODO
-    const std::filesystem::path file = std::filesystem::path(_folder) / "playerdata" / (uuid.toString() + ".dat");
+    const std::filesystem::path file = _playerDataFile(uuid);
 
     size_t fileSize = 0;
-    char *fileData = loadFile(file, &fileSize);
+    std::unique_ptr<char, decltype(&free)> fileData(loadFile(file, &fileSize), &free);
     if (!fileData)
-        throw std::runtime_error("Could not open file " + _folder);
-
-    // clang-format off
-    _userData ud = {
-        fileData,
-        fileData + fileSize - 1
-    };
-    nbt_reader_t reader = {
-        _readMem,
-        &ud
-    };
-    // clang-format on
-    auto *root = nbt_parse(reader, NBT_PARSE_FLAG_USE_ZLIB);
-    assert(root);
-    assert(root->type == NBT_TYPE_COMPOUND);
-
-    // TODO(huntears): Map the values to the destination object
-    GET_VALUE_FLOAT(absorptionAmount, "AbsorptionAmount", root);
-    GET_VALUE_SHORT(air, "Air", root);
-    GET_VALUE_INT(dataVersion, "DataVersion", root);
-    GET_VALUE_SHORT(deathTime, "DeathTime", root);
-    GET_VALUE_STRING(dimension, "Dimension", root);
-    GET_VALUE_FLOAT(fallDistance, "FallDistance", root);
-    GET_VALUE_BYTE(fallFlying, "FallFlying", root);
-    GET_VALUE_SHORT(fire, "Fire", root);
-    GET_VALUE_FLOAT(health, "Health", root);
-    GET_VALUE_INT(hurtByTimestamp, "HurtByTimestamp", root);
-    GET_VALUE_SHORT(hurtTime, "HurtTime", root);
-    GET_VALUE_BYTE(invulnerable, "Invulnerable", root);
-    {
-        auto *__tmpList = nbt_tag_compound_get(root, "Motion");
-        assert(__tmpList);
-        assert(__tmpList->type == NBT_TYPE_LIST);
-        assert(__tmpList->tag_list.size == 3);
-        assert(__tmpList->tag_list.type == NBT_TYPE_DOUBLE);
-        dest.motion.x = __tmpList->tag_list.value[0]->tag_double.value;
-        dest.motion.y = __tmpList->tag_list.value[1]->tag_double.value;
-        dest.motion.z = __tmpList->tag_list.value[2]->tag_double.value;
+        throw std::runtime_error("Could not open file " + file.string());
+
+    std::vector<uint8_t> buffer;
+    auto data = inflateData({reinterpret_cast<const uint8_t *>(fileData.get()), fileSize}, buffer);
+    if (data.empty())
+        throw std::runtime_error("Could not decompress " + file.string());
+    const auto root = nbt::TagView::root(data);
+
+    readTag(root, "AbsorptionAmount", dest.absorptionAmount);
+    readTag(root, "Air", dest.air);
+    readTag(root, "DataVersion", dest.dataVersion);
+    readTag(root, "DeathTime", dest.deathTime);
+    readTag(root, "Dimension", dest.dimension);
+    readTag(root, "FallDistance", dest.fallDistance);
+    readTag(root, "FallFlying", dest.fallFlying);
+    int16_t fire = dest.fire;
+    readTag(root, "Fire", fire);
+    dest.fire = fire;
+    readTag(root, "Health", dest.health);
+    readTag(root, "HurtByTimestamp", dest.hurtByTimestamp);
+    readTag(root, "HurtTime", dest.hurtTime);
+    readTag(root, "Invulnerable", dest.invulnerable);
+    std::array<double, 3> motion = {dest.motion.x, dest.motion.y, dest.motion.z};
+    readList(root, "Motion", motion);
+    dest.motion = {motion[0], motion[1], motion[2]};
+    readTag(root, "OnGround", dest.onGround);
+    readTag(root, "PortalCooldown", dest.portalCooldown);
+    std::array<double, 3> pos = {dest.pos.x, dest.pos.y, dest.pos.z};
+    readList(root, "Pos", pos);
+    dest.pos = {pos[0], pos[1], pos[2]};
+    std::array<float, 2> rotation = {dest.rotation.yaw, dest.rotation.pitch};
+    readList(root, "Rotation", rotation);
+    dest.rotation = {rotation[0], rotation[1]};
+    readTag(root, "Score", dest.score);
+    readTag(root, "SelectedItemSlot", dest.selectedItemSlot);
+    readTag(root, "SleepTimer", dest.sleepTimer);
+    if (auto uuidTag = root.find("UUID", nbt::TagType::IntArray); uuidTag && uuidTag->size() == 4) {
+        std::array<int32_t, 4> uuidInts;
+        uuidTag->copyIntArray(uuidInts);
+        dest.uuid.most = (uint64_t) (uint32_t) uuidInts[0] << 32 | (uint32_t) uuidInts[1];
+        dest.uuid.least = (uint64_t) (uint32_t) uuidInts[2] << 32 | (uint32_t) uuidInts[3];
     }
-    GET_VALUE_BYTE(onGround, "OnGround", root);
-    GET_VALUE_INT(portalCooldown, "PortalCooldown", root);
-    {
-        auto *__tmpList = nbt_tag_compound_get(root, "Pos");
-        assert(__tmpList);
-        assert(__tmpList->type == NBT_TYPE_LIST);
-        assert(__tmpList->tag_list.size == 3);
-        assert(__tmpList->tag_list.type == NBT_TYPE_DOUBLE);
-        dest.pos.x = __tmpList->tag_list.value[0]->tag_double.value;
-        dest.pos.y = __tmpList->tag_list.value[1]->tag_double.value;
-        dest.pos.z = __tmpList->tag_list.value[2]->tag_double.value;
-    }
-    {
-        auto *__tmpList = nbt_tag_compound_get(root, "Rotation");
-        assert(__tmpList);
-        assert(__tmpList->type == NBT_TYPE_LIST);
-        assert(__tmpList->tag_list.size == 2);
-        assert(__tmpList->tag_list.type == NBT_TYPE_FLOAT);
-        dest.rotation.yaw = __tmpList->tag_list.value[0]->tag_float.value;
-        dest.rotation.pitch = __tmpList->tag_list.value[1]->tag_float.value;
-    }
-    GET_VALUE_INT(score, "Score", root);
-    GET_VALUE_INT(selectedItemSlot, "SelectedItemSlot", root);
-    GET_VALUE_SHORT(sleepTimer, "SleepTimer", root);
-    {
-        auto *__tmpArray = nbt_tag_compound_get(root, "Rotation");
-        assert(__tmpArray);
-        assert(__tmpArray->type == NBT_TYPE_INT_ARRAY);
-        assert(__tmpArray->tag_int_array.size == 4);
-        dest.uuid.most = *(uint64_t *) &__tmpArray->tag_int_array.value[0];
-        dest.uuid.least = *(uint64_t *) &__tmpArray->tag_int_array.value[2];
-        dest.uuid.swapEndianness();
-    }
-    GET_VALUE_INT(xpLevel, "XpLevel", root);
-    GET_VALUE_FLOAT(xpP, "XpP", root);
-    GET_VALUE_INT(xpSeed, "XpSeed", root);
-    GET_VALUE_INT(xpTotal, "XpTotal", root);
-    GET_VALUE_FLOAT(foodExhaustionLevel, "foodExhaustionLevel", root);
-    GET_VALUE_INT(foodLevel, "foodLevel", root);
-    GET_VALUE_FLOAT(foodSaturationLevel, "foodSaturationLevel", root);
-    GET_VALUE_INT(foodTickTimer, "foodTickTimer", root);
-    GET_VALUE_INT(playerGameType, "playerGameType", root);
-    GET_VALUE_BYTE(seenCredits, "seenCredits", root);
+    readTag(root, "XpLevel", dest.xpLevel);
+    readTag(root, "XpP", dest.xpP);
+    readTag(root, "XpSeed", dest.xpSeed);
+    readTag(root, "XpTotal", dest.xpTotal);
+    readTag(root, "foodExhaustionLevel", dest.foodExhaustionLevel);
+    readTag(root, "foodLevel", dest.foodLevel);
+    readTag(root, "foodSaturationLevel", dest.foodSaturationLevel);
+    readTag(root, "foodTickTimer", dest.foodTickTimer);
+    readTag(root, "playerGameType", dest.playerGameType);
+    readTag(root, "seenCredits", dest.seenCredits);
 }
 
 PlayerData Persistence::loadPlayerData(u128 uuid)
@@ -339,6 +419,115 @@ void Persistence::loadPlayerData(const Player &player, PlayerData &dest) { loadP
 
 PlayerData Persistence::loadPlayerData(const Player &player) { return loadPlayerData(player.getUuid()); }
 
+std::future<std::optional<PlayerData>> Persistence::loadPlayerDataAsync(u128 uuid)
+{
+    // std::function needs a copyable job
+    auto promise = std::make_shared<std::promise<std::optional<PlayerData>>>();
+    auto future = promise->get_future();
+
+    _playerDataPool.addJob([this, uuid, promise] {
+        if (!std::filesystem::exists(_playerDataFile(uuid))) {
+            promise->set_value(std::nullopt);
+            return;
+        }
+        PlayerData data {};
+        try {
+            this->loadPlayerData(uuid, data);
+            promise->set_value(std::move(data));
+        } catch (const std::exception &e) {
+            LERROR("Could not load the data of player {}: {}", uuid.toString(), e.what());
+            promise->set_value(std::nullopt);
+        }
+    });
+    return future;
+}
+
+void Persistence::savePlayerData(u128 uuid, const PlayerData &data)
+{
+    // Most significant int first, like the game
+    const std::array<int32_t, 4> uuidInts = {(int32_t) (uuid.most >> 32), (int32_t) uuid.most, (int32_t) (uuid.least >> 32), (int32_t) uuid.least};
+
+    const std::filesystem::path file = _playerDataFile(uuid);
+
+    // The tags the server does not handle yet (inventory, abilities, attributes...) are kept from the previous file
+    nbt::arena::Document document;
+    if (std::filesystem::exists(file)) {
+        size_t fileSize = 0;
+        std::unique_ptr<char, decltype(&free)> fileData(loadFile(file, &fileSize), &free);
+        if (!fileData)
+            throw std::runtime_error("Could not open file " + file.string());
+        std::vector<uint8_t> buffer;
+        auto previous = inflateData({reinterpret_cast<const uint8_t *>(fileData.get()), fileSize}, buffer);
+        if (previous.empty())
+            throw std::runtime_error("Could not decompress " + file.string() + ", it is not overwritten");
+        for (const auto &tag : nbt::TagView::root(previous))
+            document.import(document.getRoot(), tag);
+    }
+
+    auto &root = document.getRoot();
+    writeTag(root, "AbsorptionAmount", data.absorptionAmount);
+    writeTag(root, "Air", data.air);
+    writeTag(root, "DataVersion", data.dataVersion);
+    writeTag(root, "DeathTime", data.deathTime);
+    writeTag(root, "Dimension", data.dimension);
+    writeTag(root, "FallDistance", data.fallDistance);
+    writeTag(root, "FallFlying", data.fallFlying);
+    writeTag(root, "Fire", (int16_t) data.fire);
+    writeTag(root, "Health", data.health);
+    writeTag(root, "HurtByTimestamp", data.hurtByTimestamp);
+    writeTag(root, "HurtTime", data.hurtTime);
+    writeTag(root, "Invulnerable", data.invulnerable);
+    writeList(root, "Motion", std::array<double, 3> {data.motion.x, data.motion.y, data.motion.z});
+    writeTag(root, "OnGround", data.onGround);
+    writeTag(root, "PortalCooldown", data.portalCooldown);
+    writeList(root, "Pos", std::array<double, 3> {data.pos.x, data.pos.y, data.pos.z});
+    writeList(root, "Rotation", std::array<float, 2> {data.rotation.yaw, data.rotation.pitch});
+    writeTag(root, "Score", data.score);
+    writeTag(root, "SelectedItemSlot", data.selectedItemSlot);
+    writeTag(root, "SleepTimer", data.sleepTimer);
+    root.remove("UUID");
+    root.addIntArray("UUID", uuidInts);
+    writeTag(root, "XpLevel", data.xpLevel);
+    writeTag(root, "XpP", data.xpP);
+    writeTag(root, "XpSeed", data.xpSeed);
+    writeTag(root, "XpTotal", data.xpTotal);
+    writeTag(root, "foodExhaustionLevel", data.foodExhaustionLevel);
+    writeTag(root, "foodLevel", data.foodLevel);
+    writeTag(root, "foodSaturationLevel", data.foodSaturationLevel);
+    writeTag(root, "foodTickTimer", data.foodTickTimer);
+    writeTag(root, "playerGameType", data.playerGameType);
+    writeTag(root, "seenCredits", data.seenCredits);
+    const auto raw = document.serialize();
+
+    std::vector<uint8_t> compressed;
+    if (!deflateData(raw, compressed, MAX_WBITS + 16))
+        throw std::runtime_error("Could not compress the data of player " + uuid.toString());
+
+    std::filesystem::create_directories(file.parent_path());
+    auto tmpFile = file;
+    tmpFile += ".tmp";
+    std::ofstream stream(tmpFile, std::ios::binary);
+    stream.write(reinterpret_cast<const char *>(compressed.data()), compressed.size());
+    stream.close();
+    if (!stream)
+        throw std::runtime_error("Could not write file " + tmpFile.string());
+    std::filesystem::rename(tmpFile, file);
+}
+
+void Persistence::savePlayerDataAsync(u128 uuid, PlayerData data)
+{
+    _playerDataPool.addJob([this, uuid, data = std::move(data)] {
+        try {
+            this->savePlayerData(uuid, data);
+            LDEBUG("Saved the data of player {}", uuid.toString());
+        } catch (const std::exception &e) {
+            LERROR("Could not save the data of player {}: {}", uuid.toString(), e.what());
+        }
+    });
+}
+
+void Persistence::flushPlayerData() { _playerDataPool.waitUntilJobsDone(); }
+
 void Persistence::loadRegion(Dimension &dim, int x, int z)
 {
     std::unique_lock<std::mutex> lock(_accessMutex);
@@ -350,234 +539,348 @@ void Persistence::loadRegion(Dimension &dim, int x, int z)
 
     _regionStore.emplace_back(x, z);
 
-    const std::string regionSlice = "r." + std::to_string(x) + "." + std::to_string(z) + ".mca";
-    const std::filesystem::path file = std::filesystem::path(_folder) / "region" / regionSlice;
-
-    size_t fileSize = 0;
-    char *fileContents = loadFile(file, &fileSize);
-    if (!fileContents)
-        return;
-
-    const RegionHeader *header = (const RegionHeader *) fileContents;
-
-    for (uint16_t cx = 0; cx < maxXPerRegion; cx++) {
-        for (uint16_t cz = 0; cz < maxZPerRegion; cz++) {
-            const uint16_t currentOffset = cx + cz * maxXPerRegion;
-
-            if (header->locationTable[currentOffset].isEmpty())
-                continue;
-
-            const uint64_t chunkOffset = header->locationTable[currentOffset].getOffset() * regionChunkAlignment;
-
-            const ChunkHeader *cHeader = (const ChunkHeader *) (fileContents + chunkOffset);
-
-            // clang-format off
-            _userData ud = {
-                ((char *) cHeader) + sizeof(*cHeader),
-                ((char *) cHeader) + sizeof(*cHeader) + cHeader->getLength() - 1
-            };
-            // clang-format on
+    const std::filesystem::path file = _regionFile(_regionFolder(dim), x, z);
+    if (_format == StorageFormat::NATIVE)
+        _loadNativeRegion(dim, file, x, z);
+    else
+        _loadAnvilRegion(dim, file, x, z);
+}
 
-            // clang-format off
-            nbt_reader_t reader = {
-                _readMem,
-                &ud
-            };
-            // clang-format on
+void Persistence::_loadAnvilRegion(Dimension &dim, const std::filesystem::path &file, int x, int z)
+{
+    const auto onChunk = [&](uint16_t cx, uint16_t cz, std::span<const uint8_t> data) {
+        if (data.empty()) {
+            LERROR("Could not decompress chunk {} {} of region {} {}", cx, cz, x, z);
+            return;
+        }
+        try {
+            auto chunk = readAnvilChunk(nbt::TagView::root(data), Position2D(cx + x * maxXPerRegion, cz + z * maxZPerRegion));
+            if (chunk)
+                _loadChunk(dim, *chunk);
+        } catch (const std::exception &e) {
+            LERROR("Could not load chunk {} {} of region {} {}: {}", cx, cz, x, z, e.what());
+        }
+    };
 
-            auto *data = nbt_parse(reader, NBT_PARSE_FLAG_USE_ZLIB);
-            assert(data->type == NBT_TYPE_COMPOUND);
+    if (RegionFile::read(file, _chunkBuffer, onChunk))
+        LDEBUG("Loaded region {} {}", x, z);
+}
 
-            _regionLoadChunk(dim, cx, cz, x, z, data);
+void Persistence::_loadNativeRegion(Dimension &dim, const std::filesystem::path &file, int x, int z)
+{
+    const auto onChunk = [&](uint16_t cx, uint16_t cz, std::span<const uint8_t> data) {
+        if (data.empty()) {
+            LERROR("Could not decompress chunk {} {} of region {} {}", cx, cz, x, z);
+            return;
+        }
+        try {
+            auto chunk = decodeNativeChunk(data);
+            if (chunk.chunkPos != Position2D(cx + x * maxXPerRegion, cz + z * maxZPerRegion))
+                throw std::runtime_error("Chunk stored at the wrong position");
+            _loadChunk(dim, chunk);
+        } catch (const std::exception &e) {
+            LERROR("Could not load chunk {} {} of region {} {}: {}", cx, cz, x, z, e.what());
         }
+    };
+
+    try {
+        if (NativeRegionFile::read(file, _chunkBuffer, onChunk))
+            LDEBUG("Loaded region {} {}", x, z);
+    } catch (const std::exception &e) {
+        LERROR("Could not load region {} {}: {}", x, z, e.what());
     }
-    free(fileContents);
-    LDEBUG("Loaded region {} {}", x, z);
 }
 
-void Persistence::_regionLoadChunk(Dimension &dim, uint16_t cx, uint16_t cz, int x, int z, nbt_tag_t *data)
+void Persistence::_loadChunk(Dimension &dim, ChunkData &data)
 {
-    auto status = nbt_tag_compound_get(data, "Status");
-    assert(status);
-    if (status->tag_string.size != sizeof("full") - 1 || strcmp(status->tag_string.value, "full"))
-        return; // TODO(huntears): Handle non complete chunk later somehow
-
-    // Fill a chunk
-    const auto chunkX = cx + x * 32;
-    const auto chunkZ = cz + z * 32;
-
-    auto &chunk = dim.getLevel().addChunkColumn(Position2D(chunkX, chunkZ), dim.shared_from_this());
+    const auto &globalPalette = Server::getInstance()->getGlobalPalette();
 
-    // Section
-    auto *sections = nbt_tag_compound_get(data, "sections");
-    assert(sections);
-    assert(sections->type == NBT_TYPE_LIST);
-    for (size_t currentSection = 0; currentSection < sections->tag_list.size; currentSection++) {
-        auto *section = nbt_tag_list_get(sections, currentSection);
-        assert(section->type == NBT_TYPE_COMPOUND);
+    // Decoded before the column is added, a corrupt chunk is then generated again instead of being half loaded
+    std::vector<std::pair<int, Section>> sections;
+    sections.reserve(data.sections.size());
+    for (auto &sectionData : data.sections) {
+        const int sectionY = sectionData.y + 5;
+        if (sectionY < 0 || sectionY >= NB_OF_SECTIONS)
+            throw std::runtime_error("Section " + std::to_string(sectionData.y) + " is out of the world");
+        auto &section = sections.emplace_back(sectionY, Section()).second;
+
+        if (!sectionData.palette.empty()) {
+            BlockPalette &palette = section.getBlockPalette();
+            palette.clear();
+            for (const auto &state : sectionData.palette)
+                palette.add(globalPalette.fromBlockToProtocolId(state));
+
+            // A single value palette has no blocks, see Section
+            if (!sectionData.blocks.empty() && palette.getBits() != 0) {
+                auto &blocks = section.getBlocks();
+                blocks.setValueSize(palette.getBits());
+                if (sectionData.blocks.size() != blocks.data().size())
+                    throw std::runtime_error("Section " + std::to_string(sectionData.y) + " has " + std::to_string(sectionData.blocks.size()) + " block entries instead of " + std::to_string(blocks.data().size()));
+                blocks.data() = std::move(sectionData.blocks);
+            }
+        }
 
-        _regionLoadSection(chunk, section);
+        if (!sectionData.blockLight.empty()) {
+            section.getBlockLights().setValueSize(4);
+            if (sectionData.blockLight.size() != section.getBlockLights().data().size())
+                throw std::runtime_error("Section " + std::to_string(sectionData.y) + " has an invalid block light array");
+            section.getBlockLights().data() = std::move(sectionData.blockLight);
+            section.recalculateBlockLightCount();
+        } else
+            section.recalculateBlockLight();
+
+        if (!sectionData.skyLight.empty()) {
+            section.getSkyLights().setValueSize(4);
+            if (sectionData.skyLight.size() != section.getSkyLights().data().size())
+                throw std::runtime_error("Section " + std::to_string(sectionData.y) + " has an invalid sky light array");
+            section.getSkyLights().data() = std::move(sectionData.skyLight);
+            section.recalculateSkyLightCount();
+        } else
+            section.recalculateSkyLight();
     }
 
-    _regionLoadHeightmaps(chunk, data);
+    auto chunk = dim.getLevel().addChunkColumn(data.chunkPos, dim.shared_from_this());
+    for (const auto &[sectionY, section] : sections)
+        chunk->getSection(sectionY) = section;
+    chunk->_compactSections();
+    chunk->_heightMaps = data.heightMaps;
+    chunk->_currentState = GenerationState::READY;
+    chunk->setDirty(false);
+}
 
-    chunk._currentState = GenerationState::READY;
+bool Persistence::isChunkLoaded(Dimension &dim, int x, int z)
+{
+    const int rx = transformChunkPosToRegionPos(x);
+    const int rz = transformChunkPosToRegionPos(z);
+
+    this->loadRegion(dim, rx, rz);
+    if (std::find(_regionStore.begin(), _regionStore.end(), Position2D(rx, rz)) == _regionStore.end())
+        return false;
 
-    nbt_free_tag(data);
+    if (dim.hasChunkLoaded(x, z))
+        return true;
+    return this->_reloadChunk(dim, {x, z});
 }
 
-void Persistence::_regionLoadSection(ChunkColumn &chunk, nbt_tag_t *section)
+bool Persistence::unloadChunk(Dimension &dim, const Position2D &pos)
 {
-    auto *sectionYnbt = nbt_tag_compound_get(section, "Y");
-    assert(sectionYnbt);
-    assert(sectionYnbt->type == NBT_TYPE_BYTE);
-    const uint8_t sectionY = sectionYnbt->tag_byte.value + 5;
+    // Held until the chunk is marked as unloaded, a load of the chunk in between would generate it again
+    std::lock_guard _(_accessMutex);
+    if (!dim.unloadChunk(pos))
+        return false;
 
-    _regionLoadBlocks(sectionY, section, chunk);
-    _regionLoadLights(sectionY, section, chunk);
+    const int rx = transformChunkPosToRegionPos(pos.x);
+    const int rz = transformChunkPosToRegionPos(pos.z);
+    _unloadedChunks[_regionFile(_regionFolder(dim), rx, rz).string()].set((pos.x - rx * maxXPerRegion) + (pos.z - rz * maxZPerRegion) * maxXPerRegion);
+    return true;
 }
 
-void Persistence::_regionLoadBlocks(uint8_t sectionY, nbt_tag_t *section, ChunkColumn &chunk)
+bool Persistence::_reloadChunk(Dimension &dim, const Position2D &pos)
 {
-    auto *blockStates = nbt_tag_compound_get(section, "block_states");
-    if (!blockStates)
-        return;
-    assert(blockStates->type == NBT_TYPE_COMPOUND);
-
-    BlockPalette &paletteMapping = chunk.getSection(sectionY).getBlockPalette();
-    paletteMapping.clear();
-    _regionLoadPalette(paletteMapping, blockStates);
+    std::lock_guard _(_accessMutex);
+    const int rx = transformChunkPosToRegionPos(pos.x);
+    const int rz = transformChunkPosToRegionPos(pos.z);
+    const uint16_t x = pos.x - rx * maxXPerRegion;
+    const uint16_t z = pos.z - rz * maxZPerRegion;
+    const std::filesystem::path file = _regionFile(_regionFolder(dim), rx, rz);
+
+    auto unloaded = _unloadedChunks.find(file.string());
+    if (unloaded == _unloadedChunks.end() || !unloaded->second.test(x + z * maxXPerRegion))
+        return dim.hasChunkLoaded(pos.x, pos.z); // Never saved, or loaded again while we were waiting
+    unloaded->second.reset(x + z * maxXPerRegion);
+
+    try {
+        std::span<const uint8_t> data;
+        {
+            std::lock_guard lock(_regionFilesMutex);
+            if (_format == StorageFormat::NATIVE)
+                data = _nativeRegion(file).readChunk(x, z, _chunkBuffer);
+            else
+                data = _anvilRegion(file).readChunk(x, z, _chunkBuffer);
+        }
+        if (data.empty())
+            throw std::runtime_error("The chunk is missing or cannot be decompressed");
+
+        if (_format == StorageFormat::NATIVE) {
+            auto chunk = decodeNativeChunk(data);
+            if (chunk.chunkPos != pos)
+                throw std::runtime_error("Chunk stored at the wrong position");
+            _loadChunk(dim, chunk);
+        } else {
+            auto chunk = readAnvilChunk(nbt::TagView::root(data), pos);
+            if (chunk)
+                _loadChunk(dim, *chunk);
+        }
+    } catch (const std::exception &e) {
+        LERROR("Could not load chunk {} {} again, it will be generated: {}", pos.x, pos.z, e.what());
+    }
+    return dim.hasChunkLoaded(pos.x, pos.z);
+}
 
-    auto *dataArray = nbt_tag_compound_get(blockStates, "data");
-    if (!dataArray)
-        return; // TODO(huntears): Handle single value palettes properly
+std::filesystem::path Persistence::_regionFolder(const Dimension &dim) const
+{
+    switch (dim.getDimensionType()) {
+    case DimensionType::NETHER:
+        return std::filesystem::path(_folder) / "DIM-1" / "region";
+    case DimensionType::END:
+        return std::filesystem::path(_folder) / "DIM1" / "region";
+    default:
+        return std::filesystem::path(_folder) / "region";
+    }
+}
 
-    assert(dataArray->type == NBT_TYPE_LONG_ARRAY);
+std::filesystem::path Persistence::_regionFile(const std::filesystem::path &regionFolder, int x, int z) const
+{
+    const char *extension = _format == StorageFormat::NATIVE ? nativeRegionExtension : ".mca";
+    return regionFolder / ("r." + std::to_string(x) + "." + std::to_string(z) + extension);
+}
 
-    chunk.getSection(sectionY).getBlocks().setValueSize(paletteMapping.getBits());
-    chunk.getSection(sectionY).getBlocks().data().clear();
+/**
+ * @brief Approximate size of the storages of a chunk, used to bound the memory held by the region writer
+ */
+static size_t chunkSize(const ChunkSnapshot &chunk)
+{
+    size_t size = sizeof(chunk);
+    for (const auto &section : chunk.sections) {
+        size += section.getBlocks().data().size() * sizeof(uint64_t) + section.getBlockPalette().size() * sizeof(int32_t);
+        size += section.getBlockLights().data().size() + section.getSkyLights().data().size();
+    }
+    return size;
+}
 
-    // clang-format off
-    chunk.getSection(sectionY).getBlocks().data().insert(
-        chunk.getSection(sectionY).getBlocks().begin(),
-        dataArray->tag_long_array.value,
-        dataArray->tag_long_array.value + dataArray->tag_long_array.size
-    );
-    // clang-format on
+size_t Persistence::saveDirtyChunks(
+    Dimension &dim, std::chrono::steady_clock::time_point modifiedBefore, std::chrono::steady_clock::time_point deadline, size_t maxPendingBytes
+)
+{
+    const std::filesystem::path regionFolder = _regionFolder(dim);
+    size_t queued = 0;
+
+    while (_pendingChunkBytes < maxPendingBytes && std::chrono::steady_clock::now() < deadline) {
+        auto chunk = dim.takeDirtyChunk(modifiedBefore);
+        if (!chunk)
+            break;
+        this->_queueChunk(dim, regionFolder, std::move(*chunk));
+        queued++;
+    }
+    return queued;
 }
 
-void Persistence::_regionLoadLights(uint8_t sectionY, nbt_tag_t *section, ChunkColumn &chunk)
-{
-    auto *blockLights = nbt_tag_compound_get(section, "BlockLight");
-    if (blockLights) {
-        assert(blockLights->type == NBT_TYPE_BYTE_ARRAY);
-
-        chunk.getSection(sectionY).getBlockLights().setValueSize(4);
-        chunk.getSection(sectionY).getBlockLights().data().clear();
-        // clang-format off
-        chunk.getSection(sectionY).getBlockLights().data().insert(
-            chunk.getSection(sectionY).getBlockLights().begin(),
-            blockLights->tag_byte_array.value,
-            blockLights->tag_byte_array.value + blockLights->tag_byte_array.size
-        );
-        // clang-format on
-        chunk.getSection(sectionY).recalculateBlockLightCount();
-    } else
-        chunk.getSection(sectionY).recalculateBlockLight();
-
-    auto *skyLights = nbt_tag_compound_get(section, "SkyLight");
-    if (skyLights) {
-        assert(skyLights->type == NBT_TYPE_BYTE_ARRAY);
-
-        chunk.getSection(sectionY).getSkyLights().setValueSize(4);
-        chunk.getSection(sectionY).getSkyLights().data().clear();
-        // clang-format off
-        chunk.getSection(sectionY).getSkyLights().data().insert(
-            chunk.getSection(sectionY).getSkyLights().begin(),
-            skyLights->tag_byte_array.value,
-            skyLights->tag_byte_array.value + skyLights->tag_byte_array.size
-        );
-        // clang-format on
-        chunk.getSection(sectionY).recalculateSkyLightCount();
-    } else
-        chunk.getSection(sectionY).recalculateSkyLight();
-}
-
-void Persistence::_regionLoadPalette(BlockPalette &paletteMapping, nbt_tag_t *blockStates)
+size_t Persistence::saveChunks(Dimension &dim, std::span<const Position2D> chunks)
 {
-    const auto &globalPalette = Server::getInstance()->getGlobalPalette();
+    const std::filesystem::path regionFolder = _regionFolder(dim);
+    size_t queued = 0;
+
+    for (const auto &pos : chunks) {
+        auto chunk = dim.snapshotChunk(pos);
+        if (!chunk)
+            continue;
+        this->_queueChunk(dim, regionFolder, std::move(*chunk));
+        queued++;
+    }
+    return queued;
+}
 
-    auto *palette = nbt_tag_compound_get(blockStates, "palette");
-    assert(palette);
-    assert(palette->type == NBT_TYPE_LIST);
-
-    for (size_t ii = 0; ii < palette->tag_list.size; ii++) {
-        auto *pal = nbt_tag_list_get(palette, ii);
-        assert(pal->type == NBT_TYPE_COMPOUND);
-
-        auto *name = nbt_tag_compound_get(pal, "Name");
-        assert(name);
-        assert(name->type == NBT_TYPE_STRING);
-
-        Blocks::Block __tmpBlock(std::string(name->tag_string.value, name->tag_string.size), {});
-
-        auto *properties = nbt_tag_compound_get(pal, "Properties");
-        if (properties) {
-            assert(properties->type == NBT_TYPE_COMPOUND);
-            for (size_t iii = 0; iii < properties->tag_compound.size; iii++) {
-                auto *prop = nbt_tag_compound_getidx(properties, iii);
-                assert(prop->type == NBT_TYPE_STRING);
-                // clang-format off
-                __tmpBlock.properties.push_back({
-                    std::string(prop->name, prop->name_size),
-                    std::string(prop->tag_string.value, prop->tag_string.size)
-                });
-                // clang-format on
-            }
+void Persistence::flushChunks() { _regionWritePool.waitUntilJobsDone(); }
+
+void Persistence::_queueChunk(Dimension &dim, const std::filesystem::path &regionFolder, ChunkSnapshot &&chunk)
+{
+    // Jobs must be copyable, the snapshot is shared instead
+    auto snapshot = std::make_shared<const ChunkSnapshot>(std::move(chunk));
+    auto dimension = dim.shared_from_this();
+    const size_t size = chunkSize(*snapshot);
+    _pendingChunkBytes += size;
+    _regionWritePool.addJob([this, dimension, regionFolder, snapshot, size] {
+        bool saved = true;
+        try {
+            this->_writeChunk(regionFolder, *snapshot);
+        } catch (const std::exception &e) {
+            LERROR("Could not save chunk {} {}: {}", snapshot->chunkPos.x, snapshot->chunkPos.z, e.what());
+            saved = false;
         }
+        dimension->onChunkSaved(snapshot->chunkPos, saved);
+        _pendingChunkBytes -= size;
+    });
+}
 
-        paletteMapping.add(globalPalette.fromBlockToProtocolId(__tmpBlock));
+void Persistence::_writeChunk(const std::filesystem::path &regionFolder, const ChunkSnapshot &chunk)
+{
+    const int rx = transformChunkPosToRegionPos(chunk.chunkPos.x);
+    const int rz = transformChunkPosToRegionPos(chunk.chunkPos.z);
+    const uint16_t x = chunk.chunkPos.x - rx * maxXPerRegion;
+    const uint16_t z = chunk.chunkPos.z - rz * maxZPerRegion;
+    const std::filesystem::path file = _regionFile(regionFolder, rx, rz);
+    const ChunkData data = _toChunkData(chunk);
+
+    if (_format == StorageFormat::NATIVE) {
+        encodeNativeChunk(data, _writeBuffer);
+        std::lock_guard _(_regionFilesMutex);
+        _nativeRegion(file).write(x, z, _writeBuffer);
+        return;
     }
+
+    writeAnvilChunk(data, _writeBuffer);
+    if (!deflateData(_writeBuffer, _compressedBuffer, MAX_WBITS))
+        throw std::runtime_error("Could not compress the chunk");
+    std::lock_guard _(_regionFilesMutex);
+    _anvilRegion(file).write(x, z, chunkCompressionZlib, _compressedBuffer);
 }
 
-void Persistence::_regionLoadHeightmaps(ChunkColumn &chunk, nbt_tag_t *data)
+RegionFile &Persistence::_anvilRegion(const std::filesystem::path &file)
 {
-    auto *heightmaps = nbt_tag_compound_get(data, "Heightmaps");
-    assert(heightmaps);
-    assert(heightmaps->type == NBT_TYPE_COMPOUND);
-
-    auto motionBlocking = std::make_shared<nbt::LongArray>("MOTION_BLOCKING");
-    auto *_motionBlocking = nbt_tag_compound_get(heightmaps, "MOTION_BLOCKING");
-    assert(_motionBlocking);
-    assert(_motionBlocking->type == NBT_TYPE_LONG_ARRAY);
-    for (size_t h = 0; h < _motionBlocking->tag_long_array.size; h++)
-        motionBlocking->getValues().push_back(_motionBlocking->tag_long_array.value[h]);
-    chunk._heightMap.addValue(motionBlocking);
+    auto region = _regionFiles.find(file.string());
+    if (region == _regionFiles.end())
+        region = _regionFiles.emplace(file.string(), std::make_unique<RegionFile>(file)).first;
+    return *region->second;
+}
 
-    auto worldSurface = std::make_shared<nbt::LongArray>("WORLD_SURFACE");
-    auto *_worldSurface = nbt_tag_compound_get(heightmaps, "WORLD_SURFACE");
-    assert(_worldSurface);
-    assert(_worldSurface->type == NBT_TYPE_LONG_ARRAY);
-    for (size_t h = 0; h < _worldSurface->tag_long_array.size; h++)
-        worldSurface->getValues().push_back(_worldSurface->tag_long_array.value[h]);
-    chunk._heightMap.addValue(worldSurface);
+NativeRegionFile &Persistence::_nativeRegion(const std::filesystem::path &file)
+{
+    auto region = _nativeRegionFiles.find(file.string());
+    if (region == _nativeRegionFiles.end())
+        region = _nativeRegionFiles.emplace(file.string(), std::make_unique<NativeRegionFile>(file)).first;
+    return *region->second;
 }
 
-bool Persistence::isChunkLoaded(Dimension &dim, int x, int z)
+/**
+ * @brief Block state string of a block, e.g. minecraft:grass_block[snowy=false]
+ */
+static std::string blockState(const Blocks::Block &block)
 {
-    const int rx = transformChunkPosToRegionPos(x);
-    const int rz = transformChunkPosToRegionPos(z);
+    std::string state = block.name;
+    char separator = '[';
+    for (const auto &[name, value] : block.properties) {
+        state += separator;
+        state += name;
+        state += '=';
+        state += value;
+        separator = ',';
+    }
+    if (separator == ',')
+        state += ']';
+    return state;
+}
 
-    this->loadRegion(dim, rx, rz);
-    if (std::find(_regionStore.begin(), _regionStore.end(), Position2D(rx, rz)) == _regionStore.end())
-        return false;
+ChunkData Persistence::_toChunkData(const ChunkSnapshot &chunk) const
+{
+    const auto &globalPalette = Server::getInstance()->getGlobalPalette();
 
-    auto cx = x % 32;
-    auto cz = z % 32;
-    if (cx < 0)
-        cx += 32;
-    if (cz < 0)
-        cz += 32;
-    return dim.hasChunkLoaded(x, z);
+    ChunkData data {chunk.chunkPos, std::vector<SectionData>(chunk.sections.size()), chunk.heightMaps};
+    for (size_t idx = 0; idx < chunk.sections.size(); idx++) {
+        const auto &section = chunk.sections[idx];
+        auto &dst = data.sections[idx];
+        // The first section is below the world, like the one loaded with Y = -5
+        dst.y = (int8_t) idx - 5;
+
+        if (idx >= 1 && idx <= NB_OF_PLAYABLE_SECTIONS) {
+            dst.palette.reserve(section.getBlockPalette().size());
+            for (const auto id : section.getBlockPalette())
+                dst.palette.push_back(blockState(globalPalette.fromProtocolIdToBlock(id)));
+            if (section.getBlockPalette().getBits() != 0)
+                dst.blocks = section.getBlocks().data();
+        }
+        dst.blockLight = section.getBlockLights().data();
+        dst.skyLight = section.getSkyLights().data();
+    }
+    return data;
 }
 }
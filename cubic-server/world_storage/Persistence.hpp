@@ -2,9 +2,16 @@
 #define D3EBB5BA_3F3F_4BBD_A2B5_05FD6729E432
 
 #include <arpa/inet.h>
+#include <atomic>
+#include <bitset>
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -13,46 +20,18 @@
 
 #include "LevelData.hpp"
 #include "Player.hpp"
+#include "nbt_reader.hpp"
+#include "thread_pool/ThreadPool.hpp"
 #include "types.hpp"
 #include "world_storage/ChunkColumn.hpp"
+#include "world_storage/ChunkData.hpp"
+#include "world_storage/NativeRegionFile.hpp"
 #include "world_storage/Palette.hpp"
 #include "world_storage/PlayerData.hpp"
+#include "world_storage/RegionFile.hpp"
 
 namespace world_storage {
 
-struct RegionLocation {
-    uint32_t data;
-
-    inline uint32_t getOffset() const { return ((data & 0x00FF0000) >> 16) | (data & 0x0000FF00) | ((data & 0x000000FF) << 16); }
-
-    inline uint8_t getSize() const { return data >> 24; }
-
-    inline bool isEmpty() const { return data == 0; }
-};
-
-struct RegionTimestamp {
-    uint32_t data;
-};
-
-constexpr uint32_t maxXPerRegion = 32;
-constexpr uint32_t maxZPerRegion = 32;
-constexpr uint32_t numChunksPerRegion = maxXPerRegion * maxZPerRegion;
-constexpr uint64_t regionChunkAlignment = 0x1000;
-
-struct __attribute__((__packed__)) RegionHeader {
-    RegionLocation locationTable[numChunksPerRegion];
-    RegionLocation timestampTable[numChunksPerRegion];
-};
-
-struct __attribute__((__packed__)) ChunkHeader {
-    uint32_t length;
-    uint8_t compressionScheme;
-
-    inline uint32_t getLength() const { return ntohl(length); }
-
-    inline uint8_t getCompressionScheme() const { return compressionScheme; }
-};
-
 /**
  * @brief Helper class to provide level persistence (Loading/Saving)
  *
@@ -65,6 +44,12 @@ private:
      */
     std::string _folder;
 
+    /**
+     * @brief Format of the regions, both to load and to save them
+     *
+     */
+    StorageFormat _format;
+
     /**
      * @brief Global lock for any persistence actions
      *
@@ -77,13 +62,67 @@ private:
      */
     std::vector<Position2D> _regionStore;
 
+    /**
+     * @brief Decompressed data of the chunk being loaded, reused for every chunk
+     *
+     */
+    std::vector<uint8_t> _chunkBuffer;
+
+    /**
+     * @brief Chunks removed from memory once saved, by region file, loaded one at a time when they are needed again
+     *
+     */
+    std::unordered_map<std::string, std::bitset<numChunksPerRegion>> _unloadedChunks;
+
+    /**
+     * @brief Region files opened by the region writer, also read by the loads of the unloaded chunks
+     *
+     */
+    std::mutex _regionFilesMutex;
+    std::unordered_map<std::string, std::unique_ptr<RegionFile>> _regionFiles;
+    std::unordered_map<std::string, std::unique_ptr<NativeRegionFile>> _nativeRegionFiles;
+
+    /**
+     * @brief Encoded and compressed chunk being written, reused for every chunk
+     *
+     */
+    std::vector<uint8_t> _writeBuffer;
+    std::vector<uint8_t> _compressedBuffer;
+
+    /**
+     * @brief Approximate size of the chunks waiting for the region writer
+     *
+     */
+    std::atomic<size_t> _pendingChunkBytes;
+
+    /**
+     * @brief Reads and writes the player data files, in the order they were queued
+     *
+     * A single worker is enough and keeps a save queued on disconnect ahead of the load of the next login.
+     * It does not take _accessMutex, a region being loaded never delays a login.
+     */
+    thread_pool::ThreadPool _playerDataPool;
+
+    /**
+     * @brief Writes the modified chunks to their region, a single worker owns the region files
+     *
+     */
+    thread_pool::ThreadPool _regionWritePool;
+
 public:
     /**
      * @brief Construct a new Persistence object
      *
      * @param folder Points to the folder containing the world
+     * @param format Format of the regions of the world
      */
-    Persistence(const std::string &folder);
+    Persistence(const std::string &folder, StorageFormat format = StorageFormat::ANVIL);
+
+    /**
+     * @brief Waits for the queued chunks and player data to be written
+     *
+     */
+    ~Persistence();
 
     /**
      * @brief Loads the level.dat from disk
@@ -148,6 +187,42 @@ public:
      */
     PlayerData loadPlayerData(const Player &player);
 
+    /**
+     * @brief Loads player data from disk on the player data worker
+     *
+     * @param uuid Player to load data from
+     * @return The loaded player data, std::nullopt if the player never joined this world or its file is corrupted
+     */
+    std::future<std::optional<PlayerData>> loadPlayerDataAsync(u128 uuid);
+
+    /**
+     * @brief Saves player data to disk
+     *
+     * The file is written next to the previous one then renamed over it,
+     * a crash in the middle of a save never leaves a truncated file.
+     * The tags of the previous file that are not part of PlayerData are kept.
+     *
+     * @throw std::runtime_error if the previous file cannot be read, it is then left untouched
+     *
+     * @param uuid Player to save data of
+     * @param data The data to write
+     */
+    void savePlayerData(u128 uuid, const PlayerData &data);
+
+    /**
+     * @brief Saves player data to disk on the player data worker
+     *
+     * @param uuid Player to save data of
+     * @param data The data to write
+     */
+    void savePlayerDataAsync(u128 uuid, PlayerData data);
+
+    /**
+     * @brief Waits for every queued player data load and save
+     *
+     */
+    void flushPlayerData();
+
     /**
      * @brief Loads a region from disk
      *
@@ -171,13 +246,59 @@ public:
      */
     bool isChunkLoaded(Dimension &dim, int x, int z);
 
+    /**
+     * @brief Queue the chunks of the dimension modified before a given time to the region writer, oldest first
+     *
+     * Only a snapshot of the chunks is taken by the caller, they are encoded, compressed and written by the region writer.
+     * Once the deadline is reached or maxPendingBytes are waiting to be written, the remaining chunks are left for the next call.
+     *
+     * @param dim The dimension to save
+     * @param modifiedBefore Chunks modified after this time are left for later
+     * @param deadline Time after which no more chunks are queued
+     * @param maxPendingBytes Approximate size of the chunks waiting to be written above which no more chunks are queued
+     * @return size_t The number of chunks queued
+     */
+    size_t saveDirtyChunks(
+        Dimension &dim, std::chrono::steady_clock::time_point modifiedBefore, std::chrono::steady_clock::time_point deadline, size_t maxPendingBytes
+    );
+
+    /**
+     * @brief Queue chunks of the dimension to the region writer, whether they were modified or not
+     *
+     * @param dim The dimension to save
+     * @param chunks The chunks to save, the ones that are not loaded are skipped
+     * @return size_t The number of chunks queued
+     */
+    size_t saveChunks(Dimension &dim, std::span<const Position2D> chunks);
+
+    /**
+     * @brief Waits for every queued chunk to be written
+     *
+     */
+    void flushChunks();
+
+    /**
+     * @brief Remove a saved chunk from memory, it is loaded from its region again the next time it is needed
+     *
+     * @param dim The dimension of the chunk
+     * @param pos The position of the chunk
+     * @return false if the chunk is kept in memory, see Dimension::unloadChunk
+     */
+    bool unloadChunk(Dimension &dim, const Position2D &pos);
+
 private:
-    void _regionLoadHeightmaps(ChunkColumn &chunk, nbt_tag_t *data);
-    void _regionLoadPalette(BlockPalette &paletteMapping, nbt_tag_t *blockStates);
-    void _regionLoadSection(ChunkColumn &chunk, nbt_tag_t *section);
-    void _regionLoadChunk(Dimension &dim, uint16_t cx, uint16_t cz, int x, int z, nbt_tag_t *data);
-    void _regionLoadLights(uint8_t sectionY, nbt_tag_t *section, ChunkColumn &chunk);
-    void _regionLoadBlocks(uint8_t sectionY, nbt_tag_t *section, ChunkColumn &chunk);
+    std::filesystem::path _playerDataFile(u128 uuid) const;
+    std::filesystem::path _regionFolder(const Dimension &dim) const;
+    std::filesystem::path _regionFile(const std::filesystem::path &regionFolder, int x, int z) const;
+    void _queueChunk(Dimension &dim, const std::filesystem::path &regionFolder, ChunkSnapshot &&chunk);
+    void _writeChunk(const std::filesystem::path &regionFolder, const ChunkSnapshot &chunk);
+    RegionFile &_anvilRegion(const std::filesystem::path &file);
+    NativeRegionFile &_nativeRegion(const std::filesystem::path &file);
+    bool _reloadChunk(Dimension &dim, const Position2D &pos);
+    NODISCARD ChunkData _toChunkData(const ChunkSnapshot &chunk) const;
+    void _loadAnvilRegion(Dimension &dim, const std::filesystem::path &file, int x, int z);
+    void _loadNativeRegion(Dimension &dim, const std::filesystem::path &file, int x, int z);
+    void _loadChunk(Dimension &dim, ChunkData &data);
 };
 
 }
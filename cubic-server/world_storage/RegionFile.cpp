@@ -0,0 +1,195 @@
+#include "RegionFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "world_storage/Compression.hpp"
+
+namespace world_storage {
+
+// Sectors used by the header, and the most sectors a chunk can use
+constexpr uint32_t headerSectors = sizeof(RegionHeader) / regionChunkAlignment;
+constexpr uint32_t maxChunkSectors = 0xFF;
+
+RegionFile::RegionFile(const std::filesystem::path &path):
+    _path(path),
+    _fd(-1),
+    _header {}
+{
+    std::filesystem::create_directories(path.parent_path());
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd == -1)
+        throw std::runtime_error("Could not open " + path.string() + ": " + strerror(errno));
+
+    struct stat stat_buf;
+    if (fstat(_fd, &stat_buf) == -1 || stat_buf.st_size < (off_t) sizeof(_header) || pread(_fd, &_header, sizeof(_header), 0) != sizeof(_header)) {
+        // New or truncated region, every chunk it had is lost anyway
+        _header = {};
+        _pwrite(&_header, sizeof(_header), 0);
+        stat_buf.st_size = sizeof(_header);
+    }
+
+    _usedSectors.resize((stat_buf.st_size + regionChunkAlignment - 1) / regionChunkAlignment, false);
+    _setSectors(0, headerSectors, true);
+    for (uint32_t index = 0; index < numChunksPerRegion; index++) {
+        const RegionLocation location = _header.locationTable[index];
+        if (!location.isEmpty())
+            _setSectors(location.getOffset(), location.getSize(), true);
+    }
+}
+
+RegionFile::~RegionFile()
+{
+    if (_fd != -1)
+        ::close(_fd);
+}
+
+void RegionFile::write(uint16_t x, uint16_t z, uint8_t compressionScheme, std::span<const uint8_t> data)
+{
+    const uint32_t index = x + z * maxXPerRegion;
+    // The length includes the compression scheme
+    const ChunkHeader chunkHeader = {htonl(static_cast<uint32_t>(data.size() + 1)), compressionScheme};
+    const uint32_t count = (sizeof(chunkHeader) + data.size() + regionChunkAlignment - 1) / regionChunkAlignment;
+    if (count > maxChunkSectors)
+        throw std::runtime_error("Chunk " + std::to_string(x) + " " + std::to_string(z) + " of " + _path.string() + " is too big (" + std::to_string(data.size()) + " bytes)");
+
+    const uint32_t offset = this->_allocate(count);
+    std::vector<uint8_t> sectors(count * regionChunkAlignment, 0);
+    std::memcpy(sectors.data(), &chunkHeader, sizeof(chunkHeader));
+    std::memcpy(sectors.data() + sizeof(chunkHeader), data.data(), data.size());
+    _pwrite(sectors.data(), sectors.size(), offset * regionChunkAlignment);
+
+    const RegionLocation previous = _header.locationTable[index];
+    _header.locationTable[index].set(offset, count);
+    _header.timestampTable[index].data = htonl(static_cast<uint32_t>(std::time(nullptr)));
+    _pwrite(&_header.locationTable[index], sizeof(RegionLocation), index * sizeof(RegionLocation));
+    _pwrite(&_header.timestampTable[index], sizeof(RegionLocation), sizeof(_header.locationTable) + index * sizeof(RegionLocation));
+
+    if (!previous.isEmpty())
+        _setSectors(previous.getOffset(), previous.getSize(), false);
+}
+
+std::span<const uint8_t> RegionFile::readChunk(uint16_t x, uint16_t z, std::vector<uint8_t> &buffer)
+{
+    const RegionLocation location = _header.locationTable[x + z * maxXPerRegion];
+    if (location.isEmpty())
+        return {};
+
+    _sectors.resize(location.getSize() * regionChunkAlignment);
+    this->_pread(_sectors.data(), _sectors.size(), location.getOffset() * regionChunkAlignment);
+    ChunkHeader chunkHeader;
+    std::memcpy(&chunkHeader, _sectors.data(), sizeof(chunkHeader));
+    // The length includes the compression scheme
+    const size_t compressedSize = std::min<size_t>(std::max<uint32_t>(chunkHeader.getLength(), 1) - 1, _sectors.size() - sizeof(chunkHeader));
+    const std::span<const uint8_t> compressed(_sectors.data() + sizeof(chunkHeader), compressedSize);
+
+    if (chunkHeader.getCompressionScheme() == chunkCompressionNone) {
+        buffer.assign(compressed.begin(), compressed.end());
+        return buffer;
+    }
+    return inflateData(compressed, buffer);
+}
+
+bool RegionFile::read(
+    const std::filesystem::path &path, std::vector<uint8_t> &buffer, const std::function<void(uint16_t x, uint16_t z, std::span<const uint8_t> data)> &onChunk
+)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+        return false;
+    std::vector<uint8_t> file(stream.tellg());
+    stream.seekg(0);
+    if (!stream.read(reinterpret_cast<char *>(file.data()), file.size()) || file.size() < sizeof(RegionHeader))
+        return false;
+
+    const auto *header = reinterpret_cast<const RegionHeader *>(file.data());
+    for (uint16_t cx = 0; cx < maxXPerRegion; cx++) {
+        for (uint16_t cz = 0; cz < maxZPerRegion; cz++) {
+            const RegionLocation location = header->locationTable[cx + cz * maxXPerRegion];
+            if (location.isEmpty())
+                continue;
+
+            const uint64_t chunkOffset = location.getOffset() * regionChunkAlignment;
+            if (chunkOffset + sizeof(ChunkHeader) > file.size()) {
+                onChunk(cx, cz, {});
+                continue;
+            }
+
+            ChunkHeader chunkHeader;
+            std::memcpy(&chunkHeader, file.data() + chunkOffset, sizeof(chunkHeader));
+            const uint8_t *compressed = file.data() + chunkOffset + sizeof(chunkHeader);
+            // The length includes the compression scheme
+            const size_t compressedSize = std::min<size_t>(std::max<uint32_t>(chunkHeader.getLength(), 1) - 1, file.size() - chunkOffset - sizeof(chunkHeader));
+
+            if (chunkHeader.getCompressionScheme() == chunkCompressionNone)
+                onChunk(cx, cz, {compressed, compressedSize});
+            else
+                onChunk(cx, cz, inflateData({compressed, compressedSize}, buffer));
+        }
+    }
+    return true;
+}
+
+uint32_t RegionFile::_allocate(uint32_t count)
+{
+    uint32_t run = 0;
+    for (uint32_t sector = headerSectors; sector < _usedSectors.size(); sector++) {
+        run = _usedSectors[sector] ? 0 : run + 1;
+        if (run == count) {
+            _setSectors(sector + 1 - count, count, true);
+            return sector + 1 - count;
+        }
+    }
+    // The free sectors at the end of the file are extended
+    const uint32_t offset = _usedSectors.size() - run;
+    _setSectors(offset, count, true);
+    return offset;
+}
+
+void RegionFile::_setSectors(uint32_t offset, uint32_t count, bool used)
+{
+    if (_usedSectors.size() < offset + count)
+        _usedSectors.resize(offset + count, false);
+    std::fill_n(_usedSectors.begin() + offset, count, used);
+}
+
+void RegionFile::_pwrite(const void *data, size_t size, uint64_t offset)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t written = ::pwrite(_fd, bytes, size, offset);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Could not write " + _path.string() + ": " + strerror(errno));
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+}
+
+void RegionFile::_pread(void *data, size_t size, uint64_t offset)
+{
+    auto *bytes = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t got = ::pread(_fd, bytes, size, offset);
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            throw std::runtime_error("Could not read " + _path.string() + ": " + (got == 0 ? "unexpected end of file" : strerror(errno)));
+        bytes += got;
+        size -= got;
+        offset += got;
+    }
+}
+
+}
@@ -0,0 +1,120 @@
+#ifndef CUBICSERVER_WORLDSTORAGE_REGIONFILE_HPP
+#define CUBICSERVER_WORLDSTORAGE_REGIONFILE_HPP
+
+#include <arpa/inet.h>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace world_storage {
+
+struct RegionLocation {
+    uint32_t data;
+
+    inline uint32_t getOffset() const { return ((data & 0x00FF0000) >> 16) | (data & 0x0000FF00) | ((data & 0x000000FF) << 16); }
+
+    inline uint8_t getSize() const { return data >> 24; }
+
+    inline bool isEmpty() const { return data == 0; }
+
+    inline void set(uint32_t offset, uint8_t size) { data = ((offset & 0x00FF0000) >> 16) | (offset & 0x0000FF00) | ((offset & 0x000000FF) << 16) | (size << 24); }
+};
+
+struct RegionTimestamp {
+    uint32_t data;
+};
+
+constexpr uint32_t maxXPerRegion = 32;
+constexpr uint32_t maxZPerRegion = 32;
+constexpr uint32_t numChunksPerRegion = maxXPerRegion * maxZPerRegion;
+constexpr uint64_t regionChunkAlignment = 0x1000;
+constexpr uint8_t chunkCompressionZlib = 2;
+constexpr uint8_t chunkCompressionNone = 3;
+
+struct __attribute__((__packed__)) RegionHeader {
+    RegionLocation locationTable[numChunksPerRegion];
+    RegionLocation timestampTable[numChunksPerRegion];
+};
+
+struct __attribute__((__packed__)) ChunkHeader {
+    uint32_t length;
+    uint8_t compressionScheme;
+
+    inline uint32_t getLength() const { return ntohl(length); }
+
+    inline uint8_t getCompressionScheme() const { return compressionScheme; }
+};
+
+/**
+ * @brief Region file opened for writing, chunks are replaced one at a time
+ *
+ * Like the game, a chunk is written to free sectors before the header points to it,
+ * the previous version stays valid until the header is updated.
+ */
+class RegionFile {
+public:
+    /**
+     * @brief Open the region file, it is created if it does not exist
+     *
+     * @throw std::runtime_error if the file cannot be opened
+     */
+    explicit RegionFile(const std::filesystem::path &path);
+    ~RegionFile();
+    RegionFile(const RegionFile &) = delete;
+    RegionFile &operator=(const RegionFile &) = delete;
+
+    /**
+     * @brief Replace a chunk of the region
+     *
+     * @param x The X coordinate of the chunk in the region
+     * @param z The Z coordinate of the chunk in the region
+     * @param compressionScheme How data is compressed, see ChunkHeader
+     * @param data The compressed chunk
+     * @throw std::runtime_error if the chunk is too big or the file cannot be written
+     */
+    void write(uint16_t x, uint16_t z, uint8_t compressionScheme, std::span<const uint8_t> data);
+
+    /**
+     * @brief Read a chunk of the region
+     *
+     * @param x The X coordinate of the chunk in the region
+     * @param z The Z coordinate of the chunk in the region
+     * @param buffer Holds the decompressed chunk, kept to be reused by the next call
+     * @return The decompressed chunk, empty if it is not stored or cannot be decompressed
+     * @throw std::runtime_error if the file cannot be read
+     */
+    std::span<const uint8_t> readChunk(uint16_t x, uint16_t z, std::vector<uint8_t> &buffer);
+
+    /**
+     * @brief Read every chunk of a region file
+     *
+     * @param buffer Holds the decompressed chunks, kept to be reused by the next call
+     * @param onChunk Called with the coordinates of the chunk in the region and the decompressed chunk,
+     * which is empty if the chunk is out of the file or cannot be decompressed
+     * @return false if the file cannot be read
+     */
+    static bool read(
+        const std::filesystem::path &path, std::vector<uint8_t> &buffer, const std::function<void(uint16_t x, uint16_t z, std::span<const uint8_t> data)> &onChunk
+    );
+
+private:
+    /**
+     * @brief Find the first run of free sectors, at the end of the file if there is none
+     */
+    uint32_t _allocate(uint32_t count);
+    void _setSectors(uint32_t offset, uint32_t count, bool used);
+    void _pwrite(const void *data, size_t size, uint64_t offset);
+    void _pread(void *data, size_t size, uint64_t offset);
+
+    std::filesystem::path _path;
+    int _fd;
+    RegionHeader _header;
+    std::vector<bool> _usedSectors;
+    std::vector<uint8_t> _sectors; // Sectors of the chunk being read
+};
+
+}
+
+#endif // CUBICSERVER_WORLDSTORAGE_REGIONFILE_HPP
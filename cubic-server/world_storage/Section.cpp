@@ -1,14 +1,147 @@
 #include "Section.hpp"
 #include "logging/logging.hpp"
 #include "types.hpp"
+#include <algorithm>
 #include <cstdint>
+#include <mutex>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+// Storages shared by every section until it is modified, most sections never are
+static const std::shared_ptr<world_storage::Section::BlockStorage> &emptyBlocks()
+{
+    static const auto storage = std::make_shared<world_storage::Section::BlockStorage>(0);
+    return storage;
+}
+
+static const std::shared_ptr<world_storage::Section::BiomeStorage> &emptyBiomes()
+{
+    static const auto storage = std::make_shared<world_storage::Section::BiomeStorage>(0);
+    return storage;
+}
+
+static const std::shared_ptr<world_storage::BlockPalette> &airPalette()
+{
+    static const auto palette = std::make_shared<world_storage::BlockPalette>();
+    return palette;
+}
+
+static const std::shared_ptr<world_storage::BiomePalette> &defaultBiomePalette()
+{
+    static const auto palette = std::make_shared<world_storage::BiomePalette>();
+    return palette;
+}
+
+static const std::shared_ptr<world_storage::Section::LightStorage> &noLight()
+{
+    static const auto storage = std::make_shared<world_storage::Section::LightStorage>(4);
+    return storage;
+}
+
+static const std::shared_ptr<world_storage::Section::LightStorage> &fullLight()
+{
+    static const auto storage = [] {
+        auto light = std::make_shared<world_storage::Section::LightStorage>(4);
+        for (auto &x : light->data())
+            x = 0xFF;
+        return light;
+    }();
+    return storage;
+}
+
+/**
+ * @brief Pool of the storages shared by identical sections
+ *
+ * The pool keeps a reference on every storage it holds, so their use count never drops to 1 and they are never written in place.
+ * Storages only referenced by the pool are released when it doubles in size.
+ */
+template<typename T>
+class StorageInterner {
+public:
+    void intern(std::shared_ptr<T> &storage)
+    {
+        const size_t hash = contentHash(*storage);
+
+        std::lock_guard _(_mutex);
+        auto [it, end] = _storages.equal_range(hash);
+        for (; it != end; ++it) {
+            if (it->second == storage)
+                return;
+            if (sameContent(*it->second, *storage)) {
+                storage = it->second;
+                return;
+            }
+        }
+        _storages.emplace(hash, storage);
+
+        if (_storages.size() < _nextSweep)
+            return;
+        std::erase_if(_storages, [](const auto &entry) { return entry.second.use_count() == 1; });
+        _nextSweep = std::max<size_t>(minSweep, _storages.size() * 2);
+    }
+
+private:
+    template<typename Content>
+    static size_t contentHash(const Content &content)
+    {
+        const auto &data = content.data();
+        return std::hash<std::string_view> {}({reinterpret_cast<const char *>(data.data()), data.size() * sizeof(data[0])});
+    }
+
+    static bool sameContent(const world_storage::Palette &a, const world_storage::Palette &b) { return a.data() == b.data(); }
+
+    template<typename StoreType, uint64_t ArraySize>
+    static bool sameContent(const world_storage::DynamicStorage<StoreType, ArraySize> &a, const world_storage::DynamicStorage<StoreType, ArraySize> &b)
+    {
+        return a.getValueSize() == b.getValueSize() && a.data() == b.data();
+    }
+
+    static constexpr size_t minSweep = 1024;
+
+    std::mutex _mutex;
+    std::unordered_multimap<size_t, std::shared_ptr<T>> _storages;
+    size_t _nextSweep = minSweep;
+};
+
+template<typename T>
+static StorageInterner<T> &interner()
+{
+    static StorageInterner<T> instance;
+    return instance;
+}
+
+/**
+ * @brief Replace a storage holding a single value by a palette of that value and the empty storage, then intern both
+ */
+template<typename Storage, typename PaletteType>
+static void compactValues(std::shared_ptr<Storage> &storage, std::shared_ptr<PaletteType> &palette, const std::shared_ptr<Storage> &empty, uint64_t size)
+{
+    if (storage->canContainData()) {
+        const auto first = storage->get(0);
+        uint64_t idx = 1;
+        while (idx < size && storage->get(idx) == first)
+            idx++;
+        if (idx == size) {
+            auto uniform = std::make_shared<PaletteType>();
+            uniform->clear();
+            uniform->add(palette->getGlobalId(first));
+            palette = std::move(uniform);
+            storage = empty;
+        }
+    }
+    interner<PaletteType>().intern(palette);
+    if (storage->canContainData())
+        interner<Storage>().intern(storage);
+}
 
 world_storage::Section::Section() noexcept:
-    _blocks(0),
-    _biomes(0),
-    _skyLight(4),
-    _blockLight(4),
+    _blocks(emptyBlocks()),
+    _biomes(emptyBiomes()),
+    _blockPalette(airPalette()),
+    _biomePalette(defaultBiomePalette()),
+    _skyLight(noLight()),
+    _blockLight(noLight()),
     _skyLightCount(0),
     _blockLightCount(0)
 {
@@ -19,8 +152,8 @@ world_storage::Section::Section() noexcept:
 world_storage::Section::Section(world_storage::Section &&section) noexcept:
     _blocks(section._blocks),
     _biomes(section._biomes),
-    _blockPalette(std::move(section._blockPalette)),
-    _biomePalette(std::move(section._biomePalette)),
+    _blockPalette(section._blockPalette),
+    _biomePalette(section._biomePalette),
     _skyLight(section._skyLight),
     _blockLight(section._blockLight),
     _skyLightCount(section._skyLightCount),
@@ -42,15 +175,20 @@ void world_storage::Section::setBlock(const Position &pos, int32_t block)
         throw std::out_of_range("Position is out of range");
 
     auto idx = calculateSectionBlockIdx(pos);
+    // Writing the same block must not unshare the storages
+    if (this->getBlock(idx) == block)
+        return;
 
-    auto oldBits = this->_blockPalette.getBits();
-    // if (this->_blocks.canContainData())
-    //     this->_blockPalette.remove(this->_blocks.get(idx));
-    this->_blockPalette.add(block);
-    if (oldBits != this->_blockPalette.getBits() && this->_blockPalette.getBits() != 0)
-        this->_blocks.setValueSize(this->_blockPalette.getBits());
+    auto &palette = _detach(this->_blockPalette);
+    auto &blocks = _detach(this->_blocks);
+    auto oldBits = palette.getBits();
+    // if (blocks.canContainData())
+    //     palette.remove(blocks.get(idx));
+    palette.add(block);
+    if (oldBits != palette.getBits() && palette.getBits() != 0)
+        blocks.setValueSize(palette.getBits());
 
-    this->_blocks.set(idx, this->_blockPalette.getId(block));
+    blocks.set(idx, palette.getId(block));
     // LINFO("Indeed : " << pos << " " << block);
 }
 
@@ -67,14 +205,20 @@ void world_storage::Section::setBiome(const Position &pos, int32_t biome)
     if (pos >= BIOME_SECTION_WIDTH || pos < 0)
         throw std::out_of_range("Position is out of range");
 
-    auto oldBits = this->_biomePalette.getBits();
-    // if (this->_biomes.canContainData())
-    //     this->_biomePalette.remove(this->_biomes.get(calculateSectionBiomeIdx(pos)));
-    this->_biomePalette.add(biome);
-    if (oldBits != this->_biomePalette.getBits() && this->_biomePalette.getBits() != 0)
-        this->_biomes.setValueSize(this->_biomePalette.getBits());
+    auto idx = calculateSectionBiomeIdx(pos);
+    if (this->getBiome(idx) == biome)
+        return;
 
-    this->_biomes.set(calculateSectionBiomeIdx(pos), this->_biomePalette.getId(biome));
+    auto &palette = _detach(this->_biomePalette);
+    auto &biomes = _detach(this->_biomes);
+    auto oldBits = palette.getBits();
+    // if (biomes.canContainData())
+    //     palette.remove(biomes.get(idx));
+    palette.add(biome);
+    if (oldBits != palette.getBits() && palette.getBits() != 0)
+        biomes.setValueSize(palette.getBits());
+
+    biomes.set(idx, palette.getId(biome));
 }
 
 void world_storage::Section::updateSkyLight(const Position &pos, uint8_t light)
@@ -86,18 +230,20 @@ void world_storage::Section::updateSkyLight(const Position &pos, uint8_t light)
 void world_storage::Section::setSkyLight(const Position &pos, uint8_t light)
 {
     uint64_t idx = calculateSectionBlockIdx(pos);
-    uint8_t l = _skyLight.get(idx);
+    uint8_t l = _skyLight->get(idx);
+    if (l == light)
+        return;
     if (l != 0 && light == 0)
         _skyLightCount--;
     if (l == 0 && light != 0)
         _skyLightCount++;
-    _skyLight.set(idx, light);
+    _detach(_skyLight).set(idx, light);
 }
 
 void world_storage::Section::recalculateSkyLightCount()
 {
     _skyLightCount = 0;
-    for (auto i : _skyLight.data()) {
+    for (auto i : _skyLight->data()) {
         _skyLightCount += ((i & 0b11110000) >= 1) + ((i & 0b00001111) >= 1);
     }
 }
@@ -110,17 +256,20 @@ void world_storage::Section::updateBlockLight(const Position &pos, uint8_t light
 
 void world_storage::Section::setBlockLight(const Position &pos, uint8_t light)
 {
-    if (getBlockLight(pos) != 0 && light == 0)
+    uint8_t l = getBlockLight(pos);
+    if (l == light)
+        return;
+    if (l != 0 && light == 0)
         _blockLightCount--;
-    if (getBlockLight(pos) == 0 && light != 0)
+    if (l == 0 && light != 0)
         _blockLightCount++;
-    _blockLight.set(calculateSectionBlockIdx(pos), light);
+    _detach(_blockLight).set(calculateSectionBlockIdx(pos), light);
 }
 
 void world_storage::Section::recalculateBlockLightCount()
 {
     _blockLightCount = 0;
-    for (auto i : _blockLight.data()) {
+    for (auto i : _blockLight->data()) {
         _blockLightCount += ((i & 0b11110000) >= 1) + ((i & 0b00001111) >= 1);
     }
 }
@@ -131,10 +280,8 @@ void world_storage::Section::recalculateSkyLight()
     // So... I know how this looks, but hear me out, this function took 50% of
     // the time spent in region loading. So until we have a proper way to
     // calculate skyLights this will do :)
-    for (auto &x : _skyLight.data()) {
-        x = 0xFF;
-    }
-    recalculateSkyLightCount();
+    _skyLight = fullLight();
+    _skyLightCount = SECTION_3D_SIZE;
     return;
 
     // for (auto x = 0; x < SECTION_WIDTH; x++) {
@@ -150,52 +297,60 @@ void world_storage::Section::recalculateBlockLight()
     // TODO
 }
 
+void world_storage::Section::compact()
+{
+    compactValues(_blocks, _blockPalette, emptyBlocks(), SECTION_3D_SIZE);
+    compactValues(_biomes, _biomePalette, emptyBiomes(), BIOME_SECTION_3D_SIZE);
+    interner<LightStorage>().intern(_skyLight);
+    interner<LightStorage>().intern(_blockLight);
+}
+
 int32_t world_storage::Section::getBlock(const Position &pos) const
 {
     if (pos >= SECTION_WIDTH)
         throw std::out_of_range("Position is out of range");
-    if (!this->_blocks.canContainData())
-        return 0;
-    return this->_blockPalette.getGlobalId(this->_blocks.get(calculateSectionBlockIdx(pos)));
+    if (!this->_blocks->canContainData())
+        return this->_blockPalette->getGlobalId(0);
+    return this->_blockPalette->getGlobalId(this->_blocks->get(calculateSectionBlockIdx(pos)));
 }
 
 int32_t world_storage::Section::getBiome(const Position &pos) const
 {
     if (pos >= BIOME_SECTION_WIDTH)
         throw std::out_of_range("Position is out of range");
-    if (!this->_biomes.canContainData())
-        return 0;
-    return this->_biomePalette.getGlobalId(this->_biomes.get(calculateSectionBiomeIdx(pos)));
+    if (!this->_biomes->canContainData())
+        return this->_biomePalette->getGlobalId(0);
+    return this->_biomePalette->getGlobalId(this->_biomes->get(calculateSectionBiomeIdx(pos)));
 }
 
 int32_t world_storage::Section::getBlock(uint64_t idx) const
 {
-    if (!this->_blocks.canContainData())
-        return 0;
-    return this->_blockPalette.getGlobalId(this->_blocks.get(idx));
+    if (!this->_blocks->canContainData())
+        return this->_blockPalette->getGlobalId(0);
+    return this->_blockPalette->getGlobalId(this->_blocks->get(idx));
 }
 
 int32_t world_storage::Section::getBiome(uint64_t idx) const
 {
-    if (!this->_biomes.canContainData())
-        return 0;
-    return this->_biomePalette.getGlobalId(this->_biomes.get(idx));
+    if (!this->_biomes->canContainData())
+        return this->_biomePalette->getGlobalId(0);
+    return this->_biomePalette->getGlobalId(this->_biomes->get(idx));
 }
 
 uint8_t world_storage::Section::getSkyLight(const Position &pos) const
 {
     if (pos >= SECTION_WIDTH)
         throw std::out_of_range("Position is out of range");
-    return this->_skyLight.get(calculateSectionBlockIdx(pos));
+    return this->_skyLight->get(calculateSectionBlockIdx(pos));
 }
 
-uint8_t world_storage::Section::getSkyLight(uint64_t idx) const { return this->_skyLight.get(idx); }
+uint8_t world_storage::Section::getSkyLight(uint64_t idx) const { return this->_skyLight->get(idx); }
 
 uint8_t world_storage::Section::getBlockLight(const Position &pos) const
 {
     if (pos >= SECTION_WIDTH)
         throw std::out_of_range("Position is out of range");
-    return this->_blockLight.get(calculateSectionBlockIdx(pos));
+    return this->_blockLight->get(calculateSectionBlockIdx(pos));
 }
 
-uint8_t world_storage::Section::getBlockLight(uint64_t idx) const { return this->_blockLight.get(idx); }
+uint8_t world_storage::Section::getBlockLight(uint64_t idx) const { return this->_blockLight->get(idx); }
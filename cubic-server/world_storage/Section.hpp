@@ -2,7 +2,9 @@
 #define WORLD_STORAGE_SECTION_HPP
 
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
 
 #include "Palette.hpp"
 #include "types.hpp"
@@ -34,6 +36,14 @@ constexpr int BIOME_PER_CHUNK = BIOME_SECTION_3D_SIZE * NB_OF_PLAYABLE_SECTIONS;
 constexpr uint64_t calculateSectionBlockIdx(const Position &pos) { return pos.x + (pos.z * SECTION_WIDTH) + (pos.y * SECTION_2D_SIZE); }
 constexpr uint64_t calculateSectionBiomeIdx(const Position &pos) { return pos.x + (pos.z * BIOME_SECTION_WIDTH) + (pos.y * BIOME_SECTION_2D_SIZE); }
 
+/**
+ * @brief A 16x16x16 part of a chunk column
+ *
+ * Storages and palettes are shared between copies and with the empty defaults, they are copied on the first write.
+ * Non-const accessors unshare the storage they return.
+ * A section whose blocks or biomes all have the same value holds it as a single entry palette and no array.
+ * Copying a section must not race with writes to it, Dimension takes the same lock to snapshot a chunk and to update its blocks.
+ */
 class Section {
 public:
     typedef DynamicStorage<uint64_t, SECTION_3D_SIZE> BlockStorage;
@@ -42,7 +52,9 @@ public:
 
 public:
     Section() noexcept;
+    Section(const Section &section) = default;
     Section(Section &&section) noexcept;
+    Section &operator=(const Section &section) = default;
 
     void updateBlock(const Position &pos, int32_t block);
     void setBlock(const Position &pos, int32_t block);
@@ -70,44 +82,61 @@ public:
     [[nodiscard]] uint8_t getBlockLight(uint64_t idx) const;
     [[nodiscard]] uint8_t getSkyLight(uint64_t idx) const;
 
-    [[nodiscard]] inline constexpr bool hasBlocks() const { return _blockPalette.getBits() != 0; }
-    [[nodiscard]] inline constexpr bool hasBiomes() const { return _biomePalette.getBits() != 0; }
+    [[nodiscard]] inline bool hasBlocks() const { return _blockPalette->getBits() != 0; }
+    [[nodiscard]] inline bool hasBiomes() const { return _biomePalette->getBits() != 0; }
 
-    [[nodiscard]] inline BlockStorage &getBlocks() { return _blocks; }
-    [[nodiscard]] inline BiomeStorage &getBiomes() { return _biomes; }
+    [[nodiscard]] inline BlockStorage &getBlocks() { return _detach(_blocks); }
+    [[nodiscard]] inline BiomeStorage &getBiomes() { return _detach(_biomes); }
 
-    [[nodiscard]] inline const BlockStorage &getBlocks() const { return _blocks; }
-    [[nodiscard]] inline const BiomeStorage &getBiomes() const { return _biomes; }
+    [[nodiscard]] inline const BlockStorage &getBlocks() const { return *_blocks; }
+    [[nodiscard]] inline const BiomeStorage &getBiomes() const { return *_biomes; }
 
-    [[nodiscard]] inline BlockPalette &getBlockPalette() { return _blockPalette; }
-    [[nodiscard]] inline BiomePalette &getBiomePalette() { return _biomePalette; }
+    [[nodiscard]] inline BlockPalette &getBlockPalette() { return _detach(_blockPalette); }
+    [[nodiscard]] inline BiomePalette &getBiomePalette() { return _detach(_biomePalette); }
 
-    [[nodiscard]] inline const BlockPalette &getBlockPalette() const { return _blockPalette; }
-    [[nodiscard]] inline const BiomePalette &getBiomePalette() const { return _biomePalette; }
+    [[nodiscard]] inline const BlockPalette &getBlockPalette() const { return *_blockPalette; }
+    [[nodiscard]] inline const BiomePalette &getBiomePalette() const { return *_biomePalette; }
 
     [[nodiscard]] inline bool hasSkyLight() const { return _skyLightCount > 0; }
     [[nodiscard]] inline bool hasBlockLight() const { return _blockLightCount > 0; }
 
-    [[nodiscard]] inline LightStorage &getBlockLights() { return _blockLight; }
-    [[nodiscard]] inline LightStorage &getSkyLights() { return _skyLight; }
+    [[nodiscard]] inline LightStorage &getBlockLights() { return _detach(_blockLight); }
+    [[nodiscard]] inline LightStorage &getSkyLights() { return _detach(_skyLight); }
 
-    [[nodiscard]] inline const LightStorage &getBlockLights() const { return _blockLight; }
-    [[nodiscard]] inline const LightStorage &getSkyLights() const { return _skyLight; }
+    [[nodiscard]] inline const LightStorage &getBlockLights() const { return *_blockLight; }
+    [[nodiscard]] inline const LightStorage &getSkyLights() const { return *_skyLight; }
 
     void recalculateSkyLight();
     void recalculateBlockLight();
 
+    /**
+     * @brief Drop the arrays of the single value blocks and biomes, and share the storages with the identical ones of other sections
+     * Called once a chunk is generated or loaded, the shared storages are copied on the next write
+     */
+    void compact();
+
 private:
     void _reCalculatePalette();
 
+    template<typename T>
+    static T &_detach(std::shared_ptr<T> &storage)
+    {
+        if (storage.use_count() > 1)
+            storage = std::make_shared<T>(*storage);
+        else
+            // The count is read relaxed, the reads of the last copy released on another thread must happen before the write
+            std::atomic_thread_fence(std::memory_order_acquire);
+        return *storage;
+    }
+
 private:
-    BlockStorage _blocks;
-    BiomeStorage _biomes;
-    BlockPalette _blockPalette;
-    BiomePalette _biomePalette;
+    std::shared_ptr<BlockStorage> _blocks;
+    std::shared_ptr<BiomeStorage> _biomes;
+    std::shared_ptr<BlockPalette> _blockPalette;
+    std::shared_ptr<BiomePalette> _biomePalette;
 
-    LightStorage _skyLight;
-    LightStorage _blockLight;
+    std::shared_ptr<LightStorage> _skyLight;
+    std::shared_ptr<LightStorage> _blockLight;
     uint64_t _skyLightCount;
     uint64_t _blockLightCount;
 };
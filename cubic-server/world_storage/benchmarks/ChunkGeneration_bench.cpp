@@ -0,0 +1,68 @@
+#include "Chat.hpp"
+#include "Dimension.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "WorldGroup.hpp"
+#include "world_storage/ChunkColumn.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+// Every allocation goes through here so the benchmarks can report allocations per chunk
+static thread_local uint64_t allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    allocations++;
+    if (auto ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, UNUSED std::size_t size) noexcept { std::free(ptr); }
+
+namespace ChunkGeneration {
+
+static std::shared_ptr<Dimension> getDimension(world_storage::WorldType worldType)
+{
+    static std::mutex mutex;
+    static auto worldGroup = std::make_shared<WorldGroup>(std::make_shared<Chat>());
+    static std::unordered_map<world_storage::WorldType, std::shared_ptr<Dimension>> dimensions;
+
+    std::lock_guard _(mutex);
+    if (!dimensions.contains(worldType)) {
+        auto world = std::make_shared<World>(worldGroup, worldType, "bench-world");
+        dimensions.emplace(worldType, std::make_shared<Dimension>(world, world_storage::DimensionType::OVERWORLD));
+    }
+    return dimensions.at(worldType);
+}
+
+static void generate(benchmark::State &state, world_storage::WorldType worldType)
+{
+    auto dimension = getDimension(worldType);
+
+    // Each thread generates its own row of chunks so they never share a position
+    int32_t x = 0;
+    int32_t z = state.thread_index();
+    uint64_t allocationsBefore = allocations;
+
+    for (auto _ : state) {
+        world_storage::ChunkColumn chunk({x++, z}, dimension);
+        chunk.generate(world_storage::GenerationState::READY);
+        benchmark::DoNotOptimize(chunk);
+    }
+
+    state.counters["chunks/s"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["allocs/chunk"] = benchmark::Counter(allocations - allocationsBefore, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_CAPTURE(generate, Default, world_storage::WorldType::DEFAULT)->Unit(benchmark::kMillisecond)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_CAPTURE(generate, Superflat, world_storage::WorldType::SUPERFLAT)->Unit(benchmark::kMicrosecond)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_CAPTURE(generate, Debug, world_storage::WorldType::DEBUG)->Unit(benchmark::kMicrosecond)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_CAPTURE(generate, SuperflatCubicServer, world_storage::WorldType::SUPERFLAT_CUBIC_SERVER)->Unit(benchmark::kMicrosecond)->ThreadRange(1, 8)->UseRealTime();
+
+} // namespace ChunkGeneration
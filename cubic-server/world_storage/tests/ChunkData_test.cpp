@@ -0,0 +1,95 @@
+#include "nbt_reader.hpp"
+#include "world_storage/ChunkData.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+namespace ChunkData {
+
+static world_storage::ChunkData makeChunk(Position2D pos, uint64_t seed)
+{
+    world_storage::ChunkData chunk {pos, {}, {}};
+    for (int i = 0; i < world_storage::NB_OF_SECTIONS; i++) {
+        auto &section = chunk.sections.emplace_back();
+        section.y = i - 5;
+        section.skyLight.assign(world_storage::SECTION_3D_SIZE / 2, 0xFF);
+        if (i == 0 || i == world_storage::NB_OF_SECTIONS - 1)
+            continue;
+        if (i % 3 == 0) {
+            section.palette = {"minecraft:air"};
+            continue;
+        }
+        section.palette = {"minecraft:air", "minecraft:stone", "minecraft:redstone_wire[east=up,north=side,power=0,south=up,west=none]"};
+        // 4 bits per block, 16 blocks per long
+        section.blocks.resize(world_storage::SECTION_3D_SIZE / 16);
+        for (auto &entry : section.blocks)
+            entry = seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        section.blockLight.resize(world_storage::SECTION_3D_SIZE / 2);
+        for (auto &entry : section.blockLight)
+            entry = static_cast<uint8_t>(seed >>= 1);
+    }
+    for (auto &heightMap : chunk.heightMaps) {
+        for (auto &entry : heightMap)
+            entry = static_cast<int64_t>(seed = seed * 6364136223846793005ULL + 1442695040888963407ULL);
+    }
+    return chunk;
+}
+
+static void expectSameChunk(const world_storage::ChunkData &actual, const world_storage::ChunkData &expected)
+{
+    EXPECT_EQ(actual.chunkPos, expected.chunkPos);
+    EXPECT_EQ(actual.heightMaps, expected.heightMaps);
+    ASSERT_EQ(actual.sections.size(), expected.sections.size());
+    for (size_t i = 0; i < expected.sections.size(); i++) {
+        EXPECT_EQ(actual.sections[i].y, expected.sections[i].y);
+        EXPECT_EQ(actual.sections[i].palette, expected.sections[i].palette);
+        EXPECT_EQ(actual.sections[i].blocks, expected.sections[i].blocks);
+        EXPECT_EQ(actual.sections[i].blockLight, expected.sections[i].blockLight);
+        EXPECT_EQ(actual.sections[i].skyLight, expected.sections[i].skyLight);
+    }
+}
+
+TEST(ChunkData, AnvilRoundTrip)
+{
+    const auto chunk = makeChunk({-33, 65}, 42);
+    std::vector<uint8_t> data;
+    world_storage::writeAnvilChunk(chunk, data);
+
+    auto read = world_storage::readAnvilChunk(nbt::TagView::root(data), chunk.chunkPos);
+    ASSERT_TRUE(read.has_value());
+    expectSameChunk(*read, chunk);
+}
+
+TEST(ChunkData, AnvilBlockStatesLength)
+{
+    auto chunk = makeChunk({0, 0}, 42);
+    std::vector<uint8_t> data;
+
+    // A section read with a shorter array would be read out of bounds
+    chunk.sections[1].blocks.pop_back();
+    world_storage::writeAnvilChunk(chunk, data);
+    EXPECT_THROW((void) world_storage::readAnvilChunk(nbt::TagView::root(data), chunk.chunkPos), std::runtime_error);
+
+    // 17 states take 5 bits, 12 blocks per long
+    chunk.sections[1].palette.resize(17, "minecraft:stone");
+    chunk.sections[1].blocks.assign(world_storage::SECTION_3D_SIZE / 16, 0);
+    world_storage::writeAnvilChunk(chunk, data);
+    EXPECT_THROW((void) world_storage::readAnvilChunk(nbt::TagView::root(data), chunk.chunkPos), std::runtime_error);
+
+    chunk.sections[1].blocks.assign((world_storage::SECTION_3D_SIZE + 11) / 12, 0);
+    world_storage::writeAnvilChunk(chunk, data);
+    EXPECT_NO_THROW((void) world_storage::readAnvilChunk(nbt::TagView::root(data), chunk.chunkPos));
+}
+
+TEST(ChunkData, NativeRoundTrip)
+{
+    const auto chunk = makeChunk({-33, 65}, 42);
+    std::vector<uint8_t> data;
+    world_storage::encodeNativeChunk(chunk, data);
+
+    expectSameChunk(world_storage::decodeNativeChunk(data), chunk);
+    EXPECT_THROW((void) world_storage::decodeNativeChunk(std::span<const uint8_t>(data).first(data.size() - 1)), std::runtime_error);
+}
+
+} // namespace ChunkData
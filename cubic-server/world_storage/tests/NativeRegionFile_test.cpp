@@ -0,0 +1,159 @@
+#include "world_storage/NativeRegionFile.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <string_view>
+#include <vector>
+
+namespace NativeRegionFile {
+
+class NativeRegionFileTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        _path = std::filesystem::temp_directory_path() / "cubic_native_region_file_test" / "r.0.0.cbr";
+        std::filesystem::remove_all(_path.parent_path());
+    }
+
+    void TearDown() override { std::filesystem::remove_all(_path.parent_path()); }
+
+    // Random bytes, so that the chunks do not shrink once compressed
+    static std::vector<uint8_t> chunk(size_t size, uint64_t seed)
+    {
+        std::vector<uint8_t> data(size);
+        for (auto &byte : data) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            byte = static_cast<uint8_t>(seed >> 56);
+        }
+        return data;
+    }
+
+    static std::vector<uint8_t> read(world_storage::NativeRegionFile &region, uint16_t x, uint16_t z)
+    {
+        std::vector<uint8_t> buffer;
+        auto data = region.readChunk(x, z, buffer);
+        return {data.begin(), data.end()};
+    }
+
+    std::map<uint16_t, std::vector<uint8_t>> readAll() const
+    {
+        std::map<uint16_t, std::vector<uint8_t>> chunks;
+        std::vector<uint8_t> buffer;
+        world_storage::NativeRegionFile::read(_path, buffer, [&](uint16_t x, uint16_t z, std::span<const uint8_t> data) {
+            chunks[x + z * world_storage::maxXPerRegion].assign(data.begin(), data.end());
+        });
+        return chunks;
+    }
+
+    void append(std::string_view bytes) const { std::ofstream(_path, std::ios::binary | std::ios::app) << bytes; }
+
+    std::filesystem::path _path;
+};
+
+TEST_F(NativeRegionFileTest, RoundTrip)
+{
+    const auto first = chunk(1000, 1);
+    const auto second = chunk(2000, 2);
+    {
+        world_storage::NativeRegionFile region(_path);
+        region.write(0, 0, first);
+        region.write(31, 31, second);
+        region.write(0, 0, second);
+        EXPECT_EQ(read(region, 0, 0), second);
+        EXPECT_TRUE(read(region, 1, 0).empty());
+    }
+
+    world_storage::NativeRegionFile region(_path);
+    EXPECT_EQ(read(region, 0, 0), second);
+    EXPECT_EQ(read(region, 31, 31), second);
+
+    auto chunks = readAll();
+    EXPECT_EQ(chunks.size(), 2);
+    EXPECT_EQ(chunks[0], second);
+    EXPECT_EQ(chunks[world_storage::numChunksPerRegion - 1], second);
+}
+
+TEST_F(NativeRegionFileTest, RejectsChecksumMismatch)
+{
+    const auto kept = chunk(1000, 1);
+    uint64_t validSize;
+    {
+        world_storage::NativeRegionFile region(_path);
+        region.write(0, 0, kept);
+        validSize = std::filesystem::file_size(_path);
+        region.write(1, 0, chunk(1000, 2));
+    }
+
+    // Flip the last byte of the second chunk
+    {
+        std::fstream file(_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(-1, std::ios::end);
+        const char last = static_cast<char>(file.get() ^ 0xFF);
+        file.seekp(-1, std::ios::end);
+        file.put(last);
+    }
+    auto chunks = readAll();
+    EXPECT_EQ(chunks.size(), 1);
+    EXPECT_EQ(chunks[0], kept);
+
+    world_storage::NativeRegionFile region(_path);
+    EXPECT_EQ(std::filesystem::file_size(_path), validSize);
+    EXPECT_EQ(read(region, 0, 0), kept);
+    EXPECT_TRUE(read(region, 1, 0).empty());
+}
+
+TEST_F(NativeRegionFileTest, TruncatesTornTail)
+{
+    const auto first = chunk(1000, 1);
+    const auto second = chunk(1000, 2);
+    {
+        world_storage::NativeRegionFile region(_path);
+        region.write(0, 0, first);
+    }
+    const uint64_t validSize = std::filesystem::file_size(_path);
+    // The beginning of a header, as left by a crash in the middle of an append
+    append(std::string_view("CBCK\x01\x00\x01", 7));
+
+    {
+        world_storage::NativeRegionFile region(_path);
+        EXPECT_EQ(std::filesystem::file_size(_path), validSize);
+        region.write(1, 0, second);
+        EXPECT_EQ(read(region, 1, 0), second);
+    }
+
+    world_storage::NativeRegionFile region(_path);
+    EXPECT_EQ(read(region, 0, 0), first);
+    EXPECT_EQ(read(region, 1, 0), second);
+    EXPECT_EQ(readAll().size(), 2);
+}
+
+TEST_F(NativeRegionFileTest, CompactionKeepsNewestCopy)
+{
+    const auto other = chunk(1000, 1);
+    std::vector<uint8_t> newest;
+    world_storage::NativeRegionFile region(_path);
+    region.write(1, 0, other);
+    // Compacted once the stale copies take over 1 MiB and half of the file
+    for (uint64_t round = 0; round < 5; round++) {
+        newest = chunk(300 * 1024, round + 2);
+        region.write(0, 0, newest);
+    }
+
+    EXPECT_LT(std::filesystem::file_size(_path), 2 * newest.size());
+    EXPECT_FALSE(std::filesystem::exists(_path.string() + ".tmp"));
+    EXPECT_EQ(read(region, 0, 0), newest);
+    EXPECT_EQ(read(region, 1, 0), other);
+
+    // Appends after the compaction go to the compacted file
+    const auto appended = chunk(1000, 10);
+    region.write(2, 0, appended);
+    auto chunks = readAll();
+    EXPECT_EQ(chunks.size(), 3);
+    EXPECT_EQ(chunks[0], newest);
+    EXPECT_EQ(chunks[1], other);
+    EXPECT_EQ(chunks[2], appended);
+}
+
+} // namespace NativeRegionFile
@@ -0,0 +1,114 @@
+#include "world_storage/RegionFile.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+namespace RegionFile {
+
+class RegionFileTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        _path = std::filesystem::temp_directory_path() / "cubic_region_file_test" / "r.0.0.mca";
+        std::filesystem::remove_all(_path.parent_path());
+    }
+
+    void TearDown() override { std::filesystem::remove_all(_path.parent_path()); }
+
+    static std::vector<uint8_t> chunk(size_t size, uint8_t seed)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; i++)
+            data[i] = static_cast<uint8_t>(seed + i * 7);
+        return data;
+    }
+
+    uint64_t sectors() const { return std::filesystem::file_size(_path) / world_storage::regionChunkAlignment; }
+
+    std::filesystem::path _path;
+};
+
+TEST_F(RegionFileTest, RoundTrip)
+{
+    const auto first = chunk(100, 1);
+    const auto second = chunk(3 * world_storage::regionChunkAlignment, 2);
+    {
+        world_storage::RegionFile region(_path);
+        region.write(0, 0, world_storage::chunkCompressionNone, first);
+        region.write(31, 31, world_storage::chunkCompressionNone, second);
+    }
+
+    world_storage::RegionFile region(_path);
+    std::vector<uint8_t> buffer;
+    auto data = region.readChunk(0, 0, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), first);
+    data = region.readChunk(31, 31, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), second);
+    EXPECT_TRUE(region.readChunk(1, 0, buffer).empty());
+
+    std::map<std::pair<uint16_t, uint16_t>, std::vector<uint8_t>> chunks;
+    EXPECT_TRUE(world_storage::RegionFile::read(_path, buffer, [&](uint16_t x, uint16_t z, std::span<const uint8_t> chunkData) {
+        chunks[{x, z}].assign(chunkData.begin(), chunkData.end());
+    }));
+    EXPECT_EQ(chunks.size(), 2);
+    EXPECT_EQ(chunks[std::make_pair(0, 0)], first);
+    EXPECT_EQ(chunks[std::make_pair(31, 31)], second);
+}
+
+TEST_F(RegionFileTest, ReusesFreedSectors)
+{
+    world_storage::RegionFile region(_path);
+    // 2 sectors of header, then one sector per chunk
+    region.write(0, 0, world_storage::chunkCompressionNone, chunk(100, 1));
+    region.write(1, 0, world_storage::chunkCompressionNone, chunk(100, 2));
+    EXPECT_EQ(sectors(), 4);
+
+    // The new version is written before the old one is released
+    const auto replaced = chunk(200, 3);
+    region.write(0, 0, world_storage::chunkCompressionNone, replaced);
+    EXPECT_EQ(sectors(), 5);
+
+    // The sector of the first version is free again
+    const auto reused = chunk(300, 4);
+    region.write(2, 0, world_storage::chunkCompressionNone, reused);
+    EXPECT_EQ(sectors(), 5);
+
+    std::vector<uint8_t> buffer;
+    auto data = region.readChunk(0, 0, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), replaced);
+    data = region.readChunk(2, 0, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), reused);
+
+    // The used sectors are found again when the file is reopened
+    world_storage::RegionFile reopened(_path);
+    reopened.write(0, 0, world_storage::chunkCompressionNone, chunk(100, 5));
+    EXPECT_EQ(sectors(), 6);
+    reopened.write(3, 0, world_storage::chunkCompressionNone, chunk(100, 6));
+    EXPECT_EQ(sectors(), 6);
+    data = reopened.readChunk(2, 0, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), reused);
+}
+
+TEST_F(RegionFileTest, RejectsChunksAbove255Sectors)
+{
+    world_storage::RegionFile region(_path);
+    const auto kept = chunk(100, 1);
+    region.write(0, 0, world_storage::chunkCompressionNone, kept);
+
+    // The chunk header takes 5 bytes of the first sector
+    const auto largest = chunk(255 * world_storage::regionChunkAlignment - 5, 2);
+    EXPECT_NO_THROW(region.write(1, 0, world_storage::chunkCompressionNone, largest));
+    const auto size = sectors();
+    EXPECT_THROW(region.write(0, 0, world_storage::chunkCompressionNone, chunk(255 * world_storage::regionChunkAlignment - 4, 3)), std::runtime_error);
+    EXPECT_EQ(sectors(), size);
+
+    std::vector<uint8_t> buffer;
+    auto data = region.readChunk(0, 0, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), kept);
+    data = region.readChunk(1, 0, buffer);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), largest);
+}
+
+} // namespace RegionFile
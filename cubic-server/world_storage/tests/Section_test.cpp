@@ -0,0 +1,127 @@
+#include "types.hpp"
+#include "world_storage/Section.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <utility>
+
+namespace {
+
+constexpr int32_t STONE = 1;
+constexpr int32_t DIRT = 10;
+constexpr int32_t GRASS = 9;
+
+Position positionOf(uint64_t idx)
+{
+    return {
+        static_cast<Position::valueType>(idx % world_storage::SECTION_WIDTH),
+        static_cast<Position::valueType>(idx / world_storage::SECTION_2D_SIZE),
+        static_cast<Position::valueType>(idx / world_storage::SECTION_WIDTH % world_storage::SECTION_WIDTH),
+    };
+}
+
+void fill(world_storage::Section &section, int32_t block)
+{
+    for (uint64_t i = 0; i < world_storage::SECTION_3D_SIZE; i++)
+        section.setBlock(positionOf(i), block);
+}
+
+} // namespace
+
+TEST(Section, DetachOnWrite)
+{
+    world_storage::Section original;
+    original.setBlock({1, 2, 3}, STONE);
+
+    world_storage::Section copy = original;
+    EXPECT_EQ(&std::as_const(copy).getBlocks(), &std::as_const(original).getBlocks());
+    EXPECT_EQ(&std::as_const(copy).getBlockPalette(), &std::as_const(original).getBlockPalette());
+
+    copy.setBlock({1, 2, 3}, DIRT);
+    copy.setBlock({4, 5, 6}, GRASS);
+
+    EXPECT_NE(&std::as_const(copy).getBlocks(), &std::as_const(original).getBlocks());
+    EXPECT_NE(&std::as_const(copy).getBlockPalette(), &std::as_const(original).getBlockPalette());
+    EXPECT_EQ(original.getBlock({1, 2, 3}), STONE);
+    EXPECT_EQ(original.getBlock({4, 5, 6}), 0);
+    EXPECT_EQ(std::as_const(original).getBlockPalette().size(), 2);
+    EXPECT_EQ(copy.getBlock({1, 2, 3}), DIRT);
+    EXPECT_EQ(copy.getBlock({4, 5, 6}), GRASS);
+}
+
+TEST(Section, SameBlockKeepsSharing)
+{
+    world_storage::Section original;
+    original.setBlock({0, 0, 0}, STONE);
+
+    world_storage::Section copy = original;
+    copy.setBlock({0, 0, 0}, STONE);
+
+    EXPECT_EQ(&std::as_const(copy).getBlocks(), &std::as_const(original).getBlocks());
+}
+
+TEST(Section, InternedSingleValueSectionTurnsIntoPalette)
+{
+    world_storage::Section first;
+    world_storage::Section second;
+    fill(first, STONE);
+    fill(second, STONE);
+    first.compact();
+    second.compact();
+
+    EXPECT_FALSE(first.hasBlocks());
+    EXPECT_EQ(std::as_const(first).getBlockPalette().size(), 1);
+    EXPECT_EQ(first.getBlock({7, 7, 7}), STONE);
+    // Identical sections share the same palette once compacted
+    EXPECT_EQ(&std::as_const(first).getBlockPalette(), &std::as_const(second).getBlockPalette());
+
+    first.setBlock({7, 7, 7}, DIRT);
+
+    EXPECT_TRUE(first.hasBlocks());
+    EXPECT_EQ(std::as_const(first).getBlockPalette().size(), 2);
+    for (uint64_t i = 0; i < world_storage::SECTION_3D_SIZE; i++) {
+        const auto pos = positionOf(i);
+        const Position changed {7, 7, 7};
+        EXPECT_EQ(first.getBlock(pos), pos == changed ? DIRT : STONE);
+        EXPECT_EQ(second.getBlock(pos), STONE);
+    }
+    EXPECT_FALSE(second.hasBlocks());
+    EXPECT_EQ(std::as_const(second).getBlockPalette().size(), 1);
+}
+
+TEST(Section, CompactShrinksPalette)
+{
+    world_storage::Section section;
+    section.setBlock({0, 0, 0}, STONE);
+    section.setBlock({1, 0, 0}, GRASS);
+    fill(section, DIRT);
+    EXPECT_EQ(std::as_const(section).getBlockPalette().size(), 4);
+
+    section.compact();
+
+    EXPECT_FALSE(section.hasBlocks());
+    EXPECT_EQ(std::as_const(section).getBlockPalette().size(), 1);
+    for (uint64_t i = 0; i < world_storage::SECTION_3D_SIZE; i++)
+        EXPECT_EQ(section.getBlock(i), DIRT);
+}
+
+TEST(Section, CompactKeepsBlocks)
+{
+    world_storage::Section section;
+    for (uint64_t i = 0; i < world_storage::SECTION_3D_SIZE; i++)
+        section.setBlock(positionOf(i), static_cast<int32_t>(i % 20));
+    world_storage::Section other = section;
+    other.setBlock({0, 0, 0}, STONE);
+    other.setBlock({0, 0, 0}, 0);
+
+    section.compact();
+    other.compact();
+
+    EXPECT_TRUE(section.hasBlocks());
+    EXPECT_EQ(std::as_const(section).getBlockPalette().size(), 20);
+    // The detached copy has the same content and is interned with the original storage
+    EXPECT_EQ(&std::as_const(section).getBlocks(), &std::as_const(other).getBlocks());
+    for (uint64_t i = 0; i < world_storage::SECTION_3D_SIZE; i++) {
+        EXPECT_EQ(section.getBlock(i), static_cast<int32_t>(i % 20));
+        EXPECT_EQ(section.getBlock(positionOf(i)), static_cast<int32_t>(i % 20));
+    }
+}
@@ -0,0 +1,60 @@
+import json
+import argparse
+import os
+
+# get the name of the constant of an item (for example "minecraft:oak_log" -> "OakLog")
+def item_constant(name):
+    return name.split(":")[1].title().replace("_", "")
+
+# load the items from the registries json file, sorted by protocol id
+def load_json(filename):
+    with open(filename) as f:
+        data = json.load(f)
+
+    items = data["minecraft:item"]["entries"]
+    return sorted(((item, items[item]["protocol_id"]) for item in items), key=lambda item: item[1])
+
+def create_items_hpp_file(path, items):
+    with open(path + "/items.hpp", "w") as f:
+        f.write("#ifndef CUBICSERVER_GENERATED_ITEMS_HPP\n")
+        f.write("#define CUBICSERVER_GENERATED_ITEMS_HPP\n\n")
+        f.write("#include <array>\n")
+        f.write("#include <cstdint>\n")
+        f.write("#include <string_view>\n\n")
+        f.write("namespace Items {\n")
+        f.write("typedef int32_t ItemId;\n\n")
+        f.write("namespace Vanilla {\n")
+        for name, protocol_id in items:
+            f.write("constexpr ItemId " + item_constant(name) + " = " + str(protocol_id) + ";\n")
+        f.write("\n")
+        # the ids are dense, so the names are indexed by protocol id
+        f.write("inline constexpr std::array<std::string_view, " + str(len(items)) + "> NAMES = {\n")
+        for name, protocol_id in items:
+            f.write("    \"" + name + "\",\n")
+        f.write("};\n")
+        f.write("}\n")
+        f.write("}\n\n")
+        f.write("#endif // CUBICSERVER_GENERATED_ITEMS_HPP\n")
+
+# get different option you can pass to the script
+def parse_args(options):
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-i", "--input", help="input file", default=options["input"])
+    parser.add_argument("-o", "--output", help="output directory", default=options["output"])
+    args = parser.parse_args()
+    options["input"] = args.input
+    options["output"] = args.output
+    return options
+
+def main():
+    options = {"input": "registries.json", "output": "generated/"}
+    options = parse_args(options)
+    items = load_json(options["input"])
+    for index, (name, protocol_id) in enumerate(items):
+        if index != protocol_id:
+            raise ValueError("Item protocol ids are not dense ({}: {})".format(name, protocol_id))
+    os.makedirs(os.path.dirname(options["output"]), exist_ok=True)
+    create_items_hpp_file(os.path.dirname(options["output"]), items)
+
+if __name__ == "__main__":
+    main()